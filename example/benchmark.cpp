@@ -0,0 +1,409 @@
+/*****************************************************************************
+ * Performance benchmark for Moby: runs a fixed suite of example and
+ * synthetic scenes, reports stepping rates, per-phase times, and peak memory,
+ * and compares the stepping rates and peak memory against stored baselines;
+ * when comparing, a scene without a baseline is reported but does not fail
+ *****************************************************************************/
+
+#include <errno.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <Moby/XMLReader.h>
+#include <Moby/Log.h>
+#include <Moby/EventDrivenSimulator.h>
+#include <Moby/SceneGenerator.h>
+
+using namespace Ravelin;
+using namespace Moby;
+
+/// The default simulation step size
+const double DEFAULT_STEP_SIZE = .001;
+
+/// The simulation step size
+double STEP_SIZE = DEFAULT_STEP_SIZE;
+
+/// The amount of simulated time to run each scene for
+double MAX_TIME = 1.0;
+
+/// The directory holding the example scenes
+std::string EXAMPLE_DIR = "../example";
+
+/// The file holding the baselines (if any)
+std::string BASELINE_FNAME;
+
+/// Whether to write the baselines rather than compare against them
+bool WRITE_BASELINES = false;
+
+/// The fraction by which a measurement may be worse than its baseline
+double TOLERANCE = .25;
+
+/// The results of running a single scene
+struct Result
+{
+  unsigned steps;             // number of steps taken
+  double wall_time;           // wall clock time for all steps
+  double dynamics_time;       // user time spent computing dynamics
+  double broad_phase_time;    // user time spent in broad phase coldet
+  double coldet_time;         // user time spent in narrow phase coldet
+  double event_time;          // user time spent handling events
+  long peak_kb;               // peak resident set size (in kilobytes)
+  bool ok;                    // whether the scene ran successfully
+};
+
+/// A baseline for a single scene
+struct Baseline
+{
+  double steps_per_sec;
+  long peak_kb;
+};
+
+/// Gets the current time (as a floating-point number)
+double get_current_time()
+{
+  const double MICROSEC = 1.0/1000000;
+  timeval t;
+  gettimeofday(&t, NULL);
+  return (double) t.tv_sec + (double) t.tv_usec * MICROSEC;
+}
+
+/// A scene in the suite: an example file or a generated scene
+struct Scene
+{
+  enum Type { eFile, eBoxPile, eSpherePile, eChain, eMeshClutter };
+  std::string name;           // name of the scene (in reports and baselines)
+  Type type;                  // the type of scene
+  std::string fname;          // the file holding the scene (for eFile)
+  unsigned n;                 // the number of bodies/links (generated scenes)
+
+  Scene(const std::string& name, const std::string& fname) : name(name), type(eFile), fname(fname), n(0) { }
+  Scene(const std::string& name, Type type, unsigned n) : name(name), type(type), n(n) { }
+};
+
+/// Reads or generates the objects of a scene
+std::map<std::string, BasePtr> construct_scene(const Scene& scene)
+{
+  if (scene.type == Scene::eFile)
+    return XMLReader::read(scene.fname);
+
+  // generate the scene in memory
+  SceneGenerator gen;
+  switch (scene.type)
+  {
+    case Scene::eBoxPile:
+      gen.add_box_pile(scene.n);
+      break;
+
+    case Scene::eSpherePile:
+      gen.add_sphere_pile(scene.n);
+      break;
+
+    case Scene::eChain:
+      gen.add_chain(scene.n);
+      break;
+
+    case Scene::eMeshClutter:
+      gen.add_mesh_clutter(scene.n, SceneGenerator::find_convex_meshes(EXAMPLE_DIR + "/HOAP2/robot"));
+      break;
+
+    default:
+      assert(false);
+  }
+
+  return gen.construct();
+}
+
+/// Runs a single scene (called in a child process)
+Result run_scene(const Scene& scene)
+{
+  Result r;
+  std::memset(&r, 0, sizeof(Result));
+
+  // read or generate the scene
+  std::map<std::string, BasePtr> read_map = construct_scene(scene);
+
+  // find the simulator
+  boost::shared_ptr<Simulator> s = SceneGenerator::find_simulator(read_map);
+  if (!s)
+  {
+    std::cerr << "benchmark: no simulator found in " << scene.name << std::endl;
+    return r;
+  }
+  boost::shared_ptr<EventDrivenSimulator> eds = boost::dynamic_pointer_cast<EventDrivenSimulator>(s);
+
+  // step the simulator
+  double start = get_current_time();
+  while (s->current_time < MAX_TIME)
+  {
+    s->step(STEP_SIZE);
+    r.steps++;
+
+    // tabulate the per-phase times
+    r.dynamics_time += s->dynamics_time;
+    if (eds)
+    {
+      r.broad_phase_time += eds->broad_phase_time;
+      r.coldet_time += eds->coldet_time;
+      r.event_time += eds->event_time;
+    }
+  }
+  r.wall_time = get_current_time() - start;
+
+  // get the peak memory usage of this process
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  r.peak_kb = usage.ru_maxrss;
+  r.ok = true;
+
+  return r;
+}
+
+/// Runs a scene in a separate process (so that peak memory is per scene)
+Result run_scene_isolated(const Scene& scene)
+{
+  Result r;
+  std::memset(&r, 0, sizeof(Result));
+
+  // create the pipe for the results
+  int fd[2];
+  if (pipe(fd) == -1)
+  {
+    std::cerr << "benchmark: unable to create pipe (" << strerror(errno) << ")" << std::endl;
+    return r;
+  }
+
+  // fork; the child runs the scene and writes its results to the pipe
+  std::cout.flush();
+  pid_t pid = fork();
+  if (pid == -1)
+  {
+    std::cerr << "benchmark: unable to fork (" << strerror(errno) << ")" << std::endl;
+    close(fd[0]);
+    close(fd[1]);
+    return r;
+  }
+  else if (pid == 0)
+  {
+    close(fd[0]);
+    try
+    {
+      r = run_scene(scene);
+    }
+    catch (std::exception& e)
+    {
+      std::cerr << "benchmark: " << scene.name << " failed: " << e.what() << std::endl;
+    }
+    ssize_t nwritten = write(fd[1], &r, sizeof(Result));
+    close(fd[1]);
+    _exit(nwritten == (ssize_t) sizeof(Result) ? 0 : 1);
+  }
+
+  // parent reads the results
+  close(fd[1]);
+  ssize_t nread = 0;
+  char* buf = (char*) &r;
+  while (nread < (ssize_t) sizeof(Result))
+  {
+    ssize_t n = read(fd[0], buf + nread, sizeof(Result) - nread);
+    if (n <= 0)
+      break;
+    nread += n;
+  }
+  close(fd[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  if (nread != (ssize_t) sizeof(Result) || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    r.ok = false;
+
+  return r;
+}
+
+/// Reads the baselines
+std::map<std::string, Baseline> read_baselines(const std::string& fname)
+{
+  std::map<std::string, Baseline> baselines;
+  std::ifstream in(fname.c_str());
+  if (in.fail())
+  {
+    std::cerr << "benchmark: unable to read baselines from " << fname << std::endl;
+    return baselines;
+  }
+
+  // each line is 'scene steps/sec peak-kb'; '#' begins a comment
+  std::string line;
+  while (std::getline(in, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream iss(line);
+    std::string scene;
+    Baseline b;
+    if (iss >> scene >> b.steps_per_sec >> b.peak_kb)
+      baselines[scene] = b;
+  }
+
+  return baselines;
+}
+
+/// Writes the baselines
+void write_baselines(const std::string& fname, const std::vector<std::pair<std::string, Result> >& results)
+{
+  std::ofstream out(fname.c_str());
+  if (out.fail())
+  {
+    std::cerr << "benchmark: unable to write baselines to " << fname << std::endl;
+    return;
+  }
+
+  out << "# Moby benchmark baselines (step size " << STEP_SIZE << ", " << MAX_TIME << "s simulated)" << std::endl;
+  out << "# scene steps/sec peak-kb" << std::endl;
+  for (unsigned i=0; i< results.size(); i++)
+  {
+    const Result& r = results[i].second;
+    if (!r.ok)
+      continue;
+    out << results[i].first << " " << r.steps / r.wall_time << " " << r.peak_kb << std::endl;
+  }
+}
+
+// where everything begins...
+int main(int argc, char** argv)
+{
+  const unsigned ONECHAR_ARG = 3, TWOCHAR_ARG = 4;
+
+  // get all options
+  for (int i=1; i< argc; i++)
+  {
+    // get the option
+    std::string option(argv[i]);
+
+    // process options
+    if (option.find("-s=") == 0)
+    {
+      STEP_SIZE = std::atof(&argv[i][ONECHAR_ARG]);
+      assert(STEP_SIZE > 0.0 && STEP_SIZE < 1);
+    }
+    else if (option.find("-mt=") == 0)
+    {
+      MAX_TIME = std::atof(&argv[i][TWOCHAR_ARG]);
+      assert(MAX_TIME > 0);
+    }
+    else if (option.find("-x=") == 0)
+      EXAMPLE_DIR = std::string(&argv[i][ONECHAR_ARG]);
+    else if (option.find("-b=") == 0)
+      BASELINE_FNAME = std::string(&argv[i][ONECHAR_ARG]);
+    else if (option.find("-t=") == 0)
+    {
+      TOLERANCE = std::atof(&argv[i][ONECHAR_ARG]);
+      assert(TOLERANCE >= 0.0);
+    }
+    else if (option == "-w")
+      WRITE_BASELINES = true;
+    else
+    {
+      std::cerr << "syntax: benchmark [OPTIONS]" << std::endl;
+      std::cerr << "  -x=<dir>   directory holding the example scenes (default ../example)" << std::endl;
+      std::cerr << "  -s=<step>  step size (default " << DEFAULT_STEP_SIZE << ")" << std::endl;
+      std::cerr << "  -mt=<t>    simulated time per scene (default 1)" << std::endl;
+      std::cerr << "  -b=<file>  baseline file to compare against" << std::endl;
+      std::cerr << "  -w         write the baseline file rather than comparing" << std::endl;
+      std::cerr << "  -t=<frac>  allowed fractional regression (default .25)" << std::endl;
+      return -1;
+    }
+  }
+
+  // setup the example scenes
+  std::vector<Scene> scenes;
+  scenes.push_back(Scene("stack", EXAMPLE_DIR + "/contact_simple/stack.xml"));
+  scenes.push_back(Scene("chain2", EXAMPLE_DIR + "/chain-contact/chain2.xml"));
+  scenes.push_back(Scene("pioneer2", EXAMPLE_DIR + "/mrobot/pioneer2.xml"));
+  scenes.push_back(Scene("hyq", EXAMPLE_DIR + "/HyQ/hyq.xml"));
+  scenes.push_back(Scene("hoap2", EXAMPLE_DIR + "/HOAP2/hoap.xml"));
+
+  // setup the synthetic scenes
+  const unsigned PILE_SIZES[] = { 8, 64 }, CHAIN_SIZES[] = { 5, 20 };
+  for (unsigned i=0; i< sizeof(PILE_SIZES)/sizeof(unsigned); i++)
+  {
+    scenes.push_back(Scene("boxes" + boost::lexical_cast<std::string>(PILE_SIZES[i]), Scene::eBoxPile, PILE_SIZES[i]));
+    scenes.push_back(Scene("spheres" + boost::lexical_cast<std::string>(PILE_SIZES[i]), Scene::eSpherePile, PILE_SIZES[i]));
+  }
+  for (unsigned i=0; i< sizeof(CHAIN_SIZES)/sizeof(unsigned); i++)
+    scenes.push_back(Scene("chain" + boost::lexical_cast<std::string>(CHAIN_SIZES[i]), Scene::eChain, CHAIN_SIZES[i]));
+  scenes.push_back(Scene("clutter" + boost::lexical_cast<std::string>(PILE_SIZES[0]), Scene::eMeshClutter, PILE_SIZES[0]));
+
+  // read the baselines, if any
+  std::map<std::string, Baseline> baselines;
+  if (!BASELINE_FNAME.empty() && !WRITE_BASELINES)
+    baselines = read_baselines(BASELINE_FNAME);
+
+  // run all scenes
+  std::vector<std::pair<std::string, Result> > results;
+  unsigned nregressions = 0, nfailures = 0, nmissing = 0;
+  std::cout << std::left << std::setw(10) << "scene" << std::right << std::setw(8) << "steps" << std::setw(12) << "steps/sec" << std::setw(10) << "dyn(s)" << std::setw(10) << "broad(s)" << std::setw(10) << "narrow(s)" << std::setw(10) << "event(s)" << std::setw(12) << "peak(KB)" << std::endl;
+  for (unsigned i=0; i< scenes.size(); i++)
+  {
+    const std::string& name = scenes[i].name;
+    Result r = run_scene_isolated(scenes[i]);
+    results.push_back(std::make_pair(name, r));
+    if (!r.ok)
+    {
+      std::cout << std::left << std::setw(10) << name << std::right << "  FAILED" << std::endl;
+      nfailures++;
+      continue;
+    }
+
+    // output the results
+    double rate = r.steps / r.wall_time;
+    std::cout << std::left << std::setw(10) << name << std::right << std::setw(8) << r.steps << std::setw(12) << std::setprecision(4) << rate << std::setw(10) << r.dynamics_time << std::setw(10) << r.broad_phase_time << std::setw(10) << r.coldet_time << std::setw(10) << r.event_time << std::setw(12) << r.peak_kb;
+
+    // compare against the baseline
+    std::map<std::string, Baseline>::const_iterator b = baselines.find(name);
+    if (b != baselines.end())
+    {
+      bool slow = (rate < b->second.steps_per_sec * (1.0 - TOLERANCE));
+      bool big = (r.peak_kb > b->second.peak_kb * (1.0 + TOLERANCE));
+      if (slow || big)
+      {
+        std::cout << "  REGRESSION (baseline " << b->second.steps_per_sec << " steps/sec, " << b->second.peak_kb << " KB)";
+        nregressions++;
+      }
+    }
+    else if (!BASELINE_FNAME.empty() && !WRITE_BASELINES)
+    {
+      std::cout << "  NO BASELINE";
+      nmissing++;
+    }
+    std::cout << std::endl;
+  }
+
+  // write the baselines, if requested
+  if (WRITE_BASELINES)
+  {
+    if (BASELINE_FNAME.empty())
+      std::cerr << "benchmark: no baseline file specified (use -b=<file>)" << std::endl;
+    else
+      write_baselines(BASELINE_FNAME, results);
+  }
+
+  // report; missing baselines are only a warning (baselines are machine
+  // specific and may not have been generated yet)
+  if (nregressions > 0 || nfailures > 0 || nmissing > 0)
+    std::cout << nregressions << " regression(s), " << nfailures << " failure(s), " << nmissing << " scene(s) without a baseline" << std::endl;
+  if (nmissing > 0)
+    std::cerr << "benchmark: warning: " << nmissing << " scene(s) have no baseline (generate the baselines on this machine with -w)" << std::endl;
+
+  return (nregressions > 0 || nfailures > 0) ? 1 : 0;
+}
+
@@ -7,6 +7,8 @@
 #include <cmath>
 #include <limits>
 #include <cstdlib>
+#include <string>
+#include <Moby/TrajectoryRecorder.h>
 
 static const unsigned BUF_SIZE = 100000;
 static char buffer[BUF_SIZE];
@@ -94,11 +96,80 @@ double comp(const std::vector<double>& v1, const std::vector<double>& v2)
   return diff;
 }
 
+// determines whether a file is a binary trajectory file
+bool is_binary(const char* fname)
+{
+  std::string s(fname);
+  return s.size() > 4 && s.find(".trj") == s.size()-4;
+}
+
+// determines whether a column of a binary trajectory holds timings
+bool is_timing(const std::string& name)
+{
+  return name.size() > 5 && name.find("-time") == name.size()-5;
+}
+
+// compares two binary trajectory files
+int compare_binary(const char* fname1, const char* fname2)
+{
+  std::vector<std::string> names1, names2;
+  std::vector<std::vector<double> > cols1, cols2;
+
+  // read the two files
+  try
+  {
+    Moby::TrajectoryRecorder::read(fname1, names1, cols1);
+    Moby::TrajectoryRecorder::read(fname2, names2, cols2);
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "compare-trajs: " << e.what() << std::endl;
+    return -1;
+  }
+
+  // verify that the files have the same layout
+  if (names1 != names2)
+  {
+    std::cerr << "compare-trajs: files have different columns" << std::endl;
+    return -1;
+  }
+  if (!cols1.empty() && cols1.front().size() != cols2.front().size())
+  {
+    std::cerr << "compare-trajs: unequal numbers of records" << std::endl;
+    return -1;
+  }
+
+  // compare all columns except timings; sum the timings
+  double max_diff = 0.0, time1 = 0.0, time2 = 0.0;
+  for (unsigned i=0; i< names1.size(); i++)
+  {
+    if (is_timing(names1[i]))
+    {
+      for (unsigned j=0; j< cols1[i].size(); j++)
+      {
+        time1 += cols1[i][j];
+        time2 += cols2[i][j];
+      }
+    }
+    else
+      max_diff = std::max(max_diff, comp(cols1[i], cols2[i]));
+  }
+
+  std::cout << "maximum difference: " << max_diff << std::endl;
+  std::cout << "reference timing: " << time1 << "  new timing: " << time2 << std::endl;
+
+  return 0;
+}
+
 int main(int argc, char* argv[])
 {
   if (argc < 3)
     return -1;
 
+  // compare binary trajectories directly
+  if (is_binary(argv[1]) && is_binary(argv[2]))
+    return compare_binary(argv[1], argv[2]);
+
   // read the two files
   std::ifstream in1(argv[1]);
   std::ifstream in2(argv[2]);
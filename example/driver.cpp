@@ -3,6 +3,7 @@
  *****************************************************************************/
 
 #include <errno.h>
+#include <pthread.h>
 #include <sys/time.h>
 #include <dlfcn.h>
 #include <iostream>
@@ -27,6 +28,7 @@
 #include <Moby/Simulator.h>
 #include <Moby/RigidBody.h>
 #include <Moby/EventDrivenSimulator.h>
+#include <Moby/SnapshotBuffer.h>
 
 using boost::shared_ptr;
 using namespace Ravelin;
@@ -108,6 +110,22 @@ double LAST_3D_WRITTEN_T = -std::numeric_limits<double>::max()/2.0;
 /// Last image iteration output
 unsigned LAST_IMG_WRITTEN = -1;
 double LAST_IMG_WRITTEN_T = -std::numeric_limits<double>::max()/2.0;
+
+/// Whether an image / 3D output has been scheduled but not yet written
+bool IMG_DUE = false, THREED_DUE = false;
+
+/// Guards the visualization (OSG) state when the simulation runs in its own
+/// thread: the visualization thread holds it while applying snapshots,
+/// rendering, and writing outputs, and the simulation thread while pickling
+pthread_mutex_t VIS_MUTEX = PTHREAD_MUTEX_INITIALIZER;
+
+/// Signaled by the visualization thread once scheduled outputs are written
+pthread_cond_t OUTPUTS_WRITTEN = PTHREAD_COND_INITIALIZER;
+
+/// Whether scheduled outputs are waiting on the visualization thread, and
+/// the simulation time they are due at
+bool OUTPUTS_PENDING = false;
+double OUTPUTS_T = 0.0;
       
 /// Outputs to stdout
 bool OUTPUT_FRAME_RATE = false;
@@ -117,6 +135,9 @@ bool OUTPUT_SIM_RATE = false;
 /// Render Contact Points
 bool RENDER_CONTACT_POINTS = false;
 
+/// Read the scene with the streaming XML reader
+bool STREAM_SCENE = false;
+
 /// The map of objects read from the simulation XML file
 std::map<std::string, BasePtr> READ_MAP;
 
@@ -154,8 +175,92 @@ double get_current_time()
   return (double) t.tv_sec + (double) t.tv_usec * MICROSEC;
 }
 
+/// Schedules the image and 3D file for the given simulation time, if due
+/**
+ * \return <b>true</b> if any output was scheduled (and must be written with
+ *         write_outputs())
+ */
+bool schedule_outputs(double t)
+{
+  #ifdef USE_OSG
+  // schedule the image, if desired
+  if (IMAGE_IVAL > 0)
+  {
+    // determine at what iteration nearest frame would be output
+    if ((t - LAST_IMG_WRITTEN_T > STEP_SIZE * IMAGE_IVAL))
+    {
+      LAST_IMG_WRITTEN++;
+      LAST_IMG_WRITTEN_T = t;
+      IMG_DUE = true;
+    }
+  }
+
+  // schedule the 3D file, if desired
+  if (THREED_IVAL > 0)
+  {
+    // determine at what iteration nearest frame would be output
+    if ((t - LAST_3D_WRITTEN_T > STEP_SIZE * THREED_IVAL))
+    {
+      LAST_3D_WRITTEN++;
+      LAST_3D_WRITTEN_T = t;
+      THREED_DUE = true;
+    }
+  }
+  #endif
+
+  return IMG_DUE || THREED_DUE;
+}
+
+/// Writes the scheduled image and 3D file for the given simulation time
+void write_outputs(double t)
+{
+  #ifdef USE_OSG
+  // output the image, if scheduled
+  if (IMG_DUE)
+  {
+    char buffer[128];
+    sprintf(buffer, "driver.out.%08u.png", LAST_IMG_WRITTEN);
+    // TODO: call offscreen renderer
+    IMG_DUE = false;
+  }
+
+  // output the 3D file, if scheduled
+  if (THREED_DUE)
+  {
+    // write the file (fails silently)
+    char buffer[128];
+    sprintf(buffer, "driver.out-%08u-%f.%s", LAST_3D_WRITTEN, t, THREED_EXT);
+    osgDB::writeNodeFile(*MAIN_GROUP, std::string(buffer));
+    THREED_DUE = false;
+  }
+  #endif
+}
+
+/// Waits until the visualization thread has written the scheduled outputs
+/**
+ * The current state is republished once the outputs are flagged, and the
+ * simulation thread does not publish another snapshot until the outputs are
+ * written, so the visualization thread is guaranteed to acquire it
+ * (snapshots with outputs due are never dropped).
+ */
+void wait_for_outputs(boost::shared_ptr<Simulator> s)
+{
+  pthread_mutex_lock(&VIS_MUTEX);
+  OUTPUTS_T = s->current_time;
+  OUTPUTS_PENDING = true;
+  s->publish_snapshot();
+  while (OUTPUTS_PENDING && !s->snapshot_buffer->is_closed())
+    pthread_cond_wait(&OUTPUTS_WRITTEN, &VIS_MUTEX);
+  OUTPUTS_PENDING = false;
+  pthread_mutex_unlock(&VIS_MUTEX);
+}
+
 /// runs the simulator and updates all transforms
-void step(void* arg)
+/**
+ * \return <b>false</b> once the maximum number of iterations or the maximum
+ *         time has been reached
+ */
+bool step(void* arg)
 {
   // get the simulator pointer
   boost::shared_ptr<Simulator> s = *(boost::shared_ptr<Simulator>*) arg;
@@ -175,34 +280,15 @@ void step(void* arg)
   if (Log<OutputToFile>::reporting_level > 0)
     FILE_LOG(Log<OutputToFile>::reporting_level) << "iteration: " << ITER << "  simulation time: " << s->current_time << std::endl;
 
-  // output the image, if desired
-  #ifdef USE_OSG
-  if (IMAGE_IVAL > 0)
-  {
-    // determine at what iteration nearest frame would be output
-    if ((s->current_time - LAST_IMG_WRITTEN_T > STEP_SIZE * IMAGE_IVAL))
-    {
-      char buffer[128];
-      sprintf(buffer, "driver.out.%08u.png", ++LAST_IMG_WRITTEN);
-      // TODO: call offscreen renderer
-      LAST_IMG_WRITTEN_T = s->current_time;
-    }
-  }
-
-  // output the 3D file, if desired
-  if (THREED_IVAL > 0)
+  // output the image and 3D file, if desired (the visualization thread 
+  // writes them from the current snapshot when snapshots are being published)
+  if (schedule_outputs(s->current_time))
   {
-    // determine at what iteration nearest frame would be output
-    if ((s->current_time - LAST_3D_WRITTEN_T > STEP_SIZE * THREED_IVAL))
-    {
-      // write the file (fails silently)
-      char buffer[128];
-      sprintf(buffer, "driver.out-%08u-%f.%s", ++LAST_3D_WRITTEN, s->current_time, THREED_EXT);
-      osgDB::writeNodeFile(*MAIN_GROUP, std::string(buffer));
-      LAST_3D_WRITTEN_T = s->current_time;
-    }
+    if (!s->snapshot_buffer)
+      write_outputs(s->current_time);
+    else
+      wait_for_outputs(s);
   }
-  #endif
 
   // serialize the simulation, if desired
   if (PICKLE_IVAL > 0)
@@ -210,17 +296,22 @@ void step(void* arg)
     // determine at what iteration nearest pickle would be output
     if ((s->current_time - LAST_PICKLE_T > STEP_SIZE * PICKLE_IVAL))
     {
-      // write the file (fails silently)
+      // write the file (fails silently); serialization reads visualization
+      // state, so keep the visualization thread out meanwhile
       char buffer[128];
       sprintf(buffer, "driver.out-%08u-%f.xml", ++LAST_PICKLE, s->current_time);
+      if (s->snapshot_buffer)
+        pthread_mutex_lock(&VIS_MUTEX);
       XMLWriter::serialize_to_xml(std::string(buffer), s); 
+      if (s->snapshot_buffer)
+        pthread_mutex_unlock(&VIS_MUTEX);
       LAST_PICKLE_T = s->current_time;
     }
   }
 
   // only update the graphics if it is necessary; update visualization first
   // in case simulator takes some time to perform first step
-  if (UPDATE_GRAPHICS)
+  if (UPDATE_GRAPHICS && !s->snapshot_buffer)
     s->update_visualization();
 
   // step the simulator 
@@ -260,12 +351,26 @@ void step(void* arg)
     clock_t end_time = clock();
     double elapsed = (end_time - start_time) / (double) CLOCKS_PER_SEC;
     std::cout << elapsed << " seconds elapsed" << std::endl;
-    exit(0);
+    BinaryLog::close();
+    return false;
   }
 
   // if render contact points enabled, notify the Simulator
   if( RENDER_CONTACT_POINTS && eds)
     eds->render_contact_points = true;
+
+  return true;
+}
+
+/// Steps the simulator until done (or until the snapshot buffer is closed)
+void* simulate(void* arg)
+{
+  boost::shared_ptr<Simulator> s = *(boost::shared_ptr<Simulator>*) arg;
+  while (!s->snapshot_buffer->is_closed() && step(arg));
+
+  // let the visualization thread know that the simulation is done
+  s->snapshot_buffer->close();
+  return NULL;
 }
 
 // attempts to read control code plugin
@@ -540,6 +645,16 @@ int main(int argc, char** argv)
       STEP_SIZE = std::atof(&argv[i][ONECHAR_ARG]);
       assert(STEP_SIZE >= 0.0 && STEP_SIZE < 1);
     }
+    else if (option.find("-lb=") != std::string::npos)
+    {
+      // binary log sink: -lb=<level>,<filename>
+      std::string arg(&argv[i][TWOCHAR_ARG]);
+      size_t comma = arg.find(',');
+      if (comma == std::string::npos)
+        std::cerr << "driver: -lb requires <level>,<filename>" << std::endl;
+      else
+        BinaryLog::open((unsigned) std::atoi(arg.substr(0, comma).c_str()), arg.substr(comma+1));
+    }
     else if (option.find("-lf=") != std::string::npos)
     {
       std::string fname(&argv[i][TWOCHAR_ARG]);
@@ -587,11 +702,16 @@ int main(int argc, char** argv)
       strcpy(THREED_EXT, &argv[i][ONECHAR_ARG]);
     } else if (option.find("-vcp") != std::string::npos)
       RENDER_CONTACT_POINTS = true;
+    else if (option == "-xs")
+      STREAM_SCENE = true;
 
   }
 
   // setup the simulation 
-  READ_MAP = XMLReader::read(std::string(argv[argc-1]));
+  if (STREAM_SCENE)
+    READ_MAP = XMLReader::read_streaming(std::string(argv[argc-1]));
+  else
+    READ_MAP = XMLReader::read(std::string(argv[argc-1]));
 
   // setup the offscreen renderer if necessary
   #ifdef USE_OSG
@@ -696,21 +816,63 @@ int main(int argc, char** argv)
   }
   #endif
 
-  // begin rendering
-  while (true)
+  // if graphics are being updated, step the simulator in its own thread; it
+  // publishes a snapshot after every step, and this thread renders the 
+  // newest snapshot, so neither waits on the other (except when outputs are
+  // due: the simulation thread then waits for this thread to write them)
+  #ifdef USE_OSG
+  if (UPDATE_GRAPHICS)
   {
-    #ifdef USE_OSG
-    if (ONSCREEN_RENDER)
+    // publish the initial state and start simulating
+    s->snapshot_buffer = boost::shared_ptr<SnapshotBuffer>(new SnapshotBuffer);
+    s->publish_snapshot();
+    pthread_t sim_thread;
+    pthread_create(&sim_thread, NULL, &simulate, (void*) &s);
+
+    // render (only waiting for snapshots if not rendering onscreen)
+    while (true)
     {
-      if (viewer.done())
+      bool fresh = s->snapshot_buffer->acquire(!ONSCREEN_RENDER);
+      if (!fresh && s->snapshot_buffer->is_closed())
+        break;
+      if (ONSCREEN_RENDER && viewer.done())
         break;
-      viewer.frame();
+      pthread_mutex_lock(&VIS_MUTEX);
+      if (fresh)
+      {
+        const Snapshot& snapshot = s->snapshot_buffer->get_front();
+        s->apply_snapshot(snapshot);
+
+        // write any outputs due at this snapshot's time
+        if (OUTPUTS_PENDING && snapshot.time >= OUTPUTS_T)
+        {
+          write_outputs(snapshot.time);
+          OUTPUTS_PENDING = false;
+          pthread_cond_broadcast(&OUTPUTS_WRITTEN);
+        }
+      }
+      if (ONSCREEN_RENDER)
+        viewer.frame();
+      pthread_mutex_unlock(&VIS_MUTEX);
+    }
+
+    // stop the simulation thread (waking it if it waits on outputs)
+    s->snapshot_buffer->close();
+    pthread_mutex_lock(&VIS_MUTEX);
+    pthread_cond_broadcast(&OUTPUTS_WRITTEN);
+    pthread_mutex_unlock(&VIS_MUTEX);
+    pthread_join(sim_thread, NULL);
+  }
+  else
+  #endif
+  {
+    // begin stepping
+    while (step((void*) &s))
+    {
+      #ifdef USE_OSG
+      usleep(DYNAMICS_FREQ);
+      #endif
     }
-    #endif
-    step((void*) &s);
-    #ifdef USE_OSG
-    usleep(DYNAMICS_FREQ);
-    #endif
   }
 
   // close the loaded library
@@ -0,0 +1,45 @@
+/*
+ * Formats a binary log file written by Moby::BinaryLog as text, one record
+ * per line: time, thread, level, tag, and values.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <Moby/Log.h>
+
+using namespace Moby;
+
+int main(int argc, char* argv[])
+{
+  if (argc != 2)
+  {
+    std::cerr << "syntax: logdump <binary log file>" << std::endl;
+    exit(1);
+  }
+
+  // read the log
+  std::vector<LogRecord> records;
+  std::vector<std::string> tags;
+  if (!BinaryLog::read(std::string(argv[1]), records, tags))
+  {
+    std::cerr << "logdump: unable to read binary log from " << argv[1] << std::endl;
+    exit(1);
+  }
+
+  // output the records (times are relative to the first record)
+  const double T0 = (records.empty()) ? 0.0 : records.front().time;
+  for (unsigned i=0; i< records.size(); i++)
+  {
+    const LogRecord& r = records[i];
+    std::printf("%.6f %u %u %s", r.time - T0, r.thread, r.level, r.tag);
+    for (unsigned j=0; j< r.nvalues; j++)
+      std::printf(" %.17g", r.values[j]);
+    std::printf("\n");
+  }
+
+  return 0;
+}
+
@@ -0,0 +1,89 @@
+/*
+ * Converts the geometry specified in an obj file to a Moby binary mesh file
+ * (and vice versa). The binary file includes the flat BVH and the mass data
+ * of the mesh so that neither needs to be computed when the file is loaded.
+ * Materials, normals, etc. are *not* converted.
+ */
+
+#include <string.h>
+#include <string>
+#include <list>
+#include <iostream>
+#include <Moby/Types.h>
+#include <Moby/CompGeom.h>
+#include <Moby/IndexedTriArray.h>
+#include <Moby/FlatBVH.h>
+#include <Moby/BinaryMeshFile.h>
+
+using namespace Ravelin;
+using namespace Moby;
+
+int main(int argc, char* argv[])
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // check for the centering option
+  bool center = (argc == 4 && strcmp(argv[1], "-c") == 0);
+  if (argc != 3 && !center)
+  {
+    std::cerr << "syntax: objmbm [-c] <inputfile> <outputfile>" << std::endl << std::endl;
+    std::cerr << "Converts a Wavefront OBJ file to a Moby binary mesh (.mbm) file and vice versa" << std::endl;
+    std::cerr << "  -c  centers the mesh (when writing a binary mesh file)" << std::endl;
+    exit(1);
+  }
+  std::string infile(argv[argc-2]);
+  std::string outfile(argv[argc-1]);
+
+  // determine the type of input file and read in the geometry
+  IndexedTriArray mesh;
+  if (infile.find(".obj") == infile.size()-4)
+    mesh = IndexedTriArray::read_from_obj(infile);
+  else if (infile.find(".mbm") == infile.size()-4)
+    mesh = BinaryMeshFile::read(infile);
+  else
+  {
+    std::cerr << "  -- unknown input filename type (no .obj/.mbm extension)" << std::endl;
+    exit(1);
+  }
+
+  // write an OBJ file 
+  if (outfile.find(".obj") == outfile.size()-4)
+  {
+    mesh.write_to_obj(outfile);
+    return 0;
+  }
+  else if (outfile.find(".mbm") != outfile.size()-4)
+  {
+    std::cerr << "  -- unknown output filename type (no .obj/.mbm extension)" << std::endl;
+    exit(1);
+  }
+
+  // compute the centroid of the surface
+  std::list<Triangle> tris;
+  mesh.get_tris(std::back_inserter(tris), GLOBAL);
+  Point3d c = CompGeom::calc_centroid_3D(tris.begin(), tris.end());
+  Origin3d centroid(c[X], c[Y], c[Z]);
+
+  // center the mesh, if desired
+  if (center)
+  {
+    Transform3d T = Transform3d::identity();
+    T.x = Origin3d(-centroid[X], -centroid[Y], -centroid[Z]);
+    mesh = mesh.transform(T);
+    centroid = Origin3d(0.0, 0.0, 0.0);
+  }
+
+  // compute the volume integrals and build the BVH
+  double volume_ints[10];
+  mesh.calc_volume_ints(volume_ints);
+  FlatBVH bvh(mesh);
+
+  // write the binary mesh file
+  BinaryMeshFile::write(outfile, mesh, &bvh, volume_ints, &centroid);
+  std::cout << "wrote " << mesh.get_vertices().size() << " vertices, ";
+  std::cout << mesh.num_tris() << " triangles, and " << bvh.get_nodes().size();
+  std::cout << " BVH nodes to " << outfile << std::endl;
+
+  return 0;
+}
+
@@ -12,6 +12,7 @@
 #include <Moby/Log.h>
 #include <Moby/Simulator.h>
 #include <Moby/RigidBody.h>
+#include <Moby/TrajectoryRecorder.h>
 
 using namespace Ravelin;
 using namespace Moby;
@@ -43,6 +44,12 @@ double MAX_TIME = std::numeric_limits<double>::max();
 /// The output file
 std::ofstream outfile;
 
+/// The trajectory recorder (used in place of the output file for .trj files)
+TrajectoryRecorder recorder;
+
+/// Whether to compress the trajectory file
+bool COMPRESS = false;
+
 /// Outputs to stdout
 bool OUTPUT_ITER_NUM = false;
 bool OUTPUT_SIM_RATE = false;
@@ -74,18 +81,24 @@ bool step(void* arg)
   // get the simulator pointer
   boost::shared_ptr<Simulator> s = *(boost::shared_ptr<Simulator>*) arg;
 
-  // get the generalized coordinates for all bodies in alphabetical order
-  std::vector<DynamicBodyPtr> bodies = s->get_dynamic_bodies();
-  std::sort(bodies.begin(), bodies.end(), compbody);
-  VectorNd q;
-  outfile << s->current_time;
-  for (unsigned i=0; i< bodies.size(); i++)  
+  // record the state in binary or write the generalized coordinates for all
+  // bodies in alphabetical order 
+  if (recorder.is_open())
+    recorder.record();
+  else
   {
-    bodies[i]->get_generalized_coordinates(DynamicBody::eEuler, q);
-    for (unsigned j=0; j< q.size(); j++)
-      outfile << " " << q[j];
+    std::vector<DynamicBodyPtr> bodies = s->get_dynamic_bodies();
+    std::sort(bodies.begin(), bodies.end(), compbody);
+    VectorNd q;
+    outfile << s->current_time;
+    for (unsigned i=0; i< bodies.size(); i++)  
+    {
+      bodies[i]->get_generalized_coordinates(DynamicBody::eEuler, q);
+      for (unsigned j=0; j< q.size(); j++)
+        outfile << " " << q[j];
+    }
+    outfile << std::endl;
   }
-  outfile << std::endl;
 
   // output the iteration #
   if (OUTPUT_ITER_NUM)
@@ -147,6 +160,7 @@ int main(int argc, char** argv)
   if (argc < 3)
   {
     std::cerr << "syntax: regress [OPTIONS] <xml file> <output file>" << std::endl;
+    std::cerr << "  (output files with the extension .trj are written in binary; -z compresses them)" << std::endl;
     return -1;
   }
 
@@ -178,6 +192,8 @@ int main(int argc, char** argv)
     }
     else if (option.find("-p=") != std::string::npos)
       read_plugin(&argv[i][ONECHAR_ARG]);
+    else if (option == "-z")
+      COMPRESS = true;
   }
 
   // setup the simulation 
@@ -200,7 +216,11 @@ int main(int argc, char** argv)
   } 
 
   // setup the output file
-  outfile.open(argv[argc-1]);
+  std::string outname(argv[argc-1]);
+  if (outname.size() > 4 && outname.find(".trj") == outname.size()-4)
+    recorder.open(outname, s, 4096, COMPRESS);
+  else
+    outfile.open(outname.c_str());
 
   // call the initializers, if any
   if (!INIT.empty())
@@ -221,6 +241,13 @@ int main(int argc, char** argv)
   if (HANDLE)
     dlclose(HANDLE);
 
+  // close the trajectory file (the timings are recorded at every step)
+  if (recorder.is_open())
+  {
+    recorder.close();
+    return 0;
+  }
+
   // write the number of clock ticks elapsed
   clock_t end_time = clock();
   double elapsed = (end_time - start_time) / (double) CLOCKS_PER_SEC;
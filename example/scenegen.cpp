@@ -0,0 +1,93 @@
+/*
+ * Generates a synthetic Moby XML scene for stress testing: piles of boxes and
+ * spheres, rows of cloned robots, long chains, and mesh clutter.
+ */
+
+#include <string.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <Moby/SceneGenerator.h>
+
+using namespace Moby;
+
+int main(int argc, char* argv[])
+{
+  const unsigned ONECHAR_ARG = 3;
+  unsigned nboxes = 0, nspheres = 0, nrobots = 0, nlinks = 0, nclutter = 0;
+  unsigned seed = 0;
+  std::string robot_fname = "../example/mrobot/pioneer2.xml";
+  std::string mesh_dir = "../example/HOAP2/robot";
+
+  // check syntax
+  if (argc < 2)
+  {
+    std::cerr << "syntax: scenegen [OPTIONS] <output file>" << std::endl << std::endl;
+    std::cerr << "Generates a synthetic Moby XML scene" << std::endl;
+    std::cerr << "  -b=<n>     adds a pile of n boxes" << std::endl;
+    std::cerr << "  -s=<n>     adds a pile of n spheres" << std::endl;
+    std::cerr << "  -r=<n>     adds a row of n robots" << std::endl;
+    std::cerr << "  -c=<n>     adds a chain of n links" << std::endl;
+    std::cerr << "  -m=<n>     adds clutter of n meshes" << std::endl;
+    std::cerr << "  -rf=<file> robot file (default " << robot_fname << ")" << std::endl;
+    std::cerr << "  -md=<dir>  directory with *_convex.obj meshes (default " << mesh_dir << ")" << std::endl;
+    std::cerr << "  -seed=<n>  random seed (default 0)" << std::endl;
+    exit(1);
+  }
+
+  // get all options
+  for (int i=1; i< argc-1; i++)
+  {
+    std::string option(argv[i]);
+    if (option.find("-b=") == 0)
+      nboxes = std::atoi(&argv[i][ONECHAR_ARG]);
+    else if (option.find("-s=") == 0)
+      nspheres = std::atoi(&argv[i][ONECHAR_ARG]);
+    else if (option.find("-r=") == 0)
+      nrobots = std::atoi(&argv[i][ONECHAR_ARG]);
+    else if (option.find("-c=") == 0)
+      nlinks = std::atoi(&argv[i][ONECHAR_ARG]);
+    else if (option.find("-m=") == 0)
+      nclutter = std::atoi(&argv[i][ONECHAR_ARG]);
+    else if (option.find("-rf=") == 0)
+      robot_fname = option.substr(4);
+    else if (option.find("-md=") == 0)
+      mesh_dir = option.substr(4);
+    else if (option.find("-seed=") == 0)
+      seed = std::atoi(option.substr(6).c_str());
+    else
+    {
+      std::cerr << "scenegen: unknown option " << option << std::endl;
+      exit(1);
+    }
+  }
+
+  // generate the scene
+  try
+  {
+    SceneGenerator gen(seed);
+    if (nboxes > 0)
+      gen.add_box_pile(nboxes);
+    if (nspheres > 0)
+      gen.add_sphere_pile(nspheres);
+    if (nrobots > 0)
+      gen.add_robots(nrobots, robot_fname);
+    if (nlinks > 0)
+      gen.add_chain(nlinks);
+    if (nclutter > 0)
+      gen.add_mesh_clutter(nclutter, SceneGenerator::find_convex_meshes(mesh_dir));
+    gen.write(std::string(argv[argc-1]));
+    std::cout << "wrote " << gen.get_num_bodies() << " bodies to " << argv[argc-1] << std::endl;
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "scenegen: " << e.what() << std::endl;
+    exit(1);
+  }
+
+  return 0;
+}
+
@@ -20,12 +20,58 @@ class AccelerationEventHandler
     AccelerationEventHandler();
     void process_events(const std::vector<Event>& contacts);
 
+    /// Tolerance on generalized coordinates and contact frames within which position-dependent data from the last solve is reused (negative to disable reuse; default NEAR_ZERO)
+    double cache_tol;
+
   private:
+    /// Data retained from the last solve for one group of connected contacts
+    /**
+     * The LCP matrix depends only on positions (through the contact frames
+     * and the generalized inertias), so it is reused while the contacts, their
+     * frames, and the generalized coordinates of the bodies are unchanged
+     * (e.g., across stages of a Runge-Kutta step for resting contact). The
+     * last solution is used to warm start the next solve.
+     */
+    struct CachedLCP
+    {
+      CachedLCP() { factored = false; }
+
+      /// The contact geometries (two per contact)
+      std::vector<CollisionGeometryPtr> geoms;
+
+      /// Whether each contact was sticking
+      std::vector<bool> sticking;
+
+      /// The contact points, normals, and first tangents (nine per contact)
+      std::vector<double> frames;
+
+      /// The super bodies and their stacked generalized coordinates
+      std::vector<DynamicBodyPtr> super_bodies;
+      Ravelin::VectorNd gc;
+
+      /// The LCP matrix
+      Ravelin::MatrixNd MM;
+
+      /// The last solution and the indices of its nonzero components
+      Ravelin::VectorNd z;
+      std::vector<unsigned> active;
+
+      /// The LU factorization of the LCP matrix restricted to the active indices
+      Ravelin::MatrixNd LU;
+      std::vector<int> ipiv;
+      bool factored;
+    };
+
     static DynamicBodyPtr get_super_body(SingleBodyPtr sb);
     void apply_model(const std::vector<Event>& contacts);
-    void apply_model_to_connected_contacts(const std::list<Event*>& contacts);
-    static void compute_problem_data(AccelerationEventData& epd);
-    bool solve_lcp(AccelerationEventData& epd, Ravelin::VectorNd& z);
+    void apply_model_to_connected_contacts(const std::list<Event*>& contacts, unsigned group);
+    static void compute_problem_data(AccelerationEventData& epd, bool inertia);
+    bool is_cache_valid(const AccelerationEventData& epd, const CachedLCP& c);
+    void update_cache(const AccelerationEventData& epd, CachedLCP& c);
+    static void setup_lcp_matrix(AccelerationEventData& epd, Ravelin::MatrixNd& MM);
+    static void setup_lcp_vector(AccelerationEventData& epd, Ravelin::VectorNd& qq);
+    bool solve_active_set(CachedLCP& c, const Ravelin::VectorNd& qq, Ravelin::VectorNd& z);
+    bool solve_lcp(AccelerationEventData& epd, CachedLCP& c, bool reuse, Ravelin::VectorNd& z);
     double calc_ke(AccelerationEventData& epd, const Ravelin::VectorNd& z);
     void apply_forces(const AccelerationEventData& epd) const;
     static void contact_select(const std::vector<int>& alpha_c_indices, const std::vector<int>& beta_nbeta_c_indices, const Ravelin::VectorNd& x, Ravelin::VectorNd& alpha_c, Ravelin::VectorNd& beta_c);
@@ -35,6 +81,12 @@ class AccelerationEventHandler
 
     Ravelin::LinAlgd _LA;
     LCP _lcp;
+
+    /// Data retained from the last solve, one per group of connected contacts
+    std::vector<CachedLCP> _cache;
+
+    // temporaries for solve_lcp(), solve_active_set(), and is_cache_valid()
+    Ravelin::VectorNd _qq, _zB, _w, _gc;
 }; // end class
 
 } // end namespace
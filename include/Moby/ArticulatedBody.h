@@ -35,6 +35,7 @@ class ArticulatedBody : public DynamicBody
     virtual void translate(const Ravelin::Origin3d& o);
     virtual double calc_kinetic_energy();
     virtual void update_visualization();
+    virtual void set_sleeping(bool flag);
     RigidBodyPtr find_link(const std::string& id) const; 
     JointPtr find_joint(const std::string& id) const; 
     void get_adjacent_links(std::list<sorted_pair<RigidBodyPtr> >& links) const;
@@ -0,0 +1,68 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_BINARY_MESH_FILE_H_
+#define _MOBY_BINARY_MESH_FILE_H_
+
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <Ravelin/Origin3d.h>
+#include <Moby/IndexedTriArray.h>
+#include <Moby/FlatBVH.h>
+
+namespace Moby {
+
+/// Reads and writes triangle meshes in Moby's binary mesh (.mbm) format
+/**
+ * A file consists of a fixed-size header followed by the vertices (three
+ * doubles each), the indexed triangles (three 32-bit unsigned integers each)
+ * and, optionally, the nodes and triangle indices of a FlatBVH. The header
+ * may also hold the volume integrals and surface centroid of the mesh so
+ * that mass properties need not be recomputed. All data are stored in
+ * native byte order and every section begins at a multiple of eight bytes,
+ * so files are read by memory mapping them and copying each section in bulk;
+ * files written on a machine with a different byte order or layout are
+ * rejected, as are files whose section sizes, triangle ranges, child
+ * offsets, or tree depth are inconsistent.
+ */
+class BinaryMeshFile
+{
+  public:
+    /// The version of the format written by this class
+    static const unsigned VERSION = 1;
+
+    /// Flags indicating the optional contents of a file
+    enum Contents { eMassProperties = 1, eBVH = 2 };
+
+    static void write(const std::string& filename, const IndexedTriArray& mesh, const FlatBVH* bvh = NULL, const double* volume_ints = NULL, const Ravelin::Origin3d* centroid = NULL);
+    static unsigned read(const std::string& filename, boost::shared_ptr<IndexedTriArray>& mesh, boost::shared_ptr<FlatBVH>& bvh, double volume_ints[10], Ravelin::Origin3d& centroid);
+    static IndexedTriArray read(const std::string& filename);
+
+  private:
+    /// The header of a file
+    struct Header
+    {
+      char magic[8];            // "MOBYMSH" (with terminating null)
+      unsigned version;         // version of the format
+      unsigned byte_order;      // BYTE_ORDER_MARK as written
+      unsigned contents;        // combination of Contents flags
+      unsigned num_vertices;    // number of vertices
+      unsigned num_tris;        // number of triangles
+      unsigned num_nodes;       // number of BVH nodes
+      unsigned num_tri_idx;     // number of BVH triangle indices
+      unsigned node_size;       // size of a BVH node as written
+      double volume_ints[10];   // volume integrals (if eMassProperties)
+      double centroid[3];       // surface centroid (if eMassProperties)
+    };
+
+    static const unsigned BYTE_ORDER_MARK = 0x01020304;
+    static size_t align(size_t offset) { return (offset + 7) & ~((size_t) 7); }
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -8,6 +8,9 @@
 #define _BULIRSCH_STOER_INTEGRATOR_H
 
 #include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/numeric/odeint/config.hpp>
+#include <boost/numeric/odeint/stepper/bulirsch_stoer.hpp>
 #include <Moby/VariableStepIntegrator.h>
 
 namespace Moby {
@@ -22,12 +25,31 @@ class BulirschStoerIntegrator : public VariableStepIntegrator
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
 
   private:
-    static void f(const std::vector<double>&, std::vector<double>&, const double);
-    static Ravelin::VectorNd& (*_f)(const Ravelin::VectorNd&, double, double, void*, Ravelin::VectorNd&);
-    static double _dt;
-    static void* _data;
-    static Ravelin::VectorNd _x, _dxdt;
-    static std::vector<double> _y;
+    typedef boost::numeric::odeint::bulirsch_stoer<std::vector<double> > Stepper;
+
+    /// The stepper (and its internal buffers), kept between calls to integrate()
+    boost::shared_ptr<Stepper> _stepper;
+
+    /// The tolerances that _stepper was constructed with
+    double _stepper_aerr, _stepper_rerr;
+
+    /// The system passed to odeint; forwards to f() of the integrator
+    struct System
+    {
+      BulirschStoerIntegrator* integrator;
+      void operator()(const std::vector<double>& y, std::vector<double>& dydt, const double t) const { integrator->f(y, dydt, t); }
+    };
+    friend struct System;
+
+    void f(const std::vector<double>&, std::vector<double>&, const double);
+
+    // the ODE being integrated and its arguments (per integrator, so that
+    // independent simulators may integrate concurrently)
+    Ravelin::VectorNd& (*_f)(const Ravelin::VectorNd&, double, double, void*, Ravelin::VectorNd&);
+    double _dt;
+    void* _data;
+    Ravelin::VectorNd _x, _dxdt;
+    std::vector<double> _y;
 }; // end class def
 
 } // end namespace
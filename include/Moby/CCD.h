@@ -15,13 +15,17 @@
 #include <Moby/Log.h>
 #include <Moby/SpherePrimitive.h>
 #include <Moby/BoxPrimitive.h>
+#include <Moby/HeightfieldPrimitive.h>
 #include <Moby/BV.h>
+#include <Moby/SSL.h>
+#include <Moby/PoseCache.h>
 
 namespace Moby {
 
 class RigidBody;
 class ArticulatedBody;
 class CollisionGeometry;  
+class ContactPool;
 
 /// Implements the CollisionDetection abstract class to perform exact contact finding using abstract shapes 
 class CCD
@@ -33,19 +37,36 @@ class CCD
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
     double find_next_contact_time(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB);
     void broad_phase(double dt, const std::vector<DynamicBodyPtr>& bodies, std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check);
-    double calc_CA_step(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB);
+    double calc_CA_step(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, double dt);
 
-    template <class OutputIterator>
-    OutputIterator find_contacts(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, OutputIterator output_begin);
+    void find_contacts(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, ContactPool& pool);
+    void update_poses(const std::vector<DynamicBodyPtr>& bodies);
+    double calc_signed_dist(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, Point3d& pA, Point3d& pB);
+
+    /// Gets the cache of global link and geometry transforms
+    /**
+     * \note the cache is only valid as of the last call to update_poses()
+     */
+    const PoseCache& get_poses() const { return _poses; }
 
     /// Pairs of collision geometries that aren't checked for contact/collision
     /**
-     * \note collisions between geometries for two disabled bodies and 
-     *       collisions between geometries for a single body are automatically
-     *       not checked and do not need to be added to this set.
+     * \note collisions between geometries for two disabled (or sleeping) 
+     *       bodies and collisions between geometries for a single body are 
+     *       automatically not checked and do not need to be added to this set.
      */
     std::set<sorted_pair<CollisionGeometryPtr> > disabled_pairs;
 
+    /// The maximum number of conservative advancement iterations per pair (default=8)
+    /**
+     * A single iteration bounds the step using the configuration at the
+     * start of the step only; subsequent iterations advance along the
+     * predicted motion, so bodies that rotate or move past one another are
+     * not limited by the bound computed at the start of the step. Must be at
+     * least 1 (read from the "max-CA-iterations" attribute).
+     */
+    unsigned max_CA_iterations;
+
   private:
     // the 3 axes
     enum AxisType { eXAxis, eYAxis, eZAxis };
@@ -59,12 +80,38 @@ class CCD
       bool operator<(const BoundsStruct& bs) const { return (!end && bs.end); } 
     };
 
-    // gets the distance on farthest points
-    std::map<CollisionGeometryPtr, double> _rmax;
+    // body-frame data used to bound the motion of a geometry
+    struct SupportData
+    {
+      std::vector<Ravelin::Origin3d> verts;  // vertices (body frame)
+      bool sphere;                           // whether the geometry is a sphere
+      Ravelin::Origin3d center;              // center of a sphere (body frame)
+      double radius;                         // radius of a sphere
+      Ravelin::Quatd q;                      // primitive orientation (body frame)
+      Ravelin::Origin3d x;                   // primitive origin (body frame)
+      double rmax;                           // farthest distance from the body origin
+      bool use_rmax;                         // whether to bound using rmax instead of verts
+    };
+
+    // the maximum number of (convex hull) vertices checked per support query
+    static const unsigned MAX_SUPPORT_VERTS = 64;
+
+    // gets the body-frame support data for each geometry
+    std::map<CollisionGeometryPtr, SupportData> _support;
+
+    // scratch vertices and poses reused by contact generation
+    std::vector<Point3d> _vA, _vB, _verts;
+    boost::shared_ptr<Ravelin::Pose3d> _PA, _PB;
+
+    // scratch poses for the predicted body poses used by advancement
+    boost::shared_ptr<Ravelin::Pose3d> _FA, _FB;
 
     // see whether the bounds vectors need to be rebuilt
     bool _rebuild_bounds_vecs;
 
+    // the global transforms of all links and geometries (see update_poses())
+    PoseCache _poses;
+
     // the bounding spheres 
     std::map<CollisionGeometryPtr, BVPtr> _bounding_spheres; 
 
@@ -77,31 +124,42 @@ class CCD
     /// AABB bounds (z-axis)
     std::vector<std::pair<double, BoundsStruct> > _z_bounds;
 
-    /// Swept BVs computed during last call to is_contact/update_contacts()
-    std::map<CollisionGeometryPtr, BVPtr> _swept_BVs;
+    /// The swept BV of a geometry and its bounds in the global frame
+    struct SweptBV
+    {
+      BVPtr bv;                      // the swept BV (NULL until computed)
+      boost::shared_ptr<SSL> ssl;    // storage for the BV of a moving body
+      Point3d lo, hi;                // the bounds of the swept BV
+    };
+
+    /// Swept BVs computed during the last call to broad_phase(); the entries
+    /// (and their storage) persist between calls
+    std::map<CollisionGeometryPtr, SweptBV> _swept_BVs;
 
     static BVPtr construct_bounding_sphere(CollisionGeometryPtr cg);
     void sort_AABBs(const std::vector<RigidBodyPtr>& rigid_bodies, double dt);
     void update_bounds_vector(std::vector<std::pair<double, BoundsStruct> >& bounds, AxisType axis, double dt);
     void build_bv_vector(const std::vector<RigidBodyPtr>& rigid_bodies, std::vector<std::pair<double, BoundsStruct> >& bounds);
-    BVPtr get_swept_BV(CollisionGeometryPtr geom, BVPtr bv, double dt);
-
-    double calc_max_dist_per_t(RigidBodyPtr rb, const Ravelin::Vector3d& n, double rmax);
-    static double calc_max_velocity(RigidBodyPtr rb, const Ravelin::Vector3d& n, double rmax);
+    const SweptBV& get_swept_BV(CollisionGeometryPtr geom, BVPtr bv, double dt);
+    bool is_above_heightfield(CollisionGeometryPtr cg_hf, CollisionGeometryPtr cg, double dt);
+
+    const SupportData& get_support_data(CollisionGeometryPtr cg);
+    static double calc_support(const SupportData& s, const Ravelin::Vector3d& d);
+    double calc_max_dist_per_t(RigidBodyPtr rb, CollisionGeometryPtr cg, const Ravelin::Vector3d& n);
+    double calc_max_velocity(RigidBodyPtr rb, CollisionGeometryPtr cg, const Ravelin::Vector3d& n);
+    double calc_max_deviation_per_t(RigidBodyPtr rb, CollisionGeometryPtr cg);
+    static void calc_predicted_pose(RigidBodyPtr rb, double t, Ravelin::Pose3d& F);
     bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Ravelin::Transform3d& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b);
-    static Event create_contact(CollisionGeometryPtr a, CollisionGeometryPtr b, const Point3d& point, const Ravelin::Vector3d& normal);
 
     template <class OutputIterator>
     OutputIterator intersect_BV_leafs(BVPtr a, BVPtr b, const Ravelin::Transform3d& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, OutputIterator output_begin) const;
 
-    template <class OutputIterator>
-    OutputIterator find_contacts_sphere_sphere(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, OutputIterator output_begin);
-
-    template <class OutputIterator>
-    OutputIterator find_contacts_not_separated(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, OutputIterator output_begin);
-
-    template <class OutputIterator>
-    OutputIterator find_contacts_separated(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, double min_dist, OutputIterator output_begin);
+    void get_vertices(unsigned i, CollisionGeometryPtr cg, std::vector<Point3d>& verts) const;
+    double calc_dist_and_normal(unsigned i, CollisionGeometryPtr cg, const Point3d& p, Ravelin::Vector3d& n) const;
+    void find_contacts_sphere_sphere(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, unsigned iA, unsigned iB, ContactPool& pool);
+    void find_contacts_heightfield(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, unsigned iA, unsigned iB, ContactPool& pool);
+    void find_contacts_not_separated(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, unsigned iA, unsigned iB, ContactPool& pool);
+    void find_contacts_separated(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, unsigned iA, unsigned iB, double min_dist, ContactPool& pool);
 
     template <class RandomAccessIterator>
     void insertion_sort(RandomAccessIterator begin, RandomAccessIterator end);
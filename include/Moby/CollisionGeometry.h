@@ -75,6 +75,9 @@ class CollisionGeometry : public virtual Base
   private:
     boost::weak_ptr<SingleBody> _single_body;
     boost::weak_ptr<CollisionGeometry> _parent;
+
+    // scratch pose used to get vertices
+    boost::shared_ptr<Ravelin::Pose3d> _vertex_pose;
 }; // end class
 
 } // end namespace
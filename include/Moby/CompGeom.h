@@ -94,6 +94,8 @@ class CompGeom
     static double calc_closest_points(const LineSeg3& s1, const LineSeg3& s2, Point3d& p1, Point3d& p2); 
     static bool query_intersect_tri_tri(const Triangle& t1, const Triangle& t2);
     static PolygonLocationType in_tri(const Triangle& t, const Point3d& p, double tol = NEAR_ZERO);
+    static PolyhedronPtr calc_convex_hull_3D(const std::vector<Point3d>& points);
+    static void calc_convex_hull_2D(const std::vector<Point2d>& points, std::vector<Point2d>& hull);
 
     /// Returns a if b > 0, -a if b < 0, and 0 if b = 0
     static double sgn(double a, double b, double tol = NEAR_ZERO) { if (b > NEAR_ZERO) return a; else if (b < -NEAR_ZERO) return -a; else return 0.0; }
@@ -693,10 +693,11 @@ double CompGeomSpecOne<ForwardIterator, Point3d>::fit_plane(ForwardIterator begi
     mu += *i;
   mu /= n;
 
-  // create a matrix subtracting each point from the mean
-  SAFESTATIC Ravelin::LinAlgd _LA;
-  SAFESTATIC Ravelin::MatrixNd M, U, V;
-  SAFESTATIC Ravelin::VectorNd S;
+  // create a matrix subtracting each point from the mean (workspaces are
+  // local so that OBB fitting remains reentrant)
+  Ravelin::LinAlgd _LA;
+  Ravelin::MatrixNd M, U, V;
+  Ravelin::VectorNd S;
   M.resize(n, THREE_D);
   unsigned idx = 0;
   for (ForwardIterator i = begin; i != end; i++)
@@ -1149,11 +1150,11 @@ void CompGeomSpecOne<ForwardIterator, Point2d>::calc_min_area_bounding_rect(Forw
   const unsigned X = 0, Y = 1;
   std::pair<Point2d, Point2d> ep;
 
-  // calculate the convex hull of the points in ccw order
+  // calculate the convex hull of the points in ccw order (reentrant)
   std::vector<Point2d> points, hull;
   for (; begin != end; begin++)
     points.push_back(*begin);
-  CompGeom::calc_convex_hull(points.begin(), points.end(), std::back_inserter(hull));
+  CompGeom::calc_convex_hull_2D(points, hull);
   if (hull.empty())
   {
     // convex hull is degenerate; compute line endpoints and make that the 
@@ -0,0 +1,79 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_CONTACT_BLOCK_MATRIX_H
+#define _MOBY_CONTACT_BLOCK_MATRIX_H
+
+#include <vector>
+#include <Ravelin/MatrixNd.h>
+#include <Ravelin/VectorNd.h>
+
+namespace Moby {
+
+/// A block-sparse contact-space matrix (e.g., [Cn; Cs; Ct]*inv(M)*[Cn; Cs; Ct]')
+/**
+ * Two contacts are coupled only if they share a (super) body, so the
+ * contact-space inertia of a large island is mostly structural zeros. This
+ * matrix stores only the 3x3 blocks (normal, first tangent, second tangent)
+ * of coupled contacts, row by row, with the blocks of each row sorted by
+ * column. Block (i,j) is stored row-major: entry (r,c) couples direction r
+ * of contact i with direction c of contact j. Stacked vectors are ordered
+ * as in EventProblemData: [normal; first tangent; second tangent].
+ *
+ * Storage and assembly cost scale with the number of coupled contact pairs
+ * rather than with the square of the number of contacts.
+ */
+class ContactBlockMatrix
+{
+  public:
+    /// The number of doubles in a block
+    static const unsigned BLOCK = 9;
+
+    ContactBlockMatrix() { _n = 0; }
+    void set_structure(unsigned n, const std::vector<std::vector<unsigned> >& groups);
+    void set_zero();
+    double* get_block(unsigned i, unsigned j);
+    const double* get_block(unsigned i, unsigned j) const;
+    Ravelin::VectorNd& mult(const Ravelin::VectorNd& x, Ravelin::VectorNd& y) const;
+    Ravelin::SparseMatrixNd& to_sparse(unsigned r, unsigned c, Ravelin::SparseMatrixNd& M) const;
+    Ravelin::MatrixNd& to_dense(unsigned r, unsigned c, Ravelin::MatrixNd& M) const;
+
+    /// Gets the number of contacts (block rows)
+    unsigned size() const { return _n; }
+
+    /// Gets the number of (structurally) nonzero blocks
+    unsigned num_blocks() const { return _cols.size(); }
+
+    /// Gets the index of the first block of row i (row_begin(i+1) is one past its last)
+    unsigned row_begin(unsigned i) const { return _row_begin[i]; }
+
+    /// Gets the (contact) column of the k'th block
+    unsigned column(unsigned k) const { return _cols[k]; }
+
+    /// Gets the k'th block
+    double* block(unsigned k) { return &_blocks[k*BLOCK]; }
+
+    /// Gets the k'th block
+    const double* block(unsigned k) const { return &_blocks[k*BLOCK]; }
+
+  private:
+    /// The number of contacts
+    unsigned _n;
+
+    /// The index of the first block of each row (one extra entry holds the number of blocks)
+    std::vector<unsigned> _row_begin;
+
+    /// The column of each block
+    std::vector<unsigned> _cols;
+
+    /// The blocks
+    std::vector<double> _blocks;
+}; // end class
+
+} // end namespace
+
+#endif
+
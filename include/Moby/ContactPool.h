@@ -0,0 +1,90 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_CONTACT_POOL_H_
+#define _MOBY_CONTACT_POOL_H_
+
+#include <map>
+#include <vector>
+#include <Moby/Types.h>
+#include <Moby/ContactRecord.h>
+#include <Moby/Event.h>
+
+namespace Moby {
+
+class ContactParameters;
+
+/// Reusable storage for the contact records generated during a step
+/**
+ * Clearing the pool keeps its storage, and geometries and bodies are
+ * assigned dense indices the first time they are seen, so contact
+ * generation does not allocate once the pool has grown to the size of the
+ * largest contact set. Events are materialized from the records only as
+ * views for the event handlers and callbacks.
+ */
+class ContactPool
+{
+  public:
+    void add(CollisionGeometryPtr a, CollisionGeometryPtr b, const Point3d& point, const Ravelin::Vector3d& normal);
+    void set_contact_parameters(unsigned first, const ContactParameters& cparams);
+    unsigned get_geometry_index(CollisionGeometryPtr cg);
+    unsigned get_body_index(DynamicBodyPtr db);
+    void get_event(unsigned i, Event& e) const;
+    void reset();
+
+    template <class OutputIterator>
+    OutputIterator get_events(OutputIterator output_begin) const;
+
+    /// Removes all records (the storage is kept for reuse)
+    void clear() { _records.clear(); }
+
+    /// Gets the number of records in the pool
+    unsigned size() const { return _records.size(); }
+
+    /// Gets the i'th record
+    const ContactRecord& operator[](unsigned i) const { return _records[i]; }
+
+    /// Gets the collision geometry with the given index
+    CollisionGeometryPtr get_geometry(unsigned i) const { return _geoms[i]; }
+
+    /// Gets the super body with the given index
+    DynamicBodyPtr get_body(unsigned i) const { return _bodies[i]; }
+
+  private:
+    /// The contact records
+    std::vector<ContactRecord> _records;
+
+    /// The collision geometries, indexed by the records
+    std::vector<CollisionGeometryPtr> _geoms;
+
+    /// The super bodies, indexed by the records
+    std::vector<DynamicBodyPtr> _bodies;
+
+    /// Mapping from collision geometries to their indices
+    std::map<CollisionGeometry*, unsigned> _geom_index;
+
+    /// Mapping from super bodies to their indices
+    std::map<DynamicBody*, unsigned> _body_index;
+}; // end class
+
+/// Materializes an event for every record in the pool
+template <class OutputIterator>
+OutputIterator ContactPool::get_events(OutputIterator output_begin) const
+{
+  Event e;
+  for (unsigned i=0; i< _records.size(); i++)
+  {
+    get_event(i, e);
+    *output_begin++ = e;
+  }
+
+  return output_begin;
+}
+
+} // end namespace
+
+#endif
+
@@ -0,0 +1,56 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_CONTACT_RECORD_H_
+#define _MOBY_CONTACT_RECORD_H_
+
+namespace Moby {
+
+/// Compact, plain-data description of a single point contact
+/**
+ * Records are produced by contact generation and stored in a ContactPool;
+ * geometries and bodies are referred to by their dense indices in the pool
+ * (rather than by shared pointers), and the point and normal are raw
+ * doubles in the global frame, so records may be copied with memcpy.
+ */
+struct ContactRecord
+{
+  /// Index of the first collision geometry in the pool
+  unsigned geom1;
+
+  /// Index of the second collision geometry in the pool
+  unsigned geom2;
+
+  /// Index of the super body of the first geometry in the pool
+  unsigned body1;
+
+  /// Index of the super body of the second geometry in the pool
+  unsigned body2;
+
+  /// The contact point (global frame)
+  double point[3];
+
+  /// The contact normal, pointing toward the first body (global frame)
+  double normal[3];
+
+  /// The coefficient of Coulomb friction
+  double mu_coulomb;
+
+  /// The coefficient of viscous friction
+  double mu_viscous;
+
+  /// The coefficient of restitution
+  double epsilon;
+
+  /// The number of friction directions (>= 4; zero if the contact 
+  /// parameters have not been set)
+  unsigned NK;
+}; // end struct
+
+} // end namespace
+
+#endif
+
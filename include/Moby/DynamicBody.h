@@ -31,6 +31,7 @@ class DynamicBody : public Visualizable
     { 
       controller = NULL; 
       _kinematic_update = false;
+      _sleeping = false;
     }
 
     virtual ~DynamicBody() {}
@@ -196,6 +197,12 @@ class DynamicBody : public Visualizable
     /// Sets whether this body is kinematically updated (rather than having its dynamics integrated); default is false
     virtual void set_kinematic(bool flag) { _kinematic_update = flag; }
 
+    /// Gets whether this body has been put to sleep (sleeping bodies are not integrated)
+    bool is_sleeping() const { return _sleeping; }
+
+    /// Sets whether this body is asleep; users generally should not call this
+    virtual void set_sleeping(bool flag) { _sleeping = flag; }
+
     /// Prepares to compute the derivative of the body (sustained events) 
     virtual void prepare_to_calc_ode_accel_events(Ravelin::SharedConstVectorNd& x, double t, double dt, void* data) = 0;
 
@@ -219,6 +226,9 @@ class DynamicBody : public Visualizable
     /// Kinematic update flag
     bool _kinematic_update;
 
+    /// Sleep flag (set by the simulator when the body comes to rest)
+    bool _sleeping;
+
     /// Temporaries for use with integration
     Ravelin::VectorNd gc, gv, gcgv, xp, xv, xa;
 
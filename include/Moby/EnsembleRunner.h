@@ -0,0 +1,149 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_ENSEMBLE_RUNNER_H_
+#define _MOBY_ENSEMBLE_RUNNER_H_
+
+#include <map>
+#include <list>
+#include <string>
+#include <vector>
+#include <Ravelin/VectorNd.h>
+#include <Moby/Types.h>
+#ifdef THREADSAFE
+#include <pthread.h>
+#endif
+
+namespace Moby {
+
+/// Simulates many independent copies ("instances") of one world in a single process
+/**
+ * The XML file describing the world is parsed once; each instance is then
+ * constructed from its own copy of the parsed tree, so that per-instance 
+ * overrides of attributes may be applied before any object is built. Meshes
+ * and their flat BVHs are shared between instances through the
+ * MeshAssetCache; everything else (bodies, simulators, etc.) is private to
+ * an instance, so instances are stepped concurrently on a pool of threads
+ * when Moby is built with THREADSAFE (and sequentially otherwise). The 
+ * simulation code keeps its scratch storage in SAFESTATIC variables, which 
+ * THREADSAFE builds make local to each call.
+ *
+ * The state of every instance is recorded into a columnar buffer as it is
+ * simulated: one column holds the simulation time, one holds the wall-clock
+ * time (in seconds) spent in the most recent call to Simulator::step(), and
+ * one holds each generalized coordinate (Euler)
+ * and generalized velocity (spatial) of each body, with bodies in order of
+ * ID.
+ */
+class EnsembleRunner
+{
+  public:
+    /// Function applied to the objects of an instance after construction
+    typedef void (*OverrideFn)(unsigned instance, std::map<std::string, BasePtr>& id_map, void* data);
+
+    EnsembleRunner();
+    void set_override(unsigned instance, const std::string& id, const std::string& attrib, const std::string& value);
+    void load(const std::string& fname, unsigned num_instances, OverrideFn fn = NULL, void* data = NULL);
+    void run(double step_size, unsigned num_steps, unsigned record_interval = 1);
+    void clear_records();
+    void write(const std::string& fname) const;
+
+    /// Sets the number of threads used to load and step instances
+    void set_num_threads(unsigned n) { _num_threads = (n > 0) ? n : 1; }
+
+    /// Gets the number of instances
+    unsigned num_instances() const { return _instances.size(); }
+
+    /// Gets the simulator of an instance
+    SimulatorPtr get_simulator(unsigned i) const { return _instances[i].sim; }
+
+    /// Gets the objects of an instance (indexed by ID)
+    const std::map<std::string, BasePtr>& get_id_map(unsigned i) const { return _instances[i].id_map; }
+
+    /// Determines whether simulating an instance failed (and was stopped)
+    bool failed(unsigned i) const { return !_instances[i].error.empty(); }
+
+    /// Gets the error that stopped an instance (empty if none)
+    const std::string& get_error(unsigned i) const { return _instances[i].error; }
+
+    /// Gets the names of the recorded columns of an instance
+    const std::vector<std::string>& get_column_names(unsigned i) const { return _instances[i].column_names; }
+
+    /// Gets a recorded column of an instance (one value per recorded step)
+    const std::vector<double>& get_column(unsigned i, unsigned j) const { return _instances[i].columns[j]; }
+
+  private:
+    /// An attribute override
+    struct Override
+    {
+      std::string id;       // the ID of the node to modify
+      std::string attrib;   // the name of the attribute
+      std::string value;    // the new value of the attribute
+    };
+
+    /// The data of one instance
+    struct Instance
+    {
+      std::map<std::string, BasePtr> id_map;      // objects of the instance
+      SimulatorPtr sim;                           // the simulator
+      std::vector<DynamicBodyPtr> bodies;         // bodies, sorted by ID
+      std::vector<std::string> column_names;      // names of the columns
+      std::vector<std::vector<double> > columns;  // the recorded columns
+      std::string error;                          // error stopping the instance
+      double step_time;                           // duration of the last step
+      Ravelin::VectorNd work;                     // workspace for recording
+    };
+
+    /// Arguments passed to a worker thread
+    struct Job
+    {
+      EnsembleRunner* runner;     // the runner
+      void (*fn)(EnsembleRunner*, unsigned, void*);  // function applied to each instance
+      void* arg;                  // argument to the function
+      unsigned next;              // the next instance to process
+      #ifdef THREADSAFE
+      pthread_mutex_t mutex;      // protects next
+      #endif
+    };
+
+    /// Arguments for loading instances
+    struct LoadArgs
+    {
+      XMLTreePtr tree;            // the tree read from the file
+      OverrideFn fn;              // the override function
+      void* data;                 // data passed to the override function
+    };
+
+    /// Arguments for stepping instances
+    struct RunArgs
+    {
+      double step_size;           // the step size
+      unsigned num_steps;         // the number of steps
+      unsigned record_interval;   // the number of steps between records
+    };
+
+    void for_each_instance(void (*fn)(EnsembleRunner*, unsigned, void*), void* arg);
+    static void* worker(void* arg);
+    static void load_instance(EnsembleRunner* runner, unsigned i, void* arg);
+    static void run_instance(EnsembleRunner* runner, unsigned i, void* arg);
+    static void setup_columns(Instance& inst);
+    static void record(Instance& inst);
+    static void apply_override(XMLTreePtr root, const Override& o);
+
+    /// The instances
+    std::vector<Instance> _instances;
+
+    /// Attribute overrides for each instance
+    std::map<unsigned, std::list<Override> > _overrides;
+
+    /// The number of threads used
+    unsigned _num_threads;
+}; // end class
+
+} // end namespace
+
+#endif
+
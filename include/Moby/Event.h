@@ -31,7 +31,7 @@ class Event
     enum DerivType { eVel, eAccel };
     enum CoulombFrictionType { eUndetermined, eSlipping, eSticking }; 
     Event();
-    Event(const Event& e) { _event_frame = boost::shared_ptr<Ravelin::Pose3d>(new Ravelin::Pose3d); *this = e; }
+    Event(const Event& e) { *this = e; }
     static void determine_connected_events(const std::vector<Event>& events, std::list<std::list<Event*> >& groups);
     static void remove_inactive_groups(std::list<std::list<Event*> >& groups);
     Event& operator=(const Event& e);
@@ -128,6 +128,9 @@ class Event
     /// The number of friction directions >= 4 (for contact events)
     unsigned contact_NK;
 
+    /// Whether the contact parameters above have been set from the simulator's contact parameters (for contact events)
+    bool contact_parameters_set;
+
     osg::Node* to_visualization_data() const;
 
     /// Tolerance for the event (users never need to modify this)
@@ -149,11 +152,6 @@ class Event
     };
 
 
-    // static variables
-    boost::shared_ptr<Ravelin::Pose3d> _event_frame;
-    static Ravelin::MatrixNd JJ, J, Jx, Jy, J1, J2, dJ1, dJ2, workM1, workM2;
-    static Ravelin::VectorNd v, workv, workv2;
-
     // the type of friction contact (acceleration-level only)
     CoulombFrictionType _ftype;
     void compute_vevent_data(Ravelin::MatrixNd& M, Ravelin::VectorNd& q) const;
@@ -13,6 +13,8 @@
 #include <Moby/ImpactEventHandler.h>
 #include <Moby/AccelerationEventHandler.h>
 #include <Moby/CCD.h>
+#include <Moby/GeneralizedCCD.h>
+#include <Moby/ContactPool.h>
 #include <Moby/Event.h>
 
 namespace Moby {
@@ -32,15 +34,18 @@ class EventDrivenSimulator : public Simulator
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
     virtual double step(double dt);
+    virtual void apply_snapshot(const Snapshot& s);
+    virtual void add_dynamic_body(DynamicBodyPtr body);
+    virtual void remove_dynamic_body(DynamicBodyPtr body);
 
     /// Determines whether two geometries are not checked
     std::set<sorted_pair<CollisionGeometryPtr> > unchecked_pairs;
 
     /// The coordinates vector before and after the step
-    std::vector<Ravelin::VectorNd> _q0, _qf, _qsave;
+    std::vector<Ravelin::VectorNd> _q0, _qf;
 
     /// The velocities vector before and after the step
-    std::vector<Ravelin::VectorNd> _qd0, _qdf, _qdsave;
+    std::vector<Ravelin::VectorNd> _qd0, _qdf;
 
     /// Vectors set and passed to collision detection
     std::vector<std::pair<DynamicBodyPtr, Ravelin::VectorNd> > _x0, _x1;
@@ -77,12 +82,18 @@ class EventDrivenSimulator : public Simulator
     /// Mapping from objects to contact parameters
     std::map<sorted_pair<BasePtr>, boost::shared_ptr<ContactParameters> > contact_params;
 
+    /// Contact parameters used for pairs of objects not in contact_params (if any)
+    boost::shared_ptr<ContactParameters> default_contact_params;
+
     /// If set to 'true' event driven simulator will process contact points for rendering
     bool render_contact_points;
 
-    /// User time spent by collision detection on the last step
+    /// User time spent by (narrow phase) collision detection on the last step
     double coldet_time;
 
+    /// User time spent by broad phase collision detection on the last step
+    double broad_phase_time;
+
     /// User time spent by event handling on the last step
     double event_time;
 
@@ -98,8 +109,47 @@ class EventDrivenSimulator : public Simulator
     /// The maximum time allowed for processing events
     double max_event_time;
 
+    /// If 'true', each contact island is integrated separately (default=false)
+    /**
+     * Islands are integrated independently over the same synchronization 
+     * horizon, so a variable-step integrator can take large steps for 
+     * quiescent islands while taking small steps for active ones.
+     * \note mini-steps that are integrated with acceleration events (when
+     *       events are active at the current time) and semi-implicit Euler
+     *       steps always integrate all bodies together
+     */
+    bool multirate;
+
+    /// If 'true', islands of bodies at rest are put to sleep (default=false)
+    bool allow_sleep;
+
+    /// Kinetic energy (per body) below which an island is at rest (default=1e-6)
+    double sleep_KE_tol;
+
+    /// Generalized speed below which an island is at rest (default=1e-4)
+    double sleep_vel_tol;
+
+    /// Time that an island must remain at rest before sleeping (default=0.5)
+    double sleep_time;
+
+    /// Methods for bounding the time until the next contact
+    enum ContactTimeMethod { eConservativeAdvancement, eTimeOfImpact };
+
+    /// The method for bounding the time until the next contact (default=eConservativeAdvancement)
+    /**
+     * Conservative advancement uses bounds on the body velocities and is
+     * cheap, but fast moving or thin objects force it into tiny steps;
+     * computing exact times of impact (via GeneralizedCCD) permits the
+     * simulator to step directly to the next contact.
+     */
+    ContactTimeMethod contact_time_method;
+
   protected:
     virtual void check_pairwise_constraint_violations();
+    virtual void fill_snapshot(Snapshot& s);
+
+    /// Contact points and normals found during the current step (for snapshots; 6 per contact)
+    std::vector<double> _snapshot_contacts;
 
   private:
     struct EventCmp
@@ -110,8 +160,8 @@ class EventDrivenSimulator : public Simulator
     template <class ForwardIterator>
     double integrate_with_accel_events(double step_size, ForwardIterator begin, ForwardIterator end);
 
-    /// Integrates all dynamic bodies
-    double integrate_with_accel_events(double step_size) { return integrate_with_accel_events(step_size, _bodies.begin(), _bodies.end()); }
+    /// Updates the kinematic bodies and integrates all dynamic bodies
+    double integrate_with_accel_events(double step_size) { update_kinematic_bodies(current_time); return integrate_with_accel_events(step_size, _dynamic_bodies.begin(), _dynamic_bodies.end()); }
 
     void handle_acceleration_events();
     void check_constraint_velocity_violations();
@@ -122,13 +172,22 @@ class EventDrivenSimulator : public Simulator
     void save_state();
     void restore_state();
     void calc_fwd_dyn() const;
+    void determine_islands(std::vector<std::vector<DynamicBodyPtr> >& islands);
+    double integrate_multirate(double step_size);
+    static unsigned find_island_root(std::vector<unsigned>& parent, unsigned i);
+    void update_sleeping(double dt);
+    bool wake_islands(double dt);
+    bool wake_disturbed_islands();
+    static bool is_active(CollisionGeometryPtr cg);
+    static bool is_disturbed(DynamicBodyPtr db);
+    static void merge_islands(const std::map<DynamicBodyPtr, unsigned>& body_index, std::vector<unsigned>& parent, DynamicBodyPtr db1, DynamicBodyPtr db2);
     void step_si_Euler(double dt);
     static void determine_treated_bodies(std::list<std::list<Event*> >& groups, std::vector<DynamicBodyPtr>& bodies);
     void find_events();
     void preprocess_event(Event& e);
     void handle_events();
     boost::shared_ptr<ContactParameters> get_contact_parameters(CollisionGeometryPtr geom1, CollisionGeometryPtr geom2) const;
-    double calc_CA_step();
+    double calc_CA_step(double dt_max);
     void update_constraint_violations();
     void determine_geometries();
     void calculate_bounds() const;
@@ -140,9 +199,18 @@ class EventDrivenSimulator : public Simulator
     /// The continuous collision detection mechanism
     mutable CCD _ccd;
 
+    /// The time of impact mechanism (used for eTimeOfImpact)
+    GeneralizedCCD _gccd;
+
     /// Work vector
     Ravelin::VectorNd _workV;
 
+    /// The saved state of all bodies (laid out using _state_offsets)
+    Ravelin::VectorNd _xsave;
+
+    /// The contact records found by the last call to find_events()
+    ContactPool _contact_pool;
+
     /// The vector of events
     std::vector<Event> _events;
 
@@ -169,6 +237,18 @@ class EventDrivenSimulator : public Simulator
 
     /// Geometric pairs that should be checked for events (according to broad phase collision detection)
     std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> > _pairs_to_check;
+
+    /// Islands of (awake) bodies, determined once per step
+    std::vector<std::vector<DynamicBodyPtr> > _islands;
+
+    /// Whether _islands has been determined for the current step
+    bool _islands_valid;
+
+    /// Islands of bodies that are currently asleep
+    std::vector<std::vector<DynamicBodyPtr> > _sleeping_islands;
+
+    /// The amount of time that each body has been at rest
+    std::map<DynamicBodyPtr, double> _rest_time;
 }; // end class
 
 #include "EventDrivenSimulator.inl"
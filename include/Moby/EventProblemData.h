@@ -7,6 +7,7 @@
 #include <Ravelin/VectorNd.h>
 #include <Moby/Event.h>
 #include <Moby/Types.h>
+#include <Moby/ContactBlockMatrix.h>
 
 namespace Moby {
 
@@ -84,6 +85,10 @@ struct EventProblemData
     L_iM_JxT = q.L_iM_JxT;
     Jx_iM_JxT = q.Jx_iM_JxT;
 
+    // copy block-sparse contact terms
+    sparse_contacts = q.sparse_contacts;
+    C_iM_CT = q.C_iM_CT;
+
     // copy impulse magnitudes 
     cn = q.cn;
     cs = q.cs;
@@ -144,6 +149,10 @@ struct EventProblemData
     L_iM_LT.resize(0,0);
     L_iM_JxT.resize(0,0);
     Jx_iM_JxT.resize(0,0);
+
+    // reset block-sparse contact terms
+    sparse_contacts = false;
+    C_iM_CT.set_structure(0, std::vector<std::vector<unsigned> >());
   }
 
   // sets up indices for a QP
@@ -339,6 +348,13 @@ struct EventProblemData
   Ravelin::MatrixNd                                   L_iM_LT, L_iM_JxT;
   Ravelin::MatrixNd                                            Jx_iM_JxT;
 
+  // if true, contact/contact terms are stored only in C_iM_CT (the dense
+  // contact/contact matrices above are empty)
+  bool sparse_contacts;
+
+  // block-sparse contact/contact terms: [Cn; Cs; Ct]*inv(M)*[Cn; Cs; Ct]'
+  ContactBlockMatrix C_iM_CT;
+
   // vector-based terms
   Ravelin::VectorNd Cn_v, Cs_v, Ct_v, L_v, Jx_v;
 
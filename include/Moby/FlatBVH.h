@@ -0,0 +1,90 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_FLAT_BVH_H_
+#define _MOBY_FLAT_BVH_H_
+
+#include <vector>
+#include <utility>
+#include <Ravelin/Transform3d.h>
+#include <Ravelin/Origin3d.h>
+#include <Ravelin/Vector3d.h>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+class IndexedTriArray;
+
+/// A linearized axis-aligned bounding volume hierarchy over a triangle mesh
+/**
+ * All nodes are stored in one contiguous array in depth-first order: the
+ * left child of an internal node immediately follows it and the node records
+ * the index of its right child. Each leaf records a range within a single
+ * permuted array of triangle indices. The hierarchy is built top-down using
+ * the surface area heuristic (SAH) over binned triangle centroids and is
+ * queried without any heap allocation. Angle-weighted pseudo-normals of the
+ * mesh's vertices and edges are stored alongside the hierarchy so that the
+ * side of a point can be determined even when its closest point on the mesh
+ * lies on an edge or a vertex.
+ */
+class FlatBVH
+{
+  public:
+    /// A node of the hierarchy
+    struct Node
+    {
+      double lo[3];       // lower corner of the box
+      double hi[3];       // upper corner of the box
+      unsigned offset;    // right child (internal) or first triangle (leaf)
+      unsigned count;     // number of triangles (zero for internal nodes)
+      bool is_leaf() const { return count > 0; }
+    };
+
+    FlatBVH() {}
+    FlatBVH(const IndexedTriArray& mesh) { build(mesh); }
+    void build(const IndexedTriArray& mesh);
+    void clear();
+    void assign(const Node* nodes, unsigned num_nodes, const unsigned* tri_idx, unsigned num_tri_idx);
+    void calc_pseudo_normals(const IndexedTriArray& mesh);
+    double calc_closest_tri(const IndexedTriArray& mesh, const Point3d& p, unsigned& tri, Point3d& closest) const;
+    static void intersect(const FlatBVH& a, const FlatBVH& b, const Ravelin::Transform3d& aTb, std::vector<std::pair<unsigned, unsigned> >& tri_pairs);
+    double calc_signed_dist(const IndexedTriArray& mesh, const Point3d& p, Ravelin::Vector3d& normal) const;
+    Ravelin::Vector3d get_pseudo_normal(const IndexedTriArray& mesh, unsigned tri, const Point3d& closest) const;
+
+    /// Determines whether the hierarchy is empty
+    bool empty() const { return _nodes.empty(); }
+
+    /// Gets the nodes of the hierarchy (the root is the first node)
+    const std::vector<Node>& get_nodes() const { return _nodes; }
+
+    /// Gets the permuted triangle indices referenced by the leaves
+    const std::vector<unsigned>& get_tri_indices() const { return _tri_idx; }
+
+    /// The maximum depth of a hierarchy; deeper subtrees are made into leaves
+    static const unsigned MAX_DEPTH = 40;
+
+  private:
+    unsigned build_node(unsigned begin, unsigned end, unsigned depth, const std::vector<double>& centroids, const std::vector<double>& boxes);
+    static bool overlaps(const Node& a, const Node& b, const double R[3][3], const double absR[3][3], const double t[3]);
+    static double calc_sq_dist(const Node& n, const Point3d& p);
+
+    /// The nodes of the hierarchy
+    std::vector<Node> _nodes;
+
+    /// The triangle indices referenced by the leaves
+    std::vector<unsigned> _tri_idx;
+
+    /// The angle-weighted pseudo-normals of the mesh vertices
+    std::vector<Ravelin::Origin3d> _vertex_normals;
+
+    /// The pseudo-normals of the edges of each triangle (edges ab, bc, ca)
+    std::vector<Ravelin::Origin3d> _edge_normals;
+}; // end class
+
+} // end namespace
+
+#endif
+
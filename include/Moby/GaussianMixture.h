@@ -2,6 +2,7 @@
 #define _GAUSSMIX_H_
 
 #include <Moby/Primitive.h>
+#include <Moby/FastThreadable.h>
 
 namespace Moby {
 
@@ -19,6 +20,7 @@ class GaussianMixture : public Primitive
       double th;       // planar rotation of the Gaussian
     };
 
+    GaussianMixture();
     void rebuild(const std::vector<Gauss>& gauss);
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
@@ -32,6 +34,8 @@ class GaussianMixture : public Primitive
     virtual osg::Node* create_visualization();
     virtual double calc_dist_and_normal(const Point3d& p, Ravelin::Vector3d& normal) const;
     virtual double calc_signed_dist(boost::shared_ptr<const Primitive> p, boost::shared_ptr<const Ravelin::Pose3d> pose_this, boost::shared_ptr<const Ravelin::Pose3d> pose_p, Point3d& pthis, Point3d& pb) const;
+    double calc_height(double x, double y, Ravelin::Vector3d& normal) const;
+    void calc_heights(unsigned n, const double* x, const double* y, double* h, double* dhdx, double* dhdy) const;
 
     private:
       static Ravelin::Vector3d grad(const Gauss& g, double x, double y);
@@ -42,7 +46,12 @@ class GaussianMixture : public Primitive
       static double gauss(const Gauss& g, double x, double y);
       void construct_vertices();
       void construct_BVs(CollisionGeometryPtr geom);
+      void construct_grid();
       void create_mesh();
+      int eval(double x, double y, double& h, double& dhdx, double& dhdy) const;
+      void calc_gradient(unsigned k, double x, double y, double h, double& dhdx, double& dhdy) const;
+      double calc_height_bound(double xmin, double ymin, double xmax, double ymax) const;
+      bool get_cells(double xmin, double ymin, double xmax, double ymax, unsigned& i0, unsigned& j0, unsigned& i1, unsigned& j1) const;
 
       /// Note: there are no mass properties, because this can have no mass!
       virtual void calc_mass_properties() { }
@@ -59,6 +68,12 @@ class GaussianMixture : public Primitive
       /// The bounding volumes (OBB)
       OBBPtr _root;
 
+      /// The pose of the primitive relative to the collision geometry (rebuilt with the BVs; read-only during queries)
+      boost::shared_ptr<Ravelin::Pose3d> _query_pose;
+
+      /// Per-thread candidate Gaussian buffer for segment queries
+      mutable FastThreadable<std::vector<unsigned> > _candidates;
+
       /// The set of Gaussians
       std::vector<Gauss> _gauss;
 
@@ -70,6 +85,27 @@ class GaussianMixture : public Primitive
 
       /// Set of submeshes
       std::vector<std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> > > _submesh; 
+
+      /// Lower left corner of the terrain grid (in the primitive frame)
+      double _grid_x0, _grid_y0;
+
+      /// Side length of a (square) grid cell
+      double _cell_size;
+
+      /// Number of grid cells along x and y
+      unsigned _grid_nx, _grid_ny;
+
+      /// Index of the first entry of each grid cell (one extra entry at the end)
+      std::vector<unsigned> _cell_start;
+
+      /// The Gaussian referenced by each grid cell entry
+      std::vector<unsigned> _cell_gauss;
+
+      /// Upper bound on the mixture height over each grid cell
+      std::vector<double> _cell_hmax;
+
+      /// Gaussian coefficients for each grid cell entry (stored as separate arrays so that cell evaluation vectorizes)
+      std::vector<double> _cA, _ccth, _csth, _cx0, _cy0, _cax, _cay;
 }; // end class
 
 } // end namespace Moby
@@ -1,181 +1,130 @@
 /****************************************************************************
- * Copyright 2009 Evan Drumwright
- * This library is distributed under the terms of the GNU Lesser General Public 
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
  * License (found in COPYING).
  ****************************************************************************/
 
 #ifndef _GENERALIZED_CCD_H
 #define _GENERALIZED_CCD_H
 
-#include <list>
-#include <set>
 #include <map>
-#include <boost/shared_ptr.hpp>
-#include <Moby/sorted_pair>
-#include <Moby/Log.h>
-#include <Moby/CollisionDetection.h>
-#include <Moby/ThickTriangle.h>
-#include <Moby/BV.h>
-#include <Moby/CompGeom.h>
-#include <Moby/Integrator.h>
+#include <vector>
+#include <Moby/Types.h>
 
 namespace Moby {
 
 class RigidBody;
-class ArticulatedBody;
-class CollisionGeometry;  
-
-/// Implements the CollisionDetection abstract class to perform exact contact finding using abstract shapes 
-class GeneralizedCCD : public CollisionDetection
+class CollisionGeometry;
+
+/// Computes exact times of impact between pairs of moving geometries
+/**
+ * The path of each rigid body is predicted from its current twist: its
+ * origin translates with the current linear velocity and its orientation
+ * rotates about the current angular velocity. The bodies' current
+ * accelerations are assumed to bound their accelerations over the interval;
+ * the actual path of a point then deviates from the predicted one by at
+ * most half of its acceleration bound times t^2, and this deviation is
+ * subtracted from the predicted distances (with zero accelerations, the
+ * motion is exactly the constant-twist motion). The time of impact is found
+ * by advancing every vertex of each geometry along its path relative to the
+ * other geometry; each advance is the distance of the vertex from the other
+ * geometry divided by a bound on the vertex's speed, so the advancement
+ * never steps past the first time that the vertex reaches the geometry.
+ * Spheres are represented exactly by their centers (offset by their radii).
+ * Primitive::calc_dist_and_normal() must return a lower bound on the
+ * distance of a point (the primitives compute exact distances, except for
+ * heightfields, whose distances are conservative).
+ *
+ * Body motions and geometry vertices are gathered once per query (the only
+ * part of the query that touches body state), after which pairs are
+ * checked in parallel (when OpenMP is enabled) using only local transforms
+ * and Primitive::calc_dist_and_normal(), which must not use static scratch
+ * data; no pose of any body, geometry, or primitive is modified.
+ *
+ * \note Only vertices (and sphere centers) are advanced, so an impact is
+ *       found only once a vertex reaches the other geometry. Edge/edge
+ *       impacts between polyhedra are missed: two thin boxes that cross
+ *       edge-first (neither having a vertex that passes through the other)
+ *       can tunnel through each other. Heightfield vertices are never
+ *       advanced, so a heightfield is only detected against the vertices of
+ *       the other geometry.
+ */
+class GeneralizedCCD
 {
   public:
     GeneralizedCCD();
-    virtual ~GeneralizedCCD() {}
-    virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
-    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
-    virtual bool is_collision(double epsilon = 0.0);
-    virtual bool is_contact(double dt, const std::vector<std::pair<DynamicBodyPtr, Ravelin::VectorNd> >& q0, const std::vector<std::pair<DynamicBodyPtr, Ravelin::VectorNd> >& q1, std::vector<Event>& contacts);
-    virtual void add_collision_geometry(CollisionGeometryPtr geom);
-    virtual void remove_collision_geometry(CollisionGeometryPtr geom);
-    virtual void remove_all_collision_geometries();
-    virtual void add_rigid_body(RigidBodyPtr body); 
-    virtual void remove_rigid_body(RigidBodyPtr body); 
-    virtual void add_articulated_body(ArticulatedBodyPtr abody, bool disable_adjacent);
-    virtual void remove_articulated_body(ArticulatedBodyPtr abody);
-
-    template <class InputIterator>
-    GeneralizedCCD(InputIterator begin, InputIterator end);
-
-    /// The tolerance below which subdivision does not occur
-    double eps_tolerance;
+    double calc_TOI(double dt, const std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& pairs);
+    double calc_TOI(double dt, CollisionGeometryPtr cgA, CollisionGeometryPtr cgB);
 
-  private:
+    /// The distance at which a vertex is considered to have made contact (default=NEAR_ZERO)
+    double toi_tolerance;
 
-    // the 3 axes
-    enum AxisType { eXAxis, eYAxis, eZAxis };
+    /// The maximum number of advancements per vertex (default=100)
+    /**
+     * If a vertex has not made contact after this many advancements, the
+     * time reached so far (which is conservative) is used.
+     */
+    unsigned max_iterations;
 
-    // structure for doing broad phase collision detection
-    struct BoundsStruct
+  private:
+    /// The motion of a rigid body over the query interval (global frame)
+    struct BodyMotion
     {
-      bool end;                   // bounds is for start or end
-      CollisionGeometryPtr geom;  // the geometry
-      BVPtr bv;                   // the unexpanded bounding volume
-      bool operator<(const BoundsStruct& bs) const { return (!end && bs.end); } 
+      double R0[3][3];   // orientation at the start of the interval
+      double x0[3];      // origin at the start of the interval
+      double v[3];       // linear velocity of the origin
+      double w[3];       // angular velocity
+      double wnorm;      // norm of the angular velocity
+      double alin;       // bound on the linear acceleration of the origin
+      double anorm;      // norm of the angular acceleration
     };
 
-    // structure passed to determine_TOI
-    struct DStruct
+    /// Geometric data for a collision geometry (body frame)
+    struct GeomData
     {
-      CollisionGeometryPtr ga; // geometry from which point is taken
-      CollisionGeometryPtr gb; // geometry against which point is tested
-
-      // gb's poses at time t0,tf 
-      Ravelin::Pose3d Pb_t0, Pb_tf;
+      PrimitivePtr primitive;          // the primitive
+      unsigned body;                   // index of the body motion
+      bool sphere;                     // whether the primitive is a sphere
+      bool heightfield;                // whether the primitive is a heightfield
+      double radius;                   // radius of a sphere (0 otherwise)
+      double R[3][3];                  // rotation from body to primitive frame
+      double x[3];                     // body origin in the primitive frame
+      std::vector<double> verts;       // vertices (3 per), body frame
+    };
 
-      // transforms from ga's frame to gb's frame at t0,tf
-      Ravelin::Transform3d bTa_t0, bTa_tf;
+    unsigned get_body_index(RigidBodyPtr rb);
+    unsigned get_geom_index(CollisionGeometryPtr cg);
+    void prepare(const std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& pairs);
+    double calc_pair_TOI(double dt, unsigned a, unsigned b) const;
+    double calc_vertex_TOI(double dt, const double* u, double offset, const GeomData& ga, const GeomData& gb) const;
+    double calc_dist(const double* u, double t, const GeomData& ga, const GeomData& gb, double& rho) const;
+    static void calc_pose(const BodyMotion& m, double t, double R[3][3], double x[3]);
 
-      // vertex to test for intersection (in ga's frame) 
-      Point3d u_a;     
+    /// The body motions for the current query
+    std::vector<BodyMotion> _motions;
 
-      // relative orientations (orientation of ga in gb's frame) at times t0/tf 
-      Ravelin::Quatd q0, qf;      
+    /// The geometric data for the current query
+    std::vector<GeomData> _geoms;
 
-      // BV corresponding to part of gb
-      BVPtr b_BV;              
-    };
+    /// Mapping from bodies to indices into _motions
+    std::map<RigidBody*, unsigned> _body_index;
 
-    /// Pair of poses (one at time t0, the other at time tf)
-    struct PosePair
-    {
-      Ravelin::Pose3d t0;
-      Ravelin::Pose3d tf;
-    };
+    /// Mapping from geometries to indices into _geoms
+    std::map<CollisionGeometry*, unsigned> _geom_index;
 
-    /// Pair of transforms (one at time t0, the other at time tf)
-    struct TransformPair
-    { 
-      Ravelin::Transform3d t0;
-      Ravelin::Transform3d tf;
-    };
+    /// The geometry indices for each pair of the current query
+    std::vector<std::pair<unsigned, unsigned> > _pair_index;
 
-    /// Structure used for computing deviation in a direction
-    struct DeviationCalc
-    {
-      Ravelin::Quatd q1;            // orientation of body at t0
-      Ravelin::Quatd q2;            // orientation of body at tf
-      Ravelin::Vector3d u;          // vector from com to point (in local frame)
-      Ravelin::Vector3d d;          // direction to compute deviation
-    };
+    /// The time of impact computed for each pair of the current query
+    std::vector<double> _toi;
 
-    /// Structure used for BV processing
-    struct BVProcess
-    {
-      BVPtr bva;         // the first BV (velocity-expanded)
-      BVPtr bvb;         // the second BV (velocity-expanded)
-      unsigned nexp;     // the number of expansions
-      BVPtr ax;          // the original first BV (not expanded)
-      BVPtr bx;          // the original second BV (not expanded)
-    };
+    /// Scratch vertices
+    std::vector<Point3d> _verts;
 
-    static bool bound_u(const Ravelin::Vector3d& u, const Ravelin::Quatd& q0, const Ravelin::Quatd& qf, Ravelin::Vector3d& normal1, Ravelin::Vector3d& normal2);
-    static double calc_deviation(double t, void* params);
-    static double calc_min_dev(const Ravelin::Vector3d& u, const Ravelin::Vector3d& d, const Ravelin::Quatd& q1, const Ravelin::Quatd& q2, double& t);
-    static double calc_max_dev(const Ravelin::Vector3d& u, const Ravelin::Vector3d& d, const Ravelin::Quatd& q1, const Ravelin::Quatd& q2, double& t);
-    static std::pair<double, double> calc_deviations(const Ravelin::Vector3d& u, const Ravelin::Vector3d& d, const Ravelin::Quatd& q1, const Ravelin::Quatd& q2, double ta, double tb);
-    void populate_dstruct(DStruct* ds, CollisionGeometryPtr ga, const Ravelin::Pose3d& Pa_t0, const Ravelin::Pose3d& Pa_tf, CollisionGeometryPtr gb, const Ravelin::Pose3d& Pb_t0, const Ravelin::Pose3d& Pb_tf, BVPtr b_BV) const;
-    void add_rigid_body_model(RigidBodyPtr body);
-    double determine_TOI(double t0, double tf, const DStruct* ds, Point3d& pt, Ravelin::Vector3d& normal) const;
-    double determine_TOI_fast(double t0, double tf, const DStruct* ds, Point3d& pt, Ravelin::Vector3d& normal) const;
-    BVPtr get_swept_BV(CollisionGeometryPtr g, BVPtr bv, const PosePair& v);
-    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Ravelin::Transform3d& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b);
-    static Event create_contact(double toi, CollisionGeometryPtr a, CollisionGeometryPtr b, const Point3d& point, const Ravelin::Vector3d& normal);
-    void check_vertices(double dt, CollisionGeometryPtr a, CollisionGeometryPtr b, BVPtr ob, const std::vector<const Point3d*>& a_verts, const PosePair& a_poses, const PosePair& b_poses, double& earliest, std::vector<Event>& local_contacts) const;
-    void check_geoms(double dt, CollisionGeometryPtr a, const PosePair& a_poses, CollisionGeometryPtr b, const PosePair& b_poses, std::vector<Event>& contacts); 
-    void broad_phase(const std::map<CollisionGeometryPtr, PosePair>& poses, std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check);
-    void sort_AABBs(const std::map<CollisionGeometryPtr, PosePair>& poses);
-    void update_bounds_vector(std::vector<std::pair<double, BoundsStruct> >& bounds, const std::map<CollisionGeometryPtr, PosePair>& poses, AxisType axis);
-    void build_bv_vector(const std::map<CollisionGeometryPtr, PosePair>& poses, std::vector<std::pair<double, BoundsStruct> >& bounds);
-    std::map<CollisionGeometryPtr, PosePair> get_poses(const std::vector<std::pair<DynamicBodyPtr, Ravelin::VectorNd> >& q0, const std::vector<std::pair<DynamicBodyPtr, Ravelin::VectorNd> >& q1);
-    static bool brent(double x_lower, double x_upper, double& x, double& fx, double (*f)(double, void*), double eps, void* params);
-
-    template <class RandomAccessIterator>
-    void insertion_sort(RandomAccessIterator begin, RandomAccessIterator end);
-
-    template <class OutputIterator>
-    OutputIterator intersect_BV_leafs(BVPtr a, BVPtr b, const Ravelin::Transform3d& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, OutputIterator output_begin) const;
-
-    /// Maps of transforms for a pair of geometries
-    std::map<std::pair<CollisionGeometryPtr, CollisionGeometryPtr>, TransformPair> _transform_pairs;
-
-    /// Swept BVs computed during last call to is_contact/update_contacts()
-    std::map<CollisionGeometryPtr, std::map<BVPtr, BVPtr> > _swept_BVs;
-
-    // lock for the contact map
-    pthread_mutex_t _contact_mutex;
-
-    // lock for the swept BVs
-    pthread_mutex_t _swept_BVs_mutex;
-
-    /// AABB bounds (x-axis)
-    std::vector<std::pair<double, BoundsStruct> > _x_bounds;
-
-    /// AABB bounds (y-axis)
-    std::vector<std::pair<double, BoundsStruct> > _y_bounds;
-
-    /// AABB bounds (z-axis)
-    std::vector<std::pair<double, BoundsStruct> > _z_bounds;
-
-    /// Indicates when bounds vectors need to be rebuilt
-    bool _rebuild_bounds_vecs;
-
-    /// Maximum depth of OBB expansions (default is inf)
-    unsigned _max_dexp;
+    /// Scratch pose of a primitive relative to its geometry
+    boost::shared_ptr<Ravelin::Pose3d> _P;
 }; // end class
 
-// include inline functions
-#include "GeneralizedCCD.inl"
-
 } // end namespace
 
 #endif
@@ -0,0 +1,134 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _HEIGHTFIELD_PRIMITIVE_H
+#define _HEIGHTFIELD_PRIMITIVE_H
+
+#include <string>
+#include <Moby/Primitive.h>
+
+namespace Moby {
+
+/// Represents terrain as a regular grid of heights over the x-y plane
+/**
+ * The grid is centered at the origin of the primitive frame, with rows
+ * running along y and columns running along x; heights are measured along z.
+ * Heights are read from a raw file (native 32-bit floats, row major) or a
+ * binary (P5) PGM file; either is memory mapped rather than copied. Heights
+ * between samples are interpolated bilinearly and points outside of the grid
+ * use the height at the nearest edge. A min/max pyramid over tiles of the
+ * grid gives constant-time bounds on the height over any rectangle.
+ */
+class HeightfieldPrimitive : public Primitive
+{
+  public:
+    HeightfieldPrimitive();
+    HeightfieldPrimitive(const Ravelin::Pose3d& T);
+    virtual ~HeightfieldPrimitive();
+    void load_raw(const std::string& filename, unsigned rows, unsigned cols);
+    void load_pgm(const std::string& filename);
+    void set_heights(const std::vector<double>& heights, unsigned rows, unsigned cols);
+    void set_spacing(double dx, double dy);
+    void set_height_scale(double scale);
+    virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
+    virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+    virtual void set_pose(const Ravelin::Pose3d& T);
+    virtual BVPtr get_BVH_root(CollisionGeometryPtr geom);
+    virtual void get_vertices(std::vector<Point3d>& vertices);
+    virtual boost::shared_ptr<const IndexedTriArray> get_mesh();
+    virtual const std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> >& get_sub_mesh(BVPtr bv);
+    virtual osg::Node* create_visualization();
+    virtual double calc_dist_and_normal(const Point3d& p, Ravelin::Vector3d& normal) const;
+    void calc_dist_and_normal(const std::vector<Point3d>& p, std::vector<double>& dist, std::vector<Ravelin::Vector3d>& normals) const;
+    virtual double calc_signed_dist(const Point3d& p);
+    virtual double calc_signed_dist(boost::shared_ptr<const Primitive> p, boost::shared_ptr<const Ravelin::Pose3d> pose_this, boost::shared_ptr<const Ravelin::Pose3d> pose_p, Point3d& pthis, Point3d& pp) const;
+    double calc_height(double x, double y) const;
+    double calc_height(double x, double y, double& dhdx, double& dhdy) const;
+    void calc_height_bounds(double xmin, double ymin, double xmax, double ymax, double& hmin, double& hmax) const;
+    void get_bounds(Point3d& lo, Point3d& hi) const;
+
+    /// Gets the number of rows (samples along y) in the grid
+    unsigned get_rows() const { return _rows; }
+
+    /// Gets the number of columns (samples along x) in the grid
+    unsigned get_cols() const { return _cols; }
+
+    /// Gets the spacing between samples along x
+    double get_dx() const { return _dx; }
+
+    /// Gets the spacing between samples along y
+    double get_dy() const { return _dy; }
+
+  private:
+    enum SampleFormat { eFloat32, eUInt8, eUInt16 };
+
+    // heightfields own a memory mapping, so they are not copied
+    HeightfieldPrimitive(const HeightfieldPrimitive&);
+    HeightfieldPrimitive& operator=(const HeightfieldPrimitive&);
+
+    void init();
+    void map_file(const std::string& filename);
+    void unmap_file();
+    void setup_grid(unsigned rows, unsigned cols);
+    void build_pyramid();
+    void update_OBBs();
+    double get_sample(unsigned i, unsigned j) const;
+    bool calc_max_slope(double xmin, double ymin, double xmax, double ymax, double& slope) const;
+
+    /// Note: there are no mass properties, because terrain has no mass!
+    virtual void calc_mass_properties() { }
+
+    /// The name of the file holding the heights (empty if set directly)
+    std::string _filename;
+
+    /// The start and length of the memory mapping (NULL/0 if none)
+    void* _map_addr;
+    size_t _map_len;
+
+    /// Heights that have been set directly (rather than mapped)
+    std::vector<float> _heights;
+
+    /// Pointer to the first sample
+    const unsigned char* _samples;
+
+    /// The format of the samples
+    SampleFormat _format;
+
+    /// The maximum sample value (for PGM files)
+    double _maxval;
+
+    /// The number of rows and columns in the grid
+    unsigned _rows, _cols;
+
+    /// The spacing between samples along x and y
+    double _dx, _dy;
+
+    /// The multiplier applied to each sample
+    double _hscale;
+
+    /// The coordinates of the first sample in the primitive frame
+    double _x0, _y0;
+
+    /// Number of tiles along each dimension for each level of the pyramid
+    std::vector<unsigned> _prows, _pcols;
+
+    /// Minimum and maximum height over each tile for each level of the pyramid
+    std::vector<std::vector<float> > _pmin, _pmax;
+
+    /// The bounding volumes (one per geometry)
+    std::map<CollisionGeometryPtr, OBBPtr> _obbs;
+
+    /// The triangle mesh (created on demand)
+    boost::shared_ptr<IndexedTriArray> _mesh;
+
+    /// The "sub" mesh
+    std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> > _smesh;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -47,6 +47,15 @@ class ImpactEventHandler
     /// The tolerance for to the interior-point solver (default 1e-6)
     double ip_eps;
 
+    /// The minimum number of contacts in a connected group for the block-sparse solver to be used (default 100)
+    unsigned sparse_min_contacts;
+
+    /// The maximum number of iterations of the block-sparse (iterative) solver (default 100)
+    unsigned sparse_max_iterations;
+
+    /// The impulse change below which the block-sparse (iterative) solver terminates (default 1e-8)
+    double sparse_eps;
+
   private:
     void apply_visc_friction_model_to_connected_events(const std::list<Event*>& events);
     void apply_inf_friction_model_to_connected_events(const std::list<Event*>& events);
@@ -61,6 +70,15 @@ class ImpactEventHandler
     void apply_model_to_connected_events(const std::list<Event*>& events);
     void apply_model_to_connected_events(const std::list<Event*>& events, double max_time);
     void compute_problem_data(EventProblemData& epd);
+    bool compute_rigid_contact_data(EventProblemData& epd);
+    bool use_sparse_solver(const std::list<Event*>& events) const;
+    void apply_sparse_model_to_connected_events(const std::list<Event*>& events, bool coulomb);
+    void compute_sparse_problem_data(EventProblemData& epd);
+    void solve_sparse_model(EventProblemData& epd, bool coulomb);
+    void solve_sparse_lcp(EventProblemData& epd);
+    void solve_sparse_iterative(EventProblemData& epd);
+    void update_sparse_event_velocities_from_impulses(EventProblemData& epd);
+    void add_event_impulses(const EventProblemData& epd);
     void solve_frictionless_lcp(EventProblemData& epd, Ravelin::VectorNd& z);
     void apply_visc_friction_model(EventProblemData& epd);
     void apply_inf_friction_model(EventProblemData& epd);
@@ -88,6 +106,17 @@ class ImpactEventHandler
     Ravelin::MatrixNd _MM;
     Ravelin::VectorNd _zlast, _v, _zsuccess;
 
+    // temporaries for compute_rigid_contact_data()
+    std::vector<RigidBodyPtr> _rc_bodies;
+    std::vector<std::vector<std::pair<unsigned, double> > > _rc_incident;
+    std::vector<double> _rc_R, _rc_G, _rc_H;
+    boost::shared_ptr<Ravelin::Pose3d> _rc_P;
+
+    // temporaries for the block-sparse solver
+    std::vector<std::vector<unsigned> > _sparse_groups;
+    Ravelin::SparseMatrixNd _sCn_iM_CnT;
+    Ravelin::VectorNd _sz, _sw;
+
     // temporaries for solve_qp_work() and solve_nqp_work() 
     Ravelin::VectorNd _Cnstar_v, _workv, _new_Cn_v;
     Ravelin::MatrixNd _Cnstar_Cn, _Cnstar_Cs, _Cnstar_Ct, _Cnstar_L;
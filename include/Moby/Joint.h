@@ -325,8 +325,9 @@ class Joint : public Visualizable
     // working variables for calc_s_bar_from_s()
     Ravelin::MatrixNd _ns;
 
-    // shared linear algebra object
-    static Ravelin::LinAlgd _LA;
+    // linear algebra object (per joint, so that joints of different bodies
+    // may be processed concurrently)
+    Ravelin::LinAlgd _LA;
 
     ConstraintType _constraint_type;
     unsigned _joint_idx;
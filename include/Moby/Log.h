@@ -7,23 +7,49 @@
 #ifndef _MOBY_LOG_H_
 #define _MOBY_LOG_H_
 
+#include <cstdio>
 #include <iostream>
 #include <ctime>
 #include <limits>
 #include <sstream>
 #include <fstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
 #include <boost/shared_ptr.hpp>
 
 namespace Moby {
 
+/// The subsystems (LOG_* bits) compiled into the library
+/**
+ * Logging for subsystems not in the mask is removed by the compiler
+ * (the levels are compile-time constants), so neither its branches nor the
+ * code that builds its messages remains; e.g., -DMOBY_LOG_MASK=0 removes all
+ * logging and -DMOBY_LOG_MASK=2 keeps only LOG_EVENT.
+ */
+#ifndef MOBY_LOG_MASK
 #ifdef NDEBUG
-#define FILE_LOG(level) if (false) Log<OutputToFile>().get(level)
-#define LOGGING(level) false
+#define MOBY_LOG_MASK 0
 #else
-#define FILE_LOG(level) if ((level & Log<OutputToFile>::reporting_level) > 0) Log<OutputToFile>().get(level)
-#define LOGGING(level) ((level & Log<OutputToFile>::reporting_level) > 0)
+#define MOBY_LOG_MASK 0xFFFFFFFF
+#endif
+#endif
+
+#ifdef __GNUC__
+#define MOBY_LOG_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define MOBY_LOG_UNLIKELY(x) (x)
 #endif
 
+/// Determines whether a level is compiled in (a constant for constant levels)
+#define LOG_COMPILED(level) (((level) & (MOBY_LOG_MASK)) != 0)
+
+#define FILE_LOG(level) if (LOG_COMPILED(level) && MOBY_LOG_UNLIKELY((level & Log<OutputToFile>::reporting_level) > 0)) Log<OutputToFile>().get(level)
+#define LOGGING(level) (LOG_COMPILED(level) && MOBY_LOG_UNLIKELY((level & Log<OutputToFile>::reporting_level) > 0))
+
+/// Records a binary log record, e.g., BINARY_LOG(LOG_COLDET)("gjk-iter", dist)
+#define BINARY_LOG(level) if (LOG_COMPILED(level) && MOBY_LOG_UNLIKELY(((level) & BinaryLog::recording_level) != 0)) (BinaryLog::Entry(level))
+
 struct OutputToFile
 {
   static std::ofstream stream;
@@ -70,6 +96,102 @@ class Log
 template <class T>
 unsigned Log<T>::reporting_level = 0;
 
+/// A binary log record
+/**
+ * Records are fixed size and hold only numbers and a pointer to a static
+ * tag, so recording one does not format or allocate anything; records are
+ * formatted offline (see moby-logdump).
+ */
+struct LogRecord
+{
+  /// The maximum number of values in a record
+  static const unsigned MAX_VALUES = 4;
+
+  double time;                 // wall clock time (seconds since the epoch)
+  unsigned level;              // the subsystem(s) of the record
+  unsigned thread;             // the index of the recording thread
+  const char* tag;             // static string identifying the record
+  unsigned nvalues;            // number of values
+  double values[MAX_VALUES];   // the values
+};
+
+/// Low-overhead binary logging with per-subsystem sinks
+/**
+ * Each thread records into its own ring buffer, so recording takes no lock;
+ * a thread writes its buffer to the sinks when the buffer fills and on
+ * flush(). Each sink is a file that receives the records of a set of
+ * subsystems. Files begin with the magic "MOBYLOG" and a version number,
+ * followed by records (time, level, thread, tag length, tag, number of
+ * values, values) in native byte order.
+ */
+class BinaryLog
+{
+  public:
+    /// Records one entry; constructed by the BINARY_LOG macro
+    class Entry
+    {
+      public:
+        Entry(unsigned level) { _level = level; }
+        void operator()(const char* tag) { record(_level, tag, 0, NULL); }
+        void operator()(const char* tag, double v0) { double v[] = { v0 }; record(_level, tag, 1, v); }
+        void operator()(const char* tag, double v0, double v1) { double v[] = { v0, v1 }; record(_level, tag, 2, v); }
+        void operator()(const char* tag, double v0, double v1, double v2) { double v[] = { v0, v1, v2 }; record(_level, tag, 3, v); }
+        void operator()(const char* tag, double v0, double v1, double v2, double v3) { double v[] = { v0, v1, v2, v3 }; record(_level, tag, 4, v); }
+
+      private:
+        unsigned _level;
+    };
+
+    static void open(unsigned levels, const std::string& fname);
+    static void close();
+    static void flush();
+    static void record(unsigned level, const char* tag, unsigned nvalues, const double* values);
+    static bool read(const std::string& fname, std::vector<LogRecord>& records, std::vector<std::string>& tags);
+
+    /// The levels being recorded (the union of the levels of all sinks)
+    static unsigned recording_level;
+
+    /// The number of records in each thread's buffer
+    static const unsigned CAPACITY = 4096;
+
+    /// The version of the file format
+    static const unsigned VERSION = 1;
+
+  private:
+    /// A per-thread ring buffer of records
+    struct Buffer
+    {
+      LogRecord records[CAPACITY];
+      unsigned head;           // index of the oldest record
+      unsigned size;           // number of records
+      unsigned thread;         // index of the owning thread
+    };
+
+    /// A file receiving the records of a set of subsystems
+    struct Sink
+    {
+      unsigned levels;
+      std::FILE* fp;
+    };
+
+    static Buffer* get_buffer();
+    static void flush(Buffer* buffer);
+    static void write(std::FILE* fp, const LogRecord& r);
+
+    /// The sinks
+    static std::vector<Sink> _sinks;
+
+    /// The number of threads that have recorded
+    static unsigned _nthreads;
+
+    // the buffers are per thread and the sinks are guarded in every build
+    static pthread_mutex_t _mutex;
+    static pthread_key_t _key;
+    static pthread_once_t _key_once;
+    static void create_key();
+    static void destroy_buffer(void* buffer);
+};
+
 } // end namespace
 
 #endif
@@ -0,0 +1,102 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_LOOP_CLOSURE_SOLVER_H_
+#define _MOBY_LOOP_CLOSURE_SOLVER_H_
+
+#include <vector>
+#include <Ravelin/MatrixNd.h>
+#include <Ravelin/VectorNd.h>
+
+namespace Moby {
+
+class DynamicBody;
+
+/// Solves for the generalized accelerations of a body with kinematic loops
+/**
+ * Given the generalized forces f, the loop-closure constraint Jacobian J,
+ * and the constraint bias gamma (so that the closed-loop accelerations
+ * satisfy J*a + gamma = 0), computes the accelerations a. Two formulations
+ * are available:
+ *
+ * <ul>
+ * <li>eSchur forms the constraint-space inertia J*inv(M)*J' and factors it
+ * with a rank-revealing (diagonally pivoted) LDL' factorization; redundant
+ * constraints receive zero force. The pivot order and rank are reused
+ * across calls, so the pivot search is only repeated when the rank of the
+ * constraints changes.</li>
+ * <li>eSparseKKT factors the regularized KKT matrix [M J'; J -delta*I] with
+ * a sparse LDL' factorization (followed by iterative refinement against the
+ * unregularized matrix), avoiding J*inv(M)*J' altogether; this is
+ * preferable for mechanisms with many loops, as branch-induced sparsity in
+ * M and the sparsity of J are preserved. The symbolic analysis (elimination
+ * tree and column counts) is reused while the nonzero pattern is
+ * unchanged.</li>
+ * </ul>
+ *
+ * All workspaces are members, so separate solvers may be used concurrently.
+ */
+class LoopClosureSolver
+{
+  public:
+    enum SolverType { eSchur, eSparseKKT };
+    LoopClosureSolver();
+    void solve(DynamicBody& body, const Ravelin::MatrixNd& J, const Ravelin::VectorNd& f, const Ravelin::VectorNd& gamma, Ravelin::VectorNd& a);
+
+    /// Forgets all reusable factorization data
+    void invalidate() { _perm.clear(); _Ap.clear(); _Ai.clear(); }
+
+    /// Gets the rank of the constraints found by the last (Schur) solve
+    unsigned get_rank() const { return _rank; }
+
+    /// The formulation used
+    SolverType solver_type;
+
+    /// Regularization of the constraint block of the KKT matrix
+    double kkt_regularization;
+
+  private:
+    void solve_schur(DynamicBody& body, const Ravelin::MatrixNd& J, const Ravelin::VectorNd& f, const Ravelin::VectorNd& gamma, Ravelin::VectorNd& a);
+    void solve_kkt(DynamicBody& body, const Ravelin::MatrixNd& J, const Ravelin::VectorNd& f, const Ravelin::VectorNd& gamma, Ravelin::VectorNd& a);
+    bool factor_ldl(bool pivot);
+    void solve_ldl(Ravelin::VectorNd& x) const;
+    void assemble_kkt(const Ravelin::MatrixNd& M, const Ravelin::MatrixNd& J);
+    void symbolic_kkt();
+    bool numeric_kkt();
+    void solve_kkt_factored(std::vector<double>& x) const;
+    static void swap_sym(Ravelin::MatrixNd& A, unsigned i, unsigned j);
+
+    /// Constraint-space inertia and its factorization (eSchur)
+    Ravelin::MatrixNd _Lambda, _iM_JT;
+
+    /// The symmetric row/column swap made at each step of the factorization (eSchur)
+    std::vector<unsigned> _perm;
+
+    /// The rank of the constraint-space inertia (eSchur)
+    unsigned _rank;
+
+    /// Generalized inertia (eSparseKKT)
+    Ravelin::MatrixNd _M;
+
+    /// Upper triangle of the KKT matrix in compressed column form (eSparseKKT)
+    std::vector<unsigned> _Ap, _Ai, _Ap_new, _Ai_new;
+    std::vector<double> _Ax;
+
+    /// The factor L (unit lower triangular, compressed column) and D (eSparseKKT)
+    std::vector<unsigned> _Lp, _Li, _parent, _Lnz, _flag, _pattern;
+    std::vector<double> _Lx, _D, _y;
+
+    /// Solution, right hand side, and correction of the KKT system (eSparseKKT)
+    std::vector<double> _xkkt, _rkkt, _dkkt;
+
+    /// Work vectors
+    Ravelin::VectorNd _workv, _workv2, _x;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -0,0 +1,97 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_MESH_ASSET_CACHE_H_
+#define _MOBY_MESH_ASSET_CACHE_H_
+
+#include <sys/types.h>
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <Ravelin/Origin3d.h>
+#include <Moby/IndexedTriArray.h>
+#include <Moby/FlatBVH.h>
+#ifdef THREADSAFE
+#include <pthread.h>
+#endif
+
+namespace Moby {
+
+/// A process-wide cache of triangle mesh assets loaded from files
+/**
+ * Every instance of a mesh file shares one immutable mesh, the
+ * density-independent parts of its mass properties, and its flat BVH (all in
+ * the mesh frame). Assets are keyed by the canonical path of the file and
+ * the load options (centering and convexification of the inertia); the contents of the file are hashed so that identical
+ * files at different paths are shared as well and so that modified files are
+ * reloaded. Assets are built outside of the cache lock; concurrent loads of
+ * the same file wait for the single build in progress.
+ */
+class MeshAssetCache
+{
+  public:
+    /// A mesh asset
+    struct Asset
+    {
+      /// The mesh (centered, if requested)
+      boost::shared_ptr<const IndexedTriArray> mesh;
+
+      /// The flat BVH over the mesh
+      boost::shared_ptr<const FlatBVH> bvh;
+
+      /// Whether the mass data below are those of the convex hull of the mesh
+      bool convexify_inertia;
+
+      /// The volume integrals of the mesh or its convex hull (see IndexedTriArray::calc_volume_ints())
+      double volume_ints[10];
+
+      /// The centroid of the surface of the mesh or its convex hull
+      Ravelin::Origin3d centroid;
+    };
+
+    static boost::shared_ptr<const Asset> load(const std::string& filename, bool center, bool convexify_inertia = false);
+    static void clear();
+    static unsigned size();
+
+  private:
+    /// Data stored per cache key
+    struct Entry
+    {
+      off_t size;                           // size of the file when loaded
+      time_t mtime;                         // modification time when loaded
+      unsigned long long hash;              // hash of the file contents
+      boost::shared_ptr<const Asset> asset; // the asset
+    };
+
+    static boost::shared_ptr<Asset> create_asset(const std::string& filename, bool center, bool convexify_inertia);
+    static bool hash_file(const std::string& filename, unsigned long long& hash);
+
+    /// Assets indexed by canonical path and options
+    static std::map<std::string, Entry> _by_path;
+
+    /// Assets indexed by content hash and options (see get_options())
+    static std::map<std::pair<unsigned long long, unsigned>, boost::shared_ptr<const Asset> > _by_hash;
+
+    /// Content hashes and options of the assets currently being built (outside of the lock)
+    static std::set<std::pair<unsigned long long, unsigned> > _building;
+
+    /// Gets the load options as bits (used in cache keys)
+    static unsigned get_options(bool center, bool convexify_inertia) { return ((center) ? 1 : 0) | ((convexify_inertia) ? 2 : 0); }
+
+    #ifdef THREADSAFE
+    static pthread_mutex_t _mutex;
+
+    /// Signaled whenever an asset build finishes (or fails)
+    static pthread_cond_t _built;
+    #endif
+}; // end class
+
+} // end namespace
+
+#endif
+
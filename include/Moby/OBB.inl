@@ -122,13 +122,13 @@ OBB OBB::calc_low_dim_OBB(ForwardIterator begin, ForwardIterator end)
   boost::shared_ptr<const Ravelin::Pose2d> GLOBAL_2D;
   Ravelin::Matrix3d R = CompGeom::calc_3D_to_2D_matrix(normal);
   double offset = CompGeom::determine_3D_to_2D_offset(Ravelin::Origin3d(*begin), R);
-  std::list<Point2d> points_2D;
+  std::vector<Point2d> points_2D;
   for (ForwardIterator i = begin; i != end; i++)
     points_2D.push_back(Point2d(CompGeom::to_2D(*i, R), GLOBAL_2D)); 
 
-  // compute the convex hull of the points
-  std::list<Point2d> hull_2D;
-  CompGeom::calc_convex_hull(points_2D.begin(), points_2D.end(), std::back_inserter(hull_2D));
+  // compute the convex hull of the points (reentrant)
+  std::vector<Point2d> hull_2D;
+  CompGeom::calc_convex_hull_2D(points_2D, hull_2D);
 
   // handle degeneracy
   if (hull_2D.empty())
@@ -231,8 +231,8 @@ OBB OBB::calc_min_volume_OBB(ForwardIterator begin, ForwardIterator end)
   // get the pose
   boost::shared_ptr<const Ravelin::Pose3d> P = begin->pose;
 
-  // compute the convex hull of the points
-  PolyhedronPtr hull = CompGeom::calc_convex_hull(begin, end);
+  // compute the convex hull of the points (reentrant)
+  PolyhedronPtr hull = CompGeom::calc_convex_hull_3D(std::vector<Point3d>(begin, end));
   bool is_3D = hull;
   if (!is_3D)
     return OBB::calc_low_dim_OBB(begin, end);
@@ -523,15 +523,8 @@ OBB::OBB(ForwardIterator begin, ForwardIterator end)
   this->center.set_zero();
   this->center.pose = P;
 
-  // compute the convex hull of the points
-  PolyhedronPtr hull;
-  try
-  {
-    hull = CompGeom::calc_convex_hull(begin, end);
-  }
-  catch (NumericalException e)
-  {
-  }
+  // compute the convex hull of the points (reentrant)
+  PolyhedronPtr hull = CompGeom::calc_convex_hull_3D(std::vector<Point3d>(begin, end));
   bool is_3D = hull;
   if (!is_3D)
   {
@@ -0,0 +1,96 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_POSE_CACHE_H_
+#define _MOBY_POSE_CACHE_H_
+
+#include <map>
+#include <vector>
+#include <Ravelin/Pose3d.h>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+class RigidBody;
+class CollisionGeometry;
+
+/// Flattened global transforms of rigid body (link) and collision geometry frames
+/**
+ * Frames are chains of Pose3d objects, so converting a quantity to or from
+ * the global frame walks the chain (and often allocates a temporary pose).
+ * This cache resolves every chain once per configuration: each rigid body
+ * (every link of an articulated body) and each collision geometry is given
+ * a dense index, and its global transform is stored contiguously as a
+ * row-major rotation matrix, a translation, and a quaternion (w, x, y, z).
+ * The transform stored for a collision geometry is that of its primitive
+ * (the primitive's pose relative to the geometry frame), which is the frame
+ * in which all primitive queries are made.
+ *
+ * rebuild() assigns the indices and must be called whenever bodies or
+ * geometries are added or removed; update() refreshes the transforms and
+ * must be called whenever the bodies move. update() only reads body state,
+ * and it processes bodies in parallel (when OpenMP is enabled).
+ */
+class PoseCache
+{
+  public:
+    /// The number of doubles stored per transform
+    static const unsigned STRIDE = 16;
+
+    /// Index returned for bodies and geometries that are not in the cache
+    static const unsigned NONE = (unsigned) -1;
+
+    void rebuild(const std::vector<DynamicBodyPtr>& bodies);
+    void update();
+    unsigned get_body_index(RigidBodyPtr rb) const;
+    unsigned get_geom_index(CollisionGeometryPtr cg) const;
+    void get_geom_pose(unsigned i, Ravelin::Pose3d& P) const;
+    Point3d transform_point_to_global(unsigned i, const Point3d& p) const;
+    Point3d transform_point_from_global(unsigned i, const Point3d& p) const;
+    Ravelin::Vector3d transform_vector_to_global(unsigned i, const Ravelin::Vector3d& v) const;
+
+    /// Gets the number of rigid bodies in the cache
+    unsigned num_bodies() const { return _bodies.size(); }
+
+    /// Gets the number of collision geometries in the cache
+    unsigned num_geoms() const { return _geoms.size(); }
+
+    /// Gets the global transform of the i'th rigid body (STRIDE doubles)
+    const double* get_body_transform(unsigned i) const { return &_body_T[i*STRIDE]; }
+
+    /// Gets the global transform of the primitive of the i'th collision geometry (STRIDE doubles)
+    const double* get_geom_transform(unsigned i) const { return &_geom_T[i*STRIDE]; }
+
+    /// Gets the origin of the primitive of the i'th collision geometry (global frame)
+    Point3d get_geom_origin(unsigned i) const { const double* T = get_geom_transform(i); return Point3d(T[9], T[10], T[11], GLOBAL); }
+
+  private:
+    static void set_transform(const Ravelin::Quatd& q, const Ravelin::Origin3d& x, double* T);
+    static void compose(const double* T1, const Ravelin::Quatd& q2, const Ravelin::Origin3d& x2, double* T);
+
+    /// The rigid bodies, in order of index
+    std::vector<RigidBodyPtr> _bodies;
+
+    /// The collision geometries, in order of index (grouped by body)
+    std::vector<CollisionGeometryPtr> _geoms;
+
+    /// The index of the first geometry of each body (one extra entry holds the number of geometries)
+    std::vector<unsigned> _geom_begin;
+
+    /// Mapping from rigid bodies to indices
+    std::map<RigidBody*, unsigned> _body_index;
+
+    /// Mapping from collision geometries to indices
+    std::map<CollisionGeometry*, unsigned> _geom_index;
+
+    /// The transforms of the bodies and of the geometries' primitives
+    std::vector<double> _body_T, _geom_T;
+}; // end class
+
+} // end namespace
+
+#endif
+
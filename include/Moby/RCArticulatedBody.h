@@ -19,6 +19,7 @@
 #include <Moby/RigidBody.h>
 #include <Moby/FSABAlgorithm.h>
 #include <Moby/CRBAlgorithm.h>
+#include <Moby/LoopClosureSolver.h>
 
 namespace Moby {
 
@@ -136,6 +137,9 @@ class RCArticulatedBody : public ArticulatedBody
     /// Gets constraint events (currently not any)
     virtual void get_constraint_events(std::vector<Event>& events) const { }
 
+    /// The formulation used to solve the loop-closure constraints
+    LoopClosureSolver::SolverType loop_solver_type;
+
     /// Baumgarte alpha parameter >= 0
     double b_alpha;
 
@@ -185,6 +189,13 @@ class RCArticulatedBody : public ArticulatedBody
     /// Linear algebra object
     boost::shared_ptr<Ravelin::LinAlgd> _LA;
 
+    /// The loop-closure constraint solver
+    LoopClosureSolver _loop_solver;
+
+    /// Work variables for forward dynamics with loops
+    Ravelin::MatrixNd _Jx_dot;
+    Ravelin::VectorNd _loop_v, _loop_fext, _loop_C, _loop_beta, _loop_gamma, _loop_a, _loop_workv;
+
     static double sgn(double x);
     bool treat_link_as_leaf(RigidBodyPtr link) const;
     void update_factorized_generalized_inertia();
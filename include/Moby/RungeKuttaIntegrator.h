@@ -18,6 +18,10 @@ class RungeKuttaIntegrator : public Integrator
     virtual void integrate(Ravelin::VectorNd& x, Ravelin::VectorNd& (*f)(const Ravelin::VectorNd&, double, double, void*, Ravelin::VectorNd&), double time, double step_size, void* data);
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
+
+  private:
+    // stage vectors (reused between calls to integrate())
+    Ravelin::VectorNd _k1, _k2, _k3, _k4, _tmp;
 }; // end class
 
 }  // end namespace
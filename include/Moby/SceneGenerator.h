@@ -0,0 +1,89 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_SCENE_GENERATOR_H_
+#define _MOBY_SCENE_GENERATOR_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+class Simulator;
+
+/// Generates parametric scenes for stress testing contact and articulation
+/**
+ * Scenes are assembled from groups (piles of boxes or spheres, rows of
+ * robots cloned from a Moby XML file, long chains, and clutter of triangle
+ * meshes); each group is placed in its own region along the x-axis, above a
+ * ground plane at y = 0 (gravity acts along -y). Every scene uses an
+ * EventDrivenSimulator and GeneralizedCCD; contacts use a single set of
+ * default contact parameters, so the size of a scene is linear in the number
+ * of bodies. Positions are jittered with a seeded generator, so the same
+ * calls always generate the same scene. A scene can be written as Moby XML or
+ * constructed directly.
+ */
+class SceneGenerator
+{
+  public:
+    SceneGenerator(unsigned seed = 0);
+    void add_box_pile(unsigned n, double size = 1.0);
+    void add_sphere_pile(unsigned n, double radius = 0.5);
+    void add_robots(unsigned m, const std::string& robot_fname);
+    void add_chain(unsigned n, double link_len = 1.0);
+    void add_mesh_clutter(unsigned n, const std::vector<std::string>& mesh_fnames);
+    void set_contact_parameters(double epsilon, double mu_coulomb, double mu_viscous);
+    XMLTreePtr get_tree() const;
+    void write(const std::string& fname) const;
+    std::map<std::string, BasePtr> construct() const;
+    static boost::shared_ptr<Simulator> find_simulator(const std::map<std::string, BasePtr>& id_map);
+    static std::vector<std::string> find_convex_meshes(const std::string& dir);
+
+    /// Gets the number of bodies (rigid and articulated) in the scene
+    unsigned get_num_bodies() const { return _bodies.size(); }
+
+  private:
+    std::string new_id(const std::string& prefix);
+    double random(double lo, double hi);
+    void add_body(XMLTreePtr body);
+    void add_pile(unsigned n, const std::vector<std::string>& primitive_ids, double size, double max_rot);
+    static void collect_ids(boost::shared_ptr<const XMLTree> node, std::set<std::string>& ids);
+    static void collect_refs(boost::shared_ptr<const XMLTree> node, std::set<std::string>& refs);
+    static XMLTreePtr clone_renamed(boost::shared_ptr<const XMLTree> node, const std::map<std::string, std::string>& rename);
+
+    /// The state of the random number generator
+    unsigned _seed;
+
+    /// The number of IDs generated so far
+    unsigned _next_id;
+
+    /// The x-coordinate at which the next group begins
+    double _x;
+
+    /// The maximum extent of any group along z
+    double _zext;
+
+    /// The contact parameters (epsilon, Coulomb and viscous friction)
+    double _epsilon, _mu_coulomb, _mu_viscous;
+
+    /// Shared nodes (primitives, algorithms) used by the bodies
+    std::vector<XMLTreePtr> _shared;
+
+    /// The body nodes
+    std::vector<XMLTreePtr> _bodies;
+
+    /// The primitive ID and bounding radius for each mesh file (in clutter)
+    std::map<std::string, std::pair<std::string, double> > _mesh_primitives;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -8,6 +8,7 @@
 #define _SIMULATOR_H
 
 #include <sys/times.h>
+#include <unistd.h>
 #include <list>
 #include <map>
 #include <set>
@@ -18,6 +19,7 @@
 #include <Moby/Integrator.h>
 #include <Moby/RigidBody.h>
 #include <Moby/ArticulatedBody.h>
+#include <Moby/SnapshotBuffer.h>
 
 namespace osg { 
   class Node;
@@ -44,9 +46,11 @@ class Simulator : public virtual Base
     virtual ~Simulator(); 
     virtual double step(double step_size);
     DynamicBodyPtr find_dynamic_body(const std::string& name) const;
-    void add_dynamic_body(DynamicBodyPtr body);
-    void remove_dynamic_body(DynamicBodyPtr body);
+    virtual void add_dynamic_body(DynamicBodyPtr body);
+    virtual void remove_dynamic_body(DynamicBodyPtr body);
     void update_visualization();
+    void publish_snapshot();
+    virtual void apply_snapshot(const Snapshot& s);
     virtual void save_to_xml(XMLTreePtr node, std::list<boost::shared_ptr<const Base> >& shared_objects) const;
     virtual void load_from_xml(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);  
 
@@ -77,6 +81,14 @@ class Simulator : public virtual Base
     /// User time spent by dynamics on the last step
     double dynamics_time;
 
+    /// Buffer to which a snapshot is published after every step (NULL by default)
+    /**
+     * When set, the simulator does not touch the transient visualization
+     * data while stepping; the visualization thread should instead call 
+     * apply_snapshot() with snapshots acquired from the buffer.
+     */
+    boost::shared_ptr<SnapshotBuffer> snapshot_buffer;
+
   protected:
     virtual void check_pairwise_constraint_violations() { }
     osg::Group* _persistent_vdata;
@@ -84,12 +96,47 @@ class Simulator : public virtual Base
 
     /// The set of bodies in the simulation
     std::vector<DynamicBodyPtr> _bodies;
+
+    /// The bodies whose dynamics are simulated (all bodies that are not kinematically updated)
+    std::vector<DynamicBodyPtr> _dynamic_bodies;
+
+    /// The bodies that are kinematically updated (by their controllers)
+    std::vector<DynamicBodyPtr> _kinematic_bodies;
+
+    /// The (dynamic) bodies being integrated by the current call to integrate()
+    std::vector<DynamicBodyPtr> _ode_bodies;
+
+    /// Offset of each body's state (coordinates, then velocities) in the contiguous state of all bodies
+    /**
+     * Parallel to _bodies, with one extra entry holding the total state size;
+     * invalidated whenever a body is added or removed and rebuilt by 
+     * update_state_layout() when next used.
+     */
+    std::vector<unsigned> _state_offsets;
+
+    /// Whether _state_offsets reflects the current set of bodies
+    bool _state_layout_valid;
+
+    /// The state vector handed to the integrator (reused between steps)
+    Ravelin::VectorNd _x;
+
+    void update_state_layout();
+    void update_body_lists();
+    void update_kinematic_bodies(double t);
+    virtual void fill_snapshot(Snapshot& s);
+    void get_visualizables(std::vector<boost::shared_ptr<Visualizable> >& vis) const;
+
+    /// The visualizable objects in snapshot order (simulation thread)
+    std::vector<boost::shared_ptr<Visualizable> > _snapshot_vis;
+
+    /// The visualizable objects in snapshot order (visualization thread)
+    std::vector<boost::shared_ptr<Visualizable> > _apply_vis;
   
     template <class ForwardIterator>
     double integrate(double step_size, ForwardIterator begin, ForwardIterator end);
 
-    /// Integrates all dynamic bodies
-    double integrate(double step_size) { return integrate(step_size, _bodies.begin(), _bodies.end()); }
+    /// Updates the kinematic bodies and integrates all dynamic bodies
+    double integrate(double step_size) { update_kinematic_bodies(current_time); return integrate(step_size, _dynamic_bodies.begin(), _dynamic_bodies.end()); }
 
   private:
     static Ravelin::VectorNd& ode(const Ravelin::VectorNd& x, double t, double dt, void* data, Ravelin::VectorNd& dx);
@@ -6,6 +6,8 @@
 
 /// Integrates both position and velocity of rigid _bodies
 /**
+ * \pre no body in [begin, end) is kinematically updated (kinematic bodies
+ *      are updated separately by update_kinematic_bodies())
  * \return the size of step taken
  */
 template <class ForwardIterator>
@@ -18,79 +20,68 @@ double Simulator::integrate(double step_size, ForwardIterator begin, ForwardIter
   // get the simulator pointer
   boost::shared_ptr<Simulator> shared_this = boost::dynamic_pointer_cast<Simulator>(shared_from_this());
 
-  // get the state size
+  // get the state size and the bodies to integrate
   unsigned state_sz = 0;
+  _ode_bodies.clear();
   for (ForwardIterator i = begin; i != end; i++)
   {
-    // if the body is kinematically updated, call its controller and otherwise
-    // ignore it
-    if ((*i)->get_kinematic())
-    {
-      if ((*i)->controller)
-        (*(*i)->controller)(*i, current_time, (*i)->controller_arg);
-
-      // ignore body otherwise
+    // sleeping bodies are not integrated
+    if ((*i)->is_sleeping())
       continue;
-    }
 
     // reset limit estimates
     (*i)->reset_limit_estimates();
 
+    // body will be integrated
+    _ode_bodies.push_back(*i);
+
     // update the state size
     state_sz += (*i)->num_generalized_coordinates(DynamicBody::eEuler);
     state_sz += (*i)->num_generalized_coordinates(DynamicBody::eSpatial);
   }
 
-  // init x and work vectors
-  Ravelin::VectorNd x(state_sz);
+  // size the state vector (only reallocates if the state has grown)
+  _x.resize(state_sz);
 
   // get the current generalized coordinates and velocity for each body
   unsigned idx = 0;
-  for (ForwardIterator i = begin; i != end; i++)
+  for (unsigned i=0; i< _ode_bodies.size(); i++)
   {
-    // see whether to skip the body
-    if ((*i)->get_kinematic())
-      continue;
-
     // get number of generalized coordinates and velocities
-    const unsigned NGC = (*i)->num_generalized_coordinates(DynamicBody::eEuler);
-    const unsigned NGV = (*i)->num_generalized_coordinates(DynamicBody::eSpatial);
+    const unsigned NGC = _ode_bodies[i]->num_generalized_coordinates(DynamicBody::eEuler);
+    const unsigned NGV = _ode_bodies[i]->num_generalized_coordinates(DynamicBody::eSpatial);
 
     // get the shared vectors
-    Ravelin::SharedVectorNd xgc = x.segment(idx, idx+NGC); idx += NGC;
-    Ravelin::SharedVectorNd xgv = x.segment(idx, idx+NGV); idx += NGV;
-    (*i)->get_generalized_coordinates(DynamicBody::eEuler, xgc);
-    (*i)->get_generalized_velocity(DynamicBody::eSpatial, xgv);
+    Ravelin::SharedVectorNd xgc = _x.segment(idx, idx+NGC); idx += NGC;
+    Ravelin::SharedVectorNd xgv = _x.segment(idx, idx+NGV); idx += NGV;
+    _ode_bodies[i]->get_generalized_coordinates(DynamicBody::eEuler, xgc);
+    _ode_bodies[i]->get_generalized_velocity(DynamicBody::eSpatial, xgv);
   }
 
   // call the integrator
-  integrator->integrate(x, &ode, current_time, step_size, (void*) &shared_this);
+  integrator->integrate(_x, &ode, current_time, step_size, (void*) &shared_this);
 
   // update the generalized coordinates and velocity
   idx = 0;
-  for (ForwardIterator i = begin; i != end; i++)
+  for (unsigned i=0; i< _ode_bodies.size(); i++)
   {
-    // see whether to skip the body
-    if ((*i)->get_kinematic())
-      continue;
-
     // get number of generalized coordinates and velocities
-    const unsigned NGC = (*i)->num_generalized_coordinates(DynamicBody::eEuler);
-    const unsigned NGV = (*i)->num_generalized_coordinates(DynamicBody::eSpatial);
+    const unsigned NGC = _ode_bodies[i]->num_generalized_coordinates(DynamicBody::eEuler);
+    const unsigned NGV = _ode_bodies[i]->num_generalized_coordinates(DynamicBody::eSpatial);
 
     // get the shared vectors
-    Ravelin::SharedConstVectorNd xgc = x.segment(idx, idx+NGC); idx += NGC;
-    Ravelin::SharedConstVectorNd xgv = x.segment(idx, idx+NGV); idx += NGV;
+    Ravelin::SharedConstVectorNd xgc = _x.segment(idx, idx+NGC); idx += NGC;
+    Ravelin::SharedConstVectorNd xgv = _x.segment(idx, idx+NGV); idx += NGV;
 
     // set the generalized coordinates and velocity
-    (*i)->set_generalized_coordinates(DynamicBody::eEuler, xgc);
-    (*i)->set_generalized_velocity(DynamicBody::eSpatial, xgv);
+    _ode_bodies[i]->set_generalized_coordinates(DynamicBody::eEuler, xgc);
+    _ode_bodies[i]->set_generalized_velocity(DynamicBody::eSpatial, xgv);
   }
 
   // tabulate dynamics computation
   tms cstop;  
   clock_t stop = times(&cstop);
-  dynamics_time += (double) (stop-start)/CLOCKS_PER_SEC;
+  dynamics_time += (double) (stop-start)/sysconf(_SC_CLK_TCK);
 
   return step_size;
 }
@@ -0,0 +1,88 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_SNAPSHOT_BUFFER_H_
+#define _MOBY_SNAPSHOT_BUFFER_H_
+
+#include <vector>
+#include <pthread.h>
+
+namespace Moby {
+
+/// The renderable state of a simulation at one instant
+struct Snapshot
+{
+  /// The simulation time of the snapshot
+  double time;
+
+  /// The sequence number of the snapshot (assigned on publishing)
+  unsigned sequence;
+
+  /// Global poses of the visualizable objects (7 per: position, then quaternion w, x, y, z)
+  std::vector<double> poses;
+
+  /// Contact points and normals (6 per: point, then normal; global frame)
+  std::vector<double> contacts;
+};
+
+/// Passes snapshots from a simulation thread to a visualization thread
+/**
+ * The buffer holds three snapshots: one being written by the simulation
+ * thread (the back), one being read by the visualization thread (the
+ * front), and the most recently published one (the middle). Publishing
+ * exchanges the back and middle snapshots and acquiring exchanges the
+ * middle and front snapshots; the mutex only guards these exchanges, so
+ * neither thread ever waits on the other to copy data. The simulation
+ * thread never blocks; the visualization thread sees only the newest
+ * snapshot (intermediate snapshots are dropped if it falls behind). The
+ * snapshots' vectors are reused, so steady-state publishing does not
+ * allocate memory.
+ */
+class SnapshotBuffer
+{
+  public:
+    SnapshotBuffer();
+    ~SnapshotBuffer();
+    void publish();
+    bool acquire(bool wait);
+    void close();
+    bool is_closed();
+
+    /// Gets the snapshot to be written (simulation thread only)
+    Snapshot& get_back() { return _snapshots[_back]; }
+
+    /// Gets the last acquired snapshot (visualization thread only)
+    const Snapshot& get_front() const { return _snapshots[_front]; }
+
+  private:
+    // buffers own a mutex, so they are not copied
+    SnapshotBuffer(const SnapshotBuffer&);
+    SnapshotBuffer& operator=(const SnapshotBuffer&);
+
+    /// The three snapshots
+    Snapshot _snapshots[3];
+
+    /// Indices of the front, middle, and back snapshots
+    unsigned _front, _middle, _back;
+
+    /// The number of snapshots published
+    unsigned _published;
+
+    /// Whether the middle snapshot has been published since it was last acquired
+    bool _fresh;
+
+    /// Whether the buffer has been closed
+    bool _closed;
+
+    /// Synchronization for the exchanges
+    pthread_mutex_t _mutex;
+    pthread_cond_t _published_cond;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -38,9 +38,6 @@ struct Tetrahedron
 
   /// Fourth vertex of the tetrahedron
   Point3d d;
-
-  private:
-    static Ravelin::LinAlgd _LA;
 }; // end struct
 
 } // end namespace
@@ -0,0 +1,114 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MOBY_TRAJECTORY_RECORDER_H_
+#define _MOBY_TRAJECTORY_RECORDER_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <Ravelin/VectorNd.h>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+/// Records the trajectory of a simulation to a compact binary file
+/**
+ * Each call to record() appends a fixed-size record to a ring buffer; the
+ * record holds the simulation time, the time spent on dynamics, collision
+ * detection, and event handling during the last step, the number of contact
+ * events, and the generalized coordinates (Euler) and velocities (spatial)
+ * of every body (in order of body ID). A background thread removes blocks of
+ * records from the buffer and writes them column by column to the file, 
+ * optionally compressing each block (when Moby is built with zlib), so 
+ * recording adds almost no time to the simulation loop. 
+ *
+ * The file consists of the magic string "MOBYTRJ" (with terminating null), 
+ * the format version, the number of columns, flags, and the names of the 
+ * columns (each a length followed by the characters), followed by blocks.
+ * Each block holds the number of records, the uncompressed and stored 
+ * sizes of its data in bytes, and the data: the values of the first column
+ * for every record, then the second column, etc. All integers are 32-bit
+ * unsigned and all values are native doubles.
+ */
+class TrajectoryRecorder
+{
+  public:
+    /// The version of the file format
+    static const unsigned VERSION = 1;
+
+    /// File flag indicating that blocks are compressed
+    static const unsigned COMPRESSED = 1;
+
+    TrajectoryRecorder();
+    ~TrajectoryRecorder();
+    void open(const std::string& fname, SimulatorPtr sim, unsigned capacity = 4096, bool compress = false);
+    void record();
+    void close();
+    static void read(const std::string& fname, std::vector<std::string>& names, std::vector<std::vector<double> >& columns);
+
+    /// Determines whether the recorder is open
+    bool is_open() const { return _fp != NULL; }
+
+    /// Gets the names of the recorded columns
+    const std::vector<std::string>& get_column_names() const { return _names; }
+
+  private:
+    // recorders own a thread and a file, so they are not copied
+    TrajectoryRecorder(const TrajectoryRecorder&);
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&);
+
+    static void* flush_thread(void* arg);
+    void write_block(unsigned start, unsigned n);
+
+    /// The simulator being recorded
+    SimulatorPtr _sim;
+
+    /// The bodies being recorded (in order of ID)
+    std::vector<DynamicBodyPtr> _bodies;
+
+    /// The names of the columns
+    std::vector<std::string> _names;
+
+    /// The ring buffer of records (each of _names.size() values)
+    std::vector<double> _ring;
+
+    /// The capacity of the ring buffer (in records)
+    unsigned _capacity;
+
+    /// Index of the oldest record in the ring buffer and the number of records 
+    unsigned _tail, _count;
+
+    /// The number of records written by the background thread at once
+    unsigned _block_size;
+
+    /// Whether blocks are compressed
+    bool _compress;
+
+    /// Whether the recorder is being closed
+    bool _closing;
+
+    /// The file being written
+    FILE* _fp;
+
+    /// Buffers for the block being written (used by the background thread)
+    std::vector<double> _block;
+    std::vector<unsigned char> _zblock;
+
+    /// Workspace for recording
+    Ravelin::VectorNd _work;
+
+    /// The background thread and its synchronization
+    pthread_t _thread;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _not_full, _not_empty;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -15,6 +15,8 @@
 #include <string>
 #include <Moby/Types.h>
 #include <Moby/Primitive.h>
+#include <Moby/FlatBVH.h>
+#include <Moby/MeshAssetCache.h>
 
 namespace Moby {
 
@@ -44,8 +46,12 @@ class TriangleMeshPrimitive : public Primitive
     virtual void set_pose(const Ravelin::Pose3d& T);
     virtual double calc_signed_dist(boost::shared_ptr<const Primitive> p, boost::shared_ptr<const Ravelin::Pose3d> pose_this, boost::shared_ptr<const Ravelin::Pose3d> pose_p, Point3d& pthis, Point3d& pp) const;
 
+    /// Gets the flat (linearized) bounding volume hierarchy over the mesh (in the primitive frame)
+    const FlatBVH& get_flat_BVH() const { return (_flat_bvh) ? *_flat_bvh : _empty_bvh; }
+
   private:
     void center();
+    void set_asset(boost::shared_ptr<const MeshAssetCache::Asset> asset);
     virtual void calc_mass_properties();
 
     /// Determines whether we convexify the mesh for inertial calculations
@@ -60,39 +66,24 @@ class TriangleMeshPrimitive : public Primitive
      */
     boost::shared_ptr<const IndexedTriArray> _mesh;
 
+    /// Flat bounding volume hierarchy over the triangles of the mesh (shared with other instances when the mesh came from the asset cache)
+    boost::shared_ptr<const FlatBVH> _flat_bvh;
+
+    /// An empty flat BVH (returned when there is no mesh)
+    static const FlatBVH _empty_bvh;
+
+    /// The cached asset that the mesh came from (null if the mesh is not shared)
+    boost::shared_ptr<const MeshAssetCache::Asset> _asset;
+
     /// Edge sample length above which pseudo-vertices are added
     double _edge_sample_length;
 
-    /// Thick triangle structure augmented with mesh data
-    class AThickTri : public ThickTriangle
-    {
-      public:
-        AThickTri(const Triangle& tri, double tol) : ThickTriangle(tri, tol) {}
-        boost::shared_ptr<const IndexedTriArray> mesh;  // the mesh that this triangle came from
-        unsigned tri_idx;             // the index of this triangle
-    };
-
-    void construct_mesh_vertices(boost::shared_ptr<const IndexedTriArray> mesh, CollisionGeometryPtr geom, boost::shared_ptr<const Ravelin::Pose3d> P);
-    void build_BB_tree(CollisionGeometryPtr geom);
-    void split_tris(const Point3d& point, const Ravelin::Vector3d& normal, const IndexedTriArray& orig_mesh, const std::list<unsigned>& ofacets, std::list<unsigned>& pfacets, std::list<unsigned>& nfacets);
-    bool split(boost::shared_ptr<const IndexedTriArray> mesh, BVPtr source, BVPtr& tgt1, BVPtr& tgt2, const Ravelin::Vector3d& axis);
-    static bool is_degen_point_on_tri(boost::shared_ptr<AThickTri> tri, const Point3d& p);
-
     template <class InputIterator, class OutputIterator>
     static OutputIterator get_vertices(const IndexedTriArray& tris, InputIterator fselect_begin, InputIterator fselect_end, OutputIterator output, boost::shared_ptr<const Ravelin::Pose3d> P);
 
-    /// Mapping from BVs to triangles contained within (not necessary to index this per geometry)
-    std::map<BVPtr, std::list<unsigned> > _mesh_tris;
-
     /// Map from the geometry to the vector of vertices (w/transform and intersection tolerance applied), if any
     std::vector<Point3d> _vertices;
 
-    /// Mapping from BVs to vertex indices contained within (not necessary to index this per geometry)
-    std::map<BVPtr, std::list<unsigned> > _mesh_vertices;
-
-    /// Mapping from BV leafs to thick triangles (not necessary to index this per geometry)
-    std::map<BVPtr, std::list<boost::shared_ptr<AThickTri> > > _tris;
-
     /// List of triangles covered by a bounding volume
     std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> > _smesh;
 }; // end class
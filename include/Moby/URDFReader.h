@@ -48,6 +48,15 @@ class URDFReader
           #endif
         }
 
+        /// Gets the path of a file named relative to the URDF file
+        std::string get_path(const std::string& fname) const
+        {
+          return (fname.empty() || fname[0] == '/') ? fname : directory + fname;
+        }
+
+        /// The directory (with trailing separator) of the URDF file
+        std::string directory;
+
         std::map<RigidBodyPtr, void*> visual_transform_nodes;
         std::map<JointPtr, RigidBodyPtr> joint_parent, joint_child;
         std::map<std::string, std::pair<Ravelin::VectorNd, std::string> > materials;
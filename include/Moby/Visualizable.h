@@ -33,6 +33,7 @@ class Visualizable : public virtual Base
     Visualizable(const Visualizable* v) : Base(v) { }
     virtual ~Visualizable(); 
     virtual void update_visualization();
+    void set_visualization_transform(const Ravelin::Pose3d& T0);
     void set_visualization_relative_pose(const Ravelin::Pose3d& P);
     virtual void set_visualization_data(osg::Node* vdata); 
     virtual void set_visualization_data(OSGGroupWrapperPtr vdata); 
@@ -24,16 +24,29 @@ class MCArticulatedBody;
 class Primitive;
 
 /// Used to read the simulator state from XML
+/**
+ * The reader keeps no state between calls and does not change the working
+ * directory, so separate files may be read concurrently from several
+ * threads.
+ */
 class XMLReader
 {
   public:
     static std::map<std::string, BasePtr> read(const std::string& fname);
+    static std::map<std::string, BasePtr> read_streaming(const std::string& fname);
+    static boost::shared_ptr<XMLTree> read_tree(const std::string& fname);
+    static std::map<std::string, BasePtr> construct(boost::shared_ptr<XMLTree> moby_tree);
     
   private:
     enum TupleType { eNone, eVectorN, eVector3, eQuat };
+    static std::string get_directory(const std::string& fname);
+    static void resolve_paths(boost::shared_ptr<XMLTree> root, const std::string& dir);
+    static void process_tags(boost::shared_ptr<const XMLTree> tree, std::map<std::string, BasePtr>& id_map);
+    static void report_unprocessed(boost::shared_ptr<const XMLTree> root);
     static boost::shared_ptr<const XMLTree> find_subtree(boost::shared_ptr<const XMLTree> root, const std::string& name);
     static void process_tag(const std::string& tag, boost::shared_ptr<const XMLTree> root, void (*fn)(boost::shared_ptr<const XMLTree>, std::map<std::string, BasePtr>&), std::map<std::string, BasePtr>& id_map);
     static void read_gaussian_mixture(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
+    static void read_heightfield(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     static void read_box(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     static void read_sphere(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
     static void read_cylinder(boost::shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map);
@@ -84,10 +84,14 @@ class XMLTree : public boost::enable_shared_from_this<XMLTree>
     XMLTree(const std::string& name);
     XMLTree(const std::string& name, const std::list<XMLAttrib>& attributes);
     static boost::shared_ptr<const XMLTree> read_from_xml(const std::string& name);
+    static boost::shared_ptr<const XMLTree> construct_xml_tree(xmlNode* root);
+    static void init_parser();
+    XMLTreePtr clone() const;
     XMLAttrib* get_attrib(const std::string& attrib_name) const;
     std::list<boost::shared_ptr<const XMLTree> > find_child_nodes(const std::string& name) const;
     std::list<boost::shared_ptr<const XMLTree> > find_child_nodes(const std::list<std::string>& name) const;
     std::list<boost::shared_ptr<const XMLTree> > find_descendant_nodes(const std::string& name) const;
+    std::string get_path(const std::string& fname) const;
 
     /// Adds a child tree to this tree; also sets the parent node
     void add_child(XMLTreePtr child) { children.push_back(child); child->set_parent(shared_from_this()); }
@@ -116,9 +120,11 @@ class XMLTree : public boost::enable_shared_from_this<XMLTree>
     /// Indicates whether this tag has been processed
     bool processed;
 
+    /// The directory (with trailing separator) of the document, if this is the root of a document being written; see get_path()
+    std::string directory;
+
   private:
     boost::weak_ptr<XMLTree> _parent;
-    static boost::shared_ptr<const XMLTree> construct_xml_tree(xmlNode* root);
 }; // end class
 
 std::ostream& operator<<(std::ostream& out, const XMLTree& tree);
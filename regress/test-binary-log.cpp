@@ -0,0 +1,179 @@
+/*****************************************************************************
+ * Checks that binary log records reach the sinks for their subsystems, in
+ * order and with their values, that concurrent threads record into their
+ * own buffers, and that damaged files are handled by the reader
+ *****************************************************************************/
+
+#include <unistd.h>
+#include <pthread.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include "test.h"
+
+using namespace Moby;
+using std::vector;
+using std::string;
+
+/// Gets a temporary file name
+static string get_temp_file()
+{
+  char fname_buf[] = "/tmp/moby-test-binary-log-XXXXXX";
+  int fd = mkstemp(fname_buf);
+  CHECK(fd >= 0);
+  if (fd >= 0)
+    close(fd);
+  return string(fname_buf);
+}
+
+/// Gets the size of a file
+static long get_file_size(const string& fname)
+{
+  FILE* fp = fopen(fname.c_str(), "rb");
+  if (!fp)
+    return -1;
+  fseek(fp, 0, SEEK_END);
+  const long SZ = ftell(fp);
+  fclose(fp);
+  return SZ;
+}
+
+/// The number of records made by each recording thread
+const unsigned NTHREAD_RECORDS = 3*BinaryLog::CAPACITY/2;
+
+/// Records entries from a thread (the buffer is flushed when the thread exits)
+static void* record_from_thread(void* tag)
+{
+  for (unsigned i=0; i< NTHREAD_RECORDS; i++)
+    (BinaryLog::Entry(LOG_EVENT))((const char*) tag, (double) i);
+  return NULL;
+}
+
+int main(int argc, char** argv)
+{
+  const unsigned NFILL = BinaryLog::CAPACITY + 10;
+
+  // one sink for events only, one for events and collision detection
+  const string EVENT_FNAME = get_temp_file(), ALL_FNAME = get_temp_file();
+  BinaryLog::open(LOG_EVENT, EVENT_FNAME);
+  BinaryLog::open(LOG_EVENT | LOG_COLDET, ALL_FNAME);
+  CHECK(BinaryLog::recording_level == (LOG_EVENT | LOG_COLDET));
+
+  // record entries with each number of values; more values than a record
+  // holds are dropped
+  const double VALUES[] = { 1.5, -2.0, 1e-300, 4e10, 7.0 };
+  (BinaryLog::Entry(LOG_EVENT))("none");
+  (BinaryLog::Entry(LOG_COLDET))("one", VALUES[0]);
+  (BinaryLog::Entry(LOG_EVENT))("two", VALUES[0], VALUES[1]);
+  (BinaryLog::Entry(LOG_EVENT | LOG_COLDET))("three", VALUES[0], VALUES[1], VALUES[2]);
+  (BinaryLog::Entry(LOG_COLDET))("four", VALUES[0], VALUES[1], VALUES[2], VALUES[3]);
+  BinaryLog::record(LOG_EVENT, "five", 5, VALUES);
+
+  // fill the buffer past its capacity so that it is written before close()
+  for (unsigned i=0; i< NFILL; i++)
+    (BinaryLog::Entry(LOG_COLDET))("fill", (double) i);
+  BinaryLog::close();
+  CHECK(BinaryLog::recording_level == 0);
+
+  // the event sink gets only the event records
+  vector<LogRecord> records;
+  vector<string> tags;
+  CHECK(BinaryLog::read(EVENT_FNAME, records, tags));
+  CHECK(records.size() == 4);
+  if (records.size() == 4)
+  {
+    CHECK(strcmp(records[0].tag, "none") == 0 && records[0].nvalues == 0);
+    CHECK(strcmp(records[1].tag, "two") == 0 && records[1].nvalues == 2);
+    CHECK(strcmp(records[2].tag, "three") == 0 && records[2].nvalues == 3);
+    CHECK(strcmp(records[3].tag, "five") == 0 && records[3].nvalues == LogRecord::MAX_VALUES);
+    CHECK(records[2].level == (LOG_EVENT | LOG_COLDET));
+    for (unsigned i=0; i< records.size(); i++)
+    {
+      CHECK(records[i].thread == records[0].thread);
+      CHECK(i == 0 || records[i].time >= records[i-1].time);
+      for (unsigned j=0; j< records[i].nvalues; j++)
+        CHECK(records[i].values[j] == VALUES[j]);
+    }
+  }
+  CHECK(tags.size() == 4);
+
+  // the other sink gets everything, in order, with the tags shared
+  CHECK(BinaryLog::read(ALL_FNAME, records, tags));
+  CHECK(records.size() == 6 + NFILL);
+  CHECK(tags.size() == 7);
+  if (records.size() == 6 + NFILL)
+  {
+    const char* ORDER[] = { "none", "one", "two", "three", "four", "five" };
+    for (unsigned i=0; i< 6; i++)
+      CHECK(strcmp(records[i].tag, ORDER[i]) == 0);
+    CHECK(records[4].nvalues == 4 && records[4].values[3] == VALUES[3]);
+    for (unsigned i=0; i< NFILL; i++)
+    {
+      const LogRecord& r = records[6+i];
+      CHECK(strcmp(r.tag, "fill") == 0 && r.level == LOG_COLDET);
+      CHECK(r.nvalues == 1 && r.values[0] == (double) i);
+      CHECK(r.tag == records[6].tag);
+    }
+  }
+
+  // a truncated record is dropped; the records before it are kept
+  const long SZ = get_file_size(EVENT_FNAME);
+  CHECK(SZ > 0 && truncate(EVENT_FNAME.c_str(), SZ - 1) == 0);
+  CHECK(BinaryLog::read(EVENT_FNAME, records, tags));
+  CHECK(records.size() == 3);
+
+  // a file with the wrong magic or version is rejected
+  FILE* fp = fopen(EVENT_FNAME.c_str(), "r+b");
+  CHECK(fp);
+  if (fp)
+  {
+    unsigned version = BinaryLog::VERSION + 1;
+    fseek(fp, 8, SEEK_SET);
+    fwrite(&version, sizeof(unsigned), 1, fp);
+    fclose(fp);
+  }
+  CHECK(!BinaryLog::read(EVENT_FNAME, records, tags));
+  fp = fopen(ALL_FNAME.c_str(), "r+b");
+  CHECK(fp);
+  if (fp)
+  {
+    fwrite("NOTALOG", 1, 8, fp);
+    fclose(fp);
+  }
+  CHECK(!BinaryLog::read(ALL_FNAME, records, tags));
+  CHECK(!BinaryLog::read("/nonexistent/moby.log", records, tags));
+
+  // two threads recording at once each get their own buffer and index
+  const string THREAD_FNAME = get_temp_file();
+  const char* TAGS[] = { "thread0", "thread1" };
+  BinaryLog::open(LOG_EVENT, THREAD_FNAME);
+  pthread_t threads[2];
+  for (unsigned i=0; i< 2; i++)
+    CHECK(pthread_create(&threads[i], NULL, &record_from_thread, (void*) TAGS[i]) == 0);
+  for (unsigned i=0; i< 2; i++)
+    pthread_join(threads[i], NULL);
+  BinaryLog::close();
+  CHECK(BinaryLog::read(THREAD_FNAME, records, tags));
+  CHECK(records.size() == 2*NTHREAD_RECORDS);
+  unsigned count[2] = { 0, 0 }, thread[2] = { 0, 0 };
+  for (unsigned i=0; i< records.size(); i++)
+  {
+    const unsigned T = (strcmp(records[i].tag, TAGS[0]) == 0) ? 0 : 1;
+    CHECK(strcmp(records[i].tag, TAGS[T]) == 0);
+    if (count[T] == 0)
+      thread[T] = records[i].thread;
+    CHECK(records[i].thread == thread[T]);
+    CHECK(records[i].nvalues == 1 && records[i].values[0] == (double) count[T]);
+    count[T]++;
+  }
+  CHECK(count[0] == NTHREAD_RECORDS && count[1] == NTHREAD_RECORDS);
+  CHECK(thread[0] != thread[1]);
+
+  unlink(EVENT_FNAME.c_str());
+  unlink(ALL_FNAME.c_str());
+  unlink(THREAD_FNAME.c_str());
+  return report("binary-log");
+}
@@ -0,0 +1,183 @@
+/*****************************************************************************
+ * Checks that binary mesh files round trip and that files with inconsistent
+ * BVH data are rejected rather than read
+ *****************************************************************************/
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include <Moby/BinaryMeshFile.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::vector;
+using std::string;
+
+/// Creates a (closed) unit cube mesh
+static IndexedTriArray create_cube()
+{
+  vector<Origin3d> verts;
+  for (unsigned i=0; i< 8; i++)
+    verts.push_back(Origin3d((i & 1) ? 0.5 : -0.5, (i & 2) ? 0.5 : -0.5, (i & 4) ? 0.5 : -0.5));
+  const unsigned QUADS[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+  vector<IndexedTri> facets;
+  for (unsigned i=0; i< 6; i++)
+  {
+    facets.push_back(IndexedTri(QUADS[i][0], QUADS[i][1], QUADS[i][2]));
+    facets.push_back(IndexedTri(QUADS[i][0], QUADS[i][2], QUADS[i][3]));
+  }
+  return IndexedTriArray(verts.begin(), verts.end(), facets.begin(), facets.end());
+}
+
+/// Creates a hierarchy in which each internal node has a leaf as its left child
+static FlatBVH create_chain(unsigned depth)
+{
+  vector<FlatBVH::Node> nodes(2*depth+1);
+  for (unsigned i=0; i< nodes.size(); i++)
+  {
+    FlatBVH::Node& n = nodes[i];
+    for (unsigned k=0; k< 3; k++)
+    {
+      n.lo[k] = -0.5;
+      n.hi[k] = 0.5;
+    }
+    const bool LEAF = (i % 2 == 1 || i+1 == nodes.size());
+    n.offset = (LEAF) ? 0 : i+2;
+    n.count = (LEAF) ? 1 : 0;
+  }
+  const unsigned TRI_IDX = 0;
+  FlatBVH bvh;
+  bvh.assign(&nodes[0], nodes.size(), &TRI_IDX, 1);
+  return bvh;
+}
+
+/// Determines whether a file can be read
+static bool readable(const string& fname)
+{
+  shared_ptr<IndexedTriArray> mesh;
+  shared_ptr<FlatBVH> bvh;
+  double volume_ints[10];
+  Origin3d centroid;
+  try
+  {
+    BinaryMeshFile::read(fname, mesh, bvh, volume_ints, centroid);
+    return true;
+  }
+  catch (std::runtime_error&)
+  {
+    return false;
+  }
+}
+
+/// Writes a node of the BVH in a file
+static void write_node(const string& fname, unsigned num_nodes, unsigned num_tri_idx, unsigned i, const FlatBVH::Node& n)
+{
+  FILE* fp = fopen(fname.c_str(), "r+b");
+  fseek(fp, 0, SEEK_END);
+  const long END = ftell(fp);
+  fseek(fp, END - (long) (sizeof(unsigned)*num_tri_idx + sizeof(FlatBVH::Node)*(num_nodes-i)), SEEK_SET);
+  fwrite(&n, sizeof(FlatBVH::Node), 1, fp);
+  fclose(fp);
+}
+
+int main(int argc, char** argv)
+{
+  // get a temporary file
+  char fname_buf[] = "/tmp/moby-test-binary-mesh-XXXXXX";
+  int fd = mkstemp(fname_buf);
+  CHECK(fd >= 0);
+  if (fd < 0)
+    return report("binary-mesh");
+  close(fd);
+  const string FNAME(fname_buf);
+
+  // write the cube with its BVH and mass data and read it back
+  IndexedTriArray cube = create_cube();
+  FlatBVH bvh(cube);
+  double volume_ints[10];
+  cube.calc_volume_ints(volume_ints);
+  Origin3d centroid(0.0, 0.0, 0.0);
+  BinaryMeshFile::write(FNAME, cube, &bvh, volume_ints, &centroid);
+  shared_ptr<IndexedTriArray> mesh;
+  shared_ptr<FlatBVH> bvh2;
+  double volume_ints2[10];
+  Origin3d centroid2;
+  const unsigned CONTENTS = BinaryMeshFile::read(FNAME, mesh, bvh2, volume_ints2, centroid2);
+  CHECK(CONTENTS == (BinaryMeshFile::eBVH | BinaryMeshFile::eMassProperties));
+  CHECK(mesh && mesh->get_vertices().size() == 8 && mesh->num_tris() == 12);
+  CHECK(bvh2 && bvh2->get_nodes().size() == bvh.get_nodes().size());
+  CHECK(bvh2 && bvh2->get_tri_indices() == bvh.get_tri_indices());
+  for (unsigned i=0; i< 10; i++)
+    CHECK_NEAR(volume_ints2[i], volume_ints[i], 0.0);
+
+  // the distance queries must agree for the read hierarchy
+  if (mesh && bvh2)
+  {
+    Vector3d n1, n2;
+    Point3d p(0.6, 0.7, -0.2, GLOBAL);
+    CHECK_NEAR(bvh.calc_signed_dist(cube, p, n1), bvh2->calc_signed_dist(*mesh, p, n2), 1e-12);
+    Point3d q(0.1, -0.2, 0.3, GLOBAL);
+    CHECK_NEAR(bvh2->calc_signed_dist(*mesh, q, n2), -0.2, 1e-12);
+  }
+
+  // corrupt the root (an internal node) and the first leaf
+  const unsigned NNODES = bvh.get_nodes().size(), NIDX = bvh.get_tri_indices().size();
+  const FlatBVH::Node ROOT = bvh.get_nodes()[0];
+  CHECK(!ROOT.is_leaf());
+  unsigned leaf = 0;
+  while (leaf < NNODES && !bvh.get_nodes()[leaf].is_leaf())
+    leaf++;
+  const FlatBVH::Node LEAF = bvh.get_nodes()[leaf];
+
+  // a right child must follow the left child
+  FlatBVH::Node bad = ROOT;
+  bad.offset = 1;
+  write_node(FNAME, NNODES, NIDX, 0, bad);
+  CHECK(!readable(FNAME));
+
+  // a right child must exist
+  bad.offset = NNODES;
+  write_node(FNAME, NNODES, NIDX, 0, bad);
+  CHECK(!readable(FNAME));
+  write_node(FNAME, NNODES, NIDX, 0, ROOT);
+  CHECK(readable(FNAME));
+
+  // a leaf's triangle range must not wrap around
+  bad = LEAF;
+  bad.offset = 0xFFFFFFF0;
+  bad.count = 0x20;
+  write_node(FNAME, NNODES, NIDX, leaf, bad);
+  CHECK(!readable(FNAME));
+
+  // a leaf's triangle range must lie within the indices
+  bad.offset = NIDX;
+  bad.count = 1;
+  write_node(FNAME, NNODES, NIDX, leaf, bad);
+  CHECK(!readable(FNAME));
+  write_node(FNAME, NNODES, NIDX, leaf, LEAF);
+  CHECK(readable(FNAME));
+
+  // hierarchies deeper than the traversal stacks allow are rejected
+  FlatBVH deep = create_chain(FlatBVH::MAX_DEPTH - 1);
+  BinaryMeshFile::write(FNAME, cube, &deep);
+  CHECK(readable(FNAME));
+  FlatBVH too_deep = create_chain(FlatBVH::MAX_DEPTH);
+  BinaryMeshFile::write(FNAME, cube, &too_deep);
+  CHECK(!readable(FNAME));
+
+  // truncated files are rejected
+  BinaryMeshFile::write(FNAME, cube, &bvh);
+  FILE* fp = fopen(FNAME.c_str(), "r+b");
+  fseek(fp, 0, SEEK_END);
+  const long LEN = ftell(fp);
+  fclose(fp);
+  CHECK(truncate(FNAME.c_str(), LEN - 4) == 0);
+  CHECK(!readable(FNAME));
+
+  std::remove(FNAME.c_str());
+  return report("binary-mesh");
+}
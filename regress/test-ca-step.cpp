@@ -0,0 +1,99 @@
+/*****************************************************************************
+ * Checks that the conservative advancement step computed by CCD never
+ * passes the exact time of impact (for translating and rotating bodies),
+ * is exact for pure translation at the velocity limit, and that the
+ * iteration limit is saved, restored, and validated
+ *****************************************************************************/
+
+#include <cmath>
+#include <list>
+#include <stdexcept>
+#include <Moby/XMLTree.h>
+#include <Moby/RigidBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/CCD.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::map;
+using std::list;
+using std::string;
+
+/// Gets the (single) collision geometry of a rigid body
+static CollisionGeometryPtr get_geometry(shared_ptr<RigidBody> rb)
+{
+  CHECK(rb && rb->geometries.size() == 1);
+  if (!rb || rb->geometries.empty())
+    return CollisionGeometryPtr();
+  return rb->geometries.front();
+}
+
+int main(int argc, char** argv)
+{
+  const double DT = 0.1;
+
+  map<string, BasePtr> id_map = read_scene(argc, argv, "ccd.xml");
+  shared_ptr<RigidBody> box_body = get_object<RigidBody>(id_map, "box");
+  shared_ptr<RigidBody> rotor_body = get_object<RigidBody>(id_map, "rotor");
+  CollisionGeometryPtr wall = get_geometry(get_object<RigidBody>(id_map, "wall"));
+  CollisionGeometryPtr box = get_geometry(box_body);
+  CollisionGeometryPtr rotor = get_geometry(rotor_body);
+  if (!wall || !box || !rotor)
+    return report("ca-step");
+
+  // setup the velocity limits (30% beyond the current velocities)
+  box_body->update_vel_limits();
+  rotor_body->update_vel_limits();
+
+  // the box (face at x = -1.5) moves at 100 toward the wall (face at
+  // x = -0.01) and may move at up to 130; as it cannot rotate, the bound is
+  // exact for the limiting velocity
+  CCD ccd;
+  const double TOI_BOX = 1.49/100.0;
+  const double T_BOX = ccd.calc_CA_step(box, wall, DT);
+  CHECK_NEAR(T_BOX, 1.49/130.0, 1e-8);
+  CHECK(T_BOX <= TOI_BOX);
+
+  // the rotor only rotates; the step must be positive but must not pass
+  // the time at which its corner reaches the wall
+  const double CORNER = std::sqrt(0.5);
+  const double TOI_ROTOR = (M_PI/4.0 - std::acos(0.59/CORNER))/20.0;
+  const double T_ROTOR = ccd.calc_CA_step(rotor, wall, DT);
+  CHECK(T_ROTOR > 0.0);
+  CHECK(T_ROTOR <= TOI_ROTOR);
+
+  // more iterations can only advance further, never past the impact
+  ccd.max_CA_iterations = 1;
+  const double T_ROTOR1 = ccd.calc_CA_step(rotor, wall, DT);
+  ccd.max_CA_iterations = 50;
+  const double T_ROTOR50 = ccd.calc_CA_step(rotor, wall, DT);
+  CHECK(T_ROTOR1 > 0.0 && T_ROTOR1 <= T_ROTOR);
+  CHECK(T_ROTOR50 >= T_ROTOR && T_ROTOR50 <= TOI_ROTOR);
+
+  // the iteration limit is saved and restored
+  XMLTreePtr node(new XMLTree("CCD"));
+  list<shared_ptr<const Base> > shared_objects;
+  ccd.max_CA_iterations = 13;
+  ccd.save_to_xml(node, shared_objects);
+  CCD ccd2;
+  ccd2.load_from_xml(node, id_map);
+  CHECK(ccd2.max_CA_iterations == 13);
+
+  // zero iterations are rejected
+  XMLTreePtr bad(new XMLTree("CCD"));
+  bad->attribs.insert(XMLAttrib("max-CA-iterations", (unsigned) 0));
+  bool thrown = false;
+  try
+  {
+    ccd2.load_from_xml(bad, id_map);
+  }
+  catch (std::runtime_error& e)
+  {
+    thrown = true;
+  }
+  CHECK(thrown);
+
+  return report("ca-step");
+}
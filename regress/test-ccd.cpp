@@ -0,0 +1,104 @@
+/*****************************************************************************
+ * Checks the times of impact computed by GeneralizedCCD against the exact
+ * times for fast boxes and spheres approaching a thin wall, translating
+ * and rotating (and accelerating), and checks that the query leaves the
+ * bodies untouched
+ *****************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <Moby/RigidBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/GeneralizedCCD.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::map;
+using std::string;
+using std::vector;
+using std::pair;
+using std::make_pair;
+
+/// Gets the (single) collision geometry of a rigid body
+static CollisionGeometryPtr get_geometry(shared_ptr<RigidBody> rb)
+{
+  CHECK(rb && rb->geometries.size() == 1);
+  if (!rb || rb->geometries.empty())
+    return CollisionGeometryPtr();
+  return rb->geometries.front();
+}
+
+int main(int argc, char** argv)
+{
+  const double DT = 0.1, TOL = 1e-5;
+
+  map<string, BasePtr> id_map = read_scene(argc, argv, "ccd.xml");
+  CollisionGeometryPtr wall = get_geometry(get_object<RigidBody>(id_map, "wall"));
+  CollisionGeometryPtr box = get_geometry(get_object<RigidBody>(id_map, "box"));
+  CollisionGeometryPtr ball = get_geometry(get_object<RigidBody>(id_map, "ball"));
+  CollisionGeometryPtr rotor = get_geometry(get_object<RigidBody>(id_map, "rotor"));
+  CollisionGeometryPtr spinner = get_geometry(get_object<RigidBody>(id_map, "spinner"));
+  if (!wall || !box || !ball || !rotor || !spinner)
+    return report("ccd");
+  shared_ptr<RigidBody> box_body = get_object<RigidBody>(id_map, "box");
+  const Transform3d T0 = Pose3d::calc_relative_pose(box_body->get_pose(), GLOBAL);
+
+  // the box (face at x = -1.5, moving at 100) reaches the wall (face at
+  // x = -0.01) well before the end of the interval, when it would already
+  // be past the wall
+  GeneralizedCCD ccd;
+  const double TOI_BOX = 1.49/100.0;
+  CHECK_NEAR(ccd.calc_TOI(DT, box, wall), TOI_BOX, TOL);
+  CHECK_NEAR(ccd.calc_TOI(DT, wall, box), TOI_BOX, TOL);
+
+  // the sphere (surface at x = 2.5, moving at -50) reaches the other face
+  const double TOI_BALL = 2.49/50.0;
+  CHECK_NEAR(ccd.calc_TOI(DT, ball, wall), TOI_BALL, TOL);
+  CHECK_NEAR(ccd.calc_TOI(DT, wall, ball), TOI_BALL, TOL);
+
+  // the box and the sphere approach each other at 150
+  CHECK_NEAR(ccd.calc_TOI(DT, box, ball), 4.0/150.0, TOL);
+
+  // the rotor (centered at x = -0.6, rotating at 20 about z) has no face
+  // moving toward the wall; its corner, starting at -45 degrees, reaches
+  // x = -0.01 when its angle is -acos(0.59/|corner|)
+  const double CORNER = std::sqrt(0.5);
+  const double TOI_ROTOR = (M_PI/4.0 - std::acos(0.59/CORNER))/20.0;
+  CHECK_NEAR(ccd.calc_TOI(DT, rotor, wall), TOI_ROTOR, TOL);
+
+  // the spinner never reaches the wall
+  CHECK(ccd.calc_TOI(DT, spinner, wall) == DT);
+
+  // the earliest time is found over a set of pairs (checked in parallel
+  // when OpenMP is enabled)
+  vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> > pairs;
+  pairs.push_back(make_pair(spinner, wall));
+  pairs.push_back(make_pair(ball, wall));
+  pairs.push_back(make_pair(rotor, wall));
+  pairs.push_back(make_pair(box, wall));
+  CHECK_NEAR(ccd.calc_TOI(DT, pairs), std::min(TOI_BOX, TOI_ROTOR), TOL);
+  pairs.pop_back();
+  pairs.pop_back();
+  CHECK_NEAR(ccd.calc_TOI(DT, pairs), TOI_BALL, TOL);
+
+  // stopped, the box never reaches the wall under constant twist; when it
+  // accelerates toward the wall at 1000, its face reaches the wall when
+  // 1000*t^2/2 = 1.49
+  SVelocityd v0 = box_body->get_velocity();
+  v0.set_zero();
+  box_body->set_velocity(v0);
+  CHECK(ccd.calc_TOI(DT, box, wall) == DT);
+  SAcceld a0(box_body->get_mixed_pose());
+  a0.set_zero();
+  a0.set_linear(Vector3d(1000.0, 0.0, 0.0, box_body->get_mixed_pose()));
+  box_body->set_accel(a0);
+  CHECK_NEAR(ccd.calc_TOI(DT, box, wall), std::sqrt(2.0*1.49/1000.0), TOL);
+
+  // the query must not have moved the body
+  const Transform3d T1 = Pose3d::calc_relative_pose(box_body->get_pose(), GLOBAL);
+  CHECK((T1.x - T0.x).norm() == 0.0);
+
+  return report("ccd");
+}
@@ -0,0 +1,123 @@
+/*****************************************************************************
+ * Checks the signed distance computed with FlatBVH against the exact
+ * distance to a thin wedge, whose sharp edges are where a single closest
+ * triangle's normal gives the wrong side, and checks that the tree-tree
+ * traversal reports every pair of intersecting triangles of two wedges
+ *****************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <Moby/CompGeom.h>
+#include <Moby/IndexedTriArray.h>
+#include <Moby/FlatBVH.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using std::vector;
+using std::pair;
+using std::make_pair;
+
+/// The half-width of the wedge at x = 1
+const double WIDTH = 0.1;
+
+/// Determines whether a point lies inside the wedge (and not near its surface)
+static int classify(const Point3d& p)
+{
+  const double EPS = 1e-3;
+  const double DX = std::min(p[0], 1.0 - p[0]);
+  const double DY = WIDTH*p[0] - std::fabs(p[1]);
+  const double DZ = std::min(p[2], 1.0 - p[2]);
+  if (DX > EPS && DY > EPS && DZ > EPS)
+    return -1;
+  if (DX < -EPS || DY < -EPS || DZ < -EPS)
+    return 1;
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  const unsigned NANGLES = 720;
+  const double R = 0.05;
+
+  // setup a wedge: a triangular prism with a sharp edge along the z axis
+  vector<Origin3d> verts;
+  const double XY[3][2] = { { 0.0, 0.0 }, { 1.0, -WIDTH }, { 1.0, WIDTH } };
+  for (unsigned z=0; z< 2; z++)
+    for (unsigned i=0; i< 3; i++)
+      verts.push_back(Origin3d(XY[i][0], XY[i][1], (double) z));
+  vector<IndexedTri> facets;
+  facets.push_back(IndexedTri(3, 4, 5));
+  facets.push_back(IndexedTri(0, 2, 1));
+  for (unsigned i=0; i< 3; i++)
+  {
+    const unsigned J = (i+1) % 3;
+    facets.push_back(IndexedTri(i, J, J+3));
+    facets.push_back(IndexedTri(i, J+3, i+3));
+  }
+  IndexedTriArray mesh(verts.begin(), verts.end(), facets.begin(), facets.end());
+  FlatBVH bvh(mesh);
+
+  // check points on circles around the sharp edge and around the apex
+  // vertex, where the closest point on the mesh is an edge or a vertex
+  unsigned tested = 0;
+  for (unsigned k=0; k< 2; k++)
+  {
+    const double Z = (k == 0) ? 0.5 : -0.02;
+    for (unsigned i=0; i< NANGLES; i++)
+    {
+      const double TH = 2.0*M_PI*i/NANGLES;
+      Point3d p(R*std::cos(TH), R*std::sin(TH), Z, GLOBAL);
+      const int SIDE = classify(p);
+      if (SIDE == 0)
+        continue;
+
+      Vector3d normal;
+      const double DIST = bvh.calc_signed_dist(mesh, p, normal);
+      CHECK((DIST > 0.0) == (SIDE > 0));
+      CHECK_NEAR(normal.norm(), 1.0, 1e-8);
+      tested++;
+    }
+  }
+  CHECK(tested > NANGLES);
+
+  // check points along the axis of the wedge
+  for (unsigned i=1; i< 10; i++)
+  {
+    Vector3d normal;
+    Point3d p(0.1*i, 0.0, 0.5, GLOBAL);
+    CHECK(bvh.calc_signed_dist(mesh, p, normal) < 0.0);
+  }
+
+  // intersect the wedge with a copy of itself rotated about the center of
+  // its broad faces
+  Transform3d aTb;
+  aTb.source = aTb.target = GLOBAL;
+  aTb.q = Quatd::rpy(0.3, -0.2, 1.1);
+  aTb.x = Origin3d(0.8, 0.0, 0.5) - aTb.q * Origin3d(0.8, 0.0, 0.5);
+  vector<pair<unsigned, unsigned> > tri_pairs;
+  FlatBVH::intersect(bvh, bvh, aTb, tri_pairs);
+  std::sort(tri_pairs.begin(), tri_pairs.end());
+
+  // every pair of intersecting triangles must be reported
+  unsigned nisect = 0;
+  for (unsigned i=0; i< facets.size(); i++)
+    for (unsigned j=0; j< facets.size(); j++)
+    {
+      Triangle ta = mesh.get_triangle(i, GLOBAL);
+      Triangle tb = Triangle::transform(mesh.get_triangle(j, GLOBAL), aTb);
+      if (!CompGeom::query_intersect_tri_tri(ta, tb))
+        continue;
+      nisect++;
+      CHECK(std::binary_search(tri_pairs.begin(), tri_pairs.end(), make_pair(i, j)));
+    }
+  CHECK(nisect > 0);
+
+  // separated copies must report no pairs
+  aTb.x = Origin3d(5.0, 0.0, 0.0);
+  FlatBVH::intersect(bvh, bvh, aTb, tri_pairs);
+  CHECK(tri_pairs.empty());
+
+  return report("flat-bvh");
+}
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * Checks the grid-accelerated height queries of GaussianMixture against a
+ * brute-force evaluation of the mixture, and the batched queries against
+ * the scalar ones
+ *****************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <Moby/GaussianMixture.h>
+#include "test.h"
+
+using namespace Moby;
+using std::vector;
+
+/// Evaluates the mixture height by examining every Gaussian
+static double brute_force_height(const vector<GaussianMixture::Gauss>& gauss, double x, double y)
+{
+  double h = 0.0;
+  for (unsigned i=0; i< gauss.size(); i++)
+  {
+    const GaussianMixture::Gauss& g = gauss[i];
+    const double CTH = std::cos(g.th), STH = std::sin(g.th);
+    const double DX = CTH*x + STH*y - g.x0;
+    const double DY = -STH*x + CTH*y - g.y0;
+    h = std::max(h, g.A * std::exp(-(DX*DX/(2.0*g.sigma_x*g.sigma_x) + DY*DY/(2.0*g.sigma_y*g.sigma_y))));
+  }
+
+  return h;
+}
+
+int main(int argc, char** argv)
+{
+  const double TOL = 1e-6, FD_H = 1e-6, FD_TOL = 1e-4;
+  const unsigned N = 41;
+
+  // setup a mixture of overlapping, rotated Gaussians
+  vector<GaussianMixture::Gauss> gauss;
+  GaussianMixture::Gauss g;
+  g.A = 1.0;  g.sigma_x = 0.5; g.sigma_y = 0.25; g.x0 = 0.0;  g.y0 = 0.0; g.th = 0.3;
+  gauss.push_back(g);
+  g.A = 0.5;  g.sigma_x = 0.2; g.sigma_y = 0.2;  g.x0 = 1.0;  g.y0 = -0.5; g.th = 0.0;
+  gauss.push_back(g);
+  g.A = 0.75; g.sigma_x = 0.3; g.sigma_y = 0.6;  g.x0 = -1.0; g.y0 = 1.0; g.th = -1.2;
+  gauss.push_back(g);
+  GaussianMixture mix;
+  mix.rebuild(gauss);
+
+  // sample a grid of points covering (and extending past) the mixture
+  vector<double> x, y;
+  for (unsigned i=0; i< N; i++)
+    for (unsigned j=0; j< N; j++)
+    {
+      x.push_back(-3.0 + 6.0*i/(N-1));
+      y.push_back(-3.0 + 6.0*j/(N-1));
+    }
+
+  // evaluate the heights in one batch
+  const unsigned NPTS = x.size();
+  vector<double> h(NPTS), dhdx(NPTS), dhdy(NPTS);
+  mix.calc_heights(NPTS, &x[0], &y[0], &h[0], &dhdx[0], &dhdy[0]);
+
+  for (unsigned i=0; i< NPTS; i++)
+  {
+    // the batched height must match the scalar query and brute force
+    Ravelin::Vector3d normal;
+    CHECK_NEAR(h[i], mix.calc_height(x[i], y[i], normal), 1e-12);
+    CHECK_NEAR(h[i], brute_force_height(gauss, x[i], y[i]), TOL);
+
+    // the gradient must match finite differences away from the creases
+    // where the dominant Gaussian changes
+    const double HX0 = brute_force_height(gauss, x[i]-FD_H, y[i]);
+    const double HX1 = brute_force_height(gauss, x[i]+FD_H, y[i]);
+    const double HY0 = brute_force_height(gauss, x[i], y[i]-FD_H);
+    const double HY1 = brute_force_height(gauss, x[i], y[i]+FD_H);
+    const double GX = (HX1 - HX0)/(2.0*FD_H), GY = (HY1 - HY0)/(2.0*FD_H);
+    const double GX0 = (h[i] - HX0)/FD_H, GX1 = (HX1 - h[i])/FD_H;
+    const double GY0 = (h[i] - HY0)/FD_H, GY1 = (HY1 - h[i])/FD_H;
+    if (std::fabs(GX0 - GX1) < FD_TOL && std::fabs(GY0 - GY1) < FD_TOL)
+    {
+      CHECK_NEAR(dhdx[i], GX, FD_TOL);
+      CHECK_NEAR(dhdy[i], GY, FD_TOL);
+    }
+  }
+
+  // the batch may omit the gradients
+  vector<double> h2(NPTS);
+  mix.calc_heights(NPTS, &x[0], &y[0], &h2[0], NULL, NULL);
+  for (unsigned i=0; i< NPTS; i++)
+    CHECK_NEAR(h2[i], h[i], 1e-12);
+
+  return report("gaussian-heights");
+}
@@ -0,0 +1,116 @@
+/*****************************************************************************
+ * Checks the heightfield distance queries against a heightfield with a
+ * single (analytically known) peak: point distances must be lower bounds on
+ * the true distance, and a box whose face rests on the peak (with every
+ * corner well clear of the heightfield) must be found in contact
+ *****************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <Moby/HeightfieldPrimitive.h>
+#include <Moby/BoxPrimitive.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::vector;
+
+/// The number of samples along each side of the heightfield
+const unsigned N = 11;
+
+/// The spacing between samples
+const double SPACING = 0.1;
+
+/// The height of the peak at the center of the heightfield
+const double PEAK = 0.5;
+
+/// Computes the (bilinear) height of the heightfield analytically
+static double analytic_height(double x, double y)
+{
+  return PEAK * std::max(0.0, 1.0 - std::fabs(x)/SPACING) * std::max(0.0, 1.0 - std::fabs(y)/SPACING);
+}
+
+/// Computes the distance from a point to the heightfield by dense sampling
+static double sampled_dist(double x, double y, double z)
+{
+  const unsigned M = 401;
+  const double HALF = 0.5*(N-1)*SPACING;
+  double min_dist = std::numeric_limits<double>::max();
+  for (unsigned i=0; i< M; i++)
+    for (unsigned j=0; j< M; j++)
+    {
+      const double SX = -HALF + 2.0*HALF*i/(M-1);
+      const double SY = -HALF + 2.0*HALF*j/(M-1);
+      const double DX = x - SX, DY = y - SY, DZ = z - analytic_height(SX, SY);
+      min_dist = std::min(min_dist, std::sqrt(DX*DX + DY*DY + DZ*DZ));
+    }
+
+  return min_dist;
+}
+
+int main(int argc, char** argv)
+{
+  const double TOL = 1e-9;
+
+  // setup a flat heightfield with a single peak at the origin
+  vector<double> heights(N*N, 0.0);
+  heights[(N/2)*N + N/2] = PEAK;
+  shared_ptr<HeightfieldPrimitive> hf(new HeightfieldPrimitive);
+  hf->set_heights(heights, N, N);
+  hf->set_spacing(SPACING, SPACING);
+  shared_ptr<const Pose3d> P = hf->get_pose();
+
+  // the interpolated heights must match the analytic heights
+  for (double x = -0.45; x <= 0.45; x += 0.03)
+    for (double y = -0.45; y <= 0.45; y += 0.07)
+      CHECK_NEAR(hf->calc_height(x, y), analytic_height(x, y), TOL);
+
+  // far from the peak, the heightfield is flat and the distance is exact
+  Vector3d normal;
+  CHECK_NEAR(hf->calc_dist_and_normal(Point3d(0.4, 0.4, 0.2, P), normal), 0.2, TOL);
+  CHECK_NEAR(normal[2], 1.0, TOL);
+
+  // below the heightfield, the distance is the (negative) height gap
+  CHECK_NEAR(hf->calc_dist_and_normal(Point3d(0.4, 0.4, -0.1, P), normal), -0.1, TOL);
+
+  // near the peak, the distance must never exceed the true distance (the
+  // flat tangent plane under the first point is farther than the peak)
+  const double PTS[5][3] = { { 0.15, 0.0, 0.3 }, { 0.0, 0.0, 1.0 }, { 0.12, 0.12, 0.2 }, { -0.2, 0.05, 0.6 }, { 0.05, 0.05, 0.2 } };
+  for (unsigned i=0; i< 5; i++)
+  {
+    const double D = hf->calc_dist_and_normal(Point3d(PTS[i][0], PTS[i][1], PTS[i][2], P), normal);
+    CHECK(D > 0.0);
+    CHECK(D <= sampled_dist(PTS[i][0], PTS[i][1], PTS[i][2]) + TOL);
+  }
+
+  // setup a box (0.6 x 0.6 x 0.2) over the peak; its corners lie over the
+  // flat part of the heightfield
+  shared_ptr<BoxPrimitive> box(new BoxPrimitive(0.6, 0.6, 0.2));
+  shared_ptr<Pose3d> box_pose(new Pose3d);
+  Point3d pthis, pbox;
+
+  // lower the bottom face onto the peak: the peak penetrates it by 0.05
+  box_pose->x = Origin3d(0.0, 0.0, PEAK + 0.05);
+  double D = hf->calc_signed_dist(box, P, box_pose, pthis, pbox);
+  CHECK_NEAR(D, -0.05, TOL);
+  CHECK_NEAR(pthis[0], 0.0, TOL);
+  CHECK_NEAR(pthis[1], 0.0, TOL);
+  CHECK_NEAR(pthis[2], PEAK, TOL);
+
+  // raise the bottom face 0.1 above the peak: the distance must be positive
+  // but no more than the gap over the peak
+  box_pose->x = Origin3d(0.0, 0.0, PEAK + 0.2);
+  D = hf->calc_signed_dist(box, P, box_pose, pthis, pbox);
+  CHECK(D > 0.0);
+  CHECK(D <= 0.1 + TOL);
+
+  // rotate the box about z; the peak still penetrates the bottom face
+  box_pose->x = Origin3d(0.0, 0.0, PEAK + 0.05);
+  box_pose->q = Quatd::rpy(0.0, 0.0, 0.7);
+  D = hf->calc_signed_dist(box, P, box_pose, pthis, pbox);
+  CHECK_NEAR(D, -0.05, TOL);
+
+  return report("heightfield-dist");
+}
@@ -0,0 +1,180 @@
+/*****************************************************************************
+ * Checks that both loop-closure solvers satisfy the constraints (including
+ * redundant ones) as the rank of the constraints changes, and that a
+ * slider-crank mechanism stays closed when simulated with either solver
+ *****************************************************************************/
+
+#include <cstdlib>
+#include <algorithm>
+#include <Ravelin/LinAlgd.h>
+#include <Moby/Simulator.h>
+#include <Moby/RigidBody.h>
+#include <Moby/RCArticulatedBody.h>
+#include <Moby/Joint.h>
+#include <Moby/LoopClosureSolver.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::map;
+using std::string;
+
+/// Computes the accelerations of a body with full-rank constraints from the (dense) KKT system
+static void solve_reference(DynamicBody& body, const MatrixNd& J, const VectorNd& f, const VectorNd& gamma, VectorNd& a)
+{
+  MatrixNd M;
+  body.get_generalized_inertia(M);
+  const unsigned N = M.rows(), R = J.rows();
+
+  // setup [M J'; J 0] and [f; -gamma]
+  MatrixNd K(N+R, N+R);
+  VectorNd x(N+R);
+  for (unsigned i=0; i< N+R; i++)
+    for (unsigned j=0; j< N+R; j++)
+      K(i,j) = 0.0;
+  for (unsigned i=0; i< N; i++)
+  {
+    for (unsigned j=0; j< N; j++)
+      K(i,j) = M(i,j);
+    x[i] = f[i];
+  }
+  for (unsigned i=0; i< R; i++)
+  {
+    for (unsigned j=0; j< N; j++)
+      K(N+i,j) = K(j,N+i) = J(i,j);
+    x[N+i] = -gamma[i];
+  }
+
+  // solve
+  LinAlgd LA;
+  LA.solve_fast(K, x);
+  a.resize(N);
+  for (unsigned i=0; i< N; i++)
+    a[i] = x[i];
+}
+
+/// Solves with both formulations and compares against the reference
+static void check_solvers(DynamicBody& body, LoopClosureSolver& schur, LoopClosureSolver& kkt, const MatrixNd& J, const MatrixNd& Jfull, const VectorNd& f, const VectorNd& gamma, const VectorNd& gamma_full, unsigned rank)
+{
+  const double TOL = 1e-6;
+  VectorNd a_ref, a_schur, a_kkt, Ja;
+  solve_reference(body, Jfull, f, gamma_full, a_ref);
+  schur.solve(body, J, f, gamma, a_schur);
+  kkt.solve(body, J, f, gamma, a_kkt);
+  CHECK(schur.get_rank() == rank);
+  CHECK(a_schur.size() == a_ref.size() && a_kkt.size() == a_ref.size());
+  if (a_schur.size() != a_ref.size() || a_kkt.size() != a_ref.size())
+    return;
+  for (unsigned i=0; i< a_ref.size(); i++)
+  {
+    CHECK_NEAR(a_schur[i], a_ref[i], TOL*(1.0 + std::fabs(a_ref[i])));
+    CHECK_NEAR(a_kkt[i], a_ref[i], TOL*(1.0 + std::fabs(a_ref[i])));
+  }
+
+  // every constraint (including the redundant ones) must hold
+  J.mult(a_schur, Ja) += gamma;
+  for (unsigned i=0; i< Ja.size(); i++)
+    CHECK_NEAR(Ja[i], 0.0, TOL);
+  J.mult(a_kkt, Ja) += gamma;
+  for (unsigned i=0; i< Ja.size(); i++)
+    CHECK_NEAR(Ja[i], 0.0, TOL);
+}
+
+/// Checks the solvers directly on a single rigid body
+static void test_solvers(int argc, char** argv)
+{
+  map<string, BasePtr> id_map = read_scene(argc, argv, "free-fall.xml");
+  shared_ptr<RigidBody> rb = get_object<RigidBody>(id_map, "box2");
+  if (!rb)
+    return;
+  const unsigned N = rb->num_generalized_coordinates(DynamicBody::eSpatial);
+
+  // setup three independent constraints and the forces
+  const unsigned R = 3;
+  MatrixNd J3(R, N);
+  VectorNd f(N), gamma3(R);
+  for (unsigned i=0; i< R; i++)
+  {
+    for (unsigned j=0; j< N; j++)
+      J3(i,j) = std::cos(1.0 + i*N + j) + ((i == j) ? 2.0 : 0.0);
+    gamma3[i] = 0.1*i - 0.2;
+  }
+  for (unsigned j=0; j< N; j++)
+    f[j] = std::sin(0.5 + j);
+
+  // add a fourth, redundant constraint (a combination of the first two)
+  MatrixNd J4(R+1, N);
+  VectorNd gamma4(R+1);
+  for (unsigned i=0; i< R; i++)
+  {
+    for (unsigned j=0; j< N; j++)
+      J4(i,j) = J3(i,j);
+    gamma4[i] = gamma3[i];
+  }
+  for (unsigned j=0; j< N; j++)
+    J4(R,j) = J3(0,j) - 2.0*J3(1,j);
+  gamma4[R] = gamma3[0] - 2.0*gamma3[1];
+
+  // the solvers are reused throughout, so that their factorization data are
+  // reused across calls and must be discarded when the rank changes
+  LoopClosureSolver schur, kkt;
+  schur.solver_type = LoopClosureSolver::eSchur;
+  kkt.solver_type = LoopClosureSolver::eSparseKKT;
+  check_solvers(*rb, schur, kkt, J3, J3, f, gamma3, gamma3, R);
+  f[0] += 1.0;
+  check_solvers(*rb, schur, kkt, J3, J3, f, gamma3, gamma3, R);
+  check_solvers(*rb, schur, kkt, J4, J3, f, gamma4, gamma3, R);
+  f[1] -= 2.0;
+  check_solvers(*rb, schur, kkt, J4, J3, f, gamma4, gamma3, R);
+
+  // make the fourth constraint independent
+  J4(R,R) += 1.0;
+  check_solvers(*rb, schur, kkt, J4, J4, f, gamma4, gamma4, R+1);
+  check_solvers(*rb, schur, kkt, J3, J3, f, gamma3, gamma3, R);
+}
+
+/// Simulates the slider-crank with the given solver, returning the final height of the block
+static double simulate_slider_crank(int argc, char** argv, LoopClosureSolver::SolverType type)
+{
+  const unsigned STEPS = 1000;
+  const double STEP_SIZE = 1e-3, TOL = 0.5;
+
+  map<string, BasePtr> id_map = read_scene(argc, argv, "slider-crank.xml");
+  shared_ptr<Simulator> sim = get_object<Simulator>(id_map, "simulator");
+  shared_ptr<RCArticulatedBody> ab = get_object<RCArticulatedBody>(id_map, "slidercrank");
+  shared_ptr<Joint> loop = get_object<Joint>(id_map, "j3");
+  shared_ptr<RigidBody> block = get_object<RigidBody>(id_map, "block");
+  if (!sim || !ab || !loop || !block)
+    return 0.0;
+  ab->loop_solver_type = type;
+
+  // the loop must stay closed while the mechanism falls
+  double C[6];
+  double max_violation = 0.0;
+  for (unsigned i=0; i< STEPS; i++)
+  {
+    sim->step(STEP_SIZE);
+    loop->evaluate_constraints(C);
+    for (unsigned j=0; j< loop->num_constraint_eqns(); j++)
+      max_violation = std::max(max_violation, std::fabs(C[j]));
+  }
+  CHECK(max_violation < TOL);
+
+  // the mechanism must have moved
+  Point3d x = Pose3d::transform_point(GLOBAL, Point3d(0.0, 0.0, 0.0, block->get_pose()));
+  CHECK(std::fabs(x[1] + 100.0) > TOL);
+  return x[1];
+}
+
+int main(int argc, char** argv)
+{
+  test_solvers(argc, argv);
+
+  // both formulations must produce the same motion
+  const double Y_SCHUR = simulate_slider_crank(argc, argv, LoopClosureSolver::eSchur);
+  const double Y_KKT = simulate_slider_crank(argc, argv, LoopClosureSolver::eSparseKKT);
+  CHECK_NEAR(Y_SCHUR, Y_KKT, 1e-2);
+
+  return report("loop-closure");
+}
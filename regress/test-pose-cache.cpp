@@ -0,0 +1,163 @@
+/*****************************************************************************
+ * Checks the flattened global transforms of the pose cache (of rigid
+ * bodies, of the links of an articulated body, and of the primitives of
+ * collision geometries) against the transforms found by walking the pose
+ * chains, before and after the bodies move
+ *****************************************************************************/
+
+#include <cmath>
+#include <set>
+#include <vector>
+#include <boost/foreach.hpp>
+#include <Moby/RigidBody.h>
+#include <Moby/RCArticulatedBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/Primitive.h>
+#include <Moby/PoseCache.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+/// The tolerance for comparing transforms
+const double TOL = 1e-10;
+
+/// Checks a cached transform against a transform found by walking the pose chain
+static void check_transform(const double* T, const Transform3d& Tref)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // the rotation (row major) and the translation
+  Matrix3d R(Tref.q);
+  for (unsigned i=0; i< 3; i++)
+    for (unsigned j=0; j< 3; j++)
+      CHECK_NEAR(T[i*3+j], R(i,j), TOL);
+  CHECK_NEAR(T[9], Tref.x[X], TOL);
+  CHECK_NEAR(T[10], Tref.x[Y], TOL);
+  CHECK_NEAR(T[11], Tref.x[Z], TOL);
+
+  // the quaternion (either sign represents the rotation)
+  const double DOT = T[12]*Tref.q.w + T[13]*Tref.q.x + T[14]*Tref.q.y + T[15]*Tref.q.z;
+  CHECK_NEAR(std::fabs(DOT), 1.0, TOL);
+}
+
+/// Checks the cached transforms of a set of rigid bodies and their geometries
+static void check_cache(const PoseCache& cache, const vector<RigidBodyPtr>& bodies)
+{
+  BOOST_FOREACH(RigidBodyPtr rb, bodies)
+  {
+    // check the transform of the body
+    const unsigned I = cache.get_body_index(rb);
+    CHECK(I != PoseCache::NONE);
+    if (I == PoseCache::NONE)
+      continue;
+    check_transform(cache.get_body_transform(I), Pose3d::calc_relative_pose(rb->get_pose(), GLOBAL));
+
+    // check the transforms of the geometries' primitives; the primitive's
+    // pose is defined relative to the geometry
+    BOOST_FOREACH(CollisionGeometryPtr cg, rb->geometries)
+    {
+      const unsigned J = cache.get_geom_index(cg);
+      CHECK(J != PoseCache::NONE);
+      if (J == PoseCache::NONE)
+        continue;
+      shared_ptr<Pose3d> P(new Pose3d(*cg->get_geometry()->get_pose()));
+      P->rpose = cg->get_pose();
+      const Transform3d TG = Pose3d::calc_relative_pose(P, GLOBAL);
+      check_transform(cache.get_geom_transform(J), TG);
+
+      // check the origin and the pose
+      Point3d o = cache.get_geom_origin(J);
+      for (unsigned k=0; k< 3; k++)
+        CHECK_NEAR(o[k], TG.x[k], TOL);
+      Pose3d G;
+      cache.get_geom_pose(J, G);
+      CHECK(G.rpose == GLOBAL);
+      CHECK_NEAR((G.x - TG.x).norm(), 0.0, TOL);
+      CHECK_NEAR(std::fabs(G.q.w*TG.q.w + G.q.x*TG.q.x + G.q.y*TG.q.y + G.q.z*TG.q.z), 1.0, TOL);
+
+      // check the transformations of points and vectors
+      const Point3d P_LOCAL(0.3, -0.2, 0.5, P);
+      const Vector3d V_LOCAL(-0.4, 0.1, 0.7, P);
+      Point3d p0 = TG.transform_point(P_LOCAL);
+      Point3d p = cache.transform_point_to_global(J, P_LOCAL);
+      Vector3d v0 = TG.transform_vector(V_LOCAL);
+      Vector3d v = cache.transform_vector_to_global(J, V_LOCAL);
+      Point3d q = cache.transform_point_from_global(J, p);
+      for (unsigned k=0; k< 3; k++)
+      {
+        CHECK_NEAR(p[k], p0[k], TOL);
+        CHECK_NEAR(v[k], v0[k], TOL);
+        CHECK_NEAR(q[k], P_LOCAL[k], TOL);
+      }
+      CHECK(p.pose == GLOBAL && v.pose == GLOBAL);
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  // get a rotated block with an offset center of mass (whose geometry frame
+  // is thus offset from the body frame), the ground, and a slider-crank
+  // mechanism (whose links are cached individually)
+  map<string, BasePtr> id_map = read_scene(argc, argv, "offset-com.xml");
+  RigidBodyPtr block = get_object<RigidBody>(id_map, "block");
+  RigidBodyPtr ground = get_object<RigidBody>(id_map, "ground");
+  id_map = read_scene(argc, argv, "slider-crank.xml");
+  shared_ptr<RCArticulatedBody> crank = get_object<RCArticulatedBody>(id_map, "slidercrank");
+  if (!block || !ground || !crank || block->geometries.empty())
+    return report("pose-cache");
+
+  // give the primitive of the block a pose of its own
+  Pose3d F;
+  F.q = Quatd::rpy(0.2, -0.1, 0.4);
+  F.x = Origin3d(0.1, 0.2, 0.3);
+  block->geometries.front()->get_geometry()->set_pose(F);
+
+  // index the bodies; each link of the mechanism gets its own index
+  vector<DynamicBodyPtr> dbodies;
+  dbodies.push_back(ground);
+  dbodies.push_back(crank);
+  dbodies.push_back(block);
+  PoseCache cache;
+  cache.rebuild(dbodies);
+  vector<RigidBodyPtr> bodies = crank->get_links();
+  bodies.push_back(ground);
+  bodies.push_back(block);
+  CHECK(cache.num_bodies() == bodies.size());
+  CHECK(cache.num_geoms() == ground->geometries.size() + block->geometries.size());
+
+  // indices are dense and distinct; bodies and geometries that are not in
+  // the cache are reported as such
+  set<unsigned> indices;
+  BOOST_FOREACH(RigidBodyPtr rb, bodies)
+    indices.insert(cache.get_body_index(rb));
+  CHECK(indices.size() == bodies.size() && *indices.rbegin() == bodies.size() - 1);
+  CHECK(cache.get_body_index(RigidBodyPtr(new RigidBody)) == PoseCache::NONE);
+  CHECK(cache.get_geom_index(CollisionGeometryPtr(new CollisionGeometry)) == PoseCache::NONE);
+
+  // the transforms match those of the pose chains
+  cache.update();
+  check_cache(cache, bodies);
+
+  // move the block and the crank; the transforms follow after an update
+  Pose3d Pb = *block->get_pose();
+  Pb.x = Origin3d(1.0, 2.0, -3.0);
+  Pb.q = Quatd::rpy(-0.5, 0.7, 1.1);
+  block->set_pose(Pb);
+  DynamicBodyPtr crank_db = crank;
+  VectorNd q;
+  crank_db->get_generalized_coordinates(DynamicBody::eEuler, q);
+  for (unsigned i=0; i< q.size(); i++)
+    q[i] += 0.1*(i+1);
+  crank_db->set_generalized_coordinates(DynamicBody::eEuler, q);
+  cache.update();
+  check_cache(cache, bodies);
+
+  return report("pose-cache");
+}
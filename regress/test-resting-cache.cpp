@@ -0,0 +1,148 @@
+/*****************************************************************************
+ * Checks that the resting contact forces computed with the data retained
+ * from the last solve (as across the stages of a Runge-Kutta step) match
+ * those computed from scratch, and that the retained data are discarded
+ * when the bodies move or the friction types change
+ *****************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <Moby/RigidBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/Event.h>
+#include <Moby/AccelerationEventHandler.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::map;
+using std::string;
+using std::vector;
+
+/// Sets up the body state and external (gravitational) force for one derivative evaluation
+static void setup_state(shared_ptr<RigidBody> rb, const Pose3d& P, const Vector3d& xd, double g)
+{
+  rb->set_pose(P);
+
+  // set the velocity (of the origin, global frame)
+  shared_ptr<Pose3d> F(new Pose3d);
+  F->x = Pose3d::calc_relative_pose(rb->get_pose(), GLOBAL).x;
+  SVelocityd v(F);
+  v.set_zero(F);
+  v.set_linear(xd);
+  rb->set_velocity(v);
+
+  // apply the weight at the center of mass
+  shared_ptr<Pose3d> C(new Pose3d);
+  C->x = Pose3d::calc_relative_pose(rb->get_inertial_pose(), GLOBAL).x;
+  SForced w(C);
+  w.set_zero(C);
+  w.set_force(Vector3d(0.0, -g*rb->get_inertia().m, 0.0, C));
+  rb->reset_accumulators();
+  rb->add_force(w);
+  rb->calc_fwd_dyn();
+}
+
+/// Computes the resting contact forces at the bottom corners of the block
+static void solve(AccelerationEventHandler& handler, shared_ptr<RigidBody> block_body, shared_ptr<RigidBody> ground_body, vector<double>& forces)
+{
+  const double CORNERS[3][3] = { { -0.5, -0.5, -0.5 }, { 0.5, -0.5, -0.5 }, { -0.5, -0.5, 0.5 } };
+
+  // setup the contact events at the corners
+  vector<Event> events;
+  for (unsigned i=0; i< 3; i++)
+  {
+    Point3d c(CORNERS[i][0], CORNERS[i][1], CORNERS[i][2], block_body->get_pose());
+    Event e;
+    e.event_type = Event::eContact;
+    e.deriv_type = Event::eAccel;
+    e.contact_geom1 = block_body->geometries.front();
+    e.contact_geom2 = ground_body->geometries.front();
+    e.contact_point = Pose3d::transform_point(GLOBAL, c);
+    e.contact_normal = Vector3d(0.0, 1.0, 0.0, GLOBAL);
+    e.contact_mu_coulomb = 0.5;
+    e.contact_impulse.set_zero(GLOBAL);
+    events.push_back(e);
+  }
+
+  // compute the forces, then the resulting acceleration
+  handler.process_events(events);
+  block_body->calc_fwd_dyn();
+
+  // store the contact forces and the acceleration
+  forces.clear();
+  for (unsigned i=0; i< events.size(); i++)
+  {
+    Vector3d f = events[i].contact_impulse.get_linear();
+    forces.push_back(f[0]);
+    forces.push_back(f[1]);
+    forces.push_back(f[2]);
+    CHECK(events[i].calc_event_accel() >= -1e-6);
+  }
+  SAcceld a = block_body->get_accel();
+  for (unsigned i=0; i< 6; i++)
+    forces.push_back(a[i]);
+}
+
+int main(int argc, char** argv)
+{
+  const double TOL = 1e-8;
+  const double G[] = { 9.81, 9.0, 10.5, 9.81 };
+
+  map<string, BasePtr> id_map = read_scene(argc, argv, "offset-com.xml");
+  shared_ptr<RigidBody> block_body = get_object<RigidBody>(id_map, "block");
+  shared_ptr<RigidBody> ground_body = get_object<RigidBody>(id_map, "ground");
+  if (!block_body || !ground_body || block_body->geometries.empty() || ground_body->geometries.empty())
+    return report("resting-cache");
+  const Pose3d P0 = *block_body->get_pose();
+
+  // a turned pose (about the vertical), with the corners still on the ground
+  Pose3d P1 = P0;
+  P1.q = Quatd::rpy(0.0, 0.35, 0.0);
+
+  // the states evaluated in sequence: repeated evaluations at one pose (as
+  // for the stages of a step), a sliding velocity, and a new pose
+  const Vector3d STILL(0.0, 0.0, 0.0, GLOBAL), SLIDE(0.5, 0.0, 0.2, GLOBAL);
+  vector<const Pose3d*> poses;
+  vector<const Vector3d*> vels;
+  vector<double> gs;
+  for (unsigned i=0; i< 4; i++)
+  {
+    poses.push_back(&P0);
+    vels.push_back(&STILL);
+    gs.push_back(G[i]);
+  }
+  for (unsigned i=0; i< 2; i++)
+  {
+    poses.push_back(&P0);
+    vels.push_back(&SLIDE);
+    gs.push_back(G[i]);
+  }
+  for (unsigned i=0; i< 3; i++)
+  {
+    poses.push_back(&P1);
+    vels.push_back(&STILL);
+    gs.push_back(G[i]);
+  }
+  poses.push_back(&P0);
+  vels.push_back(&STILL);
+  gs.push_back(G[0]);
+
+  // one handler retains data between evaluations, the other never does
+  AccelerationEventHandler cached, uncached;
+  uncached.cache_tol = -1.0;
+  vector<double> fc, fu;
+  for (unsigned i=0; i< poses.size(); i++)
+  {
+    setup_state(block_body, *poses[i], *vels[i], gs[i]);
+    solve(cached, block_body, ground_body, fc);
+    setup_state(block_body, *poses[i], *vels[i], gs[i]);
+    solve(uncached, block_body, ground_body, fu);
+    CHECK(fc.size() == fu.size());
+    for (unsigned j=0; j< fc.size() && j< fu.size(); j++)
+      CHECK_NEAR(fc[j], fu[j], TOL*(1.0 + std::fabs(fu[j])));
+  }
+
+  return report("resting-cache");
+}
@@ -0,0 +1,115 @@
+/*****************************************************************************
+ * Checks the impulses computed with the closed-form contact data for free
+ * rigid bodies (whose centers of mass are offset from their origins)
+ * against the contact data computed generically for each event: the
+ * impulses and post-impact velocities must solve the generic LCP
+ *****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <Moby/RigidBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/Event.h>
+#include <Moby/ImpactEventHandler.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::map;
+using std::string;
+using std::vector;
+
+/// Sets up a frictionless, inelastic contact event between the block and the ground
+static Event make_contact(CollisionGeometryPtr block, CollisionGeometryPtr ground, const Point3d& p)
+{
+  Event e;
+  e.event_type = Event::eContact;
+  e.deriv_type = Event::eVel;
+  e.contact_geom1 = block;
+  e.contact_geom2 = ground;
+  e.contact_point = p;
+  e.contact_normal = Vector3d(0.0, 1.0, 0.0, GLOBAL);
+  e.contact_mu_coulomb = 0.0;
+  e.contact_mu_viscous = 0.0;
+  e.contact_epsilon = 0.0;
+  e.contact_NK = 4;
+  e.contact_impulse.set_zero(GLOBAL);
+  e.determine_contact_tangents();
+  return e;
+}
+
+/// Processes the events and checks the result against the generic contact data
+static void check_events(vector<Event>& events)
+{
+  const double TOL = 1e-6;
+  const unsigned NC = events.size();
+
+  // compute the contact-space inertia (normal components) and the normal
+  // velocities generically, before the impact
+  MatrixNd K(NC, NC), MM;
+  VectorNd vn(NC), v;
+  for (unsigned i=0; i< NC; i++)
+  {
+    events[i].compute_event_data(MM, v);
+    K(i,i) = MM(0,0);
+    vn[i] = v[0];
+    CHECK_NEAR(vn[i], events[i].calc_event_vel(), TOL);
+    CHECK(vn[i] < 0.0);
+    for (unsigned j=i+1; j< NC; j++)
+    {
+      events[i].compute_cross_event_data(events[j], MM);
+      K(i,j) = K(j,i) = MM(0,0);
+    }
+  }
+
+  // handle the impact (the bodies are free, so the closed-form data are used)
+  ImpactEventHandler handler;
+  handler.process_events(events, std::numeric_limits<double>::max());
+
+  // the impulses and the post-impact velocities must solve the LCP
+  // w = K*j + vn, w >= 0, j >= 0, j'w = 0
+  for (unsigned i=0; i< NC; i++)
+  {
+    double w = vn[i];
+    for (unsigned j=0; j< NC; j++)
+      w += K(i,j)*events[j].contact_impulse.get_linear().dot(events[j].contact_normal);
+    const double JI = events[i].contact_impulse.get_linear().dot(events[i].contact_normal);
+    CHECK_NEAR(events[i].calc_event_vel(), w, TOL*(1.0 + std::fabs(vn[i])));
+    CHECK(JI >= -TOL);
+    CHECK(w >= -TOL);
+    CHECK_NEAR(JI*w, 0.0, TOL);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  map<string, BasePtr> id_map = read_scene(argc, argv, "offset-com.xml");
+  shared_ptr<RigidBody> block_body = get_object<RigidBody>(id_map, "block");
+  shared_ptr<RigidBody> ground_body = get_object<RigidBody>(id_map, "ground");
+  if (!block_body || !ground_body || block_body->geometries.empty() || ground_body->geometries.empty())
+    return report("rigid-contact");
+  CollisionGeometryPtr block = block_body->geometries.front();
+  CollisionGeometryPtr ground = ground_body->geometries.front();
+
+  // the center of mass must be offset from the origin for this test to
+  // exercise the coupling between the linear and angular components
+  Transform3d T = Pose3d::calc_relative_pose(block_body->get_inertial_pose(), block_body->get_pose());
+  CHECK(T.x.norm() > 0.1);
+
+  // a single contact away from the center of mass
+  SVelocityd v0 = block_body->get_velocity();
+  vector<Event> events;
+  events.push_back(make_contact(block, ground, Point3d(-0.4, 0.0, 0.3, GLOBAL)));
+  check_events(events);
+
+  // two contacts (with cross terms) on the same body
+  block_body->set_velocity(v0);
+  events.clear();
+  events.push_back(make_contact(block, ground, Point3d(-0.4, 0.0, 0.3, GLOBAL)));
+  events.push_back(make_contact(block, ground, Point3d(0.45, 0.0, -0.2, GLOBAL)));
+  check_events(events);
+
+  return report("rigid-contact");
+}
@@ -0,0 +1,181 @@
+/*****************************************************************************
+ * Checks that generated scenes are deterministic for a seed, that their IDs
+ * are unique and every reference resolves (including in cloned robots),
+ * that piled bodies start apart and above the ground, and that the scenes
+ * construct (directly and from the written XML) into a simulator holding
+ * every body
+ *****************************************************************************/
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <stdexcept>
+#include <vector>
+#include <boost/foreach.hpp>
+#include <Moby/XMLTree.h>
+#include <Moby/Simulator.h>
+#include <Moby/SceneGenerator.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::vector;
+using std::string;
+using std::map;
+using std::set;
+
+/// The number of bodies in each group of the test scene
+const unsigned NBOXES = 8, NSPHERES = 12, NLINKS = 4, NROBOTS = 2;
+
+/// The radius of the spheres in the test scene
+const double RADIUS = 0.3;
+
+/// Gets a temporary file name
+static string get_temp_file()
+{
+  char fname_buf[] = "/tmp/moby-test-scenegen-XXXXXX";
+  int fd = mkstemp(fname_buf);
+  CHECK(fd >= 0);
+  if (fd >= 0)
+    close(fd);
+  return string(fname_buf);
+}
+
+/// Gets the contents of a file
+static string read_file(const string& fname)
+{
+  std::ifstream in(fname.c_str());
+  std::ostringstream oss;
+  oss << in.rdbuf();
+  return oss.str();
+}
+
+/// Generates the test scene
+static void generate(SceneGenerator& gen, int argc, char** argv)
+{
+  gen.add_box_pile(NBOXES);
+  gen.add_sphere_pile(NSPHERES, RADIUS);
+  gen.add_chain(NLINKS);
+  gen.add_robots(NROBOTS, get_scene_dir(argc, argv) + "/slider-crank.xml");
+}
+
+/// Collects the IDs (counting duplicates) and the references to IDs in a tree
+static void collect(shared_ptr<const XMLTree> node, vector<string>& ids, set<string>& refs)
+{
+  BOOST_FOREACH(const XMLAttrib& a, node->attribs)
+    if (a.name == "id")
+      ids.push_back(a.value);
+    else if (a.name.size() > 3 && a.name.compare(a.name.size()-3, 3, "-id") == 0)
+      refs.insert(a.value);
+  BOOST_FOREACH(XMLTreePtr child, node->children)
+    collect(child, ids, refs);
+}
+
+/// Determines whether adding a robot from a missing file throws std::runtime_error
+static bool throws_missing_robot(SceneGenerator& gen)
+{
+  try
+  {
+    gen.add_robots(1, "/nonexistent/robot.xml");
+  }
+  catch (std::runtime_error&)
+  {
+    return true;
+  }
+
+  return false;
+}
+
+/// Determines whether adding clutter without mesh files throws std::runtime_error
+static bool throws_no_meshes(SceneGenerator& gen)
+{
+  try
+  {
+    gen.add_mesh_clutter(1, vector<string>());
+  }
+  catch (std::runtime_error&)
+  {
+    return true;
+  }
+
+  return false;
+}
+
+int main(int argc, char** argv)
+{
+  // generate the scene; each pile, the chain, and each robot is a body
+  SceneGenerator gen(7);
+  generate(gen, argc, argv);
+  CHECK(gen.get_num_bodies() == NBOXES + NSPHERES + 1 + NROBOTS);
+
+  // IDs are unique and every reference resolves
+  XMLTreePtr tree = gen.get_tree();
+  vector<string> ids;
+  set<string> refs;
+  collect(tree, ids, refs);
+  const set<string> ID_SET(ids.begin(), ids.end());
+  CHECK(ID_SET.size() == ids.size());
+  BOOST_FOREACH(const string& ref, refs)
+    if (ID_SET.find(ref) == ID_SET.end())
+    {
+      std::cerr << "unresolved reference: " << ref << std::endl;
+      CHECK(false);
+    }
+
+  // the spheres start apart from each other and above the ground (the
+  // sphere pile's primitive is the first sphere; the robots have their own)
+  string sphere_id;
+  BOOST_FOREACH(XMLTreePtr child, tree->children)
+    if (child->name == "Sphere" && sphere_id.empty())
+      sphere_id = child->get_attrib("id")->value;
+  vector<Origin3d> centers;
+  BOOST_FOREACH(XMLTreePtr child, tree->children)
+  {
+    XMLAttrib* vis_attr = child->get_attrib("visualization-id");
+    if (child->name == "RigidBody" && vis_attr && vis_attr->value == sphere_id)
+      centers.push_back(child->get_attrib("position")->get_origin_value());
+  }
+  CHECK(centers.size() == NSPHERES);
+  for (unsigned i=0; i< centers.size(); i++)
+  {
+    CHECK(centers[i][1] >= RADIUS);
+    for (unsigned j=0; j< i; j++)
+      CHECK((centers[i] - centers[j]).norm() >= 2.0*RADIUS - 1e-8);
+  }
+
+  // the same seed generates the same scene; another seed does not
+  const string FNAME1 = get_temp_file(), FNAME2 = get_temp_file();
+  gen.write(FNAME1);
+  SceneGenerator same(7);
+  generate(same, argc, argv);
+  same.write(FNAME2);
+  CHECK(read_file(FNAME1) == read_file(FNAME2));
+  SceneGenerator other(8);
+  generate(other, argc, argv);
+  other.write(FNAME2);
+  CHECK(read_file(FNAME1) != read_file(FNAME2));
+
+  // the scene constructs directly and from the written file into a
+  // simulator holding every body (and the ground)
+  shared_ptr<Simulator> sim = SceneGenerator::find_simulator(gen.construct());
+  CHECK(sim);
+  if (sim)
+    CHECK(sim->get_dynamic_bodies().size() == gen.get_num_bodies() + 1);
+  sim = SceneGenerator::find_simulator(XMLReader::read(FNAME1));
+  CHECK(sim);
+  if (sim)
+    CHECK(sim->get_dynamic_bodies().size() == gen.get_num_bodies() + 1);
+
+  // bad inputs are reported
+  CHECK(throws_missing_robot(gen));
+  CHECK(throws_no_meshes(gen));
+  CHECK(SceneGenerator::find_convex_meshes("/nonexistent").empty());
+
+  unlink(FNAME1.c_str());
+  unlink(FNAME2.c_str());
+  return report("scene-generator");
+}
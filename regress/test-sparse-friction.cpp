@@ -0,0 +1,111 @@
+/*****************************************************************************
+ * Checks that contact groups with Coulomb friction that are handled by the
+ * block-sparse solver get frictional impulses (inside the friction cone)
+ * that stop the impact and slow the sliding, and that frictionless groups
+ * get none
+ *****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <Moby/RigidBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/Event.h>
+#include <Moby/ImpactEventHandler.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::map;
+using std::string;
+using std::vector;
+
+/// Gets the horizontal speed of the center of mass of a body
+static double calc_sliding_speed(shared_ptr<RigidBody> rb)
+{
+  shared_ptr<Pose3d> P(new Pose3d);
+  P->x = Pose3d::calc_relative_pose(rb->get_inertial_pose(), GLOBAL).x;
+  SVelocityd v = Pose3d::transform(P, rb->get_velocity());
+  Vector3d xd = v.get_linear();
+  return std::sqrt(xd[0]*xd[0] + xd[2]*xd[2]);
+}
+
+/// Handles an impact at three bottom corners of the block with the given friction coefficient
+static void check_impact(shared_ptr<RigidBody> block_body, shared_ptr<RigidBody> ground_body, double mu)
+{
+  const double TOL = 1e-4;
+  const double CORNERS[3][3] = { { -0.5, -0.5, -0.5 }, { 0.5, -0.5, -0.5 }, { -0.5, -0.5, 0.5 } };
+
+  // setup the contact events at the corners
+  vector<Event> events;
+  for (unsigned i=0; i< 3; i++)
+  {
+    Point3d c(CORNERS[i][0], CORNERS[i][1], CORNERS[i][2], block_body->get_pose());
+    Event e;
+    e.event_type = Event::eContact;
+    e.deriv_type = Event::eVel;
+    e.contact_geom1 = block_body->geometries.front();
+    e.contact_geom2 = ground_body->geometries.front();
+    e.contact_point = Pose3d::transform_point(GLOBAL, c);
+    e.contact_normal = Vector3d(0.0, 1.0, 0.0, GLOBAL);
+    e.contact_mu_coulomb = mu;
+    e.contact_mu_viscous = 0.0;
+    e.contact_epsilon = 0.0;
+    e.contact_NK = 4;
+    e.contact_impulse.set_zero(GLOBAL);
+    events.push_back(e);
+    CHECK(e.calc_event_vel() < 0.0);
+  }
+
+  // handle the impact with the block-sparse solver
+  const double SPEED0 = calc_sliding_speed(block_body);
+  ImpactEventHandler handler;
+  handler.sparse_min_contacts = 1;
+  handler.process_events(events, std::numeric_limits<double>::max());
+
+  // the impact must be stopped and every impulse must lie in the cone
+  double tangential = 0.0;
+  for (unsigned i=0; i< events.size(); i++)
+  {
+    const Vector3d& n = events[i].contact_normal;
+    Vector3d j = events[i].contact_impulse.get_linear();
+    const double JN = j.dot(n);
+    const double JT = (j - n*JN).norm();
+    CHECK(events[i].calc_event_vel() >= -TOL);
+    CHECK(JN >= -TOL);
+    CHECK(JT <= mu*JN + TOL);
+    tangential += JT;
+  }
+
+  // friction must act when there is friction (and slow the sliding) and
+  // must not otherwise
+  const double SPEED1 = calc_sliding_speed(block_body);
+  if (mu > 0.0)
+  {
+    CHECK(tangential > TOL);
+    CHECK(SPEED1 < 0.5*SPEED0);
+  }
+  else
+  {
+    CHECK(tangential <= TOL);
+    CHECK_NEAR(SPEED1, SPEED0, TOL);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  map<string, BasePtr> id_map = read_scene(argc, argv, "offset-com.xml");
+  shared_ptr<RigidBody> block_body = get_object<RigidBody>(id_map, "block");
+  shared_ptr<RigidBody> ground_body = get_object<RigidBody>(id_map, "ground");
+  if (!block_body || !ground_body || block_body->geometries.empty() || ground_body->geometries.empty())
+    return report("sparse-friction");
+
+  // frictional contacts, then frictionless contacts from the same state
+  SVelocityd v0 = block_body->get_velocity();
+  check_impact(block_body, ground_body, 0.5);
+  block_body->set_velocity(v0);
+  check_impact(block_body, ground_body, 0.0);
+
+  return report("sparse-friction");
+}
@@ -0,0 +1,170 @@
+/*****************************************************************************
+ * Checks that trajectories recorded through the ring buffer (which wraps
+ * and fills several times) are read back complete and in order, with and
+ * without compression, and that damaged files are rejected
+ *****************************************************************************/
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <Moby/Simulator.h>
+#include <Moby/DynamicBody.h>
+#include <Moby/TrajectoryRecorder.h>
+#include "test.h"
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::vector;
+using std::string;
+
+/// Gets a temporary file name
+static string get_temp_file()
+{
+  char fname_buf[] = "/tmp/moby-test-trajectory-XXXXXX";
+  int fd = mkstemp(fname_buf);
+  CHECK(fd >= 0);
+  if (fd >= 0)
+    close(fd);
+  return string(fname_buf);
+}
+
+/// Determines whether a trajectory file is rejected by the reader
+static bool rejected(const string& fname)
+{
+  vector<string> names;
+  vector<vector<double> > columns;
+  try
+  {
+    TrajectoryRecorder::read(fname, names, columns);
+  }
+  catch (std::runtime_error&)
+  {
+    return true;
+  }
+
+  return false;
+}
+
+/// Compares two bodies by ID (the order in which bodies are recorded)
+static bool compbody(DynamicBodyPtr b1, DynamicBodyPtr b2)
+{
+  return b1->id < b2->id;
+}
+
+/// Records a simulation and checks the recorded trajectory against the states of the bodies
+static void check_recording(int argc, char** argv, bool compress, const string& fname)
+{
+  const unsigned STEPS = 50, CAPACITY = 8;
+  const double STEP_SIZE = 1e-3;
+
+  std::map<string, BasePtr> id_map = read_scene(argc, argv, "free-fall.xml");
+  shared_ptr<Simulator> sim = get_object<Simulator>(id_map, "simulator");
+  if (!sim)
+    return;
+
+  // open the recorder; the buffer holds far fewer records than are made
+  TrajectoryRecorder tr;
+  tr.open(fname, sim, CAPACITY, compress);
+  CHECK(tr.is_open());
+  const vector<string> NAMES = tr.get_column_names();
+  CHECK(NAMES.size() > 5 && NAMES[0] == "time" && NAMES[4] == "contacts");
+
+  // record each step, keeping the expected time and body states
+  vector<DynamicBodyPtr> bodies = sim->get_dynamic_bodies();
+  std::sort(bodies.begin(), bodies.end(), compbody);
+  vector<vector<double> > expected;
+  VectorNd q, qd;
+  for (unsigned i=0; i< STEPS; i++)
+  {
+    sim->step(STEP_SIZE);
+    tr.record();
+    vector<double> r(1, sim->current_time);
+    for (unsigned j=0; j< bodies.size(); j++)
+    {
+      DynamicBodyPtr db = bodies[j];
+      db->get_generalized_coordinates(DynamicBody::eEuler, q);
+      db->get_generalized_velocity(DynamicBody::eSpatial, qd);
+      r.insert(r.end(), q.begin(), q.end());
+      r.insert(r.end(), qd.begin(), qd.end());
+    }
+    expected.push_back(r);
+  }
+  tr.close();
+  CHECK(!tr.is_open());
+
+  // read the trajectory back
+  vector<string> names;
+  vector<vector<double> > columns;
+  TrajectoryRecorder::read(fname, names, columns);
+  CHECK(names == NAMES);
+  CHECK(columns.size() == names.size());
+  if (columns.size() != names.size())
+    return;
+  for (unsigned j=0; j< columns.size(); j++)
+    CHECK(columns[j].size() == STEPS);
+  if (columns[0].size() != STEPS)
+    return;
+
+  // the times and the body states (columns 5 onward) must match exactly
+  for (unsigned i=0; i< STEPS; i++)
+  {
+    CHECK(columns[0][i] == expected[i][0]);
+    CHECK(expected[i].size() + 4 == columns.size());
+    for (unsigned j=1; j< expected[i].size() && j+4 < columns.size(); j++)
+      CHECK(columns[j+4][i] == expected[i][j]);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const string FNAME = get_temp_file();
+
+  // uncompressed, then compressed (stored uncompressed when Moby is built
+  // without zlib)
+  check_recording(argc, argv, false, FNAME);
+  check_recording(argc, argv, true, FNAME);
+
+  // a truncated file is rejected
+  FILE* fp = fopen(FNAME.c_str(), "rb");
+  CHECK(fp);
+  vector<char> data;
+  if (fp)
+  {
+    char c;
+    while (fread(&c, 1, 1, fp) == 1)
+      data.push_back(c);
+    fclose(fp);
+  }
+  CHECK(data.size() > 100);
+  CHECK(truncate(FNAME.c_str(), data.size() - 1) == 0);
+  CHECK(rejected(FNAME));
+
+  // a file with the wrong magic or version is rejected
+  fp = fopen(FNAME.c_str(), "wb");
+  CHECK(fp);
+  if (fp && !data.empty())
+  {
+    fwrite(&data[0], 1, data.size(), fp);
+    fseek(fp, 8, SEEK_SET);
+    unsigned version = TrajectoryRecorder::VERSION + 1;
+    fwrite(&version, sizeof(unsigned), 1, fp);
+    fclose(fp);
+  }
+  CHECK(rejected(FNAME));
+  fp = fopen(FNAME.c_str(), "r+b");
+  CHECK(fp);
+  if (fp)
+  {
+    fwrite("NOTATRJ", 1, 8, fp);
+    fclose(fp);
+  }
+  CHECK(rejected(FNAME));
+  CHECK(rejected("/nonexistent/moby.trj"));
+
+  unlink(FNAME.c_str());
+  return report("trajectory-recorder");
+}
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * Checks that stepping the simulator performs no heap allocation once the
+ * state and integrator workspaces have been sized (steady state), with the
+ * fixed-step and adaptive integrators and with the event-driven simulator
+ * handling resting contact
+ *****************************************************************************/
+
+#include <cstdlib>
+#include <new>
+#include <Moby/Simulator.h>
+#include <Moby/RungeKuttaFehlbergIntegrator.h>
+#include <Moby/BulirschStoerIntegrator.h>
+#include "test.h"
+
+using namespace Moby;
+
+/// Whether allocations are being counted
+static bool COUNTING = false;
+
+/// The number of allocations counted
+static unsigned long ALLOCATIONS = 0;
+
+/// Allocates memory, counting the allocation
+static void* counted_alloc(std::size_t n)
+{
+  if (COUNTING)
+    ALLOCATIONS++;
+  void* p = std::malloc(n > 0 ? n : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(std::size_t n) throw(std::bad_alloc) { return counted_alloc(n); }
+void* operator new[](std::size_t n) throw(std::bad_alloc) { return counted_alloc(n); }
+void operator delete(void* p) throw() { std::free(p); }
+void operator delete[](void* p) throw() { std::free(p); }
+
+/// Steps a simulator until its workspaces are sized, then checks that further steps do not allocate
+static void check_steps(boost::shared_ptr<Simulator> sim, unsigned warmup_steps, const char* name)
+{
+  const unsigned STEPS = 100;
+  const double STEP_SIZE = 1e-3;
+
+  if (!sim)
+    return;
+
+  // step until the workspaces have been sized
+  for (unsigned i=0; i< warmup_steps; i++)
+    sim->step(STEP_SIZE);
+
+  // no step may allocate from now on
+  ALLOCATIONS = 0;
+  COUNTING = true;
+  for (unsigned i=0; i< STEPS; i++)
+    sim->step(STEP_SIZE);
+  COUNTING = false;
+
+  if (ALLOCATIONS > 0)
+    std::cerr << name << ": " << ALLOCATIONS << " allocation(s) in " << STEPS << " steps" << std::endl;
+  CHECK(ALLOCATIONS == 0);
+}
+
+int main(int argc, char** argv)
+{
+  const unsigned WARMUP_STEPS = 10, CONTACT_WARMUP_STEPS = 100;
+
+  // free fall, with the fixed-step (RK4) integrator from the scene
+  std::map<std::string, BasePtr> id_map = read_scene(argc, argv, "free-fall.xml");
+  check_steps(get_object<Simulator>(id_map, "simulator"), WARMUP_STEPS, "rk4");
+
+  // free fall, with the adaptive Runge-Kutta-Fehlberg integrator
+  id_map = read_scene(argc, argv, "free-fall.xml");
+  boost::shared_ptr<Simulator> sim = get_object<Simulator>(id_map, "simulator");
+  if (sim)
+    sim->integrator = boost::shared_ptr<Integrator>(new RungeKuttaFehlbergIntegrator);
+  check_steps(sim, WARMUP_STEPS, "rkf45");
+
+  // free fall, with the Bulirsch-Stoer integrator
+  id_map = read_scene(argc, argv, "free-fall.xml");
+  sim = get_object<Simulator>(id_map, "simulator");
+  if (sim)
+    sim->integrator = boost::shared_ptr<Integrator>(new BulirschStoerIntegrator);
+  check_steps(sim, WARMUP_STEPS, "bulirsch-stoer");
+
+  // a box resting on the ground, with the event-driven simulator (the box
+  // settles and the contact set stops changing during the warm-up)
+  id_map = read_scene(argc, argv, "resting-box.xml");
+  check_steps(get_object<Simulator>(id_map, "simulator"), CONTACT_WARMUP_STEPS, "event-driven contact");
+
+  return report("zero-alloc");
+}
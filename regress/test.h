@@ -0,0 +1,81 @@
+/*****************************************************************************
+ * Helpers shared by the behavior tests in this directory (run with ctest);
+ * each test takes the directory holding the test scenes as its argument
+ *****************************************************************************/
+
+#ifndef _MOBY_REGRESS_TEST_H
+#define _MOBY_REGRESS_TEST_H
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <Moby/XMLReader.h>
+
+/// The number of checks that have failed
+static unsigned FAILURES = 0;
+
+/// Checks that a condition holds
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) \
+    { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #cond << std::endl; \
+      FAILURES++; \
+    } \
+  } while (0)
+
+/// Checks that two values agree to within a tolerance
+#define CHECK_NEAR(a, b, tol) \
+  do { \
+    const double _a = (a), _b = (b); \
+    if (!(std::fabs(_a - _b) <= (tol))) \
+    { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #a << " (" << _a << ") != " << #b << " (" << _b << ")" << std::endl; \
+      FAILURES++; \
+    } \
+  } while (0)
+
+/// Gets the directory holding the test scenes
+static std::string get_scene_dir(int argc, char** argv)
+{
+  return (argc > 1) ? std::string(argv[1]) : std::string("scenes");
+}
+
+/// Reads a test scene
+static std::map<std::string, Moby::BasePtr> read_scene(int argc, char** argv, const std::string& fname)
+{
+  return Moby::XMLReader::read(get_scene_dir(argc, argv) + "/" + fname);
+}
+
+/// Gets an object of the given type from a scene (NULL if there is none)
+template <class T>
+boost::shared_ptr<T> get_object(const std::map<std::string, Moby::BasePtr>& id_map, const std::string& id)
+{
+  std::map<std::string, Moby::BasePtr>::const_iterator i = id_map.find(id);
+  if (i == id_map.end())
+  {
+    std::cerr << "object '" << id << "' not found in scene" << std::endl;
+    FAILURES++;
+    return boost::shared_ptr<T>();
+  }
+
+  return boost::dynamic_pointer_cast<T>(i->second);
+}
+
+/// Reports the outcome of a test
+static int report(const char* name)
+{
+  if (FAILURES > 0)
+  {
+    std::cerr << name << ": " << FAILURES << " check(s) failed" << std::endl;
+    return 1;
+  }
+
+  std::cout << name << ": passed" << std::endl;
+  return 0;
+}
+
+#endif
+
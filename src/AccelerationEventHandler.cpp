@@ -39,7 +39,10 @@ using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
 
 /// Sets up the default parameters for the impact event handler
-AccelerationEventHandler::AccelerationEventHandler(){}
+AccelerationEventHandler::AccelerationEventHandler()
+{
+  cache_tol = NEAR_ZERO;
+}
 
 // Processes impacts
 void AccelerationEventHandler::process_events(const vector<Event>& contacts)
@@ -82,7 +85,8 @@ void AccelerationEventHandler::apply_model(const vector<Event>& contacts)
   // **********************************************************
   // do method for each connected set
   // **********************************************************
-  for (list<list<Event*> >::iterator i = groups.begin(); i != groups.end(); i++)
+  unsigned group = 0;
+  for (list<list<Event*> >::iterator i = groups.begin(); i != groups.end(); i++, group++)
   {
     // determine contact tangents
     for (list<Event*>::iterator j = i->begin(); j != i->end(); j++)
@@ -99,7 +103,7 @@ void AccelerationEventHandler::apply_model(const vector<Event>& contacts)
       Event::determine_minimal_set(rcontacts);
 
       // apply model to the reduced contacts
-      apply_model_to_connected_contacts(rcontacts);
+      apply_model_to_connected_contacts(rcontacts, group);
 
       FILE_LOG(LOG_EVENT) << " -- post-contact acceleration (all contacts): " << std::endl;
       for (list<Event*>::iterator j = i->begin(); j != i->end(); j++)
@@ -109,8 +113,10 @@ void AccelerationEventHandler::apply_model(const vector<Event>& contacts)
 
 /**
  * \param contacts a set of connected contacts
+ * \param group the index of the set of connected contacts (used to find
+ *        data retained from the last solve)
  */
-void AccelerationEventHandler::apply_model_to_connected_contacts(const list<Event*>& contacts)
+void AccelerationEventHandler::apply_model_to_connected_contacts(const list<Event*>& contacts, unsigned group)
 {
   SAFESTATIC AccelerationEventData epd;
   SAFESTATIC VectorNd v,a, ke_minus, ke_plus;
@@ -125,13 +131,21 @@ void AccelerationEventHandler::apply_model_to_connected_contacts(const list<Even
   // save the contacts
   epd.events = vector<Event*>(contacts.begin(), contacts.end());
 
-  // compute all contact cross-terms
-  compute_problem_data(epd);
+  // see whether position-dependent data from the last solve can be reused
+  if (_cache.size() <= group)
+    _cache.resize(group+1);
+  CachedLCP& c = _cache[group];
+  const bool REUSE = is_cache_valid(epd, c);
+
+  // compute all contact cross-terms (or only the contact accelerations)
+  compute_problem_data(epd, !REUSE);
+  if (!REUSE)
+    update_cache(epd, c);
 
   // solve the (non-frictional) linear complementarity problem to determine
   // the kappa constant
   VectorNd z;
-  if (!solve_lcp(epd, z))
+  if (!solve_lcp(epd, c, REUSE, z))
     throw AccelerationEventFailException();
 
   FILE_LOG(LOG_EVENT) << "Resting Event forces : " << z << std::endl;
@@ -218,7 +232,12 @@ void AccelerationEventHandler::apply_forces(const AccelerationEventData& q) cons
 }
 
 /// Computes the data to the LCP / QP problems
-void AccelerationEventHandler::compute_problem_data(AccelerationEventData& q)
+/**
+ * \param inertia if <b>false</b>, only the contact accelerations (which
+ *        depend on velocities and forces) are computed; the cross-contact
+ *        terms (which depend only on positions) are left zero
+ */
+void AccelerationEventHandler::compute_problem_data(AccelerationEventData& q, bool inertia)
 {
   const unsigned UINF = std::numeric_limits<unsigned>::max();
   SAFESTATIC MatrixNd workM;
@@ -341,7 +360,7 @@ void AccelerationEventHandler::compute_problem_data(AccelerationEventData& q)
           q.Cn_a[i] = *workv.row_iterator_begin();
         }
       }
-      else
+      else if (inertia)
       {
         // compute matrix for cross event
          q.events[i]->compute_cross_event_data(* q.events[j], workM);
@@ -414,12 +433,105 @@ void AccelerationEventHandler::compute_problem_data(AccelerationEventData& q)
   }
 }
 
- /// Solves the Resting Event LCP
-bool AccelerationEventHandler::solve_lcp(AccelerationEventData& q, VectorNd& z)
+/// Determines whether the LCP matrix from the last solve of a group of contacts can be reused
+/**
+ * The matrix can be reused if the contacts are between the same geometries,
+ * have the same friction types, have (nearly) the same points, normals, and
+ * first tangents, and if the generalized coordinates of the super bodies are
+ * (nearly) unchanged.
+ */
+bool AccelerationEventHandler::is_cache_valid(const AccelerationEventData& q, const CachedLCP& c)
 {
-  SAFESTATIC MatrixNd UL, LL, MM,UR,workM;
-  SAFESTATIC VectorNd qq,workv;
-  FILE_LOG(LOG_EVENT) << "AccelerationEventHandler::solve_lcp() entered" << std::endl;
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // see whether reuse is disabled
+  if (cache_tol < 0.0)
+    return false;
+
+  // check the contacts
+  const unsigned NC = q.events.size();
+  if (c.sticking.size() != NC)
+    return false;
+  for (unsigned i=0; i< NC; i++)
+  {
+    const Event& e = *q.events[i];
+    if (c.geoms[i*2] != e.contact_geom1 || c.geoms[i*2+1] != e.contact_geom2)
+      return false;
+    if (c.sticking[i] != (e.get_friction_type() == Event::eSticking))
+      return false;
+    const double* f = &c.frames[i*9];
+    if (std::fabs(f[0] - e.contact_point[X]) > cache_tol ||
+        std::fabs(f[1] - e.contact_point[Y]) > cache_tol ||
+        std::fabs(f[2] - e.contact_point[Z]) > cache_tol ||
+        std::fabs(f[3] - e.contact_normal[X]) > cache_tol ||
+        std::fabs(f[4] - e.contact_normal[Y]) > cache_tol ||
+        std::fabs(f[5] - e.contact_normal[Z]) > cache_tol ||
+        std::fabs(f[6] - e.contact_tan1[X]) > cache_tol ||
+        std::fabs(f[7] - e.contact_tan1[Y]) > cache_tol ||
+        std::fabs(f[8] - e.contact_tan1[Z]) > cache_tol)
+      return false;
+  }
+
+  // the geometries are unchanged, so the super bodies are as well; check
+  // their generalized coordinates
+  unsigned k = 0;
+  for (unsigned i=0; i< c.super_bodies.size(); i++)
+  {
+    c.super_bodies[i]->get_generalized_coordinates(DynamicBody::eEuler, _gc);
+    if (k + _gc.size() > c.gc.size())
+      return false;
+    for (unsigned j=0; j< _gc.size(); j++, k++)
+      if (std::fabs(_gc[j] - c.gc[k]) > cache_tol)
+        return false;
+  }
+
+  return (k == c.gc.size());
+}
+
+/// Records the contacts and positions for which the LCP matrix of a group of contacts is computed
+void AccelerationEventHandler::update_cache(const AccelerationEventData& q, CachedLCP& c)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+  const unsigned NC = q.events.size();
+
+  // save the contacts
+  c.geoms.resize(NC*2);
+  c.sticking.resize(NC);
+  c.frames.resize(NC*9);
+  for (unsigned i=0; i< NC; i++)
+  {
+    const Event& e = *q.events[i];
+    c.geoms[i*2] = e.contact_geom1;
+    c.geoms[i*2+1] = e.contact_geom2;
+    c.sticking[i] = (e.get_friction_type() == Event::eSticking);
+    double* f = &c.frames[i*9];
+    f[0] = e.contact_point[X];  f[1] = e.contact_point[Y];  f[2] = e.contact_point[Z];
+    f[3] = e.contact_normal[X]; f[4] = e.contact_normal[Y]; f[5] = e.contact_normal[Z];
+    f[6] = e.contact_tan1[X];   f[7] = e.contact_tan1[Y];   f[8] = e.contact_tan1[Z];
+  }
+
+  // save the generalized coordinates of the super bodies
+  c.super_bodies = q.super_bodies;
+  c.gc.resize(0);
+  for (unsigned i=0; i< c.super_bodies.size(); i++)
+  {
+    c.super_bodies[i]->get_generalized_coordinates(DynamicBody::eEuler, _gc);
+    const unsigned K = c.gc.size();
+    c.gc.resize(K + _gc.size(), true);
+    c.gc.set_sub_vec(K, _gc);
+  }
+
+  // the LCP matrix will change
+  c.factored = false;
+}
+
+/// Sets up the LCP matrix for resting contact (depends only on positions)
+/**
+ * \note the cross-contact terms of q are negated on return
+ */
+void AccelerationEventHandler::setup_lcp_matrix(AccelerationEventData& q, MatrixNd& MM)
+{
+  SAFESTATIC MatrixNd UL, LL, UR;
 
   unsigned NK_DIRS = 0;
   for(unsigned i=0,j=0,r=0;i<q.N_CONTACTS;i++)
@@ -448,11 +560,6 @@ bool AccelerationEventHandler::solve_lcp(AccelerationEventData& q, VectorNd& z)
   r                         Ct_iM_CsT               Ct_iM_CtT
   */
   UL.set_sub_mat(0,0,q.Cn_iM_CnT);
-  // setup the LCP matrix
-
-  // setup the LCP vector
-  qq.set_zero(MM.rows());
-  qq.set_sub_vec(0,q.Cn_a);
 
   if(q.N_STICKING > 0){
 
@@ -536,8 +643,27 @@ bool AccelerationEventHandler::solve_lcp(AccelerationEventData& q, VectorNd& z)
     // setup the LCP matrix
     MM.set_sub_mat(0, UL.columns(), UR);
     MM.set_sub_mat(UL.rows(), 0, LL);
+  }
+
+  MM.set_sub_mat(0, 0, UL);
+}
 
-    // setup the LCP vector
+/// Sets up the LCP vector for resting contact (depends on velocities and forces)
+/**
+ * \note Cs_a and Ct_a of q are negated on return
+ */
+void AccelerationEventHandler::setup_lcp_vector(AccelerationEventData& q, VectorNd& qq)
+{
+  unsigned NK_DIRS = 0;
+  for(unsigned i=0;i<q.N_CONTACTS;i++)
+    if(q.events[i]->get_friction_type() == Event::eSticking)
+      NK_DIRS+=(q.events[i]->contact_NK+4)/4;
+
+  // setup the LCP vector
+  qq.set_zero(q.N_CONTACTS+q.N_STICKING*4+NK_DIRS);
+  qq.set_sub_vec(0,q.Cn_a);
+
+  if(q.N_STICKING > 0){
     qq.set_sub_vec(q.N_CONTACTS,q.Cs_a);
     qq.set_sub_vec(q.N_CONTACTS+q.N_STICKING*2,q.Ct_a);
     q.Cs_a.negate();
@@ -545,16 +671,110 @@ bool AccelerationEventHandler::solve_lcp(AccelerationEventData& q, VectorNd& z)
     qq.set_sub_vec(q.N_CONTACTS+q.N_STICKING,q.Cs_a);
     qq.set_sub_vec(q.N_CONTACTS+q.N_STICKING*3,q.Ct_a);
   }
+}
 
-  MM.set_sub_mat(0, 0, UL);
+/// Attempts to solve the LCP using the active set of the last solution
+/**
+ * If the components of the solution that are nonzero (the active set) are
+ * the same as those of the last solution, the solution is found by solving
+ * a linear system with the LCP matrix restricted to the active set; the
+ * factorization of that matrix is reused for as long as the LCP matrix is.
+ * \return <b>true</b> if the solution satisfies the LCP (z is then set),
+ *         <b>false</b> if the active set has changed
+ */
+bool AccelerationEventHandler::solve_active_set(CachedLCP& c, const VectorNd& qq, VectorNd& z)
+{
+  const unsigned N = qq.size();
 
-  FILE_LOG(LOG_EVENT) << " LCP matrix: " << std::endl << MM;
-  FILE_LOG(LOG_EVENT) << " LCP vector: " << qq << std::endl;
+  // verify that there is a last solution of the right size
+  if (c.z.size() != N)
+    return false;
 
-  // solve the LCP
-  //if (!_lcp.lcp_lemke_regularized(MM, qq, z))
-  if (!solve_lcp(MM, qq, z))
-    return false; 
+  // factor the LCP matrix restricted to the active set, if necessary
+  if (!c.factored)
+  {
+    c.MM.select_square(c.active.begin(), c.active.end(), c.LU);
+    c.ipiv.resize(c.active.size());
+    if (!c.active.empty() && !_LA.factor_LU(c.LU, c.ipiv))
+      return false;
+    c.factored = true;
+  }
+
+  // solve for the active components: M_AA * z_A = -q_A
+  qq.select(c.active.begin(), c.active.end(), _zB);
+  _zB.negate();
+  if (!c.active.empty())
+    _LA.solve_LU_fast(c.LU, false, c.ipiv, _zB);
+
+  // determine the tolerance
+  const double ZERO_TOL = NEAR_ZERO * std::max((double) 1.0, qq.norm_inf());
+
+  // the active components must be nonnegative
+  z.set_zero(N);
+  for (unsigned i=0; i< c.active.size(); i++)
+  {
+    if (_zB[i] < -ZERO_TOL)
+      return false;
+    z[c.active[i]] = std::max(_zB[i], 0.0);
+  }
+
+  // w = M*z + q must be nonnegative
+  c.MM.mult(z, _w) += qq;
+  for (unsigned i=0; i< N; i++)
+    if (_w[i] < -ZERO_TOL)
+      return false;
+
+  return true;
+}
+
+/// Solves the Resting Event LCP
+/**
+ * \param c data retained from the last solve for this group of contacts
+ * \param reuse if <b>true</b>, the LCP matrix of c is reused; otherwise, it
+ *        is computed from q and stored in c
+ */
+bool AccelerationEventHandler::solve_lcp(AccelerationEventData& q, CachedLCP& c, bool reuse, VectorNd& z)
+{
+  FILE_LOG(LOG_EVENT) << "AccelerationEventHandler::solve_lcp() entered" << std::endl;
+
+  // setup the LCP matrix and vector
+  if (!reuse)
+    setup_lcp_matrix(q, c.MM);
+  setup_lcp_vector(q, _qq);
+
+  FILE_LOG(LOG_EVENT) << " LCP matrix" << ((reuse) ? " (reused): " : ": ") << std::endl << c.MM;
+  FILE_LOG(LOG_EVENT) << " LCP vector: " << _qq << std::endl;
+
+  // if the LCP matrix is reused, try the last active set first
+  if (reuse && solve_active_set(c, _qq, z))
+    FILE_LOG(LOG_EVENT) << " solved using the last active set" << std::endl;
+  else
+  {
+    // solve the LCP, warm starting from the last solution
+    z = c.z;
+    if (!solve_lcp(c.MM, _qq, z))
+    {
+      // try again without warm starting
+      z.resize(0);
+      if (!solve_lcp(c.MM, _qq, z))
+        return false; 
+    }
+
+    // determine the new active set; the factorization must be recomputed
+    // if it has changed
+    vector<unsigned> active;
+    for (unsigned i=0; i< z.size(); i++)
+      if (z[i] > 0.0)
+        active.push_back(i);
+    if (active != c.active || c.z.size() != z.size())
+    {
+      c.active.swap(active);
+      c.factored = false;
+    }
+  }
+
+  // save the solution
+  c.z = z;
 
   for(unsigned i=0,j=0;i<q.N_CONTACTS;i++)
   {
@@ -605,7 +825,7 @@ bool AccelerationEventHandler::solve_lcp(AccelerationEventData& q, VectorNd& z)
   {
     // compute LCP 'w' vector
     VectorNd w;
-    MM.mult(z, w) += qq;
+    c.MM.mult(z, w) += _qq;
 
     // output new acceleration
     FILE_LOG(LOG_EVENT) << "new normal acceleration: " << w.segment(0, q.events.size()) << std::endl;
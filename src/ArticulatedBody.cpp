@@ -876,6 +876,14 @@ void ArticulatedBody::update_visualization()
     rb->update_visualization(); 
 }
 
+/// Puts the articulated body and all of its links to sleep (or wakes them)
+void ArticulatedBody::set_sleeping(bool flag)
+{
+  DynamicBody::set_sleeping(flag);
+  BOOST_FOREACH(RigidBodyPtr rb, _links)
+    rb->set_sleeping(flag);
+}
+
 /// Loads a MCArticulatedBody object from an XML node
 void ArticulatedBody::load_from_xml(shared_ptr<const XMLTree> node, std::map<string, BasePtr>& id_map)
 {
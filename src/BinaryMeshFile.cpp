@@ -0,0 +1,286 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <Moby/BinaryMeshFile.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::vector;
+using std::string;
+
+// the magic string that begins every file
+static const char MAGIC[8] = "MOBYMSH";
+
+/// Determines whether count items of the given size fit between an offset and the end of a file
+/**
+ * (computed without overflow)
+ */
+static bool fits(size_t offset, size_t count, size_t size, size_t len)
+{
+  return offset <= len && count <= (len - offset)/size;
+}
+
+/// Writes zero bytes to a file until the offset is a multiple of eight bytes
+static void pad(FILE* fp, size_t offset, size_t aligned)
+{
+  const char ZEROS[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  if (aligned > offset)
+    fwrite(ZEROS, 1, aligned - offset, fp);
+}
+
+/// Writes a mesh (and, optionally, its flat BVH and mass data) to a file
+/**
+ * \param filename the name of the file to write
+ * \param mesh the mesh to write
+ * \param bvh the flat BVH built over the mesh, or NULL
+ * \param volume_ints the volume integrals of the mesh, or NULL
+ * \param centroid the centroid of the mesh surface (must be non-NULL if
+ *        volume_ints is non-NULL)
+ */
+void BinaryMeshFile::write(const string& filename, const IndexedTriArray& mesh, const FlatBVH* bvh, const double* volume_ints, const Origin3d* centroid)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // get the vertices and facets
+  const vector<Origin3d>& verts = mesh.get_vertices();
+  const vector<IndexedTri>& facets = mesh.get_facets();
+
+  // setup the header
+  Header h;
+  memset(&h, 0, sizeof(Header));
+  memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = VERSION;
+  h.byte_order = BYTE_ORDER_MARK;
+  h.num_vertices = verts.size();
+  h.num_tris = facets.size();
+  h.node_size = sizeof(FlatBVH::Node);
+  if (bvh && !bvh->empty())
+  {
+    h.contents |= eBVH;
+    h.num_nodes = bvh->get_nodes().size();
+    h.num_tri_idx = bvh->get_tri_indices().size();
+  }
+  if (volume_ints)
+  {
+    assert(centroid);
+    h.contents |= eMassProperties;
+    std::copy(volume_ints, volume_ints+10, h.volume_ints);
+    h.centroid[X] = (*centroid)[X];
+    h.centroid[Y] = (*centroid)[Y];
+    h.centroid[Z] = (*centroid)[Z];
+  }
+
+  // open the file
+  FILE* fp = fopen(filename.c_str(), "wb");
+  if (!fp)
+    throw std::runtime_error("BinaryMeshFile::write() - unable to open " + filename);
+
+  // write the header
+  size_t offset = sizeof(Header);
+  fwrite(&h, sizeof(Header), 1, fp);
+  pad(fp, offset, align(offset));
+  offset = align(offset);
+
+  // write the vertices
+  vector<double> vdata(verts.size()*3);
+  for (unsigned i=0, j=0; i< verts.size(); i++)
+  {
+    vdata[j++] = verts[i][X];
+    vdata[j++] = verts[i][Y];
+    vdata[j++] = verts[i][Z];
+  }
+  if (!vdata.empty())
+    fwrite(&vdata[0], sizeof(double), vdata.size(), fp);
+  offset += sizeof(double)*vdata.size();
+
+  // write the facets
+  vector<unsigned> fdata(facets.size()*3);
+  for (unsigned i=0, j=0; i< facets.size(); i++)
+  {
+    fdata[j++] = facets[i].a;
+    fdata[j++] = facets[i].b;
+    fdata[j++] = facets[i].c;
+  }
+  if (!fdata.empty())
+    fwrite(&fdata[0], sizeof(unsigned), fdata.size(), fp);
+  offset += sizeof(unsigned)*fdata.size();
+  pad(fp, offset, align(offset));
+  offset = align(offset);
+
+  // write the BVH
+  if (h.contents & eBVH)
+  {
+    fwrite(&bvh->get_nodes()[0], sizeof(FlatBVH::Node), h.num_nodes, fp);
+    if (h.num_tri_idx > 0)
+      fwrite(&bvh->get_tri_indices()[0], sizeof(unsigned), h.num_tri_idx, fp);
+  }
+
+  // verify that everything was written
+  bool failed = ferror(fp);
+  if (fclose(fp) != 0 || failed)
+    throw std::runtime_error("BinaryMeshFile::write() - unable to write " + filename);
+}
+
+/// Reads a mesh from a file, ignoring any BVH and mass data
+IndexedTriArray BinaryMeshFile::read(const string& filename)
+{
+  shared_ptr<IndexedTriArray> mesh;
+  shared_ptr<FlatBVH> bvh;
+  double volume_ints[10];
+  Origin3d centroid;
+  read(filename, mesh, bvh, volume_ints, centroid);
+  return *mesh;
+}
+
+/// Reads a mesh (and its flat BVH and mass data, if present) from a file
+/**
+ * \param filename the name of the file to read
+ * \param mesh contains the mesh on return
+ * \param bvh contains the flat BVH on return (null if the file has none)
+ * \param volume_ints contains the volume integrals on return (if the file
+ *        has mass data)
+ * \param centroid contains the surface centroid on return (if the file
+ *        has mass data)
+ * \return the Contents flags of the file
+ */
+unsigned BinaryMeshFile::read(const string& filename, shared_ptr<IndexedTriArray>& mesh, shared_ptr<FlatBVH>& bvh, double volume_ints[10], Origin3d& centroid)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // open the file
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("BinaryMeshFile::read() - unable to open " + filename);
+
+  // get the file size
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header))
+  {
+    close(fd);
+    throw std::runtime_error("BinaryMeshFile::read() - " + filename + " is not a binary mesh file");
+  }
+
+  // map the file; the mapping remains valid after the descriptor is closed
+  const size_t LEN = (size_t) st.st_size;
+  void* addr = mmap(NULL, LEN, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED)
+    throw std::runtime_error("BinaryMeshFile::read() - unable to map " + filename);
+  const unsigned char* data = (const unsigned char*) addr;
+
+  try
+  {
+    // verify the header
+    Header h;
+    memcpy(&h, data, sizeof(Header));
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0)
+      throw std::runtime_error("BinaryMeshFile::read() - " + filename + " is not a binary mesh file");
+    if (h.version != VERSION)
+      throw std::runtime_error("BinaryMeshFile::read() - " + filename + " has an unsupported version");
+    if (h.byte_order != BYTE_ORDER_MARK || h.node_size != sizeof(FlatBVH::Node))
+      throw std::runtime_error("BinaryMeshFile::read() - " + filename + " was written on an incompatible platform");
+
+    // determine the offsets of the sections, verifying that each fits in
+    // the file before computing the next
+    const string TRUNCATED = "BinaryMeshFile::read() - " + filename + " is truncated";
+    const size_t VERTS_OFFSET = align(sizeof(Header));
+    if (!fits(VERTS_OFFSET, h.num_vertices, sizeof(double)*3, LEN))
+      throw std::runtime_error(TRUNCATED);
+    const size_t FACETS_OFFSET = VERTS_OFFSET + sizeof(double)*3*h.num_vertices;
+    if (!fits(FACETS_OFFSET, h.num_tris, sizeof(unsigned)*3, LEN))
+      throw std::runtime_error(TRUNCATED);
+    const size_t NODES_OFFSET = align(FACETS_OFFSET + sizeof(unsigned)*3*h.num_tris);
+    if (!fits(NODES_OFFSET, h.num_nodes, sizeof(FlatBVH::Node), LEN))
+      throw std::runtime_error(TRUNCATED);
+    const size_t TRI_IDX_OFFSET = NODES_OFFSET + sizeof(FlatBVH::Node)*h.num_nodes;
+    if (!fits(TRI_IDX_OFFSET, h.num_tri_idx, sizeof(unsigned), LEN))
+      throw std::runtime_error(TRUNCATED);
+
+    // copy the vertices
+    const double* vdata = (const double*) (data + VERTS_OFFSET);
+    shared_ptr<vector<Origin3d> > verts(new vector<Origin3d>(h.num_vertices));
+    for (unsigned i=0; i< h.num_vertices; i++, vdata += 3)
+      (*verts)[i] = Origin3d(vdata[X], vdata[Y], vdata[Z]);
+
+    // copy the facets
+    const unsigned* fdata = (const unsigned*) (data + FACETS_OFFSET);
+    shared_ptr<vector<IndexedTri> > facets(new vector<IndexedTri>(h.num_tris));
+    for (unsigned i=0; i< h.num_tris; i++, fdata += 3)
+      (*facets)[i] = IndexedTri(fdata[0], fdata[1], fdata[2]);
+
+    // create the mesh (this validates the vertex indices)
+    mesh = shared_ptr<IndexedTriArray>(new IndexedTriArray(verts, facets));
+
+    // read the BVH
+    bvh.reset();
+    if (h.contents & eBVH)
+    {
+      const FlatBVH::Node* nodes = (const FlatBVH::Node*) (data + NODES_OFFSET);
+      const unsigned* tri_idx = (const unsigned*) (data + TRI_IDX_OFFSET);
+
+      // verify that the nodes and indices are in range: a leaf's range of
+      // triangle indices must lie within the index array, and an internal
+      // node's children (the next node and the node at its offset) must
+      // follow it; as children follow their parents, the depth of each node
+      // is final once the node is reached, and the depth is limited by the
+      // fixed-size traversal stacks of FlatBVH
+      const string INVALID = "BinaryMeshFile::read() - " + filename + " has an invalid BVH";
+      vector<unsigned> depth(h.num_nodes, 0);
+      for (unsigned i=0; i< h.num_nodes; i++)
+      {
+        if (depth[i] >= FlatBVH::MAX_DEPTH)
+          throw std::runtime_error(INVALID);
+        if (nodes[i].is_leaf())
+        {
+          if (nodes[i].count > h.num_tri_idx || nodes[i].offset > h.num_tri_idx - nodes[i].count)
+            throw std::runtime_error(INVALID);
+        }
+        else
+        {
+          if (nodes[i].offset <= i+1 || nodes[i].offset >= h.num_nodes)
+            throw std::runtime_error(INVALID);
+          depth[i+1] = std::max(depth[i+1], depth[i]+1);
+          depth[nodes[i].offset] = std::max(depth[nodes[i].offset], depth[i]+1);
+        }
+      }
+      for (unsigned i=0; i< h.num_tri_idx; i++)
+        if (tri_idx[i] >= h.num_tris)
+          throw std::runtime_error(INVALID);
+
+      bvh = shared_ptr<FlatBVH>(new FlatBVH);
+      bvh->assign(nodes, h.num_nodes, tri_idx, h.num_tri_idx);
+      bvh->calc_pseudo_normals(*mesh);
+    }
+
+    // read the mass data
+    if (h.contents & eMassProperties)
+    {
+      std::copy(h.volume_ints, h.volume_ints+10, volume_ints);
+      centroid = Origin3d(h.centroid[X], h.centroid[Y], h.centroid[Z]);
+    }
+
+    // release the mapping
+    munmap(addr, LEN);
+    return h.contents;
+  }
+  catch (...)
+  {
+    munmap(addr, LEN);
+    throw;
+  }
+}
+
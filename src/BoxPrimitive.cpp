@@ -15,6 +15,7 @@
 #include <Moby/Constants.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/QP.h>
+#include <Moby/HeightfieldPrimitive.h>
 #include <Moby/BoxPrimitive.h>
 
 using namespace Ravelin;
@@ -82,6 +83,11 @@ double BoxPrimitive::calc_signed_dist(shared_ptr<const Primitive> p, shared_ptr<
   if (spherep)
     return calc_signed_dist(spherep, poseA, poseB, pthis, pp);
 
+  // now try box/heightfield
+  shared_ptr<const HeightfieldPrimitive> hfp = dynamic_pointer_cast<const HeightfieldPrimitive>(p);
+  if (hfp)
+    return hfp->calc_signed_dist(dynamic_pointer_cast<const Primitive>(shared_from_this()), poseB, poseA, pp, pthis);
+
   // TODO: verify transform is set in the proper order
   // TODO: finish implementing pairwise checks
   assert(false);
@@ -817,7 +823,7 @@ bool BoxPrimitive::intersect_seg(BVPtr bv, const LineSeg3& seg, double& t, Point
   const unsigned X = 0, Y = 1, Z = 2;
   double tmin = (double) 0.0;
   double tmax = (double) 2.0;
-  static shared_ptr<Pose3d> P;
+  SAFESTATIC shared_ptr<Pose3d> P;
 
   // get the pose for the collision geometry
   shared_ptr<const Pose3d> gpose = bv->geom->get_pose(); 
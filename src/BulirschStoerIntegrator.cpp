@@ -5,6 +5,7 @@
  ****************************************************************************/
 
 #include <strings.h>
+#include <boost/ref.hpp>
 #include <boost/numeric/odeint/config.hpp>
 #include <boost/numeric/odeint.hpp>
 #include <boost/numeric/odeint/stepper/bulirsch_stoer.hpp>
@@ -16,16 +17,12 @@ using namespace boost::numeric::odeint;
 using Ravelin::VectorNd;
 using namespace Moby;
 
-// static definitions
-VectorNd& (*BulirschStoerIntegrator::_f)(const VectorNd&, double, double, void*, VectorNd&);
-double BulirschStoerIntegrator::_dt;
-vector<double> BulirschStoerIntegrator::_y;
-VectorNd BulirschStoerIntegrator::_x;
-VectorNd BulirschStoerIntegrator::_dxdt;
-void* BulirschStoerIntegrator::_data;
-
 BulirschStoerIntegrator::BulirschStoerIntegrator()
 {
+  _stepper_aerr = _stepper_rerr = -1.0;
+  _f = NULL;
+  _dt = 0.0;
+  _data = NULL;
 }
 
 void BulirschStoerIntegrator::f(const vector<double>& y, vector<double>& dydt, const double t)
@@ -43,8 +40,16 @@ void BulirschStoerIntegrator::f(const vector<double>& y, vector<double>& dydt, c
 
 void BulirschStoerIntegrator::integrate(VectorNd& x, VectorNd& (*ode)(const VectorNd&, double, double, void*, VectorNd&), double time, double step_size, void* data)
 {
-  // setup the integrator
-  bulirsch_stoer<std::vector<double> > integrator(aerr_tolerance, rerr_tolerance, 1.0, 1.0);
+  // setup the stepper; it is only rebuilt when the tolerances change, so
+  // its internal buffers are reused from step to step
+  if (!_stepper || _stepper_aerr != aerr_tolerance || _stepper_rerr != rerr_tolerance)
+  {
+    _stepper = shared_ptr<Stepper>(new Stepper(aerr_tolerance, rerr_tolerance, 1.0, 1.0));
+    _stepper_aerr = aerr_tolerance;
+    _stepper_rerr = rerr_tolerance;
+  }
+  else
+    _stepper->reset();
   
   // setup y
   _y.resize(x.size());
@@ -58,7 +63,9 @@ void BulirschStoerIntegrator::integrate(VectorNd& x, VectorNd& (*ode)(const Vect
   _data = data;
 
   // integrate adaptively
-  integrate_adaptive(integrator, f, _y, time, time+step_size, step_size); 
+  System system;
+  system.integrator = this;
+  integrate_adaptive(boost::ref(*_stepper), system, _y, time, time+step_size, step_size); 
 
   // copy _y back to x
   std::copy(_y.begin(), _y.end(), x.begin());
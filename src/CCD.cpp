@@ -19,6 +19,7 @@
 #include <Moby/RigidBody.h>
 #include <Moby/ArticulatedBody.h>
 #include <Moby/CollisionGeometry.h>  
+#include <Moby/CompGeom.h>
 #include <Moby/XMLTree.h>
 #include <Moby/SSL.h>
 #include <Moby/BoundingSphere.h>
@@ -28,7 +29,9 @@
 #include <Moby/ConePrimitive.h>
 #include <Moby/TriangleMeshPrimitive.h>
 #include <Moby/GaussianMixture.h>
+#include <Moby/HeightfieldPrimitive.h>
 #include <Moby/CSG.h>
+#include <Moby/ContactPool.h>
 #include <Moby/CCD.h>
 
 using boost::dynamic_pointer_cast;
@@ -52,6 +55,11 @@ using namespace Moby;
 /// Constructs a collision detector with default tolerances
 CCD::CCD()
 {
+  _PA = shared_ptr<Pose3d>(new Pose3d);
+  _PB = shared_ptr<Pose3d>(new Pose3d);
+  _FA = shared_ptr<Pose3d>(new Pose3d);
+  _FB = shared_ptr<Pose3d>(new Pose3d);
+  max_CA_iterations = 8;
 }
 
 /// Finds the next event time between two rigid bodies
@@ -89,10 +97,10 @@ double CCD::find_next_contact_time(CollisionGeometryPtr cgA, CollisionGeometryPt
   Vector3d nB = Pose3d::transform_vector(rbB->get_pose(), n0);
 
   // compute the distance that body A can move toward body B
-  double velA = calc_max_velocity(rbA, -nA, _rmax[cgA]);
+  double velA = calc_max_velocity(rbA, cgA, -nA);
 
   // compute the distance that body B can move toward body A
-  double velB = calc_max_velocity(rbB, nB, _rmax[cgB]);
+  double velB = calc_max_velocity(rbB, cgB, nB);
 
   // compute the total velocity 
   double total_vel = velA + velB;
@@ -108,104 +116,340 @@ double CCD::find_next_contact_time(CollisionGeometryPtr cgA, CollisionGeometryPt
 }
 
 /// Computes a conservative advancement step between two collision geometries 
-double CCD::calc_CA_step(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB)
+/**
+ * The first iteration bounds the approach of the geometries using the
+ * velocity limits of the bodies and the directional extents of the
+ * geometries. Each subsequent iteration recomputes the distance at the
+ * configuration predicted (from the current velocities) for the time
+ * advanced so far, less a bound on how far the actual motion (within the
+ * velocity limits) may deviate from the prediction, and advances again.
+ * \param dt the step of interest; iteration stops once it is reached
+ */
+double CCD::calc_CA_step(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, double dt)
 {
-  double maxt = std::numeric_limits<double>::max();
   Point3d pA, pB;
 
-  // compute distance and closest points
-  double dist = CollisionGeometry::calc_signed_dist(cgA, cgB, pA, pB);
-
-  // if the distance is zero, quit now
-  if (dist < NEAR_ZERO)
-    return 0.0;
-
-  // get the direction of the vector from body B to body A
-  Vector3d d0 = Pose3d::transform_point(GLOBAL, pA) - 
-                Pose3d::transform_point(GLOBAL, pB);
-  double d0_norm = d0.norm();
-  FILE_LOG(LOG_COLDET) << "distance between closest points is: " << d0_norm << std::endl;
-  FILE_LOG(LOG_COLDET) << "reported distance is: " << dist << std::endl; 
-
   // get the two underlying bodies
   RigidBodyPtr rbA = dynamic_pointer_cast<RigidBody>(cgA->get_single_body());
   RigidBodyPtr rbB = dynamic_pointer_cast<RigidBody>(cgB->get_single_body());
 
-  // get the direction of the vector (from body B to body A)
-  Vector3d n0 = d0/d0_norm;
-  Vector3d nA = Pose3d::transform_vector(rbA->get_pose(), n0);
-  Vector3d nB = Pose3d::transform_vector(rbB->get_pose(), n0);
+  // setup the poses of the primitives relative to the predicted body poses
+  const SupportData& sA = get_support_data(cgA);
+  const SupportData& sB = get_support_data(cgB);
+  _PA->q = sA.q;
+  _PA->x = sA.x;
+  _PA->rpose = _FA;
+  _PB->q = sB.q;
+  _PB->x = sB.x;
+  _PB->rpose = _FB;
+
+  // get the two primitives
+  PrimitivePtr primA = cgA->get_geometry();
+  PrimitivePtr primB = cgB->get_geometry();
+
+  // bound the rate at which the actual motion deviates from the prediction
+  const double DEV_PER_T = calc_max_deviation_per_t(rbA, cgA) + 
+                           calc_max_deviation_per_t(rbB, cgB);
+
+  // advance conservatively
+  double t = 0.0;
+  for (unsigned iter=0; iter< max_CA_iterations; iter++)
+  {
+    // predict the body poses at time t
+    calc_predicted_pose(rbA, t, *_FA);
+    calc_predicted_pose(rbB, t, *_FB);
+
+    // compute distance and closest points
+    double dist = primA->calc_signed_dist(primB, _PA, _PB, pA, pB) - DEV_PER_T*t;
+    FILE_LOG(LOG_COLDET) << "  iteration " << iter << " t: " << t << " distance: " << dist << std::endl;
+
+    // if the distance is zero, quit now
+    if (dist < NEAR_ZERO)
+      return t;
+
+    // get the direction of the vector from body B to body A
+    Vector3d d0 = Pose3d::transform_point(GLOBAL, pA) - 
+                  Pose3d::transform_point(GLOBAL, pB);
+    double d0_norm = d0.norm();
+    if (d0_norm < NEAR_ZERO)
+      return t;
+
+    // get the direction of the vector (from body B to body A)
+    Vector3d n0 = d0/d0_norm;
+    Vector3d nA = Pose3d::transform_vector(_FA, n0);
+    Vector3d nB = Pose3d::transform_vector(_FB, n0);
+
+    // compute the distance that body A can move toward body B
+    double dist_per_tA = calc_max_dist_per_t(rbA, cgA, -nA);
+
+    // compute the distance that body B can move toward body A
+    double dist_per_tB = calc_max_dist_per_t(rbB, cgB, nB);
+
+    FILE_LOG(LOG_COLDET) << "  dist per tA: " << dist_per_tA << std::endl;
+    FILE_LOG(LOG_COLDET) << "  dist per tB: " << dist_per_tB << std::endl;
+
+    // if the bodies cannot approach, no contact is possible
+    double total_dist_per_t = dist_per_tA + dist_per_tB;
+    if (total_dist_per_t <= 0.0)
+      return std::numeric_limits<double>::max();
+
+    // advance
+    const double DELTA = dist/total_dist_per_t;
+    t += DELTA;
+    if (t >= dt || DELTA < NEAR_ZERO)
+      break;
+  }
 
-  // compute the distance that body A can move toward body B
-  double dist_per_tA = calc_max_dist_per_t(rbA, -nA, _rmax[cgA]);
+  FILE_LOG(LOG_COLDET) << "  maxt: " << t << std::endl;
 
-  // compute the distance that body B can move toward body A
-  double dist_per_tB = calc_max_dist_per_t(rbB, nB, _rmax[cgB]);
+  // return the maximum safe step
+  return t;
+}
 
-  // compute the total distance
-  double total_dist_per_t = dist_per_tA + dist_per_tB;
-  if (total_dist_per_t < 0.0)
-    total_dist_per_t = 0.0;
+/// Gets the body-frame support data for a geometry, computing it if necessary
+const CCD::SupportData& CCD::get_support_data(CollisionGeometryPtr cg)
+{
+  map<CollisionGeometryPtr, SupportData>::const_iterator i = _support.find(cg);
+  if (i != _support.end())
+    return i->second;
 
-  FILE_LOG(LOG_COLDET) << "  distance: " << dist << std::endl;
-  FILE_LOG(LOG_COLDET) << "  dist per tA: " << dist_per_tA << std::endl;
-  FILE_LOG(LOG_COLDET) << "  dist per tB: " << dist_per_tB << std::endl;
+  // get the rigid body and the primitive
+  RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(cg->get_single_body());
+  PrimitivePtr primitive = cg->get_geometry();
+
+  // setup new pose for the primitive that refers to the underlying geometry
+  shared_ptr<Pose3d> P(new Pose3d(*primitive->get_pose()));
+  P->rpose = cg->get_pose();
+
+  // get the pose of the primitive relative to the body
+  SupportData& s = _support[cg];
+  Transform3d T = Pose3d::calc_relative_pose(P, rb->get_pose());
+  s.q = T.q;
+  s.x = T.x;
+
+  // spheres are represented exactly using their center and radius
+  shared_ptr<SpherePrimitive> sph = dynamic_pointer_cast<SpherePrimitive>(primitive);
+  s.sphere = (bool) sph;
+  s.radius = (sph) ? sph->get_radius() : 0.0;
+  s.center = T.x;
+
+  // get the vertices in the body frame and their farthest distance from
+  // the body origin
+  s.verts.clear();
+  s.rmax = (sph) ? s.center.norm() + s.radius : 0.0;
+  s.use_rmax = false;
+  if (!sph)
+  {
+    primitive->get_vertices(_verts);
+    for (unsigned j=0; j< _verts.size(); j++)
+    {
+      _verts[j].pose = P;
+      _verts[j] = T.transform_point(_verts[j]);
+      s.rmax = std::max(s.rmax, Origin3d(_verts[j]).norm());
+    }
 
-  // compute the maximum safe step
-  maxt = std::min(maxt, dist/total_dist_per_t);
+    // only the vertices of the convex hull can be extremal
+    PolyhedronPtr hull = CompGeom::calc_convex_hull_3D(_verts);
+    if (hull)
+      s.verts = hull->get_vertices();
+    else
+    {
+      s.verts.reserve(_verts.size());
+      for (unsigned j=0; j< _verts.size(); j++)
+        s.verts.push_back(Origin3d(_verts[j]));
+    }
 
-  FILE_LOG(LOG_COLDET) << "  maxt: " << maxt << std::endl;
+    // if there are still too many vertices to check on every query, the
+    // geometry is bounded by a sphere about the body origin instead
+    s.use_rmax = (s.verts.size() > MAX_SUPPORT_VERTS);
+  }
 
-  // return the maximum safe step
-  return maxt;
+  FILE_LOG(LOG_COLDET) << "CCD::get_support_data() - " << s.verts.size() << " support vertices; farthest distance " << s.rmax << endl;
+
+  return s;
 }
 
-/// Computes the maximum velocity along a particular direction (n) 
-double CCD::calc_max_velocity(RigidBodyPtr rb, const Vector3d& n, double rmax)
+/// Computes the support of a geometry (the maximum of <d, r> over its points r)
+/**
+ * \param d the direction (body frame)
+ */
+double CCD::calc_support(const SupportData& s, const Vector3d& d)
 {
   const unsigned X = 0, Y = 1, Z = 2;
 
+  // sphere is the center plus the radius in the direction
+  if (s.sphere)
+    return d[X]*s.center[X] + d[Y]*s.center[Y] + d[Z]*s.center[Z] + s.radius*d.norm();
+
+  // nothing more to do if the direction is zero
+  if (s.verts.empty() || (d[X] == 0.0 && d[Y] == 0.0 && d[Z] == 0.0))
+    return 0.0;
+
+  // use the bounding sphere about the body origin for large geometries
+  if (s.use_rmax)
+    return s.rmax*d.norm();
+
+  // otherwise, find the extremal vertex
+  double sup = -std::numeric_limits<double>::max();
+  for (unsigned i=0; i< s.verts.size(); i++)
+  {
+    const Origin3d& r = s.verts[i];
+    sup = std::max(sup, d[X]*r[X] + d[Y]*r[Y] + d[Z]*r[Z]);
+  }
+
+  return sup;
+}
+
+/// Computes the maximum velocity of any point of a geometry along a particular direction (n) 
+/**
+ * Since <n, w x r> = <n x w, r>, the angular term is the support of the
+ * geometry in the direction n x w.
+ * \param n the direction (body frame)
+ */
+double CCD::calc_max_velocity(RigidBodyPtr rb, CollisionGeometryPtr cg, const Vector3d& n)
+{
   // get the velocities at t0
   const SVelocityd& v0 = Pose3d::transform(rb->get_pose(), rb->get_velocity());
   Vector3d xd0 = v0.get_linear();
   Vector3d w0 = v0.get_angular();
-  return n.dot(xd0) + w0.norm()*rmax; 
+  return n.dot(xd0) + calc_support(get_support_data(cg), Vector3d::cross(n, w0)); 
 }
 
-/// Solves the LP that maximizes <n, v + w x r>
-double CCD::calc_max_dist_per_t(RigidBodyPtr rb, const Vector3d& n, double rlen)
+/// Computes the maximum of <n, v + w x r> over the velocity limits and the points r of a geometry
+/**
+ * Both terms are maximized at corners of the box of velocity limits; as
+ * <n, w x r> = <w, r x n> is convex in r, the angular term is maximized at
+ * the vertices of the geometry.
+ * \param n the direction (body frame)
+ */
+double CCD::calc_max_dist_per_t(RigidBodyPtr rb, CollisionGeometryPtr cg, const Vector3d& n)
 {
   const unsigned X = 0, Y = 1, Z = 2;
 
-  // get the velocities at t0
+  // get the velocity limits
+  const SVelocityd& vhi = rb->get_vel_upper_bounds(); 
+  const SVelocityd& vlo = rb->get_vel_lower_bounds(); 
+  Vector3d xdhi = vhi.get_linear();
+  Vector3d xdlo = vlo.get_linear();
+  Vector3d omegahi = vhi.get_angular();
+  Vector3d omegalo = vlo.get_angular();
+
+  // compute the linear term
+  double dist = 0.0;
+  for (unsigned i=0; i< 3; i++)
+    dist += (n[i] < 0.0) ? xdlo[i]*n[i] : xdhi[i]*n[i];
+
+  // if the body cannot rotate, only the linear term remains
+  bool rotates = false;
+  for (unsigned i=0; i< 3; i++)
+    if (omegalo[i] != 0.0 || omegahi[i] != 0.0)
+      rotates = true;
+  if (!rotates)
+    return dist;
+
+  // a sphere is bounded using its center; the remainder is bounded by the
+  // radius (from Mirtich [1996], p. 131)
+  const SupportData& s = get_support_data(cg);
+  if (s.sphere)
+  {
+    double c[3];
+    c[X] = s.center[Y]*n[Z] - s.center[Z]*n[Y];
+    c[Y] = s.center[Z]*n[X] - s.center[X]*n[Z];
+    c[Z] = s.center[X]*n[Y] - s.center[Y]*n[X];
+    for (unsigned i=0; i< 3; i++)
+    {
+      dist += std::max(omegalo[i]*c[i], omegahi[i]*c[i]);
+      double wmax = std::max(std::fabs(omegalo[i]), std::fabs(omegahi[i]));
+      dist += s.radius*wmax*std::sqrt(std::max(0.0, 1.0-n[i]*n[i]));
+    }
+    return dist;
+  }
+
+  // a large geometry is bounded using its farthest distance from the body
+  // origin, as <w, r x n> <= |w| |r|
+  if (s.verts.empty())
+    return dist;
+  if (s.use_rmax)
+  {
+    double wmax = 0.0;
+    for (unsigned i=0; i< 3; i++)
+    {
+      double w = std::max(std::fabs(omegalo[i]), std::fabs(omegahi[i]));
+      wmax += w*w;
+    }
+    return dist + s.rmax*std::sqrt(wmax);
+  }
+
+  // find the vertex that can approach fastest
+  double ang = -std::numeric_limits<double>::max();
+  for (unsigned j=0; j< s.verts.size(); j++)
+  {
+    const Origin3d& r = s.verts[j];
+    double c[3];
+    c[X] = r[Y]*n[Z] - r[Z]*n[Y];
+    c[Y] = r[Z]*n[X] - r[X]*n[Z];
+    c[Z] = r[X]*n[Y] - r[Y]*n[X];
+    double a = 0.0;
+    for (unsigned i=0; i< 3; i++)
+      a += std::max(omegalo[i]*c[i], omegahi[i]*c[i]);
+    ang = std::max(ang, a);
+  }
+
+  return dist + ang;
+}
+
+/// Bounds the rate at which points of a geometry may deviate from their predicted motion
+/**
+ * The predicted motion uses the current velocity; the actual velocity may
+ * lie anywhere within the velocity limits.
+ */
+double CCD::calc_max_deviation_per_t(RigidBodyPtr rb, CollisionGeometryPtr cg)
+{
+  // get the velocities at t0 and the velocity limits
   const SVelocityd& v0 = Pose3d::transform(rb->get_pose(), rb->get_velocity());
-  Vector3d xd0 = v0.get_linear();
-  Vector3d w0 = v0.get_angular();
+  const SVelocityd& vhi = rb->get_vel_upper_bounds(); 
+  const SVelocityd& vlo = rb->get_vel_lower_bounds(); 
+  Vector3d xd0 = v0.get_linear(), w0 = v0.get_angular();
+  Vector3d xdhi = vhi.get_linear(), xdlo = vlo.get_linear();
+  Vector3d omegahi = vhi.get_angular(), omegalo = vlo.get_angular();
+
+  // get the largest deviations of the linear and angular velocities
+  double dv = 0.0, dw = 0.0;
+  for (unsigned i=0; i< 3; i++)
+  {
+    double a = std::max(std::fabs(xdhi[i] - xd0[i]), std::fabs(xdlo[i] - xd0[i]));
+    double b = std::max(std::fabs(omegahi[i] - w0[i]), std::fabs(omegalo[i] - w0[i]));
+    dv += a*a;
+    dw += b*b;
+  }
 
-  // get the bounds on acceleration
-  const SVelocityd& v0p = rb->get_vel_upper_bounds(); 
-  const SVelocityd& v0n = rb->get_vel_lower_bounds(); 
-  assert(v0p.pose == v0.pose);
-  assert(v0n.pose == v0.pose);
-
-  // break velocity bounds into linear and angular components
-  Vector3d xdp = v0p.get_linear();
-  Vector3d xdn = v0n.get_linear();
-  Vector3d omegap = v0p.get_angular();
-  Vector3d omegan = v0n.get_angular();
-
-  // (from Mirtich [1996], p. 131)
-  double dist = n.dot(xd0) + w0.norm()*rlen;
-  double wmaxx = std::max(std::fabs(omegap[X]), std::fabs(omegan[X]));
-  double wmaxy = std::max(std::fabs(omegap[Y]), std::fabs(omegan[Y]));
-  double wmaxz = std::max(std::fabs(omegap[Z]), std::fabs(omegan[Z]));
-  dist += (n[X] < 0.0) ? xdn[X]*n[X] : xdp[X]*n[X];
-  dist += (n[Y] < 0.0) ? xdn[Y]*n[Y] : xdp[Y]*n[Y];
-  dist += (n[Z] < 0.0) ? xdn[Z]*n[Z] : xdp[Z]*n[Z];
-  dist += rlen*(wmaxx*std::sqrt(1-n[X]*n[X]) + wmaxy*std::sqrt(1-n[Y]*n[Y]) +
-                wmaxz*std::sqrt(1-n[Z]*n[Z]));
+  return std::sqrt(dv) + std::sqrt(dw)*get_support_data(cg).rmax;
+}
 
-  return dist;
+/// Computes the pose of a body at time t, assuming its velocity is constant
+/**
+ * \param F on return, the predicted pose (relative to the global frame)
+ */
+void CCD::calc_predicted_pose(RigidBodyPtr rb, double t, Pose3d& F)
+{
+  // get the current pose and the velocity of the body origin (global frame)
+  Transform3d T0 = Pose3d::calc_relative_pose(rb->get_pose(), GLOBAL);
+  SVelocityd v = Pose3d::transform(rb->get_mixed_pose(), rb->get_velocity());
+  Vector3d xd = v.get_linear();
+  Vector3d w = v.get_angular();
+
+  // translate the origin and rotate about the angular velocity
+  F.rpose = GLOBAL;
+  F.x = T0.x + Origin3d(xd*t);
+  const double WNORM = w.norm();
+  if (WNORM*t < NEAR_ZERO)
+    F.q = T0.q;
+  else
+  {
+    Quatd qw;
+    qw = AAngled(w/WNORM, WNORM*t);
+    F.q = qw * T0.q;
+  }
 }
 
 /// Implements Base::load_from_xml()
@@ -215,6 +459,13 @@ void CCD::load_from_xml(shared_ptr<const XMLTree> node, map<std::string, BasePtr
 
   // verify that the node name is correct
   assert(strcasecmp(node->name.c_str(), "CCD") == 0);
+
+  // read the maximum number of conservative advancement iterations
+  XMLAttrib* max_CA_iter_attr = node->get_attrib("max-CA-iterations");
+  if (max_CA_iter_attr)
+    max_CA_iterations = max_CA_iter_attr->get_unsigned_value();
+  if (max_CA_iterations < 1)
+    throw std::runtime_error("CCD::load_from_xml() - max-CA-iterations must be at least 1");
 }
 
 /// Implements Base::save_to_xml()
@@ -226,42 +477,378 @@ void CCD::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_obj
 {
   // (re)set the node name
   node->name = "CCD";
+
+  // save the maximum number of conservative advancement iterations
+  node->attribs.insert(XMLAttrib("max-CA-iterations", max_CA_iterations));
 }
 
 /****************************************************************************
  Methods for Drumwright-Shell algorithm begin 
 ****************************************************************************/
 
-/// Creates a contact event given the bare-minimum info
-Event CCD::create_contact(CollisionGeometryPtr a, CollisionGeometryPtr b, const Point3d& point, const Vector3d& normal)
+/// Resolves the global transforms of all links and geometries
+/**
+ * This must be called whenever the bodies move (before broad_phase(),
+ * find_contacts(), etc.); the link and geometry indices are reassigned only
+ * when geometries are added or removed.
+ */
+void CCD::update_poses(const vector<DynamicBodyPtr>& bodies)
+{
+  // count the links and geometries
+  unsigned nbodies = 0, ngeoms = 0;
+  for (unsigned i=0; i< bodies.size(); i++)
+  {
+    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(bodies[i]);
+    if (ab)
+    {
+      const vector<RigidBodyPtr>& links = ab->get_links();
+      nbodies += links.size();
+      for (unsigned j=0; j< links.size(); j++)
+        ngeoms += links[j]->geometries.size();
+    }
+    else
+    {
+      nbodies++;
+      ngeoms += dynamic_pointer_cast<RigidBody>(bodies[i])->geometries.size();
+    }
+  }
+
+  // rebuild the indices if necessary, then refresh the transforms
+  if (nbodies != _poses.num_bodies() || ngeoms != _poses.num_geoms())
+    _poses.rebuild(bodies);
+  _poses.update();
+}
+
+/// Finds contacts between two collision geometries, adding records to the pool
+/**
+ * \note update_poses() must have been called since the bodies last moved
+ */
+void CCD::find_contacts(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, ContactPool& pool)
+{
+  // get the indices of the geometries in the pose cache
+  const unsigned iA = _poses.get_geom_index(cgA);
+  const unsigned iB = _poses.get_geom_index(cgB);
+  assert(iA != PoseCache::NONE && iB != PoseCache::NONE);
+
+  // heightfields use their own (separated or not) contact generation
+  PrimitivePtr primA = cgA->get_geometry();
+  PrimitivePtr primB = cgB->get_geometry();
+  if (dynamic_pointer_cast<HeightfieldPrimitive>(primA) ||
+      dynamic_pointer_cast<HeightfieldPrimitive>(primB))
+  {
+    find_contacts_heightfield(cgA, cgB, iA, iB, pool);
+    return;
+  }
+
+  // compute the signed distance using the cached primitive poses
+  Point3d pA, pB;
+  double dist = calc_signed_dist(cgA, cgB, pA, pB);
+  if (dist <= 0.0)
+    find_contacts_not_separated(cgA, cgB, iA, iB, pool);
+  else if (dist < NEAR_ZERO)
+    find_contacts_separated(cgA, cgB, iA, iB, dist, pool);
+}
+
+/// Computes the signed distance between two geometries using the cached primitive poses
+/**
+ * Equivalent to CollisionGeometry::calc_signed_dist(), but no pose is
+ * allocated and no chain of poses is walked.
+ * \note update_poses() must have been called since the bodies last moved
+ */
+double CCD::calc_signed_dist(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, Point3d& pA, Point3d& pB)
+{
+  const unsigned iA = _poses.get_geom_index(cgA);
+  const unsigned iB = _poses.get_geom_index(cgB);
+  assert(iA != PoseCache::NONE && iB != PoseCache::NONE);
+  _poses.get_geom_pose(iA, *_PA);
+  _poses.get_geom_pose(iB, *_PB);
+  return cgA->get_geometry()->calc_signed_dist(cgB->get_geometry(), _PA, _PB, pA, pB);
+}
+
+/// Gets the vertices of the primitive of a geometry in the global frame
+/**
+ * \param i the index of the geometry in the pose cache
+ */
+void CCD::get_vertices(unsigned i, CollisionGeometryPtr cg, vector<Point3d>& verts) const
+{
+  cg->get_geometry()->get_vertices(verts);
+  for (unsigned j=0; j< verts.size(); j++)
+    verts[j] = _poses.transform_point_to_global(i, verts[j]);
+}
+
+/// Computes the distance of a point from a geometry and the normal at the closest point
+/**
+ * \param i the index of the geometry in the pose cache
+ * \param p the point (global frame)
+ * \param n the normal (global frame) on return
+ */
+double CCD::calc_dist_and_normal(unsigned i, CollisionGeometryPtr cg, const Point3d& p, Vector3d& n) const
 {
-  Event e;
-  e.event_type = Event::eContact;
-  e.contact_point = point;
-  e.contact_normal = normal;
-  e.contact_geom1 = a;  
-  e.contact_geom2 = b;  
-
-  // check for valid normal here
-  assert(std::fabs(e.contact_normal.norm() - (double) 1.0) < NEAR_ZERO);
-
-  // make the body first that comes first alphabetically
-  if (LOGGING(LOG_COLDET))
-  {
-    SingleBodyPtr sb1 = e.contact_geom1->get_single_body();
-    SingleBodyPtr sb2 = e.contact_geom2->get_single_body();
-    if (sb2->id < sb1->id)
+  PrimitivePtr primitive = cg->get_geometry();
+
+  // transform the point to the primitive frame
+  Point3d px = _poses.transform_point_from_global(i, p);
+  px.pose = primitive->get_pose();
+
+  // call the primitive function and transform the normal back
+  double dist = primitive->calc_dist_and_normal(px, n);
+  n = _poses.transform_vector_to_global(i, n);
+  return dist;
+}
+
+void CCD::find_contacts_separated(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, unsigned iA, unsigned iB, double min_dist, ContactPool& pool)
+{
+  Vector3d n;
+
+  // look for special cases
+  PrimitivePtr primA = cgA->get_geometry();
+  PrimitivePtr primB = cgB->get_geometry();
+  if (typeid(primA) == typeid(shared_ptr<SpherePrimitive>))
+  {
+    if (typeid(primB) == typeid(shared_ptr<SpherePrimitive>))
+    {
+      find_contacts_sphere_sphere(cgA, cgB, iA, iB, pool);
+      return;
+    }
+  }
+
+  // get the vertices from A and B
+  get_vertices(iA, cgA, _vA);
+  get_vertices(iB, cgB, _vB);
+
+  // examine all points from A against B  
+  for (unsigned i=0; i< _vA.size(); i++)
+  {
+    // get the distance from the point to the primitive 
+    double dist = calc_dist_and_normal(iB, cgB, _vA[i], n);
+
+    // see whether the distance is comparable to the minimum distance
+    if (dist - NEAR_ZERO <= min_dist)
+      pool.add(cgA, cgB, _vA[i], n); 
+  }    
+
+  // examine all points from B against A
+  for (unsigned i=0; i< _vB.size(); i++)
+  {
+    // get the distance from the point to the primitive 
+    double dist = calc_dist_and_normal(iA, cgA, _vB[i], n);
+
+    // see whether the distance is comparable to the minimum distance
+    if (dist - NEAR_ZERO <= min_dist)
+      pool.add(cgA, cgB, _vB[i], -n); 
+  }
+}
+
+/// Determines contact data between two geometries that are touching or interpenetrating 
+void CCD::find_contacts_not_separated(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, unsigned iA, unsigned iB, ContactPool& pool)
+{
+  Vector3d n;
+
+  // look for special cases
+  PrimitivePtr pA = cgA->get_geometry();
+  PrimitivePtr pB = cgB->get_geometry();
+  if (typeid(pA) == typeid(shared_ptr<SpherePrimitive>))
+  {
+    if (typeid(pB) == typeid(shared_ptr<SpherePrimitive>))
     {
-      std::swap(e.contact_geom1, e.contact_geom2);
-      e.contact_normal = -e.contact_normal;
+      find_contacts_sphere_sphere(cgA, cgB, iA, iB, pool);
+      return;
     }
   }
 
-  // transform contact point and normal to global frame
-  e.contact_point = Pose3d::transform_point(GLOBAL, e.contact_point);
-  e.contact_normal = Pose3d::transform_vector(GLOBAL, e.contact_normal);
+  // indicate, as of yet, no contacts have been added
+  bool added = false;
 
-  return e;
+  // get the vertices from A and B
+  get_vertices(iA, cgA, _vA);
+  get_vertices(iB, cgB, _vB);
+
+  // examine all points from A against B  
+  for (unsigned i=0; i< _vA.size(); i++)
+  {
+    // see whether the point is inside the primitive
+    if (calc_dist_and_normal(iB, cgB, _vA[i], n) <= 0.0)
+    {
+      pool.add(cgA, cgB, _vA[i], n); 
+      added = true;
+    }
+  }
+
+  // examine all points from B against A
+  for (unsigned i=0; i< _vB.size(); i++)
+  {
+    // see whether the point is inside the primitive
+    if (calc_dist_and_normal(iA, cgA, _vB[i], n) <= 0.0)
+    {
+      pool.add(cgA, cgB, _vB[i], -n); 
+      added = true;
+    }
+  }
+
+  // if no contacts have been found, use the separated distance function
+  if (!added)
+  {
+    // examine all points from A against B  
+    for (unsigned i=0; i< _vA.size(); i++)
+    {
+      // get the distance from the point to the primitive 
+      double dist = calc_dist_and_normal(iB, cgB, _vA[i], n);
+
+      // see whether the distance is comparable to the minimum distance
+      if (dist <= NEAR_ZERO)
+        pool.add(cgA, cgB, _vA[i], n); 
+    }    
+
+    // examine all points from B against A
+    for (unsigned i=0; i< _vB.size(); i++)
+    {
+      // get the distance from the point to the primitive 
+      double dist = calc_dist_and_normal(iA, cgA, _vB[i], n);
+
+      // see whether the distance is comparable to the minimum distance
+      if (dist <= NEAR_ZERO)
+        pool.add(cgA, cgB, _vB[i], -n); 
+    }    
+  }
+}
+
+/// Finds contacts for two spheres (one piece of code works for both separated and non-separated spheres)
+void CCD::find_contacts_sphere_sphere(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, unsigned iA, unsigned iB, ContactPool& pool)
+{
+  // get the two spheres
+  shared_ptr<SpherePrimitive> sA = dynamic_pointer_cast<SpherePrimitive>(cgA->get_geometry());
+  shared_ptr<SpherePrimitive> sB = dynamic_pointer_cast<SpherePrimitive>(cgB->get_geometry());
+
+  // get the two sphere centers in the global frame
+  Point3d cA0 = _poses.get_geom_origin(iA);
+  Point3d cB0 = _poses.get_geom_origin(iB);
+  
+  // get the closest points on the two spheres
+  Vector3d d = cA0 - cB0;
+  Vector3d n = Vector3d::normalize(d);
+  Point3d closest_A = cA0 - n*sA->get_radius();
+  Point3d closest_B = cB0 + n*sB->get_radius();
+
+  // create the contact point halfway between the closest points
+  Point3d p = (closest_A + closest_B)*0.5;
+
+  // create the normal pointing from B to A
+  pool.add(cgA, cgB, p, n); 
+}
+
+/// Finds contacts between a heightfield and another geometry
+/**
+ * Spheres are tested using their centers, boxes using their corners (and the
+ * heightfield samples that lie within the box), and all other primitives
+ * using their vertices. Points within NEAR_ZERO of the terrain yield contacts.
+ */
+void CCD::find_contacts_heightfield(CollisionGeometryPtr cgA, CollisionGeometryPtr cgB, unsigned iA, unsigned iB, ContactPool& pool)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+  Vector3d n;
+
+  // determine which geometry is the heightfield; the terrain normal points
+  // from B to A only when the heightfield is B
+  shared_ptr<HeightfieldPrimitive> hf = dynamic_pointer_cast<HeightfieldPrimitive>(cgB->get_geometry());
+  CollisionGeometryPtr cg_hf = cgB, cg = cgA;
+  unsigned i_hf = iB, i_cg = iA;
+  double nsign = 1.0;
+  if (!hf)
+  {
+    hf = dynamic_pointer_cast<HeightfieldPrimitive>(cgA->get_geometry());
+    cg_hf = cgA;
+    cg = cgB;
+    i_hf = iA;
+    i_cg = iB;
+    nsign = -1.0;
+  }
+  PrimitivePtr p = cg->get_geometry();
+
+  // setup the scratch poses from the cached primitive poses
+  _poses.get_geom_pose(i_hf, *_PA);
+  _poses.get_geom_pose(i_cg, *_PB);
+
+  // get the transform from the other primitive to the heightfield
+  Transform3d T = Pose3d::calc_relative_pose(_PB, _PA);
+
+  // look for a sphere 
+  shared_ptr<SpherePrimitive> sph = dynamic_pointer_cast<SpherePrimitive>(p);
+  if (sph)
+  {
+    // get the sphere center in the heightfield frame
+    Point3d c = T.transform_point(Point3d(0.0, 0.0, 0.0, _PB));
+    c.pose = hf->get_pose();
+    double dist = hf->calc_dist_and_normal(c, n) - sph->get_radius();
+    if (dist <= NEAR_ZERO)
+    {
+      // contact point is on the sphere surface toward the terrain 
+      c.pose = n.pose = _PA;
+      pool.add(cgA, cgB, c - n*sph->get_radius(), n*nsign);
+    }
+
+    return;
+  }
+
+  // look for a box
+  shared_ptr<BoxPrimitive> box = dynamic_pointer_cast<BoxPrimitive>(p);
+  if (box)
+  {
+    const double HX = box->get_x_len()*0.5, HY = box->get_y_len()*0.5, HZ = box->get_z_len()*0.5;
+    _verts.clear();
+    for (unsigned i=0; i< 8; i++)
+      _verts.push_back(Point3d((i & 1) ? HX : -HX, (i & 2) ? HY : -HY, (i & 4) ? HZ : -HZ, _PB));
+  }
+  else
+  {
+    // use the vertices of the primitive
+    p->get_vertices(_verts);
+    for (unsigned i=0; i< _verts.size(); i++)
+      _verts[i].pose = _PB;
+  }
+
+  // examine the points against the heightfield, tracking their x/y extents
+  double xmin = std::numeric_limits<double>::max(), xmax = -xmin;
+  double ymin = xmin, ymax = -xmin;
+  for (unsigned i=0; i< _verts.size(); i++)
+  {
+    Point3d v = T.transform_point(_verts[i]);
+    v.pose = hf->get_pose();
+    xmin = std::min(xmin, v[X]);  xmax = std::max(xmax, v[X]);
+    ymin = std::min(ymin, v[Y]);  ymax = std::max(ymax, v[Y]);
+    if (hf->calc_dist_and_normal(v, n) <= NEAR_ZERO)
+    {
+      v.pose = n.pose = _PA;
+      pool.add(cgA, cgB, v, n*nsign);
+    }
+  }
+
+  // look for terrain samples that poke into the box
+  if (box && hf->get_rows() > 1 && hf->get_cols() > 1)
+  {
+    // get the range of samples beneath the box
+    const double DX = hf->get_dx(), DY = hf->get_dy();
+    const double X0 = -0.5*(hf->get_cols()-1)*DX, Y0 = -0.5*(hf->get_rows()-1)*DY;
+    const int J0 = std::max(0, (int) std::ceil((xmin - X0)/DX));
+    const int J1 = std::min((int) hf->get_cols()-1, (int) std::floor((xmax - X0)/DX));
+    const int I0 = std::max(0, (int) std::ceil((ymin - Y0)/DY));
+    const int I1 = std::min((int) hf->get_rows()-1, (int) std::floor((ymax - Y0)/DY));
+
+    // check each sample against the box
+    for (int i=I0; i<= I1; i++)
+      for (int j=J0; j<= J1; j++)
+      {
+        double dhdx, dhdy;
+        const double H = hf->calc_height(X0 + j*DX, Y0 + i*DY, dhdx, dhdy);
+        Point3d s(X0 + j*DX, Y0 + i*DY, H, _PA);
+        Point3d sbox = T.inverse_transform_point(s);
+        sbox.pose = box->get_pose();
+        if (box->calc_signed_dist(sbox) <= NEAR_ZERO)
+        {
+          n = Vector3d::normalize(Vector3d(-dhdx, -dhdy, 1.0, _PA));
+          pool.add(cgA, cgB, s, n*nsign);
+        }
+      }
+  }
 }
 
 /****************************************************************************
@@ -275,8 +862,9 @@ void CCD::broad_phase(double dt, const vector<DynamicBodyPtr>& bodies, vector<pa
 {
   FILE_LOG(LOG_COLDET) << "CCD::broad_phase() entered" << std::endl;
 
-  // clear the swept BVs
-  _swept_BVs.clear();
+  // invalidate the swept BVs (keeping their storage)
+  for (map<CollisionGeometryPtr, SweptBV>::iterator i = _swept_BVs.begin(); i != _swept_BVs.end(); i++)
+    i->second.bv.reset();
 
   // get the set of rigid bodies
   vector<RigidBodyPtr> rbs;
@@ -295,8 +883,10 @@ void CCD::broad_phase(double dt, const vector<DynamicBodyPtr>& bodies, vector<pa
     count += rbs[i]->geometries.size();
   if (count != _bounding_spheres.size())
   {
-    // clear the map of bounding spheres
+    // clear the map of bounding spheres, swept BVs, and the support data
     _bounding_spheres.clear();
+    _swept_BVs.clear();
+    _support.clear();
 
     // indicate the bounding vectors need to be rebuilt
     _rebuild_bounds_vecs = true;
@@ -304,9 +894,6 @@ void CCD::broad_phase(double dt, const vector<DynamicBodyPtr>& bodies, vector<pa
     for (unsigned j=0; j< rbs.size(); j++)
     BOOST_FOREACH(CollisionGeometryPtr i, rbs[j]->geometries)
     {
-      // get farthest distance on each geometry while we're at it 
-      _rmax[i] = i->get_farthest_point_distance();
-
       // get the primitive for the geometry
       PrimitivePtr p = i->get_geometry();
 
@@ -411,8 +998,16 @@ void CCD::broad_phase(double dt, const vector<DynamicBodyPtr>& bodies, vector<pa
     if (rb1 == rb2)
       continue;
 
-    // if both rigid bodies are disabled, don't check
-    if (!rb1->is_enabled() && !rb2->is_enabled())
+    // if neither rigid body can move (disabled or asleep), don't check; a
+    // kinematically updated body moves, so its contacts must be found
+    if ((!rb1->is_enabled() || rb1->is_sleeping()) && 
+        (!rb2->is_enabled() || rb2->is_sleeping()))
+      continue;
+
+    // if one geometry lies entirely above fixed terrain, don't check
+    if (!rb1->is_enabled() && is_above_heightfield(i->first.first, i->first.second, dt))
+      continue;
+    if (!rb2->is_enabled() && is_above_heightfield(i->first.second, i->first.first, dt))
       continue;
 
     // if we're here, we have a candidate for the narrow phase
@@ -420,46 +1015,112 @@ void CCD::broad_phase(double dt, const vector<DynamicBodyPtr>& bodies, vector<pa
     FILE_LOG(LOG_COLDET) << "  ... checking pair" << std::endl;
   }
   
+  BINARY_LOG(LOG_COLDET)("broad-phase", overlaps.size(), to_check.size());
   FILE_LOG(LOG_COLDET) << "CCD::broad_phase() exited" << std::endl;
 }
 
-/// Gets the swept BV, creating it if necessary
-BVPtr CCD::get_swept_BV(CollisionGeometryPtr cg, BVPtr bv, double dt)
+/// Gets the swept BV (and its bounds), computing it if necessary
+/**
+ * The BV of a dynamic body is swept by its current velocity and then
+ * expanded by its velocity limit estimates. The velocity of a kinematically
+ * updated body is prescribed by its controller, so its BV is swept
+ * analytically by that velocity alone. The swept BV is computed once per
+ * geometry per call to broad_phase(); the swept sphere of a moving body is
+ * written into storage kept from previous calls.
+ */
+const CCD::SweptBV& CCD::get_swept_BV(CollisionGeometryPtr cg, BVPtr bv, double dt)
 {
   const unsigned X = 0, Y = 1, Z = 2;
 
-  // verify that the map for the geometry has already been setup
-  map<CollisionGeometryPtr, BVPtr>::iterator vi;
-  vi = _swept_BVs.find(cg);
-  if (vi != _swept_BVs.end())
-    return vi->second;
+  // see whether the swept BV has already been computed
+  SweptBV& s = _swept_BVs[cg];
+  if (s.bv)
+    return s;
 
   // get the rigid body
   RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(cg->get_single_body());
 
-  // get the current velocity and the velocity limits
+  // move the bounding sphere to the current origin of the primitive (the
+  // center is stored in the global frame)
+  shared_ptr<BoundingSphere> sph = dynamic_pointer_cast<BoundingSphere>(bv);
+  if (sph)
+    sph->center = _poses.get_geom_origin(_poses.get_geom_index(cg));
+
+  // compute the swept BV; a moving bounding sphere sweeps out a SSL
   const SVelocityd& v = rb->get_velocity();
-  Vector3d v_lo = rb->get_vel_lower_bounds().get_linear();
-  Vector3d v_hi = rb->get_vel_upper_bounds().get_linear();
- 
-  // compute the swept BV
-  BVPtr swept_bv = bv->calc_swept_BV(cg, v*dt);
-  FILE_LOG(LOG_BV) << "new BV: " << swept_bv << std::endl;
+  if (sph && rb->is_enabled())
+  {
+    if (!s.ssl)
+      s.ssl = shared_ptr<SSL>(new SSL);
+    SVelocityd vx = Pose3d::transform(sph->get_relative_pose(), v);
+    s.ssl->p1 = sph->center;
+    s.ssl->p2 = sph->center + vx.get_linear()*dt;
+    s.ssl->radius = sph->radius;
+    s.bv = s.ssl;
+  }
+  else
+    s.bv = bv->calc_swept_BV(cg, v*dt);
+  FILE_LOG(LOG_BV) << "new BV: " << s.bv << std::endl;
 
-  // attempt to get the swept BV as a SSL
-  shared_ptr<SSL> ssl = dynamic_pointer_cast<SSL>(swept_bv);
-  if (ssl)
+  // the motion of a kinematic body is known exactly; it needs no expansion
+  shared_ptr<SSL> ssl = dynamic_pointer_cast<SSL>(s.bv);
+  if (ssl && !rb->get_super_body()->get_kinematic())
   {
+    // get the velocity limits
+    Vector3d v_lo = rb->get_vel_lower_bounds().get_linear();
+    Vector3d v_hi = rb->get_vel_upper_bounds().get_linear();
+
     // update the radius
     ssl->radius += dt*std::max(std::fabs(v_lo[X]), std::fabs(v_hi[X]));
     ssl->radius += dt*std::max(std::fabs(v_lo[Y]), std::fabs(v_hi[Y]));
     ssl->radius += dt*std::max(std::fabs(v_lo[Z]), std::fabs(v_hi[Z]));
   }
 
-  // store the bounding volume
-  _swept_BVs[cg] = swept_bv; 
+  // store the bounds of the swept BV
+  s.lo = s.bv->get_lower_bounds();
+  s.hi = s.bv->get_upper_bounds();
+
+  return s;
+}
+
+/// Determines whether the swept BV of a geometry lies entirely above a heightfield
+/**
+ * \param cg_hf the geometry for the heightfield (its body must not move)
+ * \param cg the geometry to check
+ * \return <b>true</b> if cg_hf is a heightfield and the swept BV of cg cannot
+ *         reach it; <b>false</b> otherwise
+ */
+bool CCD::is_above_heightfield(CollisionGeometryPtr cg_hf, CollisionGeometryPtr cg, double dt)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // see whether the first geometry is a heightfield
+  shared_ptr<HeightfieldPrimitive> hf = dynamic_pointer_cast<HeightfieldPrimitive>(cg_hf->get_geometry());
+  if (!hf)
+    return false;
+
+  // get the bounds of the swept BV for the other geometry
+  const SweptBV& swept = get_swept_BV(cg, _bounding_spheres.find(cg)->second, dt);
+  const Point3d& lo = swept.lo;
+  const Point3d& hi = swept.hi;
+
+  // transform the corners of the AABB to the heightfield frame 
+  const unsigned I_HF = _poses.get_geom_index(cg_hf);
+  double xmin = std::numeric_limits<double>::max(), xmax = -xmin;
+  double ymin = xmin, ymax = -xmin, zmin = xmin;
+  for (unsigned i=0; i< 8; i++)
+  {
+    Point3d c((i & 1) ? hi[X] : lo[X], (i & 2) ? hi[Y] : lo[Y], (i & 4) ? hi[Z] : lo[Z], GLOBAL);
+    c = _poses.transform_point_from_global(I_HF, c);
+    xmin = std::min(xmin, c[X]);  xmax = std::max(xmax, c[X]);
+    ymin = std::min(ymin, c[Y]);  ymax = std::max(ymax, c[Y]);
+    zmin = std::min(zmin, c[Z]);
+  }
 
-  return swept_bv;
+  // compare against the maximum height of the terrain beneath the AABB
+  double hmin, hmax;
+  hf->calc_height_bounds(xmin, ymin, xmax, ymax, hmin, hmax);
+  return zmin > hmax + NEAR_ZERO;
 }
 
 void CCD::sort_AABBs(const vector<RigidBodyPtr>& rigid_bodies, double dt)
@@ -509,12 +1170,16 @@ void CCD::update_bounds_vector(vector<pair<double, BoundsStruct> >& bounds, Axis
     BVPtr bv = bounds[i].second.bv;
     CollisionGeometryPtr geom = bounds[i].second.geom;
 
+    // bounds of sleeping geometries do not change (unless just rebuilt)
+    if (!_rebuild_bounds_vecs && geom->get_single_body()->is_sleeping())
+      continue;
+
     // get the swept bounding volume (should be defined in global frame)
-    BVPtr swept_bv = get_swept_BV(geom, bv, dt);
-    assert(swept_bv->get_relative_pose() == GLOBAL);
+    const SweptBV& swept = get_swept_BV(geom, bv, dt);
+    assert(swept.bv->get_relative_pose() == GLOBAL);
 
     // get the bound for the bounding volume
-    Point3d bound = (bounds[i].second.end) ? swept_bv->get_upper_bounds() : swept_bv->get_lower_bounds();
+    const Point3d& bound = (bounds[i].second.end) ? swept.hi : swept.lo;
     FILE_LOG(LOG_COLDET) << "  updating collision geometry: " << geom << "  rigid body: " << geom->get_single_body()->id << std::endl;
 
     // update the bounds for the given axis
@@ -580,6 +1245,8 @@ void CCD::build_bv_vector(const vector<RigidBodyPtr>& rigid_bodies, vector<pair<
 /// Constructs a bounding sphere for a given primitive type
 BVPtr CCD::construct_bounding_sphere(CollisionGeometryPtr cg)
 {
+  const unsigned X = 0, Y = 1, Z = 2;
+
   // create the bounding sphere
   shared_ptr<BoundingSphere> sph(new BoundingSphere);
 
@@ -611,6 +1278,16 @@ BVPtr CCD::construct_bounding_sphere(CollisionGeometryPtr cg)
     return sph;
   }
 
+  // look for heightfield primitive (bound the corners of its extents)
+  shared_ptr<HeightfieldPrimitive> hf_p = dynamic_pointer_cast<HeightfieldPrimitive>(p);
+  if (hf_p)
+  {
+    Point3d lo, hi;
+    hf_p->get_bounds(lo, hi);
+    sph->radius = std::max(Origin3d(hi[X], hi[Y], lo[Z]).norm(), Origin3d(hi[X], hi[Y], hi[Z]).norm());
+    return sph;
+  }
+
   // shouldn't still be here..
   assert(false);
   return BVPtr();
@@ -878,8 +878,9 @@ void CSG::save_to_xml(XMLTreePtr node, std::list<shared_ptr<const Base> >& share
     // do not save the array to the OBJ file if it already exists (which we
     // crudely check for using std::ifstream to avoid OS-specific calls -- note
     // that it is possible that opening a file may fails for other reasons than
-    // the file does not exist)
-    std::ifstream in(filename.c_str());
+    // the file does not exist); the file is placed relative to the document
+    std::string path = node->get_path(filename);
+    std::ifstream in(path.c_str());
     if (in.fail())
     {
       // transform the mesh to the CSG frame
@@ -888,7 +889,7 @@ void CSG::save_to_xml(XMLTreePtr node, std::list<shared_ptr<const Base> >& share
       IndexedTriArray mesh_xform = _mesh->transform(T);
 
       // write the mesh
-      mesh_xform.write_to_obj(filename);
+      mesh_xform.write_to_obj(path);
     }
     else
       in.close();
@@ -25,6 +25,7 @@ using namespace Moby;
 CollisionGeometry::CollisionGeometry()
 {
   _F = shared_ptr<Pose3d>(new Pose3d);
+  _vertex_pose = shared_ptr<Pose3d>(new Pose3d);
 }
 
 /// Gets a supporting point for this geometry in a particular direction
@@ -119,8 +120,9 @@ void CollisionGeometry::get_vertices(std::vector<Point3d>& vertices) const
   PrimitivePtr primitive = get_geometry();
   assert(!primitive->get_pose()->rpose);
 
-  // setup a new pose 
-  shared_ptr<Pose3d> P(new Pose3d(*primitive->get_pose()));
+  // setup the scratch pose (vertices are transformed out of it below)
+  shared_ptr<Pose3d> P = _vertex_pose;
+  *P = *primitive->get_pose();
   P->rpose = get_pose();
 
   // get the vertices from the primitive
@@ -10,6 +10,8 @@
 #include <iterator>
 #include <cmath>
 #include <set>
+#include <map>
+#include <algorithm>
 #include <stack>
 #include <fstream>
 #include <Ravelin/Origin2d.h>
@@ -2864,3 +2866,286 @@ void CompGeom::clip_convex_polygon_against_line(const Vector2d& rkN, double fC,
     ri = 0;
 }
 
+/// Helper function for calc_convex_hull_3D(): computes the dot product of two vectors
+static double calc_dot(const Origin3d& a, const Origin3d& b)
+{
+  return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+/// Helper function for calc_convex_hull_3D(): computes the cross product of (b-a) and (c-a)
+static Origin3d calc_tri_cross(const Origin3d& a, const Origin3d& b, const Origin3d& c)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+  const Origin3d U = b - a, V = c - a;
+  return Origin3d(U[Y]*V[Z] - U[Z]*V[Y], U[Z]*V[X] - U[X]*V[Z], U[X]*V[Y] - U[Y]*V[X]);
+}
+
+/// Helper structure for calc_convex_hull_3D(): a facet of the hull under construction
+struct HullFacet
+{
+  unsigned v[3];                 // vertex indices (ccw when viewed from outside)
+  Origin3d normal;               // unit outward normal
+  double offset;                 // plane offset (normal . x = offset)
+  bool alive;                    // false if the facet has been removed
+  std::vector<unsigned> outside; // points above the facet not yet processed
+};
+
+/// Helper function for calc_convex_hull_3D(): creates a facet
+static HullFacet make_hull_facet(const std::vector<Origin3d>& pts, unsigned a, unsigned b, unsigned c)
+{
+  HullFacet f;
+  f.v[0] = a;
+  f.v[1] = b;
+  f.v[2] = c;
+  f.normal = calc_tri_cross(pts[a], pts[b], pts[c]);
+  double nrm = f.normal.norm();
+  if (nrm > 0.0)
+    f.normal /= nrm;
+  f.offset = calc_dot(f.normal, pts[a]);
+  f.alive = true;
+  return f;
+}
+
+/// Computes the 3D convex hull of a set of points without using qhull
+/**
+ * Uses incremental construction with conflict lists; no global or static
+ * state is used, so this may be called concurrently from multiple threads.
+ * \return the convex hull or a null pointer if the points do not span three
+ *         dimensions
+ */
+PolyhedronPtr CompGeom::calc_convex_hull_3D(const std::vector<Point3d>& points)
+{
+  const unsigned X = 0;
+  const unsigned N = points.size();
+
+  // need at least four points
+  if (N < 4)
+    return PolyhedronPtr();
+
+  // copy the points and determine a scale-dependent tolerance
+  std::vector<Origin3d> pts(N);
+  double scale = 1.0;
+  for (unsigned i=0; i< N; i++)
+  {
+    pts[i] = Origin3d(points[i]);
+    for (unsigned k=0; k< 3; k++)
+      scale = std::max(scale, std::fabs(pts[i][k]));
+  }
+  const double TOL = NEAR_ZERO * scale;
+
+  // find the initial simplex: extreme point along x, farthest point from it,
+  // farthest point from that line, farthest point from that plane 
+  unsigned i0 = 0, i1 = 0, i2 = 0, i3 = 0;
+  for (unsigned i=1; i< N; i++)
+    if (pts[i][X] < pts[i0][X])
+      i0 = i;
+  double max_dist = 0.0;
+  for (unsigned i=0; i< N; i++)
+  {
+    double dist = (pts[i] - pts[i0]).norm();
+    if (dist > max_dist)
+    {
+      max_dist = dist;
+      i1 = i;
+    }
+  }
+  if (max_dist <= TOL)
+    return PolyhedronPtr();
+  max_dist = 0.0;
+  for (unsigned i=0; i< N; i++)
+  {
+    double dist = calc_tri_cross(pts[i0], pts[i1], pts[i]).norm();
+    if (dist > max_dist)
+    {
+      max_dist = dist;
+      i2 = i;
+    }
+  }
+  if (max_dist <= TOL * (pts[i1] - pts[i0]).norm())
+    return PolyhedronPtr();
+  HullFacet base = make_hull_facet(pts, i0, i1, i2);
+  max_dist = 0.0;
+  for (unsigned i=0; i< N; i++)
+  {
+    double dist = std::fabs(calc_dot(base.normal, pts[i]) - base.offset);
+    if (dist > max_dist)
+    {
+      max_dist = dist;
+      i3 = i;
+    }
+  }
+  if (max_dist <= TOL)
+    return PolyhedronPtr();
+
+  // orient the simplex so that the fourth point lies behind the base
+  if (calc_dot(base.normal, pts[i3]) - base.offset > 0.0)
+    std::swap(i1, i2);
+  std::vector<HullFacet> facets;
+  facets.push_back(make_hull_facet(pts, i0, i1, i2));
+  facets.push_back(make_hull_facet(pts, i0, i3, i1));
+  facets.push_back(make_hull_facet(pts, i1, i3, i2));
+  facets.push_back(make_hull_facet(pts, i2, i3, i0));
+
+  // assign every other point to the first facet that it lies above
+  for (unsigned i=0; i< N; i++)
+  {
+    if (i == i0 || i == i1 || i == i2 || i == i3)
+      continue;
+    for (unsigned j=0; j< facets.size(); j++)
+      if (calc_dot(facets[j].normal, pts[i]) - facets[j].offset > TOL)
+      {
+        facets[j].outside.push_back(i);
+        break;
+      }
+  }
+
+  // process facets with outside points until there are none
+  std::vector<unsigned> visible, orphans;
+  std::set<std::pair<unsigned, unsigned> > edges;
+  for (unsigned f=0; f< facets.size(); f++)
+  {
+    if (!facets[f].alive || facets[f].outside.empty())
+      continue;
+
+    // get the farthest outside point of the facet
+    unsigned eye = facets[f].outside.front();
+    double eye_dist = -1.0;
+    for (unsigned j=0; j< facets[f].outside.size(); j++)
+    {
+      unsigned k = facets[f].outside[j];
+      double dist = calc_dot(facets[f].normal, pts[k]) - facets[f].offset;
+      if (dist > eye_dist)
+      {
+        eye_dist = dist;
+        eye = k;
+      }
+    }
+
+    // find all facets visible from the point and their directed edges
+    visible.clear();
+    edges.clear();
+    for (unsigned j=0; j< facets.size(); j++)
+      if (facets[j].alive && calc_dot(facets[j].normal, pts[eye]) - facets[j].offset > TOL)
+      {
+        visible.push_back(j);
+        for (unsigned k=0; k< 3; k++)
+          edges.insert(std::make_pair(facets[j].v[k], facets[j].v[(k+1) % 3]));
+      }
+
+    // remove the visible facets, keeping their outside points
+    orphans.clear();
+    for (unsigned j=0; j< visible.size(); j++)
+    {
+      HullFacet& vf = facets[visible[j]];
+      vf.alive = false;
+      for (unsigned k=0; k< vf.outside.size(); k++)
+        if (vf.outside[k] != eye)
+          orphans.push_back(vf.outside[k]);
+      std::vector<unsigned>().swap(vf.outside);
+    }
+
+    // create new facets from the horizon edges (edges whose twin is not
+    // visible) to the point
+    const unsigned FIRST_NEW = facets.size();
+    for (std::set<std::pair<unsigned, unsigned> >::const_iterator e = edges.begin(); e != edges.end(); e++)
+      if (edges.find(std::make_pair(e->second, e->first)) == edges.end())
+        facets.push_back(make_hull_facet(pts, e->first, e->second, eye));
+
+    // reassign the orphaned points to the new facets
+    for (unsigned j=0; j< orphans.size(); j++)
+      for (unsigned k=FIRST_NEW; k< facets.size(); k++)
+        if (calc_dot(facets[k].normal, pts[orphans[j]]) - facets[k].offset > TOL)
+        {
+          facets[k].outside.push_back(orphans[j]);
+          break;
+        }
+  }
+
+  // collect the vertices and facets of the hull
+  std::map<unsigned, unsigned> vmap;
+  std::vector<Origin3d> hull_verts;
+  std::vector<IndexedTri> hull_facets;
+  for (unsigned f=0; f< facets.size(); f++)
+  {
+    if (!facets[f].alive)
+      continue;
+    unsigned idx[3];
+    for (unsigned k=0; k< 3; k++)
+    {
+      std::map<unsigned, unsigned>::const_iterator vi = vmap.find(facets[f].v[k]);
+      if (vi == vmap.end())
+      {
+        idx[k] = hull_verts.size();
+        vmap[facets[f].v[k]] = idx[k];
+        hull_verts.push_back(pts[facets[f].v[k]]);
+      }
+      else
+        idx[k] = vi->second;
+    }
+    hull_facets.push_back(IndexedTri(idx[0], idx[1], idx[2]));
+  }
+
+  return PolyhedronPtr(new Polyhedron(hull_verts.begin(), hull_verts.end(), hull_facets.begin(), hull_facets.end()));
+}
+
+/// Helper function for calc_convex_hull_2D(): lexicographic ordering of points
+static bool lex_less_2D(const Point2d& a, const Point2d& b)
+{
+  const unsigned X = 0, Y = 1;
+  return (a[X] < b[X]) || (a[X] == b[X] && a[Y] < b[Y]);
+}
+
+/// Helper function for calc_convex_hull_2D(): twice the signed area of triangle (o, a, b)
+static double cross_2D(const Point2d& o, const Point2d& a, const Point2d& b)
+{
+  const unsigned X = 0, Y = 1;
+  return (a[X] - o[X])*(b[Y] - o[Y]) - (a[Y] - o[Y])*(b[X] - o[X]);
+}
+
+/// Computes the 2D convex hull of a set of points without using qhull
+/**
+ * Uses Andrew's monotone chain algorithm; no global or static state is used,
+ * so this may be called concurrently from multiple threads.
+ * \param points the input points
+ * \param hull on return, the vertices of the hull in counter-clockwise order
+ *        (empty if the points are collinear or fewer than three)
+ */
+void CompGeom::calc_convex_hull_2D(const std::vector<Point2d>& points, std::vector<Point2d>& hull)
+{
+  hull.clear();
+  if (points.size() < 3)
+    return;
+
+  // sort the points lexicographically
+  std::vector<Point2d> pts(points);
+  std::sort(pts.begin(), pts.end(), lex_less_2D);
+
+  // determine a scale-dependent tolerance
+  double scale = 1.0;
+  for (unsigned i=0; i< pts.size(); i++)
+    scale = std::max(scale, std::max(std::fabs(pts[i][0]), std::fabs(pts[i][1])));
+  const double TOL = NEAR_ZERO * scale * scale;
+
+  // build the lower and upper chains
+  std::vector<Point2d> H(pts.size()*2);
+  unsigned k = 0;
+  for (unsigned i=0; i< pts.size(); i++)
+  {
+    while (k >= 2 && cross_2D(H[k-2], H[k-1], pts[i]) <= TOL)
+      k--;
+    H[k++] = pts[i];
+  }
+  for (unsigned i=pts.size()-1, t=k+1; i> 0; i--)
+  {
+    while (k >= t && cross_2D(H[k-2], H[k-1], pts[i-1]) <= TOL)
+      k--;
+    H[k++] = pts[i-1];
+  }
+
+  // the last point is the first point; fewer than three vertices indicates
+  // degeneracy
+  if (k < 4)
+    return;
+  hull.assign(H.begin(), H.begin()+k-1);
+}
+
@@ -632,7 +632,7 @@ static double sgn(double x) { return x / std::fabs(x); }
 /*
 bool ConePrimitive::point_inside(CollisionGeometryPtr geom, const Point3d& p, Vector3d& normal) const
 {
-  static shared_ptr<Pose3d> P;
+  SAFESTATIC shared_ptr<Pose3d> P;
 
   // get the pose for the collision geometry
   shared_ptr<const Pose3d> gpose = geom->get_pose(); 
@@ -789,7 +789,7 @@ Vector3d ConePrimitive::determine_normal(boost::shared_ptr<const Ravelin::Pose3d
 bool ConePrimitive::intersect_seg(BVPtr bv, const LineSeg3& seg, double& t, Point3d& isect, Vector3d& normal) const
 {
   const unsigned Y = 1;
-  static shared_ptr<Pose3d> P;
+  SAFESTATIC shared_ptr<Pose3d> P;
 
   // get the pose for the collision geometry
   shared_ptr<const Pose3d> gpose = bv->geom->get_pose(); 
@@ -0,0 +1,133 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cassert>
+#include <map>
+#include <algorithm>
+#include <Moby/ContactBlockMatrix.h>
+
+using std::map;
+using std::pair;
+using std::make_pair;
+using std::vector;
+using namespace Ravelin;
+using namespace Moby;
+
+/// Sets the sparsity structure of the matrix and zeros all blocks
+/**
+ * \param n the number of contacts
+ * \param groups each group holds the indices of the contacts incident to one
+ *        body; every pair of contacts within a group is coupled (every
+ *        contact is always coupled to itself)
+ */
+void ContactBlockMatrix::set_structure(unsigned n, const vector<vector<unsigned> >& groups)
+{
+  // determine the columns of each row
+  vector<vector<unsigned> > rows(n);
+  for (unsigned i=0; i< n; i++)
+    rows[i].push_back(i);
+  for (unsigned g=0; g< groups.size(); g++)
+    for (unsigned a=0; a< groups[g].size(); a++)
+      for (unsigned b=0; b< groups[g].size(); b++)
+        if (groups[g][a] != groups[g][b])
+          rows[groups[g][a]].push_back(groups[g][b]);
+
+  // sort the columns and remove duplicates (contacts may share two bodies)
+  _n = n;
+  _row_begin.resize(n+1);
+  _cols.clear();
+  for (unsigned i=0; i< n; i++)
+  {
+    std::sort(rows[i].begin(), rows[i].end());
+    rows[i].erase(std::unique(rows[i].begin(), rows[i].end()), rows[i].end());
+    _row_begin[i] = _cols.size();
+    _cols.insert(_cols.end(), rows[i].begin(), rows[i].end());
+  }
+  _row_begin[n] = _cols.size();
+
+  // zero the blocks
+  _blocks.resize(_cols.size()*BLOCK);
+  set_zero();
+}
+
+/// Zeros all blocks (the structure is kept)
+void ContactBlockMatrix::set_zero()
+{
+  std::fill(_blocks.begin(), _blocks.end(), 0.0);
+}
+
+/// Gets block (i,j) or NULL if contacts i and j are not coupled
+double* ContactBlockMatrix::get_block(unsigned i, unsigned j)
+{
+  vector<unsigned>::iterator begin = _cols.begin() + _row_begin[i];
+  vector<unsigned>::iterator end = _cols.begin() + _row_begin[i+1];
+  vector<unsigned>::iterator k = std::lower_bound(begin, end, j);
+  return (k == end || *k != j) ? NULL : &_blocks[(k - _cols.begin())*BLOCK];
+}
+
+/// Gets block (i,j) or NULL if contacts i and j are not coupled
+const double* ContactBlockMatrix::get_block(unsigned i, unsigned j) const
+{
+  vector<unsigned>::const_iterator begin = _cols.begin() + _row_begin[i];
+  vector<unsigned>::const_iterator end = _cols.begin() + _row_begin[i+1];
+  vector<unsigned>::const_iterator k = std::lower_bound(begin, end, j);
+  return (k == end || *k != j) ? NULL : &_blocks[(k - _cols.begin())*BLOCK];
+}
+
+/// Multiplies this matrix by a stacked vector [normal; first tangent; second tangent]
+VectorNd& ContactBlockMatrix::mult(const VectorNd& x, VectorNd& y) const
+{
+  const unsigned N = 0, S = 1, T = 2;
+  assert(x.size() == _n*3);
+
+  y.set_zero(_n*3);
+  for (unsigned i=0; i< _n; i++)
+  {
+    double yn = 0.0, ys = 0.0, yt = 0.0;
+    for (unsigned k=_row_begin[i]; k< _row_begin[i+1]; k++)
+    {
+      const double* K = &_blocks[k*BLOCK];
+      const unsigned j = _cols[k];
+      const double xn = x[j], xs = x[j+_n], xt = x[j+_n*2];
+      yn += K[N*3+N]*xn + K[N*3+S]*xs + K[N*3+T]*xt;
+      ys += K[S*3+N]*xn + K[S*3+S]*xs + K[S*3+T]*xt;
+      yt += K[T*3+N]*xn + K[T*3+S]*xs + K[T*3+T]*xt;
+    }
+    y[i] = yn;
+    y[i+_n] = ys;
+    y[i+_n*2] = yt;
+  }
+
+  return y;
+}
+
+/// Gets one direction/direction submatrix (e.g., Cn*inv(M)*Cs' for r = 0, c = 1) as a sparse matrix
+SparseMatrixNd& ContactBlockMatrix::to_sparse(unsigned r, unsigned c, SparseMatrixNd& M) const
+{
+  assert(r < 3 && c < 3);
+
+  map<pair<unsigned, unsigned>, double> values;
+  for (unsigned i=0; i< _n; i++)
+    for (unsigned k=_row_begin[i]; k< _row_begin[i+1]; k++)
+      values[make_pair(i, _cols[k])] = _blocks[k*BLOCK + r*3 + c];
+
+  M = SparseMatrixNd(SparseMatrixNd::eCSR, _n, _n, values);
+  return M;
+}
+
+/// Gets one direction/direction submatrix (e.g., Cn*inv(M)*Cs' for r = 0, c = 1) as a dense matrix
+MatrixNd& ContactBlockMatrix::to_dense(unsigned r, unsigned c, MatrixNd& M) const
+{
+  assert(r < 3 && c < 3);
+
+  M.set_zero(_n, _n);
+  for (unsigned i=0; i< _n; i++)
+    for (unsigned k=_row_begin[i]; k< _row_begin[i+1]; k++)
+      M(i, _cols[k]) = _blocks[k*BLOCK + r*3 + c];
+
+  return M;
+}
+
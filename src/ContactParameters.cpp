@@ -38,7 +38,8 @@ ContactParameters::ContactParameters(BasePtr o1, BasePtr o2)
 /// Implements Base::load_from_xml()
 /**
  * This method does not read the Base information (i.e., name()), because
- * a name for this object is unnecessary.
+ * a name for this object is unnecessary. If neither object ID is given, the
+ * parameters apply to any pair of objects without more specific parameters.
  */
 void ContactParameters::load_from_xml(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
 {
@@ -47,48 +48,53 @@ void ContactParameters::load_from_xml(shared_ptr<const XMLTree> node, std::map<s
   // verify that the node name is correct
   assert(strcasecmp(node->name.c_str(), "ContactParameters") == 0);
 
-  // verify that there are object IDs
+  // verify that there are either both object IDs or neither (the latter
+  // gives default parameters)
   XMLAttrib* o1_attr = node->get_attrib("object1-id");
   XMLAttrib* o2_attr = node->get_attrib("object2-id");
-  if (!o1_attr || !o2_attr)
+  if ((o1_attr && !o2_attr) || (!o1_attr && o2_attr))
   {
-    std::cerr << "ContactParameters::load_from_xml() - no object1-id and/or ";
-    std::cerr << "object2-id attributes!" << std::endl;
+    std::cerr << "ContactParameters::load_from_xml() - only one of object1-id ";
+    std::cerr << "and object2-id attributes given!" << std::endl;
     std::cerr << "  in offending node: " << std::endl << *node;
     return;
   }
 
-  // get the ids
-  const std::string& ID1 = o1_attr->get_string_value();
-  const std::string& ID2 = o2_attr->get_string_value();
-
-  // verify that the object corresponding to the first ID is found
-  if ((id_iter = id_map.find(ID1)) == id_map.end())
+  // read the objects, if given
+  if (o1_attr)
   {
-    std::cerr << "ContactParameters::load_from_xml() - unable to find object w/ID '";
-    std::cerr << ID1 << "'" << std::endl << "  in offending node: ";
-    std::cerr << std::endl << *node;
-    return;
-  }
-
-  // get the object
-  BasePtr o1 = id_iter->second;
-
-  // verify that the object corresponding to the second ID is found
-  if ((id_iter = id_map.find(ID2)) == id_map.end())
-  {
-    std::cerr << "ContactParameters::load_from_xml() - unable to find object w/ID '";
-    std::cerr << ID2 << "'" << std::endl << "  in offending node: ";
-    std::cerr << std::endl << *node;
-    return;
+    // get the ids
+    const std::string& ID1 = o1_attr->get_string_value();
+    const std::string& ID2 = o2_attr->get_string_value();
+
+    // verify that the object corresponding to the first ID is found
+    if ((id_iter = id_map.find(ID1)) == id_map.end())
+    {
+      std::cerr << "ContactParameters::load_from_xml() - unable to find object w/ID '";
+      std::cerr << ID1 << "'" << std::endl << "  in offending node: ";
+      std::cerr << std::endl << *node;
+      return;
+    }
+
+    // get the object
+    BasePtr o1 = id_iter->second;
+
+    // verify that the object corresponding to the second ID is found
+    if ((id_iter = id_map.find(ID2)) == id_map.end())
+    {
+      std::cerr << "ContactParameters::load_from_xml() - unable to find object w/ID '";
+      std::cerr << ID2 << "'" << std::endl << "  in offending node: ";
+      std::cerr << std::endl << *node;
+      return;
+    }
+
+    // get the object
+    BasePtr o2 = id_iter->second;
+
+    // form the sorted pair
+    objects = make_sorted_pair(o1, o2);
   }
 
-  // get the object
-  BasePtr o2 = id_iter->second;
-
-  // form the sorted pair
-  objects = make_sorted_pair(o1, o2);
-
   // get the value for epsilon, if specified
   XMLAttrib* rest_attr = node->get_attrib("epsilon");
   if (rest_attr)
@@ -124,13 +130,13 @@ void ContactParameters::save_to_xml(XMLTreePtr node, std::list<shared_ptr<const
   // set the node name
   node->name = "ContactParameters";
 
-  // if the object IDs are blank, skip this node..
-  if (!objects.first || !objects.second)
-    return;
-
-  // write the two object IDs
-  node->attribs.insert(XMLAttrib("object1-id", objects.first->id));
-  node->attribs.insert(XMLAttrib("object2-id", objects.second->id));
+  // write the two object IDs (if the object IDs are blank, these are
+  // default parameters)
+  if (objects.first && objects.second)
+  {
+    node->attribs.insert(XMLAttrib("object1-id", objects.first->id));
+    node->attribs.insert(XMLAttrib("object2-id", objects.second->id));
+  }
 
   // write the coefficient of epsilon 
   node->attribs.insert(XMLAttrib("epsilon", epsilon));
@@ -0,0 +1,143 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include <Moby/SingleBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/ContactParameters.h>
+#include <Moby/ContactPool.h>
+
+using std::map;
+using namespace Ravelin;
+using namespace Moby;
+
+/// Adds a contact record given the bare-minimum info
+/**
+ * \param a the first collision geometry
+ * \param b the second collision geometry
+ * \param point the contact point (in any frame)
+ * \param normal the contact normal, pointing toward a (in any frame)
+ */
+void ContactPool::add(CollisionGeometryPtr a, CollisionGeometryPtr b, const Point3d& point, const Vector3d& normal)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // check for valid normal here
+  assert(std::fabs(normal.norm() - (double) 1.0) < NEAR_ZERO);
+
+  // transform contact point and normal to global frame
+  Point3d p = Pose3d::transform_point(GLOBAL, point);
+  Vector3d n = Pose3d::transform_vector(GLOBAL, normal);
+
+  // make the body first that comes first alphabetically
+  if (LOGGING(LOG_COLDET))
+  {
+    SingleBodyPtr sb1 = a->get_single_body();
+    SingleBodyPtr sb2 = b->get_single_body();
+    if (sb2->id < sb1->id)
+    {
+      std::swap(a, b);
+      n = -n;
+    }
+  }
+
+  // setup the record
+  _records.push_back(ContactRecord());
+  ContactRecord& r = _records.back();
+  r.geom1 = get_geometry_index(a);
+  r.geom2 = get_geometry_index(b);
+  r.body1 = get_body_index(a->get_single_body()->get_super_body());
+  r.body2 = get_body_index(b->get_single_body()->get_super_body());
+  r.point[X] = p[X];  r.point[Y] = p[Y];  r.point[Z] = p[Z];
+  r.normal[X] = n[X];  r.normal[Y] = n[Y];  r.normal[Z] = n[Z];
+  r.mu_coulomb = (double) 0.0;
+  r.mu_viscous = (double) 0.0;
+  r.epsilon = (double) 0.0;
+  r.NK = 0;
+}
+
+/// Sets the contact parameters for all records from the given one onward
+void ContactPool::set_contact_parameters(unsigned first, const ContactParameters& cparams)
+{
+  for (unsigned i=first; i< _records.size(); i++)
+  {
+    _records[i].mu_coulomb = cparams.mu_coulomb;
+    _records[i].mu_viscous = cparams.mu_viscous;
+    _records[i].epsilon = cparams.epsilon;
+    _records[i].NK = cparams.NK;
+  }
+}
+
+/// Gets the index of a collision geometry, assigning one if necessary
+unsigned ContactPool::get_geometry_index(CollisionGeometryPtr cg)
+{
+  map<CollisionGeometry*, unsigned>::const_iterator i = _geom_index.find(cg.get());
+  if (i != _geom_index.end())
+    return i->second;
+
+  // assign the next index
+  const unsigned idx = _geoms.size();
+  _geoms.push_back(cg);
+  _geom_index[cg.get()] = idx;
+  return idx;
+}
+
+/// Gets the index of a super body, assigning one if necessary
+unsigned ContactPool::get_body_index(DynamicBodyPtr db)
+{
+  map<DynamicBody*, unsigned>::const_iterator i = _body_index.find(db.get());
+  if (i != _body_index.end())
+    return i->second;
+
+  // assign the next index
+  const unsigned idx = _bodies.size();
+  _bodies.push_back(db);
+  _body_index[db.get()] = idx;
+  return idx;
+}
+
+/// Sets up an event as a view of the i'th record
+void ContactPool::get_event(unsigned i, Event& e) const
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+  const ContactRecord& r = _records[i];
+
+  // reset the event
+  e = Event();
+
+  // setup the contact data
+  e.event_type = Event::eContact;
+  e.contact_geom1 = _geoms[r.geom1];
+  e.contact_geom2 = _geoms[r.geom2];
+  e.contact_point = Point3d(r.point[X], r.point[Y], r.point[Z], GLOBAL);
+  e.contact_normal = Vector3d(r.normal[X], r.normal[Y], r.normal[Z], GLOBAL);
+  if (r.NK > 0)
+  {
+    e.contact_mu_coulomb = r.mu_coulomb;
+    e.contact_mu_viscous = r.mu_viscous;
+    e.contact_epsilon = r.epsilon;
+    e.contact_NK = r.NK;
+    e.contact_parameters_set = true;
+  }
+}
+
+/// Removes all records and forgets all geometry and body indices
+/**
+ * This should be called whenever bodies are added to or removed from the
+ * simulator, so that the pool does not keep removed geometries alive.
+ */
+void ContactPool::reset()
+{
+  _records.clear();
+  _geoms.clear();
+  _bodies.clear();
+  _geom_index.clear();
+  _body_index.clear();
+}
+
@@ -671,7 +671,7 @@ bool CylinderPrimitive::point_inside(CollisionGeometryPtr geom, const Point3d& p
   const unsigned X = 0, Y = 1, Z = 2;
   const double R = _radius;
   const double halfheight = _height*0.5;
-  static shared_ptr<Pose3d> P;
+  SAFESTATIC shared_ptr<Pose3d> P;
 
   // get the pose for the collision geometry
   shared_ptr<const Pose3d> gpose = geom->get_pose(); 
@@ -1072,7 +1072,7 @@ bool CylinderPrimitive::intersect_seg(BVPtr bv, const LineSeg3& seg, double& t,
   const unsigned Y = 1;
   const double R = _radius;
   const double halfheight = _height*0.5;
-  static shared_ptr<Pose3d> P;
+  SAFESTATIC shared_ptr<Pose3d> P;
 
   FILE_LOG(LOG_COLDET) << "CylinderPrimitive::intersect_seg() entered" << std::endl;
   FILE_LOG(LOG_COLDET) << "  cylinder radius: " << R << "  half height: " << halfheight << std::endl;
@@ -0,0 +1,372 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <sys/time.h>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <Moby/XMLTree.h>
+#include <Moby/XMLReader.h>
+#include <Moby/Simulator.h>
+#include <Moby/DynamicBody.h>
+#include <Moby/EnsembleRunner.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using std::vector;
+using std::string;
+using std::map;
+
+/// Gets the current (wall-clock) time in seconds
+static double get_current_time()
+{
+  const double MICROSEC = 1.0/1000000;
+  timeval t;
+  gettimeofday(&t, NULL);
+  return (double) t.tv_sec + (double) t.tv_usec * MICROSEC;
+}
+
+/// Compares two bodies by ID
+static bool compbody(DynamicBodyPtr b1, DynamicBodyPtr b2)
+{
+  return b1->id < b2->id;
+}
+
+/// Creates an empty ensemble 
+EnsembleRunner::EnsembleRunner()
+{
+  _num_threads = 1;
+}
+
+/// Sets an attribute override for an instance
+/**
+ * Overrides are applied to the parsed XML (before any object is 
+ * constructed) by the next call to load().
+ * \param instance the index of the instance
+ * \param id the value of the "id" attribute of the node to modify
+ * \param attrib the name of the attribute to set 
+ * \param value the value of the attribute
+ */
+void EnsembleRunner::set_override(unsigned instance, const string& id, const string& attrib, const string& value)
+{
+  Override o;
+  o.id = id;
+  o.attrib = attrib;
+  o.value = value;
+  _overrides[instance].push_back(o);
+}
+
+/// Loads a number of instances of the world described in an XML file
+/**
+ * \param fname the XML file
+ * \param num_instances the number of instances
+ * \param fn if non-NULL, a function called with the objects of each
+ *        instance after they are constructed (e.g., to set parameters that
+ *        have no XML attribute)
+ * \param data data passed to fn
+ */
+void EnsembleRunner::load(const string& fname, unsigned num_instances, OverrideFn fn, void* data)
+{
+  // parse the file (once)
+  LoadArgs args;
+  args.tree = XMLReader::read_tree(fname);
+  if (!args.tree)
+    throw std::runtime_error("EnsembleRunner::load() - unable to read " + fname);
+  args.fn = fn;
+  args.data = data;
+
+  // construct the instances
+  _instances.clear();
+  _instances.resize(num_instances);
+  for_each_instance(&load_instance, &args);
+
+  // verify that all instances were constructed
+  for (unsigned i=0; i< _instances.size(); i++)
+    if (!_instances[i].error.empty())
+      throw std::runtime_error("EnsembleRunner::load() - " + _instances[i].error);
+}
+
+/// Constructs one instance
+void EnsembleRunner::load_instance(EnsembleRunner* runner, unsigned i, void* arg)
+{
+  const LoadArgs& args = *(const LoadArgs*) arg;
+  Instance& inst = runner->_instances[i];
+
+  // copy the tree and apply the overrides
+  XMLTreePtr tree = args.tree->clone();
+  map<unsigned, std::list<Override> >::const_iterator j = runner->_overrides.find(i);
+  if (j != runner->_overrides.end())
+    BOOST_FOREACH(const Override& o, j->second)
+      apply_override(tree, o);
+
+  // construct the objects
+  inst.id_map = XMLReader::construct(tree);
+  if (args.fn)
+    (*args.fn)(i, inst.id_map, args.data);
+
+  // get the (first) simulator
+  for (map<string, BasePtr>::const_iterator k = inst.id_map.begin(); k != inst.id_map.end(); k++)
+    if ((inst.sim = dynamic_pointer_cast<Simulator>(k->second)))
+      break;
+  if (!inst.sim)
+  {
+    inst.error = "no simulator found";
+    return;
+  }
+
+  // setup the columns
+  inst.step_time = 0.0;
+  setup_columns(inst);
+}
+
+/// Steps all instances 
+/**
+ * \param step_size the step size
+ * \param num_steps the number of steps to take
+ * \param record_interval the state of each instance is recorded every 
+ *        record_interval steps (and after the last step); zero disables
+ *        recording
+ * \note an instance that throws an exception is stopped (see get_error())
+ */
+void EnsembleRunner::run(double step_size, unsigned num_steps, unsigned record_interval)
+{
+  RunArgs args;
+  args.step_size = step_size;
+  args.num_steps = num_steps;
+  args.record_interval = record_interval;
+  for_each_instance(&run_instance, &args);
+}
+
+/// Steps one instance
+void EnsembleRunner::run_instance(EnsembleRunner* runner, unsigned i, void* arg)
+{
+  const RunArgs& args = *(const RunArgs*) arg;
+  Instance& inst = runner->_instances[i];
+
+  // don't step failed instances
+  if (!inst.error.empty())
+    return;
+
+  // record the initial state, if nothing has been recorded yet
+  if (args.record_interval > 0 && inst.columns.front().empty())
+    record(inst);
+
+  for (unsigned j=1; j<= args.num_steps; j++)
+  {
+    // step the simulator, timing the step
+    const double START = get_current_time();
+    inst.sim->step(args.step_size);
+    inst.step_time = get_current_time() - START;
+
+    // record the state
+    if (args.record_interval > 0 && (j % args.record_interval == 0 || j == args.num_steps))
+      record(inst);
+  }
+}
+
+/// Removes all recorded data
+void EnsembleRunner::clear_records()
+{
+  for (unsigned i=0; i< _instances.size(); i++)
+    for (unsigned j=0; j< _instances[i].columns.size(); j++)
+      _instances[i].columns[j].clear();
+}
+
+/// Sets up the columns recorded for an instance
+void EnsembleRunner::setup_columns(Instance& inst)
+{
+  // get the bodies in order of ID
+  inst.bodies = inst.sim->get_dynamic_bodies();
+  std::sort(inst.bodies.begin(), inst.bodies.end(), compbody);
+
+  // setup the names
+  inst.column_names.clear();
+  inst.column_names.push_back("time");
+  inst.column_names.push_back("step-time");
+  BOOST_FOREACH(DynamicBodyPtr db, inst.bodies)
+  {
+    const unsigned NGC = db->num_generalized_coordinates(DynamicBody::eEuler);
+    for (unsigned j=0; j< NGC; j++)
+    {
+      std::ostringstream oss;
+      oss << db->id << ".q" << j;
+      inst.column_names.push_back(oss.str());
+    }
+    const unsigned NGV = db->num_generalized_coordinates(DynamicBody::eSpatial);
+    for (unsigned j=0; j< NGV; j++)
+    {
+      std::ostringstream oss;
+      oss << db->id << ".qd" << j;
+      inst.column_names.push_back(oss.str());
+    }
+  }
+
+  // setup the columns
+  inst.columns.clear();
+  inst.columns.resize(inst.column_names.size());
+}
+
+/// Records the state of an instance
+void EnsembleRunner::record(Instance& inst)
+{
+  unsigned col = 0;
+  inst.columns[col++].push_back(inst.sim->current_time);
+  inst.columns[col++].push_back(inst.step_time);
+  BOOST_FOREACH(DynamicBodyPtr db, inst.bodies)
+  {
+    db->get_generalized_coordinates(DynamicBody::eEuler, inst.work);
+    for (unsigned j=0; j< inst.work.size(); j++)
+      inst.columns[col++].push_back(inst.work[j]);
+    db->get_generalized_velocity(DynamicBody::eSpatial, inst.work);
+    for (unsigned j=0; j< inst.work.size(); j++)
+      inst.columns[col++].push_back(inst.work[j]);
+  }
+  assert(col == inst.columns.size());
+}
+
+/// Writes the recorded data of all instances to a binary file
+/**
+ * The file holds the magic string "MOBYENS" (with terminating null), the
+ * number of instances (32-bit unsigned) and then, for each instance, the
+ * number of columns and rows (32-bit unsigned each), the column names (each
+ * a 32-bit unsigned length followed by the characters), and the columns 
+ * (native doubles, one column after another).
+ */
+void EnsembleRunner::write(const string& fname) const
+{
+  const char MAGIC[8] = "MOBYENS";
+
+  // open the file
+  FILE* fp = fopen(fname.c_str(), "wb");
+  if (!fp)
+    throw std::runtime_error("EnsembleRunner::write() - unable to open " + fname);
+
+  // write the header
+  fwrite(MAGIC, 1, sizeof(MAGIC), fp);
+  unsigned n = _instances.size();
+  fwrite(&n, sizeof(unsigned), 1, fp);
+
+  // write each instance
+  for (unsigned i=0; i< _instances.size(); i++)
+  {
+    const Instance& inst = _instances[i];
+    unsigned ncols = inst.columns.size();
+    unsigned nrows = (ncols > 0) ? inst.columns.front().size() : 0;
+    fwrite(&ncols, sizeof(unsigned), 1, fp);
+    fwrite(&nrows, sizeof(unsigned), 1, fp);
+    for (unsigned j=0; j< ncols; j++)
+    {
+      unsigned len = inst.column_names[j].size();
+      fwrite(&len, sizeof(unsigned), 1, fp);
+      fwrite(inst.column_names[j].data(), 1, len, fp);
+    }
+    for (unsigned j=0; j< ncols; j++)
+      if (nrows > 0)
+        fwrite(&inst.columns[j][0], sizeof(double), nrows, fp);
+  }
+
+  // verify that everything was written
+  bool failed = ferror(fp);
+  if (fclose(fp) != 0 || failed)
+    throw std::runtime_error("EnsembleRunner::write() - unable to write " + fname);
+}
+
+/// Applies a function to every instance, using a pool of threads if possible
+void EnsembleRunner::for_each_instance(void (*fn)(EnsembleRunner*, unsigned, void*), void* arg)
+{
+  // setup the job
+  Job job;
+  job.runner = this;
+  job.fn = fn;
+  job.arg = arg;
+  job.next = 0;
+
+  #ifdef THREADSAFE
+  // start the threads; each takes instances from the job until none remain
+  pthread_mutex_init(&job.mutex, NULL);
+  const unsigned NTHREADS = std::min(_num_threads, (unsigned) _instances.size());
+  vector<pthread_t> threads(NTHREADS);
+  for (unsigned i=0; i< NTHREADS; i++)
+    pthread_create(&threads[i], NULL, &worker, &job);
+  for (unsigned i=0; i< NTHREADS; i++)
+    pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&job.mutex);
+  #else
+  worker(&job);
+  #endif
+}
+
+/// Processes instances of a job until none remain
+void* EnsembleRunner::worker(void* arg)
+{
+  Job& job = *(Job*) arg;
+  vector<Instance>& instances = job.runner->_instances;
+
+  while (true)
+  {
+    // get the next instance
+    #ifdef THREADSAFE
+    pthread_mutex_lock(&job.mutex);
+    #endif
+    unsigned i = job.next++;
+    #ifdef THREADSAFE
+    pthread_mutex_unlock(&job.mutex);
+    #endif
+    if (i >= instances.size())
+      break;
+
+    // process it; errors only stop this instance
+    try
+    {
+      (*job.fn)(job.runner, i, job.arg);
+    }
+    catch (std::exception& e)
+    {
+      instances[i].error = e.what();
+    }
+  }
+
+  return NULL;
+}
+
+/// Applies an override to every node of a tree with the override's ID 
+void EnsembleRunner::apply_override(XMLTreePtr root, const Override& o)
+{
+  bool found = false;
+
+  // process the tree
+  std::queue<XMLTreePtr> q;
+  q.push(root);
+  while (!q.empty())
+  {
+    // get the node off the front of the queue
+    XMLTreePtr node = q.front();
+    q.pop();
+
+    // see whether the node matches
+    XMLAttrib* id_attr = node->get_attrib("id");
+    if (id_attr && id_attr->value == o.id)
+    {
+      node->attribs.erase(XMLAttrib(o.attrib, ""));
+      node->attribs.insert(XMLAttrib(o.attrib, o.value));
+      found = true;
+    }
+
+    // add all children to the queue
+    BOOST_FOREACH(XMLTreePtr child, node->children)
+      q.push(child);
+  }
+
+  if (!found)
+    throw std::runtime_error("EnsembleRunner - no node with ID '" + o.id + "' for override");
+}
+
@@ -42,15 +42,9 @@ using std::endl;
 using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
 
-// static declarations
-MatrixNd Event::J1, Event::J2, Event::workM1, Event::workM2;
-MatrixNd Event::JJ, Event::J, Event::Jx, Event::Jy, Event::dJ1, Event::dJ2;
-VectorNd Event::v, Event::workv, Event::workv2; 
-
 /// Creates an empty event 
 Event::Event()
 {
-  _event_frame = shared_ptr<Pose3d>(new Pose3d);
   tol = NEAR_ZERO;              // default collision tolerance
   stick_tol = NEAR_ZERO;
   event_type = eNone;
@@ -68,6 +62,7 @@ Event::Event()
   contact_mu_viscous = (double) 0.0;
   contact_epsilon = (double) 0.0;
   contact_NK = 4;
+  contact_parameters_set = false;
   _ftype = eUndetermined;
   deriv_type = eVel;
 }
@@ -82,9 +77,9 @@ Event& Event::operator=(const Event& e)
   limit_impulse = e.limit_impulse;
   limit_joint = e.limit_joint;
   contact_normal = e.contact_normal;
-  contact_normal_dot = e.contact_normal;
-  contact_tan1_dot = e.contact_tan1;
-  contact_tan2_dot = e.contact_tan2;
+  contact_normal_dot = e.contact_normal_dot;
+  contact_tan1_dot = e.contact_tan1_dot;
+  contact_tan2_dot = e.contact_tan2_dot;
   contact_geom1 = e.contact_geom1;
   contact_geom2 = e.contact_geom2;
   contact_point = e.contact_point;
@@ -93,6 +88,7 @@ Event& Event::operator=(const Event& e)
   contact_mu_viscous = e.contact_mu_viscous;
   contact_epsilon = e.contact_epsilon;
   contact_NK = e.contact_NK;
+  contact_parameters_set = e.contact_parameters_set;
   contact_tan1 = e.contact_tan1;
   contact_tan2 = e.contact_tan2;
   constraint_nimpulse = e.constraint_nimpulse;
@@ -128,6 +124,10 @@ void Event::compute_cross_event_data(const Event& e, MatrixNd& M) const
 /// Computes the acceleration event data
 void Event::compute_aevent_data(MatrixNd& M, VectorNd& q) const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+  SAFESTATIC MatrixNd JJ, J1, J2, dJ1, dJ2, workM1, workM2;
+  SAFESTATIC VectorNd v, workv;
+
   assert(event_type == eContact);
 
   // setup useful indices
@@ -155,16 +155,16 @@ void Event::compute_aevent_data(MatrixNd& M, VectorNd& q) const
   assert(_ftype != eUndetermined);
 
   // setup the contact frame
-  _event_frame->q.set_identity();
-  _event_frame->x = contact_point;
+  event_frame->q.set_identity();
+  event_frame->x = contact_point;
 
   // case 1: sticking friction
   if (_ftype == eSticking)
   {
     // get the directions in the event frame
-    Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
-    Vector3d tan1 = Pose3d::transform_vector(_event_frame, contact_tan1);
-    Vector3d tan2 = Pose3d::transform_vector(_event_frame, contact_tan2);
+    Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
+    Vector3d tan1 = Pose3d::transform_vector(event_frame, contact_tan1);
+    Vector3d tan2 = Pose3d::transform_vector(event_frame, contact_tan2);
 
     // setup a matrix of contact directions
     Matrix3d R;
@@ -177,10 +177,10 @@ void Event::compute_aevent_data(MatrixNd& M, VectorNd& q) const
     J2.resize(THREE_D, NGC2);
 
     // compute the Jacobians for the two bodies
-    su1->calc_jacobian(_event_frame, sb1, JJ);
+    su1->calc_jacobian(event_frame, sb1, JJ);
     SharedConstMatrixNd Jlin1 = JJ.block(0, THREE_D, 0, JJ.columns());
     R.transpose_mult(Jlin1, J1);
-    su2->calc_jacobian(_event_frame, sb2, JJ);
+    su2->calc_jacobian(event_frame, sb2, JJ);
     SharedConstMatrixNd Jlin2 = JJ.block(0, THREE_D, 0, JJ.columns());
     (-R).transpose_mult(Jlin2, J2);
 
@@ -205,8 +205,8 @@ void Event::compute_aevent_data(MatrixNd& M, VectorNd& q) const
   else
   {
     // get the normal and sliding directions in the event frame
-    Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
-    Vector3d tan1 = Pose3d::transform_vector(_event_frame, contact_tan1);
+    Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
+    Vector3d tan1 = Pose3d::transform_vector(event_frame, contact_tan1);
 
     // resize the Jacobians 
     J1.resize(1,NGC1);
@@ -221,11 +221,11 @@ void Event::compute_aevent_data(MatrixNd& M, VectorNd& q) const
     SharedVectorNd J2s = dJ2.row(0);
 
     // compute the Jacobians for the two bodies
-    su1->calc_jacobian(_event_frame, sb1, JJ);
+    su1->calc_jacobian(event_frame, sb1, JJ);
     SharedConstMatrixNd Jlin1 = JJ.block(0, THREE_D, 0, JJ.columns());
     Jlin1.transpose_mult(normal, J1n);
     Jlin1.transpose_mult(tan1, J1s);
-    su2->calc_jacobian(_event_frame, sb2, JJ);
+    su2->calc_jacobian(event_frame, sb2, JJ);
     SharedConstMatrixNd Jlin2 = JJ.block(0, THREE_D, 0, JJ.columns());
     Jlin2.transpose_mult(-normal, J2n);
     Jlin2.transpose_mult(-tan1, J2s);
@@ -260,6 +260,10 @@ void Event::compute_aevent_data(MatrixNd& M, VectorNd& q) const
 /// Computes the contact vector data (\dot{N}v and Na)
 void Event::compute_dotv_data(VectorNd& q) const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+  SAFESTATIC MatrixNd JJ, J1, J2, dJ1, dJ2;
+  SAFESTATIC VectorNd v, workv;
+
   assert(event_type == eContact);
 
   // setup useful indices
@@ -283,21 +287,21 @@ void Event::compute_dotv_data(VectorNd& q) const
   assert(contact_tan2_dot.pose == GLOBAL);
 
   // setup the contact frame
-  _event_frame->q.set_identity();
-  _event_frame->x = contact_point;
+  event_frame->q.set_identity();
+  event_frame->x = contact_point;
 
   // case 1: sticking friction
   if (_ftype == eSticking)
   {
     // get the directions in the event frame
-    Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
-    Vector3d tan1 = Pose3d::transform_vector(_event_frame, contact_tan1);
-    Vector3d tan2 = Pose3d::transform_vector(_event_frame, contact_tan2);
+    Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
+    Vector3d tan1 = Pose3d::transform_vector(event_frame, contact_tan1);
+    Vector3d tan2 = Pose3d::transform_vector(event_frame, contact_tan2);
 
     // get the directional derivatives in the event frame 
-    Vector3d dnormal = Pose3d::transform_vector(_event_frame, contact_normal_dot);
-    Vector3d dtan1 = Pose3d::transform_vector(_event_frame, contact_tan1_dot);
-    Vector3d dtan2 = Pose3d::transform_vector(_event_frame, contact_tan2_dot);
+    Vector3d dnormal = Pose3d::transform_vector(event_frame, contact_normal_dot);
+    Vector3d dtan1 = Pose3d::transform_vector(event_frame, contact_tan1_dot);
+    Vector3d dtan2 = Pose3d::transform_vector(event_frame, contact_tan2_dot);
 
     // setup a matrices of contact directions and directional derivatives
     Matrix3d R, dR;
@@ -315,18 +319,18 @@ void Event::compute_dotv_data(VectorNd& q) const
     dJ2.resize(THREE_D, NGC2);
 
     // compute the Jacobians for the two bodies
-    su1->calc_jacobian(_event_frame, sb1, JJ);
+    su1->calc_jacobian(event_frame, sb1, JJ);
     SharedConstMatrixNd Jlin1 = JJ.block(0, THREE_D, 0, JJ.columns());
     dR.transpose_mult(Jlin1, J1);
-    su2->calc_jacobian(_event_frame, sb2, JJ);
+    su2->calc_jacobian(event_frame, sb2, JJ);
     SharedConstMatrixNd Jlin2 = JJ.block(0, THREE_D, 0, JJ.columns());
     (-dR).transpose_mult(Jlin2, J2);
 
     // compute the time-derivatives of the Jacobians for the two bodies
-    su1->calc_jacobian_dot(_event_frame, sb1, JJ);
+    su1->calc_jacobian_dot(event_frame, sb1, JJ);
     SharedConstMatrixNd dJlin1 = JJ.block(0, THREE_D, 0, JJ.columns());
     R.transpose_mult(dJlin1, dJ1); 
-    su2->calc_jacobian_dot(_event_frame, sb2, JJ);
+    su2->calc_jacobian_dot(event_frame, sb2, JJ);
     SharedConstMatrixNd dJlin2 = JJ.block(0, THREE_D, 0, JJ.columns());
     (-R).transpose_mult(dJlin2, dJ2);
 
@@ -351,8 +355,8 @@ void Event::compute_dotv_data(VectorNd& q) const
   else
   {
     // get the normal and its time derivative in the event frame
-    Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
-    Vector3d dnormal = Pose3d::transform_vector(_event_frame, contact_normal_dot);
+    Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
+    Vector3d dnormal = Pose3d::transform_vector(event_frame, contact_normal_dot);
 
     // resize the Jacobians 
     J1.resize(1, NGC1);
@@ -367,18 +371,18 @@ void Event::compute_dotv_data(VectorNd& q) const
     SharedVectorNd dJ2n = dJ2.row(N); 
 
     // compute the Jacobians for the two bodies
-    su1->calc_jacobian(_event_frame, sb1, JJ);
+    su1->calc_jacobian(event_frame, sb1, JJ);
     SharedConstMatrixNd Jlin1 = JJ.block(0, THREE_D, 0, JJ.columns());
     Jlin1.transpose_mult(dnormal, J1n);
-    su2->calc_jacobian(_event_frame, sb2, JJ);
+    su2->calc_jacobian(event_frame, sb2, JJ);
     SharedConstMatrixNd Jlin2 = JJ.block(0, THREE_D, 0, JJ.columns());
     Jlin2.transpose_mult(-dnormal, J2n);
 
     // compute the time-derivatives of the Jacobians for the two bodies
-    su1->calc_jacobian_dot(_event_frame, sb1, JJ);
+    su1->calc_jacobian_dot(event_frame, sb1, JJ);
     SharedConstMatrixNd dJlin1 = JJ.block(0, THREE_D, 0, JJ.columns());
     dJlin1.transpose_mult(normal, dJ1n);
-    su2->calc_jacobian_dot(_event_frame, sb2, JJ);
+    su2->calc_jacobian_dot(event_frame, sb2, JJ);
     SharedConstMatrixNd dJlin2 = JJ.block(0, THREE_D, 0, JJ.columns());
     dJlin2.transpose_mult(-normal, dJ2n);
 
@@ -405,6 +409,10 @@ void Event::compute_dotv_data(VectorNd& q) const
 /// Computes the event data
 void Event::compute_vevent_data(MatrixNd& M, VectorNd& q) const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+  SAFESTATIC MatrixNd JJ, J1, J2, Jx, workM1, workM2;
+  SAFESTATIC VectorNd v, workv;
+
   if (event_type == eContact)
   {
     // setup useful indices
@@ -425,8 +433,8 @@ void Event::compute_vevent_data(MatrixNd& M, VectorNd& q) const
     assert(contact_tan2.pose == GLOBAL);
 
     // setup the contact frame
-    _event_frame->q.set_identity();
-    _event_frame->x = contact_point;
+    event_frame->q.set_identity();
+    event_frame->x = contact_point;
 
     // get the numbers of generalized coordinates for the two super bodies
     const unsigned NGC1 = su1->num_generalized_coordinates(DynamicBody::eSpatial);
@@ -437,9 +445,9 @@ void Event::compute_vevent_data(MatrixNd& M, VectorNd& q) const
     J2.set_zero(THREE_D, NGC2);
 
     // get the directions in the event frame
-    Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
-    Vector3d tan1 = Pose3d::transform_vector(_event_frame, contact_tan1);
-    Vector3d tan2 = Pose3d::transform_vector(_event_frame, contact_tan2);
+    Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
+    Vector3d tan1 = Pose3d::transform_vector(event_frame, contact_tan1);
+    Vector3d tan2 = Pose3d::transform_vector(event_frame, contact_tan2);
 
     // setup a matrix of contact directions
     Matrix3d R;
@@ -448,10 +456,10 @@ void Event::compute_vevent_data(MatrixNd& M, VectorNd& q) const
     R.set_column(T, tan2);
 
     // compute the Jacobians for the two bodies
-    su1->calc_jacobian(_event_frame, sb1, JJ);
+    su1->calc_jacobian(event_frame, sb1, JJ);
     SharedConstMatrixNd Jlin1 = JJ.block(0, THREE_D, 0, JJ.columns());
     R.transpose_mult(Jlin1, J1);
-    su2->calc_jacobian(_event_frame, sb2, JJ);
+    su2->calc_jacobian(event_frame, sb2, JJ);
     SharedConstMatrixNd Jlin2 = JJ.block(0, THREE_D, 0, JJ.columns());
     (-R).transpose_mult(Jlin2, J2);
 
@@ -666,6 +674,9 @@ void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd&
 /// Computes cross contact data for one super body
 void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd& M, DynamicBodyPtr su) const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+  SAFESTATIC MatrixNd JJ, J;
+
   // setup useful indices
   const unsigned N = 0, S = 1, T = 2, THREE_D = 3;
 
@@ -684,13 +695,13 @@ void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd&
   J.resize(THREE_D, NGC);
 
   // setup the contact frame
-  _event_frame->q.set_identity();
-  _event_frame->x = contact_point;
+  event_frame->q.set_identity();
+  event_frame->x = contact_point;
 
   // get the directions in the event frame
-  Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
-  Vector3d tan1 = Pose3d::transform_vector(_event_frame, contact_tan1);
-  Vector3d tan2 = Pose3d::transform_vector(_event_frame, contact_tan2);
+  Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
+  Vector3d tan1 = Pose3d::transform_vector(event_frame, contact_tan1);
+  Vector3d tan2 = Pose3d::transform_vector(event_frame, contact_tan2);
 
   // setup a matrix of contact directions
   Matrix3d R;
@@ -701,14 +712,14 @@ void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd&
   // compute the Jacobians, checking to see whether necessary
   if (sua1 == su)
   {
-    su->calc_jacobian(_event_frame, sba1, JJ);
+    su->calc_jacobian(event_frame, sba1, JJ);
     SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
     R.transpose_mult(Jlin, J);
     compute_cross_contact_contact_vevent_data(e, M, su, J);
   }
   if (sua2 == su)
   {
-    su->calc_jacobian(_event_frame, sba2, JJ);
+    su->calc_jacobian(event_frame, sba2, JJ);
     SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
     (-R).transpose_mult(Jlin, J);
     compute_cross_contact_contact_vevent_data(e, M, su, J);
@@ -718,6 +729,9 @@ void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd&
 /// Computes cross contact data for one super body
 void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd& M, DynamicBodyPtr su, const MatrixNd& J) const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+  SAFESTATIC MatrixNd JJ, Jx, workM1, workM2;
+
   // setup useful indices
   const unsigned N = 0, S = 1, T = 2, THREE_D = 3;
 
@@ -736,13 +750,13 @@ void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd&
   Jx.resize(THREE_D, NGC);
 
   // setup the contact frame
-  _event_frame->q.set_identity();
-  _event_frame->x = e.contact_point;
+  event_frame->q.set_identity();
+  event_frame->x = e.contact_point;
 
   // get the directions in the event frame
-  Vector3d normal = Pose3d::transform_vector(_event_frame, e.contact_normal);
-  Vector3d tan1 = Pose3d::transform_vector(_event_frame, e.contact_tan1);
-  Vector3d tan2 = Pose3d::transform_vector(_event_frame, e.contact_tan2);
+  Vector3d normal = Pose3d::transform_vector(event_frame, e.contact_normal);
+  Vector3d tan1 = Pose3d::transform_vector(event_frame, e.contact_tan1);
+  Vector3d tan2 = Pose3d::transform_vector(event_frame, e.contact_tan2);
 
   // setup a matrix of contact directions
   Matrix3d R;
@@ -754,7 +768,7 @@ void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd&
   if (sub1 == su)
   {
     // first compute the Jacobian
-    su->calc_jacobian(_event_frame, sbb1, JJ);
+    su->calc_jacobian(event_frame, sbb1, JJ);
     SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
     R.transpose_mult(Jlin, Jx);
 
@@ -764,7 +778,7 @@ void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd&
   }
   if (sub2 == su)
   {
-    su->calc_jacobian(_event_frame, sbb2, JJ);
+    su->calc_jacobian(event_frame, sbb2, JJ);
     SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
     (-R).transpose_mult(Jlin, Jx);
 
@@ -777,6 +791,9 @@ void Event::compute_cross_contact_contact_vevent_data(const Event& e, MatrixNd&
 /// Updates contact/limit cross event data
 void Event::compute_cross_contact_limit_vevent_data(const Event& e, MatrixNd& M) const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+  SAFESTATIC MatrixNd JJ, J1, workM1;
+
   // setup useful indices
   const unsigned N = 0, S = 1, T = 2, THREE_D = 3;
 
@@ -797,14 +814,14 @@ void Event::compute_cross_contact_limit_vevent_data(const Event& e, MatrixNd& M)
   DynamicBodyPtr su2 = sb2->get_super_body();
 
   // setup the contact frame
-  _event_frame->q.set_identity();
-  _event_frame->x = contact_point;
-  _event_frame->rpose = GLOBAL;
+  event_frame->q.set_identity();
+  event_frame->x = contact_point;
+  event_frame->rpose = GLOBAL;
 
   // get the directions in the event frame
-  Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
-  Vector3d tan1 = Pose3d::transform_vector(_event_frame, contact_tan1);
-  Vector3d tan2 = Pose3d::transform_vector(_event_frame, contact_tan2);
+  Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
+  Vector3d tan1 = Pose3d::transform_vector(event_frame, contact_tan1);
+  Vector3d tan2 = Pose3d::transform_vector(event_frame, contact_tan2);
 
   // setup a matrix of contact directions
   Matrix3d R;
@@ -823,7 +840,7 @@ void Event::compute_cross_contact_limit_vevent_data(const Event& e, MatrixNd& M)
     J1.resize(THREE_D, NGC1);
 
     // compute the Jacobians for the two bodies
-    su1->calc_jacobian(_event_frame, sb1, JJ);
+    su1->calc_jacobian(event_frame, sb1, JJ);
     SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
     R.transpose_mult(Jlin, J1);
 
@@ -848,7 +865,7 @@ void Event::compute_cross_contact_limit_vevent_data(const Event& e, MatrixNd& M)
     J1.resize(THREE_D, NGC2);
 
     // compute the Jacobians for the two bodies
-    su2->calc_jacobian(_event_frame, sb2, JJ);
+    su2->calc_jacobian(event_frame, sb2, JJ);
     SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
     (-R).transpose_mult(Jlin, J1);
 
@@ -867,6 +884,8 @@ void Event::compute_cross_contact_limit_vevent_data(const Event& e, MatrixNd& M)
 /// Updates limit/contact cross event data
 void Event::compute_cross_limit_contact_vevent_data(const Event& e, MatrixNd& M) const
 {
+  SAFESTATIC MatrixNd workM2;
+
   // compute the cross event data
   e.compute_cross_contact_limit_vevent_data(*this, workM2);
 
@@ -877,6 +896,8 @@ void Event::compute_cross_limit_contact_vevent_data(const Event& e, MatrixNd& M)
 /// Updates limit/limit cross event data
 void Event::compute_cross_limit_limit_vevent_data(const Event& e, MatrixNd& M) const
 {
+  SAFESTATIC VectorNd workv, workv2;
+
   // get the super body
   ArticulatedBodyPtr ab = limit_joint->get_articulated_body();
   RCArticulatedBodyPtr su = dynamic_pointer_cast<RCArticulatedBody>(ab);
@@ -987,7 +1008,8 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
 /// Computes cross contact data for one super body
 void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd& M, DynamicBodyPtr su) const
 {
-  static MatrixNd J;
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+  SAFESTATIC MatrixNd JJ, J;
 
   // setup useful indices
   const unsigned N = 0, S = 1, T = 2, THREE_D = 3;
@@ -1013,13 +1035,13 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
     J.resize(THREE_D, NGC);
 
     // setup the contact frame
-    _event_frame->q.set_identity();
-    _event_frame->x = contact_point;
+    event_frame->q.set_identity();
+    event_frame->x = contact_point;
 
     // get the directions in the event frame
-    Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
-    Vector3d tan1 = Pose3d::transform_vector(_event_frame, contact_tan1);
-    Vector3d tan2 = Pose3d::transform_vector(_event_frame, contact_tan2);
+    Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
+    Vector3d tan1 = Pose3d::transform_vector(event_frame, contact_tan1);
+    Vector3d tan2 = Pose3d::transform_vector(event_frame, contact_tan2);
 
     // setup a matrix of contact directions
     Matrix3d R;
@@ -1030,14 +1052,14 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
     // compute the Jacobians, checking to see whether necessary
     if (sua1 == su)
     {
-      su->calc_jacobian(_event_frame, sba1, JJ);
+      su->calc_jacobian(event_frame, sba1, JJ);
       SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
       R.transpose_mult(Jlin, J);
       compute_cross_contact_contact_aevent_data(c, M, su, J);
     }
     if (sua2 == su)
     {
-      su->calc_jacobian(_event_frame, sba2, JJ);
+      su->calc_jacobian(event_frame, sba2, JJ);
       SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
       (-R).transpose_mult(Jlin, J);
       compute_cross_contact_contact_aevent_data(c, M, su, J);
@@ -1052,23 +1074,23 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
     SharedVectorNd Jn = J.row(N); 
 
     // setup the contact frame
-    _event_frame->q.set_identity();
-    _event_frame->x = contact_point;
+    event_frame->q.set_identity();
+    event_frame->x = contact_point;
 
     // get the normal in the event frame
-    Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
+    Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
 
     // compute the Jacobians, checking to see whether necessary
     if (sua1 == su)
     {
-      su->calc_jacobian(_event_frame, sba1, JJ);
+      su->calc_jacobian(event_frame, sba1, JJ);
       SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
       Jlin.transpose_mult(normal, Jn);
       compute_cross_contact_contact_aevent_data(c, M, su, J);
     }
     if (sua2 == su)
     {
-      su->calc_jacobian(_event_frame, sba2, JJ);
+      su->calc_jacobian(event_frame, sba2, JJ);
       SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
       Jlin.transpose_mult(-normal, Jn);
       compute_cross_contact_contact_aevent_data(c, M, su, J);
@@ -1079,6 +1101,9 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
 /// Computes cross contact data for one super body
 void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd& M, DynamicBodyPtr su, const MatrixNd& J) const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+  SAFESTATIC MatrixNd JJ, Jx, Jy, workM1, workM2;
+
   // setup useful indices
   const unsigned N = 0, S = 1, T = 2, THREE_D = 3;
 
@@ -1100,8 +1125,8 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
   assert(_ftype != eUndetermined);
 
   // setup the contact frame
-  _event_frame->q.set_identity();
-  _event_frame->x = c.contact_point;
+  event_frame->q.set_identity();
+  event_frame->x = c.contact_point;
 
   if (c._ftype == eSticking)
   {
@@ -1109,9 +1134,9 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
     Jx.resize(THREE_D, NGC);
 
     // get the directions in the event frame
-    Vector3d normal = Pose3d::transform_vector(_event_frame, c.contact_normal);
-    Vector3d tan1 = Pose3d::transform_vector(_event_frame, c.contact_tan1);
-    Vector3d tan2 = Pose3d::transform_vector(_event_frame, c.contact_tan2);
+    Vector3d normal = Pose3d::transform_vector(event_frame, c.contact_normal);
+    Vector3d tan1 = Pose3d::transform_vector(event_frame, c.contact_tan1);
+    Vector3d tan2 = Pose3d::transform_vector(event_frame, c.contact_tan2);
 
     // setup a matrix of contact directions
     Matrix3d R;
@@ -1123,7 +1148,7 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
     if (sub1 == su)
     {
       // first compute the Jacobian
-      su->calc_jacobian(_event_frame, sbb1, JJ);
+      su->calc_jacobian(event_frame, sbb1, JJ);
       SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
       R.transpose_mult(Jlin, Jx);
 
@@ -1134,7 +1159,7 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
     if (sub2 == su)
     {
       // first compute the Jacobian
-      su->calc_jacobian(_event_frame, sbb2, JJ);
+      su->calc_jacobian(event_frame, sbb2, JJ);
       SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
       (-R).transpose_mult(Jlin, Jx);
 
@@ -1154,14 +1179,14 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
     SharedVectorNd Jyn = Jy.row(N);
 
     // get the normal and sliding directions in the event frame
-    Vector3d normal = Pose3d::transform_vector(_event_frame, c.contact_normal);
-    Vector3d tan1 = Pose3d::transform_vector(_event_frame, c.contact_tan1);
+    Vector3d normal = Pose3d::transform_vector(event_frame, c.contact_normal);
+    Vector3d tan1 = Pose3d::transform_vector(event_frame, c.contact_tan1);
 
     // compute the Jacobians, checking to see whether necessary
     if (sub1 == su)
     {
       // first compute the Jacobian
-      su->calc_jacobian(_event_frame, sbb1, JJ);
+      su->calc_jacobian(event_frame, sbb1, JJ);
       SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
       Jlin.transpose_mult(normal, Jxn);
       Jlin.transpose_mult(tan1, Jyn);
@@ -1176,7 +1201,7 @@ void Event::compute_cross_contact_contact_aevent_data(const Event& c, MatrixNd&
     }
     if (sub2 == su)
     {
-      su->calc_jacobian(_event_frame, sbb2, JJ);
+      su->calc_jacobian(event_frame, sbb2, JJ);
       SharedConstMatrixNd Jlin = JJ.block(0, THREE_D, 0, JJ.columns());
       Jlin.transpose_mult(-normal, Jxn);
       Jlin.transpose_mult(-tan1, Jyn);
@@ -1199,6 +1224,7 @@ void Event::set_contact_parameters(const ContactParameters& cparams)
   contact_mu_viscous = cparams.mu_viscous;
   contact_epsilon = cparams.epsilon;
   contact_NK = cparams.NK;
+  contact_parameters_set = true;
   assert(contact_NK >= 4);
 }
 
@@ -1270,6 +1296,8 @@ double calc_event_accel2(const Event& e)
  */
 double Event::calc_event_accel() const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+
   if (event_type == eContact)
   {
     assert(contact_geom1 && contact_geom2);
@@ -1284,19 +1312,19 @@ double Event::calc_event_accel() const
     const SAcceld& ab = sbb->get_accel(); 
 
     // setup the event frame
-    _event_frame->x = contact_point;
-    _event_frame->q.set_identity();
-    _event_frame->rpose = GLOBAL;
+    event_frame->x = contact_point;
+    event_frame->q.set_identity();
+    event_frame->rpose = GLOBAL;
 
     // compute the velocities and accelerations at the contact point
-    SVelocityd tva = Pose3d::transform(_event_frame, va); 
-    SVelocityd tvb = Pose3d::transform(_event_frame, vb); 
-    SAcceld taa = Pose3d::transform(_event_frame, aa); 
-    SAcceld tab = Pose3d::transform(_event_frame, ab); 
+    SVelocityd tva = Pose3d::transform(event_frame, va); 
+    SVelocityd tvb = Pose3d::transform(event_frame, vb); 
+    SAcceld taa = Pose3d::transform(event_frame, aa); 
+    SAcceld tab = Pose3d::transform(event_frame, ab); 
 
     // get the contact normal and derivative in the correct pose
-    Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
-    Vector3d normal_dot = Pose3d::transform_vector(_event_frame, contact_normal_dot);
+    Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
+    Vector3d normal_dot = Pose3d::transform_vector(event_frame, contact_normal_dot);
 
     // compute 
     double ddot = normal.dot(taa.get_linear() - tab.get_linear());
@@ -1374,6 +1402,8 @@ double calc_event_vel2(const Event& e)
  */
 double Event::calc_event_vel() const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+
   if (event_type == eContact)
   {
     assert(contact_geom1 && contact_geom2);
@@ -1386,21 +1416,21 @@ double Event::calc_event_vel() const
     const SVelocityd& vb = sbb->get_velocity(); 
 
     // setup the event frame
-    _event_frame->x = contact_point;
-    _event_frame->q.set_identity();
-    _event_frame->rpose = GLOBAL;
+    event_frame->x = contact_point;
+    event_frame->q.set_identity();
+    event_frame->rpose = GLOBAL;
 
     // compute the velocities at the contact point
-    SVelocityd ta = Pose3d::transform(_event_frame, va); 
-    SVelocityd tb = Pose3d::transform(_event_frame, vb); 
+    SVelocityd ta = Pose3d::transform(event_frame, va); 
+    SVelocityd tb = Pose3d::transform(event_frame, vb); 
 
     // get the contact normal in the correct pose
-    Vector3d normal = Pose3d::transform_vector(_event_frame, contact_normal);
+    Vector3d normal = Pose3d::transform_vector(event_frame, contact_normal);
 
     FILE_LOG(LOG_EVENT) << "Event::calc_event_vel() entered" << std::endl;
     FILE_LOG(LOG_EVENT) << "normal (event frame): " << normal << std::endl;
-    FILE_LOG(LOG_EVENT) << "tangent 1 (event frame): " << Pose3d::transform_vector(_event_frame, contact_tan1) << std::endl;
-    FILE_LOG(LOG_EVENT) << "tangent 2 (event frame): " << Pose3d::transform_vector(_event_frame, contact_tan2) << std::endl;
+    FILE_LOG(LOG_EVENT) << "tangent 1 (event frame): " << Pose3d::transform_vector(event_frame, contact_tan1) << std::endl;
+    FILE_LOG(LOG_EVENT) << "tangent 2 (event frame): " << Pose3d::transform_vector(event_frame, contact_tan2) << std::endl;
 /*
     FILE_LOG(LOG_EVENT) << "spatial velocity (mixed frame) for body A: " << Pose3d::transform(dynamic_pointer_cast<RigidBody>(sba)->get_mixed_pose(), ta) << std::endl;
     FILE_LOG(LOG_EVENT) << "spatial velocity (event frame) for body A: " << ta << std::endl;
@@ -1779,6 +1809,7 @@ void Event::determine_connected_events(const vector<Event>& events, list<list<Ev
     }
   }
 
+  BINARY_LOG(LOG_EVENT)("connected-events", events.size(), groups.size());
   FILE_LOG(LOG_EVENT) << "Event::determine_connected_events() exited" << std::endl;
 }
 
@@ -2458,6 +2489,8 @@ Event::EventClass Event::determine_event_class() const
  */
 double Event::calc_vevent_tol() const
 {
+  SAFESTATIC shared_ptr<Pose3d> event_frame(new Pose3d);
+
   if (event_type == eContact)
   {
     assert(contact_geom1 && contact_geom2);
@@ -2470,13 +2503,13 @@ double Event::calc_vevent_tol() const
     const SVelocityd& vb = sbb->get_velocity(); 
 
     // setup the event frame
-    _event_frame->x = contact_point;
-    _event_frame->q.set_identity();
-    _event_frame->rpose = GLOBAL;
+    event_frame->x = contact_point;
+    event_frame->q.set_identity();
+    event_frame->rpose = GLOBAL;
 
     // compute the velocities at the contact point
-    SVelocityd ta = Pose3d::transform(_event_frame, va); 
-    SVelocityd tb = Pose3d::transform(_event_frame, vb); 
+    SVelocityd ta = Pose3d::transform(event_frame, va); 
+    SVelocityd tb = Pose3d::transform(event_frame, vb); 
 
     // compute the difference in linear velocities
     return std::max((ta.get_linear() - tb.get_linear()).norm(), (double) 1.0);
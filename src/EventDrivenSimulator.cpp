@@ -4,6 +4,7 @@
  * License (found in COPYING).
  ****************************************************************************/
 
+#include <algorithm>
 #include <boost/tuple/tuple.hpp>
 #include <Moby/XMLTree.h>
 #include <Moby/ArticulatedBody.h>
@@ -48,6 +49,15 @@ EventDrivenSimulator::EventDrivenSimulator()
   post_mini_step_callback_fn = NULL;
   get_contact_parameters_callback_fn = NULL;
   render_contact_points = false;
+  multirate = false;
+  _islands_valid = false;
+  contact_time_method = eConservativeAdvancement;
+
+  // setup sleeping parameters
+  allow_sleep = false;
+  sleep_KE_tol = 1e-6;
+  sleep_vel_tol = 1e-4;
+  sleep_time = 0.5;
 
   // setup the maximum event processing time
   max_event_time = std::numeric_limits<double>::max();
@@ -67,6 +77,7 @@ EventDrivenSimulator::EventDrivenSimulator()
   dynamics_time = (double) 0.0;
   event_time = (double) 0.0;
   coldet_time = (double) 0.0;
+  broad_phase_time = (double) 0.0;
 }
 
 /// Compares two events for purposes of mapping velocity tolerances
@@ -141,14 +152,14 @@ void EventDrivenSimulator::handle_acceleration_events()
   // tabulate times for event handling 
   tms cstop;  
   clock_t stop = times(&cstop);
-  event_time += (double) (stop-start)/CLOCKS_PER_SEC;
+  event_time += (double) (stop-start)/sysconf(_SC_CLK_TCK);
 
   // call the post-force application callback, if any 
   if (event_post_impulse_callback_fn)
     (*event_post_impulse_callback_fn)(_events, event_post_impulse_callback_data);
 
   // recompute forward dynamics
-  BOOST_FOREACH(DynamicBodyPtr body, _bodies)
+  BOOST_FOREACH(DynamicBodyPtr body, _dynamic_bodies)
     body->calc_fwd_dyn();
 }
 
@@ -167,11 +178,8 @@ VectorNd& EventDrivenSimulator::ode_accel_events(const VectorNd& x, double t, do
   dx.resize(x.size());
 
   // loop through all bodies, preparing to compute the ODE
-  BOOST_FOREACH(DynamicBodyPtr db, s->_bodies)
+  BOOST_FOREACH(DynamicBodyPtr db, s->_ode_bodies)
   {
-    if (db->get_kinematic())
-      continue;
-
     // get the number of generalized coordinates and velocities
     const unsigned NGC = db->num_generalized_coordinates(DynamicBody::eEuler);
     const unsigned NGV = db->num_generalized_coordinates(DynamicBody::eSpatial);
@@ -202,13 +210,8 @@ VectorNd& EventDrivenSimulator::ode_accel_events(const VectorNd& x, double t, do
     s->_events[i].deriv_type = Event::eAccel;
 
   // loop through all bodies, computing forward dynamics 
-  BOOST_FOREACH(DynamicBodyPtr db, s->_bodies)
-  {
-    if (db->get_kinematic())
-      continue;
-
+  BOOST_FOREACH(DynamicBodyPtr db, s->_ode_bodies)
     db->calc_fwd_dyn();
-  }
 
   // compute acceleration-based event forces
   s->handle_acceleration_events();
@@ -217,11 +220,8 @@ VectorNd& EventDrivenSimulator::ode_accel_events(const VectorNd& x, double t, do
   idx = 0;
 
   // loop through all bodies, computing the ODE
-  BOOST_FOREACH(DynamicBodyPtr db, s->_bodies)
+  BOOST_FOREACH(DynamicBodyPtr db, s->_ode_bodies)
   {
-    if (db->get_kinematic())
-      continue;
-
     // get the number of generalized coordinates and velocities
     const unsigned NGC = db->num_generalized_coordinates(DynamicBody::eEuler);
     const unsigned NGV = db->num_generalized_coordinates(DynamicBody::eSpatial);
@@ -259,7 +259,8 @@ VectorNd& EventDrivenSimulator::ode_accel_events(const VectorNd& x, double t, do
  * </ol>
  * The search order allows for multiple granularities; for example, a collision can easily
  * be specified between two geometries of two of a robot's links (i.e., representing different
- * surfaces on the links), between two links, or between two robots.
+ * surfaces on the links), between two links, or between two robots. If
+ * no parameters are found, the default contact parameters (if any) are used.
  * \param g1 the first collision geometry
  * \param g2 the second collision geometry
  * \return a pointer to the contact data, if any, found
@@ -337,8 +338,8 @@ shared_ptr<ContactParameters> EventDrivenSimulator::get_contact_parameters(Colli
     if ((iter = contact_params.find(make_sorted_pair(ab1, ab2))) != contact_params.end())
       return iter->second;
   
-  // still here?  no contact data found
-  return shared_ptr<ContactParameters>();
+  // still here?  no contact data found; use the default (if any)
+  return default_contact_params;
 }
 
 /// Draws a ray directed from a contact point along the contact normal
@@ -481,6 +482,32 @@ void EventDrivenSimulator::visualize_contact( Event& event ) {
   #endif // USE_OSG
 }
 
+/// Fills a snapshot with the poses and the contacts found during the step
+void EventDrivenSimulator::fill_snapshot(Snapshot& s)
+{
+  Simulator::fill_snapshot(s);
+  s.contacts = _snapshot_contacts;
+}
+
+/// Updates the visualization from a snapshot, drawing its contacts
+void EventDrivenSimulator::apply_snapshot(const Snapshot& s)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // set the transforms (this clears the one-step visualization data)
+  Simulator::apply_snapshot(s);
+
+  // draw the contacts
+  for (unsigned i=0; i+6 <= s.contacts.size(); i+= 6)
+  {
+    Event e;
+    e.event_type = Event::eContact;
+    e.contact_point = Point3d(s.contacts[i+X], s.contacts[i+Y], s.contacts[i+Z], GLOBAL);
+    e.contact_normal = Vector3d(s.contacts[i+3+X], s.contacts[i+3+Y], s.contacts[i+3+Z], GLOBAL);
+    visualize_contact(e);
+  }
+}
+
 /// Handles events
 void EventDrivenSimulator::handle_events()
 {
@@ -496,12 +523,23 @@ void EventDrivenSimulator::handle_events()
   for (unsigned i=0; i< _events.size(); i++)
     preprocess_event(_events[i]);
 
-  // if the setting is enabled, draw all contact events
+  // if the setting is enabled, draw all contact events (or record them
+  // for the snapshot, if snapshots are being published)
   if( render_contact_points ) {
     for ( std::vector<Event>::iterator it = _events.begin(); it < _events.end(); it++ ) {
       Event event = *it;
       if( event.event_type != Event::eContact ) continue;
-      visualize_contact( event );
+      if (snapshot_buffer)
+      {
+        Point3d p = Pose3d::transform_point(GLOBAL, event.contact_point);
+        Vector3d n = Pose3d::transform_vector(GLOBAL, event.contact_normal);
+        for (unsigned i=0; i< 3; i++)
+          _snapshot_contacts.push_back(p[i]);
+        for (unsigned i=0; i< 3; i++)
+          _snapshot_contacts.push_back(n[i]);
+      }
+      else
+        visualize_contact( event );
     }
   }
 
@@ -522,7 +560,7 @@ void EventDrivenSimulator::handle_events()
   // tabulate times for event handling 
   tms cstop;  
   clock_t stop = times(&cstop);
-  event_time += (double) (stop-start)/CLOCKS_PER_SEC;
+  event_time += (double) (stop-start)/sysconf(_SC_CLK_TCK);
 
   // call the post-impulse application callback, if any 
   if (event_post_impulse_callback_fn)
@@ -540,8 +578,13 @@ void EventDrivenSimulator::preprocess_event(Event& e)
   if (e.event_type == Event::eNone)
     return;
 
-  // get the contact parameters 
+  // events generated by find_events() already hold the parameters of their
+  // geometry pair (looked up once per pair)
   assert(e.event_type == Event::eContact);
+  if (e.contact_parameters_set)
+    return;
+
+  // get the contact parameters 
   shared_ptr<ContactParameters> cparams = get_contact_parameters(e.contact_geom1, e.contact_geom2);
   if (cparams)
     e.set_contact_parameters(*cparams);
@@ -579,6 +622,44 @@ void EventDrivenSimulator::determine_geometries()
   }
 }
 
+/// Adds a dynamic body to the simulator
+void EventDrivenSimulator::add_dynamic_body(DynamicBodyPtr body)
+{
+  Simulator::add_dynamic_body(body);
+
+  // the geometry and body indices of the contact pool must be reassigned
+  _contact_pool.reset();
+}
+
+/// Removes a dynamic body from the simulator
+void EventDrivenSimulator::remove_dynamic_body(DynamicBodyPtr body)
+{
+  Simulator::remove_dynamic_body(body);
+
+  // the contact pool should not keep the body's geometries alive
+  _contact_pool.reset();
+
+  // forget the body's rest time
+  _rest_time.erase(body);
+
+  // remove the body from any sleeping island
+  for (unsigned i=0; i< _sleeping_islands.size(); )
+  {
+    vector<DynamicBodyPtr>& island = _sleeping_islands[i];
+    island.erase(std::remove(island.begin(), island.end(), body), island.end());
+    if (island.empty())
+    {
+      _sleeping_islands[i] = _sleeping_islands.back();
+      _sleeping_islands.pop_back();
+    }
+    else
+      i++;
+  }
+
+  // the islands must be redetermined
+  _islands_valid = false;
+}
+
 /// Steps the simulator forward by the given step size
 double EventDrivenSimulator::step(double step_size)
 {
@@ -588,6 +669,7 @@ double EventDrivenSimulator::step(double step_size)
   dynamics_time = (double) 0.0;
   event_time = (double) 0.0;
   coldet_time = (double) 0.0;
+  broad_phase_time = (double) 0.0;
 
   tms cstart;  
   clock_t start = times(&cstart);
@@ -595,10 +677,17 @@ double EventDrivenSimulator::step(double step_size)
   // determine the set of collision geometries
   determine_geometries();
 
-  // clear one-step visualization data
+  // separate kinematic bodies from dynamic bodies (set_kinematic() may have
+  // been called since the last step)
+  update_body_lists();
+
+  // clear one-step visualization data (the visualization thread owns it
+  // when snapshots are being published)
   #ifdef USE_OSG
-  _transient_vdata->removeChildren(0, _transient_vdata->getNumChildren());
+  if (!snapshot_buffer)
+    _transient_vdata->removeChildren(0, _transient_vdata->getNumChildren());
   #endif
+  _snapshot_contacts.clear();
   FILE_LOG(LOG_SIMULATOR) << "+stepping simulation from time: " << this->current_time << std::endl;
 
   if (LOGGING(LOG_SIMULATOR))
@@ -614,6 +703,9 @@ double EventDrivenSimulator::step(double step_size)
   // setup the time stepped
   double h = 0.0;
 
+  // islands are determined at the first mini-step
+  _islands_valid = false;
+
   // step until the requisite time has elapsed
   while (h < step_size)
   {
@@ -634,11 +726,31 @@ double EventDrivenSimulator::step(double step_size)
 
     FILE_LOG(LOG_SIMULATOR) << "  determining conservative advancement time up to step of " << dt << std::endl;
 
-    // do broad-phase collision detection here
+    // do broad-phase collision detection here (resolving the global poses
+    // of all links and geometries first)
+    tms bp_cstart;  
+    clock_t bp_start = times(&bp_cstart);
+    _ccd.update_poses(_bodies);
     _ccd.broad_phase(dt, _bodies, _pairs_to_check); 
+    tms bp_cstop;  
+    clock_t bp_stop = times(&bp_cstop);
+    broad_phase_time += (double) (bp_stop-bp_start)/sysconf(_SC_CLK_TCK);
+
+    // wake any sleeping islands that have been disturbed (woken bodies must
+    // then be placed into islands)
+    if (allow_sleep && wake_islands(dt))
+      _islands_valid = false;
+
+    // determine the islands once per step, using the broad phase pairs (which
+    // cover the remainder of the step) and the most recently found events
+    if ((multirate || allow_sleep) && !_islands_valid)
+    {
+      determine_islands(_islands);
+      _islands_valid = true;
+    }
 
     // determine the maximum step according to conservative advancement
-    double safe_dt = std::min(calc_CA_step(), dt);
+    double safe_dt = std::min(calc_CA_step(dt), dt);
     if (safe_dt < dt)
       FILE_LOG(LOG_SIMULATOR) << "  maximum conservative step size: " << safe_dt << std::endl;
 
@@ -679,7 +791,10 @@ double EventDrivenSimulator::step(double step_size)
       try
       {
         // do "smart" integration (watching for state violation) 
-        integrate(dt);
+        if (multirate)
+          integrate_multirate(dt);
+        else
+          integrate(dt);
 
         // update constraint violation after integration
         update_constraint_violations();
@@ -749,7 +864,7 @@ double EventDrivenSimulator::step(double step_size)
 
     // see whether there were any force or acceleration limits exceeded
     bool reintegrate = false;
-    BOOST_FOREACH(DynamicBodyPtr db, _bodies)
+    BOOST_FOREACH(DynamicBodyPtr db, _dynamic_bodies)
     {
       if (db->limit_estimates_exceeded())
       {
@@ -778,6 +893,14 @@ double EventDrivenSimulator::step(double step_size)
       post_mini_step_callback_fn(this);
   }
 
+  // put islands at rest to sleep
+  if (allow_sleep)
+    update_sleeping(step_size);
+
+  // publish the snapshot, if desired
+  if (snapshot_buffer)
+    publish_snapshot();
+
   // call the callback 
   if (post_step_callback_fn)
     post_step_callback_fn(this);
@@ -785,17 +908,332 @@ double EventDrivenSimulator::step(double step_size)
   return step_size;
 }
 
+/// Determines the islands of (non-kinematic) bodies that may interact 
+/**
+ * Two bodies are placed into the same island if they participate in a
+ * common event (as determined by Event::determine_connected_events()) or if
+ * broad phase collision detection indicates that they may come into contact
+ * over the current step. Bodies that interact with no other body are placed
+ * in their own islands. No events are found here: the events found most
+ * recently are used (any new contact is covered by the broad phase pairs).
+ */
+void EventDrivenSimulator::determine_islands(vector<vector<DynamicBodyPtr> >& islands)
+{
+  list<list<Event*> > groups;
+  vector<DynamicBodyPtr> super_bodies;
+
+  // setup a disjoint set over all non-kinematic bodies
+  map<DynamicBodyPtr, unsigned> body_index;
+  vector<unsigned> parent;
+  for (unsigned i=0; i< _dynamic_bodies.size(); i++)
+  {
+    if (_dynamic_bodies[i]->is_sleeping())
+      continue;
+    body_index[_dynamic_bodies[i]] = parent.size();
+    parent.push_back(parent.size());
+  }
+
+  // determine the connected groups of the most recently found events
+  Event::determine_connected_events(_events, groups);
+
+  // merge the super bodies of each event group
+  BOOST_FOREACH(const list<Event*>& group, groups)
+  {
+    super_bodies.clear();
+    BOOST_FOREACH(Event* e, group)
+      e->get_super_bodies(std::back_inserter(super_bodies));
+    for (unsigned i=1; i< super_bodies.size(); i++)
+      merge_islands(body_index, parent, super_bodies.front(), super_bodies[i]);
+  }
+
+  // merge the super bodies of each pair from broad phase collision detection
+  // (disabled bodies do not connect islands)
+  for (unsigned i=0; i< _pairs_to_check.size(); i++)
+  {
+    SingleBodyPtr sb1 = _pairs_to_check[i].first->get_single_body();
+    SingleBodyPtr sb2 = _pairs_to_check[i].second->get_single_body();
+    if (sb1->is_enabled() && sb2->is_enabled())
+      merge_islands(body_index, parent, sb1->get_super_body(), sb2->get_super_body());
+  }
+
+  // setup the islands
+  map<unsigned, unsigned> root_to_island;
+  islands.clear();
+  for (unsigned i=0; i< _dynamic_bodies.size(); i++)
+  {
+    if (_dynamic_bodies[i]->is_sleeping())
+      continue;
+
+    // get the root of the body's set
+    unsigned root = find_island_root(parent, body_index[_dynamic_bodies[i]]);
+    map<unsigned, unsigned>::const_iterator iter = root_to_island.find(root);
+    if (iter == root_to_island.end())
+    {
+      root_to_island[root] = islands.size();
+      islands.push_back(vector<DynamicBodyPtr>());
+      islands.back().push_back(_dynamic_bodies[i]);
+    }
+    else
+      islands[iter->second].push_back(_dynamic_bodies[i]);
+  }
+
+  FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::determine_islands() - " << islands.size() << " islands determined" << std::endl;
+}
+
+/// Finds the root of the set containing element i (with path compression)
+unsigned EventDrivenSimulator::find_island_root(vector<unsigned>& parent, unsigned i)
+{
+  while (parent[i] != i)
+  {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+
+  return i;
+}
+
+/// Merges the sets containing two bodies (kinematic and sleeping bodies are not merged)
+void EventDrivenSimulator::merge_islands(const map<DynamicBodyPtr, unsigned>& body_index, vector<unsigned>& parent, DynamicBodyPtr db1, DynamicBodyPtr db2)
+{
+  map<DynamicBodyPtr, unsigned>::const_iterator i1 = body_index.find(db1);
+  map<DynamicBodyPtr, unsigned>::const_iterator i2 = body_index.find(db2);
+  if (i1 == body_index.end() || i2 == body_index.end())
+    return;
+
+  parent[find_island_root(parent, i1->second)] = find_island_root(parent, i2->second);
+}
+
+/// Integrates each island of bodies independently over the given step
+/**
+ * Every island is integrated over the same synchronization horizon 
+ * [current_time, current_time + step_size]; variable step integrators 
+ * choose their step sizes independently for each island. The islands are
+ * those determined at the start of the step (see step()).
+ * \return the size of step taken
+ */
+double EventDrivenSimulator::integrate_multirate(double step_size)
+{
+  // integrate each island over the horizon
+  for (unsigned i=0; i< _islands.size(); i++)
+  {
+    FILE_LOG(LOG_SIMULATOR) << " -- integrating island " << i << " (" << _islands[i].size() << " bodies)" << std::endl;
+    integrate(step_size, _islands[i].begin(), _islands[i].end());
+  }
+
+  // kinematic bodies were not part of any island; update them now
+  update_kinematic_bodies(current_time);
+
+  return step_size;
+}
+
+/// Determines whether a collision geometry belongs to a body that can move
+bool EventDrivenSimulator::is_active(CollisionGeometryPtr cg)
+{
+  SingleBodyPtr sb = cg->get_single_body();
+  return sb->is_enabled() && !sb->is_sleeping();
+}
+
+/// Determines whether a sleeping body has been disturbed (by a force or impulse) 
+bool EventDrivenSimulator::is_disturbed(DynamicBodyPtr db)
+{
+  if (!db->is_sleeping())
+    return true;
+
+  // links of articulated bodies may be disturbed individually
+  ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(db);
+  if (ab)
+    BOOST_FOREACH(RigidBodyPtr rb, ab->get_links())
+      if (!rb->is_sleeping())
+        return true;
+
+  return false;
+}
+
+/// Puts islands of bodies that have been at rest long enough to sleep
+/**
+ * An island is at rest when its kinetic energy is below sleep_KE_tol (per
+ * body) and no generalized speed in the island exceeds sleep_vel_tol. Islands
+ * containing controlled bodies are never put to sleep.
+ * \param dt the amount of time stepped 
+ */
+void EventDrivenSimulator::update_sleeping(double dt)
+{
+  const double INF = std::numeric_limits<double>::max();
+
+  // the islands of awake bodies were determined during the step (unless
+  // bodies were woken since)
+  if (!_islands_valid)
+  {
+    determine_islands(_islands);
+    _islands_valid = true;
+  }
+  // process each island
+  for (unsigned i=0; i< _islands.size(); i++)
+  {
+    const vector<DynamicBodyPtr>& island = _islands[i];
+
+    // see whether the island is at rest
+    bool at_rest = true;
+    double KE = 0.0;
+    for (unsigned j=0; j< island.size() && at_rest; j++)
+    {
+      // controlled bodies can start moving at any time
+      if (island[j]->controller)
+      {
+        at_rest = false;
+        break;
+      }
+
+      // check the generalized velocity
+      island[j]->get_generalized_velocity(DynamicBody::eSpatial, _workV);
+      if (_workV.size() > 0 && _workV.norm_inf() > sleep_vel_tol)
+        at_rest = false;
+
+      // update the island kinetic energy
+      KE += island[j]->calc_kinetic_energy();
+    }
+    if (KE > sleep_KE_tol * island.size())
+      at_rest = false;
+
+    // if the island is not at rest, reset the rest times
+    if (!at_rest)
+    {
+      for (unsigned j=0; j< island.size(); j++)
+        _rest_time[island[j]] = 0.0;
+      continue;
+    }
+
+    // update the rest times
+    double min_rest_time = INF;
+    for (unsigned j=0; j< island.size(); j++)
+    {
+      double& rest_time = _rest_time[island[j]];
+      rest_time += dt;
+      min_rest_time = std::min(min_rest_time, rest_time);
+    }
+
+    // put the island to sleep if it has been at rest long enough
+    if (min_rest_time >= sleep_time)
+    {
+      FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::update_sleeping() - putting island of " << island.size() << " bodies to sleep" << std::endl;
+      for (unsigned j=0; j< island.size(); j++)
+      {
+        island[j]->get_generalized_velocity(DynamicBody::eSpatial, _workV);
+        _workV.set_zero();
+        island[j]->set_generalized_velocity(DynamicBody::eSpatial, _workV);
+        island[j]->set_sleeping(true);
+      }
+      _sleeping_islands.push_back(island);
+    }
+  }
+}
+
+/// Wakes sleeping islands that have been disturbed 
+/**
+ * An island is woken if a force or impulse has been applied to one of its
+ * bodies or if an awake body may contact one of its bodies within dt.
+ * \return <b>true</b> if any island was woken
+ */
+bool EventDrivenSimulator::wake_islands(double dt)
+{
+  bool woken = true, any_woken = false;
+
+  // waking one island may cause another island to wake
+  while (woken && !_sleeping_islands.empty())
+  {
+    woken = false;
+
+    // look for awake bodies that may come into contact with sleeping bodies
+    for (unsigned i=0; i< _pairs_to_check.size(); i++)
+    {
+      CollisionGeometryPtr cg1 = _pairs_to_check[i].first;
+      CollisionGeometryPtr cg2 = _pairs_to_check[i].second;
+      SingleBodyPtr sb1 = cg1->get_single_body();
+      SingleBodyPtr sb2 = cg2->get_single_body();
+
+      // one body must be asleep, the other awake (and able to move)
+      SingleBodyPtr sleeper;
+      if (sb1->is_sleeping() && is_active(cg2))
+        sleeper = sb1;
+      else if (sb2->is_sleeping() && is_active(cg1))
+        sleeper = sb2;
+      else
+        continue;
+
+      // disturb the sleeping body if contact is possible over dt
+      double step = (contact_time_method == eTimeOfImpact) ? _gccd.calc_TOI(dt, cg1, cg2) : _ccd.calc_CA_step(cg1, cg2, dt);
+      if (step < dt)
+        sleeper->set_sleeping(false);
+    }
+
+    // wake every island with a disturbed body
+    if (wake_disturbed_islands())
+      woken = any_woken = true;
+  }
+
+  return any_woken;
+}
+
+/// Wakes every sleeping island containing a disturbed body
+/**
+ * Applying a force or impulse wakes only the body to which it is applied;
+ * the remainder of the body's island must be woken as well, or the body
+ * would pass through its sleeping neighbors.
+ * \return <b>true</b> if any island was woken
+ */
+bool EventDrivenSimulator::wake_disturbed_islands()
+{
+  bool woken = false;
+
+  for (unsigned i=0; i< _sleeping_islands.size(); )
+  {
+    const vector<DynamicBodyPtr>& island = _sleeping_islands[i];
+    bool disturbed = false;
+    for (unsigned j=0; j< island.size() && !disturbed; j++)
+      disturbed = is_disturbed(island[j]);
+
+    // if the island was not disturbed, keep it asleep
+    if (!disturbed)
+    {
+      i++;
+      continue;
+    }
+
+    FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::wake_disturbed_islands() - waking island of " << island.size() << " bodies" << std::endl;
+    for (unsigned j=0; j< island.size(); j++)
+    {
+      island[j]->set_sleeping(false);
+      _rest_time[island[j]] = 0.0;
+    }
+    _sleeping_islands[i] = _sleeping_islands.back();
+    _sleeping_islands.pop_back();
+    woken = true;
+  }
+
+  return woken;
+}
+
 /// Saves the state of the system (all dynamic bodies) at the current time
+/**
+ * The state is stored contiguously using the simulator's state layout, so
+ * no allocation takes place once the buffer has been sized.
+ */
 void EventDrivenSimulator::save_state()
 {
-  // resize the vector if necessary
-  _qsave.resize(_bodies.size());
-  _qdsave.resize(_bodies.size());
+  // rebuild the state layout if bodies have been added or removed
+  update_state_layout();
+
+  // size the buffer (only reallocates if bodies have been added)
+  _xsave.resize(_state_offsets.back());
 
   for (unsigned i=0; i< _bodies.size(); i++)
   {
-    _bodies[i]->get_generalized_coordinates(DynamicBody::eEuler, _qsave[i]);
-    _bodies[i]->get_generalized_velocity(DynamicBody::eSpatial, _qdsave[i]);
+    const unsigned NGC = _bodies[i]->num_generalized_coordinates(DynamicBody::eEuler);
+    const unsigned OFS = _state_offsets[i];
+    SharedVectorNd q = _xsave.segment(OFS, OFS+NGC);
+    SharedVectorNd qd = _xsave.segment(OFS+NGC, _state_offsets[i+1]);
+    _bodies[i]->get_generalized_coordinates(DynamicBody::eEuler, q);
+    _bodies[i]->get_generalized_velocity(DynamicBody::eSpatial, qd);
   }
 }
 
@@ -804,8 +1242,12 @@ void EventDrivenSimulator::restore_state()
 {
   for (unsigned i=0; i< _bodies.size(); i++)
   {
-    _bodies[i]->set_generalized_coordinates(DynamicBody::eEuler, _qsave[i]);
-    _bodies[i]->set_generalized_velocity(DynamicBody::eSpatial, _qdsave[i]);
+    const unsigned NGC = _bodies[i]->num_generalized_coordinates(DynamicBody::eEuler);
+    const unsigned OFS = _state_offsets[i];
+    SharedConstVectorNd q = _xsave.segment(OFS, OFS+NGC);
+    SharedConstVectorNd qd = _xsave.segment(OFS+NGC, _state_offsets[i+1]);
+    _bodies[i]->set_generalized_coordinates(DynamicBody::eEuler, q);
+    _bodies[i]->set_generalized_velocity(DynamicBody::eSpatial, qd);
   }
 }
 
@@ -844,6 +1286,9 @@ void EventDrivenSimulator::check_constraint_velocity_violations()
 /// Checks whether bodies violate interpenetration constraints
 void EventDrivenSimulator::check_pairwise_constraint_violations()
 {
+  // the bodies have just moved; resolve the global poses of all geometries
+  _ccd.update_poses(_bodies);
+
   // update constraint violation due to increasing interpenetration
   // loop over all pairs of geometries
   BOOST_FOREACH(CollisionGeometryPtr cg1, _geometries)
@@ -853,9 +1298,13 @@ void EventDrivenSimulator::check_pairwise_constraint_violations()
       if (cg1 == cg2 || unchecked_pairs.find(make_sorted_pair(cg1, cg2)) != unchecked_pairs.end())
         continue;
 
+      // if neither body can move, skip
+      if (!is_active(cg1) && !is_active(cg2))
+        continue;
+
       // compute the distance between the two bodies
       Point3d p1, p2;
-      double d = CollisionGeometry::calc_signed_dist(cg1, cg2, p1, p2);
+      double d = _ccd.calc_signed_dist(cg1, cg2, p1, p2);
       if (d <= _ip_tolerances[make_sorted_pair(cg1, cg2)] - NEAR_ZERO)
         throw InvalidStateException();
     }
@@ -864,6 +1313,10 @@ void EventDrivenSimulator::check_pairwise_constraint_violations()
 /// Updates constraint violation after integration
 void EventDrivenSimulator::update_constraint_violations()
 {
+  // the bodies have just been integrated; resolve the global poses of all 
+  // geometries
+  _ccd.update_poses(_bodies);
+
   // update constraint violation due to increasing interpenetration
   // loop over all pairs of geometries
   BOOST_FOREACH(CollisionGeometryPtr cg1, _geometries)
@@ -873,9 +1326,13 @@ void EventDrivenSimulator::update_constraint_violations()
       if (cg1 == cg2 || unchecked_pairs.find(make_sorted_pair(cg1, cg2)) != unchecked_pairs.end())
         continue;
 
+      // if neither body can move, skip
+      if (!is_active(cg1) && !is_active(cg2))
+        continue;
+
       // compute the distance between the two bodies
       Point3d p1, p2;
-      double d = CollisionGeometry::calc_signed_dist(cg1, cg2, p1, p2);
+      double d = _ccd.calc_signed_dist(cg1, cg2, p1, p2);
       if (d <= 0)
         _ip_tolerances[make_sorted_pair(cg1, cg2)] = d;
       else
@@ -892,7 +1349,11 @@ void EventDrivenSimulator::update_constraint_violations()
 }
 
 /// Computes a conservative advancement step
-double EventDrivenSimulator::calc_CA_step()
+/**
+ * \param dt_max the amount remaining to step (contact times are only sought
+ *        over this interval)
+ */
+double EventDrivenSimulator::calc_CA_step(double dt_max)
 {
   // setup safe amount to step
   double dt = std::numeric_limits<double>::max();
@@ -911,16 +1372,30 @@ double EventDrivenSimulator::calc_CA_step()
       return dt;
   }
 
+  // begin timing for collision detection
+  tms cstart;  
+  clock_t start = times(&cstart);
+
   // do narrow-phase collision detection here
-  for (unsigned i=0; i< _pairs_to_check.size(); i++)
+  if (contact_time_method == eTimeOfImpact)
+    dt = std::min(dt, _gccd.calc_TOI(std::min(dt, dt_max), _pairs_to_check));
+  else
   {
-    const pair<CollisionGeometryPtr, CollisionGeometryPtr>& cgpair = _pairs_to_check[i];
-    double step = _ccd.calc_CA_step(cgpair.first, cgpair.second);
-    dt = std::min(dt, step);
-    if (dt <= 0.0)
-      return dt;
+    for (unsigned i=0; i< _pairs_to_check.size(); i++)
+    {
+      const pair<CollisionGeometryPtr, CollisionGeometryPtr>& cgpair = _pairs_to_check[i];
+      double step = _ccd.calc_CA_step(cgpair.first, cgpair.second, std::min(dt, dt_max));
+      dt = std::min(dt, step);
+      if (dt <= 0.0)
+        break;
+    }
   }
 
+  // tabulate times for collision detection 
+  tms cstop;  
+  clock_t stop = times(&cstop);
+  coldet_time += (double) (stop-start)/sysconf(_SC_CLK_TCK);
+
   return dt;
 }
 
@@ -929,7 +1404,7 @@ void EventDrivenSimulator::reset_limit_estimates() const
   // first compute forward dynamics
 //  calc_fwd_dyn();
   // now compute the bounds
-  BOOST_FOREACH(DynamicBodyPtr db, _bodies)
+  BOOST_FOREACH(DynamicBodyPtr db, _dynamic_bodies)
   {
     // first, reset the limit estimates
     db->reset_limit_estimates(); 
@@ -940,8 +1415,12 @@ void EventDrivenSimulator::reset_limit_estimates() const
 void EventDrivenSimulator::calculate_bounds() const
 {
   // now compute the bounds
-  BOOST_FOREACH(DynamicBodyPtr db, _bodies)
+  BOOST_FOREACH(DynamicBodyPtr db, _dynamic_bodies)
   {
+    // velocities of sleeping bodies do not change
+    if (db->is_sleeping())
+      continue;
+
     ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(db);
     if (ab)
     {
@@ -957,11 +1436,15 @@ void EventDrivenSimulator::calculate_bounds() const
   }
 }
 
-/// Computes forward dynamics for all bodies
+/// Computes forward dynamics for all (non-kinematic) bodies
 void EventDrivenSimulator::calc_fwd_dyn() const
 {
-  BOOST_FOREACH(DynamicBodyPtr db, _bodies)
+  BOOST_FOREACH(DynamicBodyPtr db, _dynamic_bodies)
   {
+    // sleeping bodies are not simulated
+    if (db->is_sleeping())
+      continue;
+
     // clear the force accumulators on the body
     db->reset_accumulators();
 
@@ -989,8 +1472,12 @@ void EventDrivenSimulator::integrate_velocities_Euler(double dt)
   calc_fwd_dyn();
 
   // now update all velocities
-  BOOST_FOREACH(DynamicBodyPtr db, _bodies)
+  BOOST_FOREACH(DynamicBodyPtr db, _dynamic_bodies)
   {
+    // sleeping bodies are not simulated
+    if (db->is_sleeping())
+      continue;
+
     // get the generalized acceleration
     db->get_generalized_acceleration(qdd);
     qdd *= dt;
@@ -1010,8 +1497,12 @@ void EventDrivenSimulator::integrate_positions_Euler(double dt)
   VectorNd q, qd;
 
   // update all positions 
-  BOOST_FOREACH(DynamicBodyPtr db, _bodies)
+  BOOST_FOREACH(DynamicBodyPtr db, _dynamic_bodies)
   {
+    // sleeping bodies are not simulated
+    if (db->is_sleeping())
+      continue;
+
     db->get_generalized_velocity(DynamicBody::eEuler, qd);
     qd *= dt;
     db->get_generalized_coordinates(DynamicBody::eEuler, q);
@@ -1026,16 +1517,17 @@ void EventDrivenSimulator::find_events()
   // clear the set of events
   _events.clear();
 
-  // process each articulated body, getting joint events
-  for (unsigned i=0; i< _bodies.size(); i++)
+  // process each articulated body, getting joint events (kinematic bodies
+  // have no limit events)
+  for (unsigned i=0; i< _dynamic_bodies.size(); i++)
   {
     // see whether the i'th body is articulated
-    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(_bodies[i]);
+    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(_dynamic_bodies[i]);
     if (!ab)
       continue;
 
-    // if the body is kinematically controlled, do nothing
-    if (ab->get_kinematic())
+    // if the body is asleep, do nothing
+    if (ab->is_sleeping())
       continue;
     
     // get limit events 
@@ -1043,11 +1535,30 @@ void EventDrivenSimulator::find_events()
   }
 
   // find contact events
+  tms cstart;  
+  clock_t start = times(&cstart);
+  _contact_pool.clear();
   for (unsigned i=0; i< _pairs_to_check.size(); i++)
   {
     const pair<CollisionGeometryPtr, CollisionGeometryPtr>& cgpair = _pairs_to_check[i];
-    _ccd.find_contacts(cgpair.first, cgpair.second, std::back_inserter(_events));  
+    const unsigned FIRST = _contact_pool.size();
+    _ccd.find_contacts(cgpair.first, cgpair.second, _contact_pool);  
+
+    // look up the contact parameters once for the pair
+    if (_contact_pool.size() > FIRST)
+    {
+      shared_ptr<ContactParameters> cparams = get_contact_parameters(cgpair.first, cgpair.second);
+      if (cparams)
+        _contact_pool.set_contact_parameters(FIRST, *cparams);
+    }
   }
+  tms cstop;  
+  clock_t stop = times(&cstop);
+  coldet_time += (double) (stop-start)/sysconf(_SC_CLK_TCK);
+
+  // materialize events from the contact records (events are views for the
+  // handlers and callbacks; _events keeps its storage between calls)
+  _contact_pool.get_events(std::back_inserter(_events));
 
   FILE_LOG(LOG_SIMULATOR) << "EventDrivenSimulator::find_events() entered" << std::endl;
   if (LOGGING(LOG_SIMULATOR))
@@ -1065,16 +1576,17 @@ double EventDrivenSimulator::compute_next_event_time() const
   // setup inf as the default time
   double dt = std::numeric_limits<double>::max();
 
-  // process each articulated body, looking for next joint events
-  for (unsigned i=0; i< _bodies.size(); i++)
+  // process each articulated body, looking for next joint events (kinematic
+  // bodies have no limit events)
+  for (unsigned i=0; i< _dynamic_bodies.size(); i++)
   {
     // see whether the i'th body is articulated
-    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(_bodies[i]);
+    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(_dynamic_bodies[i]);
     if (!ab)
       continue;
 
-    // if the body is kinematically controlled, do nothing
-    if (ab->get_kinematic())
+    // if the body is asleep, do nothing
+    if (ab->is_sleeping())
       continue;
     
     // get limit events in [t, t+dt] (if any)
@@ -1097,6 +1609,9 @@ void EventDrivenSimulator::step_si_Euler(double dt)
 {
   FILE_LOG(LOG_SIMULATOR) << "-- doing semi-implicit Euler step" << std::endl;
 
+  // update the kinematic bodies (they are not integrated)
+  update_kinematic_bodies(current_time);
+
   // integrate bodies' velocities forward by dt
   integrate_velocities_Euler(dt);
   FILE_LOG(LOG_SIMULATOR) << "   integrating velocities forward by " << dt << std::endl;
@@ -1108,13 +1623,24 @@ void EventDrivenSimulator::step_si_Euler(double dt)
   while (current_time < target_time)
   {
     // determine constraints (contacts, limits) that are currently active 
+    // (positions have changed since the poses were last resolved)
     FILE_LOG(LOG_SIMULATOR) << "   finding events" << std::endl;
+    _ccd.update_poses(_bodies);
     find_events();
 
     // solve events to yield new velocities
     FILE_LOG(LOG_SIMULATOR) << "   handling events" << std::endl;
     handle_events();
 
+    // impulses wake only the bodies to which they are applied; wake the
+    // rest of their islands and redo the broad phase so that the woken
+    // bodies' neighbors are considered over the remainder of the step 
+    if (allow_sleep && wake_disturbed_islands())
+    {
+      _ccd.broad_phase(target_time - current_time, _bodies, _pairs_to_check);
+      _islands_valid = false;
+    }
+
     if (LOGGING(LOG_SIMULATOR))
     {
       VectorNd qd;
@@ -1173,6 +1699,42 @@ void EventDrivenSimulator::load_from_xml(shared_ptr<const XMLTree> node, map<std
   if (min_advance_attrib)
     min_advance = min_advance_attrib->get_real_value();
 
+  // read whether islands are to be integrated independently
+  XMLAttrib* multirate_attrib = node->get_attrib("multirate");
+  if (multirate_attrib)
+    multirate = multirate_attrib->get_bool_value();
+
+  // read the sleeping parameters
+  XMLAttrib* allow_sleep_attrib = node->get_attrib("allow-sleep");
+  if (allow_sleep_attrib)
+    allow_sleep = allow_sleep_attrib->get_bool_value();
+  XMLAttrib* sleep_KE_tol_attrib = node->get_attrib("sleep-KE-tol");
+  if (sleep_KE_tol_attrib)
+    sleep_KE_tol = sleep_KE_tol_attrib->get_real_value();
+  XMLAttrib* sleep_vel_tol_attrib = node->get_attrib("sleep-vel-tol");
+  if (sleep_vel_tol_attrib)
+    sleep_vel_tol = sleep_vel_tol_attrib->get_real_value();
+  XMLAttrib* sleep_time_attrib = node->get_attrib("sleep-time");
+  if (sleep_time_attrib)
+    sleep_time = sleep_time_attrib->get_real_value();
+
+  // read the method for bounding the time until the next contact
+  XMLAttrib* contact_time_attrib = node->get_attrib("contact-time-method");
+  if (contact_time_attrib)
+  {
+    std::string method = contact_time_attrib->get_string_value();
+    if (strcasecmp(method.c_str(), "ca") == 0)
+      contact_time_method = eConservativeAdvancement;
+    else if (strcasecmp(method.c_str(), "toi") == 0)
+      contact_time_method = eTimeOfImpact;
+    else
+    {
+      std::cerr << "EventDrivenSimulator::load_from_xml() - unknown ";
+      std::cerr << "contact time method '" << method << "' -- valid types ";
+      std::cerr << "are 'ca' and 'toi'" << std::endl;
+    }
+  }
+
   // read the error tolerances
   XMLAttrib* rel_tol_attrib = node->get_attrib("rel-err-tol");
   XMLAttrib* abs_tol_attrib = node->get_attrib("abs-err-tol");
@@ -1184,12 +1746,20 @@ void EventDrivenSimulator::load_from_xml(shared_ptr<const XMLTree> node, map<std
   // read in any ContactParameters
   child_nodes = node->find_child_nodes("ContactParameters");
   if (!child_nodes.empty())
+  {
     contact_params.clear();
+    default_contact_params.reset();
+  }
   for (list<shared_ptr<const XMLTree> >::const_iterator i = child_nodes.begin(); i != child_nodes.end(); i++)
   {
     boost::shared_ptr<ContactParameters> cd(new ContactParameters);
     cd->load_from_xml(*i, id_map);
-    contact_params[cd->objects] = cd;
+
+    // parameters without objects are the defaults
+    if (!(*i)->get_attrib("object1-id") && !(*i)->get_attrib("object2-id"))
+      default_contact_params = cd;
+    else
+      contact_params[cd->objects] = cd;
   }
 }
 
@@ -1211,6 +1781,21 @@ void EventDrivenSimulator::save_to_xml(XMLTreePtr node, list<shared_ptr<const Ba
   // save the minimum advancement step
   node->attribs.insert(XMLAttrib("min-advance", min_advance));
 
+  // save whether islands are integrated independently
+  node->attribs.insert(XMLAttrib("multirate", multirate));
+
+  // save the sleeping parameters
+  node->attribs.insert(XMLAttrib("allow-sleep", allow_sleep));
+  node->attribs.insert(XMLAttrib("sleep-KE-tol", sleep_KE_tol));
+  node->attribs.insert(XMLAttrib("sleep-vel-tol", sleep_vel_tol));
+  node->attribs.insert(XMLAttrib("sleep-time", sleep_time));
+
+  // save the method for bounding the time until the next contact
+  if (contact_time_method == eConservativeAdvancement)
+    node->attribs.insert(XMLAttrib("contact-time-method", std::string("ca")));
+  else
+    node->attribs.insert(XMLAttrib("contact-time-method", std::string("toi")));
+
   // save the error tolerances
   node->attribs.insert(XMLAttrib("rel-err-tol", rel_err_tol));
   node->attribs.insert(XMLAttrib("abs-err-tol", abs_err_tol));
@@ -1222,6 +1807,14 @@ void EventDrivenSimulator::save_to_xml(XMLTreePtr node, list<shared_ptr<const Ba
     node->add_child(new_node);
     i->second->save_to_xml(new_node, shared_objects);
   }
+
+  // save the default ContactParameters
+  if (default_contact_params)
+  {
+    XMLTreePtr new_node(new XMLTree("ContactParameters"));
+    node->add_child(new_node);
+    default_contact_params->save_to_xml(new_node, shared_objects);
+  }
 }
 
 
@@ -0,0 +1,594 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <map>
+#include <Ravelin/Matrix3d.h>
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include <Moby/Triangle.h>
+#include <Moby/IndexedTriArray.h>
+#include <Moby/FlatBVH.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using std::vector;
+using std::pair;
+using std::make_pair;
+using std::map;
+
+// number of bins used to evaluate the surface area heuristic
+const unsigned NBINS = 16;
+
+// number of triangles at or below which a node is always made a leaf
+const unsigned MIN_LEAF_TRIS = 2;
+
+// number of triangles above which a node is never made a leaf (unless it
+// cannot be split)
+const unsigned MAX_LEAF_TRIS = 16;
+
+// cost of traversing a node relative to intersecting a triangle
+const double TRAVERSAL_COST = 1.0;
+
+/// Computes half of the surface area of a box given by its extents
+static double half_area(const double lo[3], const double hi[3])
+{
+  const double DX = hi[0] - lo[0], DY = hi[1] - lo[1], DZ = hi[2] - lo[2];
+  return DX*DY + DY*DZ + DZ*DX;
+}
+
+/// Computes the cross product of two vectors
+static Origin3d cross(const Origin3d& u, const Origin3d& v)
+{
+  return Origin3d(u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0]);
+}
+
+/// Normalizes a vector (if it is not zero)
+static Origin3d normalize(const Origin3d& u)
+{
+  const double NRM = u.norm();
+  return (NRM > 0.0) ? u/NRM : u;
+}
+
+/// Computes the angle between two vectors
+static double calc_angle(const Origin3d& u, const Origin3d& v)
+{
+  const double NRM = u.norm()*v.norm();
+  if (NRM <= 0.0)
+    return 0.0;
+  return std::acos(std::max(-1.0, std::min(1.0, u.dot(v)/NRM)));
+}
+
+/// Functor for partitioning triangle indices about a bin along an axis
+struct BinPredicate
+{
+  BinPredicate(const vector<double>& centroids, unsigned axis, double cmin, double scale, unsigned split) : c(centroids), axis(axis), cmin(cmin), scale(scale), split(split) {}
+
+  bool operator()(unsigned t) const
+  {
+    unsigned bin = std::min((unsigned) ((c[t*3+axis] - cmin)*scale), NBINS-1);
+    return bin < split;
+  }
+
+  const vector<double>& c;
+  unsigned axis;
+  double cmin, scale;
+  unsigned split;
+};
+
+/// Functor for ordering triangle indices by centroid along an axis
+struct CentroidLess
+{
+  CentroidLess(const vector<double>& centroids, unsigned axis) : c(centroids), axis(axis) {}
+  bool operator()(unsigned t1, unsigned t2) const { return c[t1*3+axis] < c[t2*3+axis]; }
+  const vector<double>& c;
+  unsigned axis;
+};
+
+/// Removes all nodes from the hierarchy
+void FlatBVH::clear()
+{
+  _nodes.clear();
+  _tri_idx.clear();
+  _vertex_normals.clear();
+  _edge_normals.clear();
+}
+
+/// Sets the hierarchy from previously built nodes and triangle indices
+/**
+ * \note the data are copied as-is (e.g., from a serialized hierarchy); the
+ *       caller is responsible for their consistency with the mesh and for
+ *       calling calc_pseudo_normals() afterward
+ */
+void FlatBVH::assign(const Node* nodes, unsigned num_nodes, const unsigned* tri_idx, unsigned num_tri_idx)
+{
+  _nodes.assign(nodes, nodes+num_nodes);
+  _tri_idx.assign(tri_idx, tri_idx+num_tri_idx);
+}
+
+/// Builds the hierarchy over the triangles of a mesh (in the mesh frame)
+void FlatBVH::build(const IndexedTriArray& mesh)
+{
+  clear();
+
+  // get the vertices and facets
+  const vector<Origin3d>& verts = mesh.get_vertices();
+  const vector<IndexedTri>& facets = mesh.get_facets();
+  if (facets.empty())
+    return;
+
+  // compute the centroid and bounds of each triangle
+  const unsigned N = facets.size();
+  vector<double> centroids(N*3), boxes(N*6);
+  for (unsigned i=0; i< N; i++)
+  {
+    const Origin3d& a = verts[facets[i].a];
+    const Origin3d& b = verts[facets[i].b];
+    const Origin3d& c = verts[facets[i].c];
+    for (unsigned k=0; k< 3; k++)
+    {
+      centroids[i*3+k] = (a[k] + b[k] + c[k])/3.0;
+      boxes[i*6+k] = std::min(a[k], std::min(b[k], c[k]));
+      boxes[i*6+k+3] = std::max(a[k], std::max(b[k], c[k]));
+    }
+  }
+
+  // setup the triangle indices
+  _tri_idx.resize(N);
+  for (unsigned i=0; i< N; i++)
+    _tri_idx[i] = i;
+
+  // build the hierarchy (a binary tree with N leaves has at most 2N-1 nodes)
+  _nodes.reserve(2*N-1);
+  build_node(0, N, 0, centroids, boxes);
+
+  // compute the pseudo-normals used to determine the side of a point
+  calc_pseudo_normals(mesh);
+
+  FILE_LOG(LOG_BV) << "FlatBVH::build() - " << N << " triangles, " << _nodes.size() << " nodes" << std::endl;
+}
+
+/// Computes the angle-weighted pseudo-normals of the vertices and edges of a mesh
+/**
+ * The pseudo-normal of a vertex is the sum of the normals of its incident
+ * triangles, each weighted by the triangle's angle at the vertex; the
+ * pseudo-normal of an edge is the sum of the normals of the triangles that
+ * share it. For a closed, consistently oriented mesh, the direction from the
+ * closest point on the mesh to a point outside the mesh always has a
+ * positive dot product with the pseudo-normal of the closest feature.
+ */
+void FlatBVH::calc_pseudo_normals(const IndexedTriArray& mesh)
+{
+  const vector<Origin3d>& verts = mesh.get_vertices();
+  const vector<IndexedTri>& facets = mesh.get_facets();
+
+  // accumulate the normals of the vertices and (undirected) edges
+  _vertex_normals.assign(verts.size(), Origin3d(0.0, 0.0, 0.0));
+  map<pair<unsigned, unsigned>, Origin3d> edge_sums;
+  for (unsigned i=0; i< facets.size(); i++)
+  {
+    const unsigned V[3] = { facets[i].a, facets[i].b, facets[i].c };
+    const Origin3d N = normalize(cross(verts[V[1]] - verts[V[0]], verts[V[2]] - verts[V[0]]));
+    for (unsigned k=0; k< 3; k++)
+    {
+      const unsigned V0 = V[k], V1 = V[(k+1) % 3], V2 = V[(k+2) % 3];
+      _vertex_normals[V0] += N*calc_angle(verts[V1] - verts[V0], verts[V2] - verts[V0]);
+      map<pair<unsigned, unsigned>, Origin3d>::iterator e = edge_sums.insert(make_pair(make_pair(std::min(V0, V1), std::max(V0, V1)), Origin3d(0.0, 0.0, 0.0))).first;
+      e->second += N;
+    }
+  }
+
+  // normalize the vertex normals
+  for (unsigned i=0; i< _vertex_normals.size(); i++)
+    _vertex_normals[i] = normalize(_vertex_normals[i]);
+
+  // store the edge normals by triangle
+  _edge_normals.resize(facets.size()*3);
+  for (unsigned i=0; i< facets.size(); i++)
+  {
+    const unsigned V[3] = { facets[i].a, facets[i].b, facets[i].c };
+    for (unsigned k=0; k< 3; k++)
+    {
+      const unsigned V0 = V[k], V1 = V[(k+1) % 3];
+      _edge_normals[i*3+k] = normalize(edge_sums[make_pair(std::min(V0, V1), std::max(V0, V1))]);
+    }
+  }
+}
+
+/// Builds the subtree over triangle indices [begin, end) and returns the index of its root
+unsigned FlatBVH::build_node(unsigned begin, unsigned end, unsigned depth, const vector<double>& centroids, const vector<double>& boxes)
+{
+  const double INF = std::numeric_limits<double>::max();
+
+  // create the node
+  const unsigned IDX = _nodes.size();
+  _nodes.push_back(Node());
+
+  // compute the bounds of the node and of the centroids
+  double lo[3] = { INF, INF, INF }, hi[3] = { -INF, -INF, -INF };
+  double clo[3] = { INF, INF, INF }, chi[3] = { -INF, -INF, -INF };
+  for (unsigned i=begin; i< end; i++)
+  {
+    const unsigned T = _tri_idx[i];
+    for (unsigned k=0; k< 3; k++)
+    {
+      lo[k] = std::min(lo[k], boxes[T*6+k]);
+      hi[k] = std::max(hi[k], boxes[T*6+k+3]);
+      clo[k] = std::min(clo[k], centroids[T*3+k]);
+      chi[k] = std::max(chi[k], centroids[T*3+k]);
+    }
+  }
+  for (unsigned k=0; k< 3; k++)
+  {
+    _nodes[IDX].lo[k] = lo[k];
+    _nodes[IDX].hi[k] = hi[k];
+  }
+
+  // make a leaf, if appropriate
+  const unsigned N = end - begin;
+  if (N <= MIN_LEAF_TRIS || depth+1 >= MAX_DEPTH)
+  {
+    _nodes[IDX].offset = begin;
+    _nodes[IDX].count = N;
+    return IDX;
+  }
+
+  // find the best split using binned SAH
+  double best_cost = INF;
+  unsigned best_axis = 0, best_split = 0;
+  for (unsigned axis=0; axis< 3; axis++)
+  {
+    // skip axes along which all centroids coincide
+    const double EXTENT = chi[axis] - clo[axis];
+    if (EXTENT <= std::numeric_limits<double>::epsilon()*std::max((double) 1.0, std::fabs(chi[axis])))
+      continue;
+
+    // bin the triangles
+    const double SCALE = NBINS/EXTENT;
+    unsigned bin_count[NBINS];
+    double bin_lo[NBINS][3], bin_hi[NBINS][3];
+    for (unsigned b=0; b< NBINS; b++)
+    {
+      bin_count[b] = 0;
+      for (unsigned k=0; k< 3; k++)
+      {
+        bin_lo[b][k] = INF;
+        bin_hi[b][k] = -INF;
+      }
+    }
+    for (unsigned i=begin; i< end; i++)
+    {
+      const unsigned T = _tri_idx[i];
+      const unsigned B = std::min((unsigned) ((centroids[T*3+axis] - clo[axis])*SCALE), NBINS-1);
+      bin_count[B]++;
+      for (unsigned k=0; k< 3; k++)
+      {
+        bin_lo[B][k] = std::min(bin_lo[B][k], boxes[T*6+k]);
+        bin_hi[B][k] = std::max(bin_hi[B][k], boxes[T*6+k+3]);
+      }
+    }
+
+    // sweep from the right to get the areas and counts of the right sides
+    double right_area[NBINS];
+    unsigned right_count[NBINS];
+    double rlo[3] = { INF, INF, INF }, rhi[3] = { -INF, -INF, -INF };
+    unsigned rcount = 0;
+    for (unsigned b=NBINS-1; b> 0; b--)
+    {
+      rcount += bin_count[b];
+      for (unsigned k=0; k< 3; k++)
+      {
+        rlo[k] = std::min(rlo[k], bin_lo[b][k]);
+        rhi[k] = std::max(rhi[k], bin_hi[b][k]);
+      }
+      right_count[b] = rcount;
+      right_area[b] = (rcount > 0) ? half_area(rlo, rhi) : 0.0;
+    }
+
+    // sweep from the left, evaluating the cost of splitting before each bin
+    double llo[3] = { INF, INF, INF }, lhi[3] = { -INF, -INF, -INF };
+    unsigned lcount = 0;
+    for (unsigned b=1; b< NBINS; b++)
+    {
+      lcount += bin_count[b-1];
+      for (unsigned k=0; k< 3; k++)
+      {
+        llo[k] = std::min(llo[k], bin_lo[b-1][k]);
+        lhi[k] = std::max(lhi[k], bin_hi[b-1][k]);
+      }
+      if (lcount == 0 || right_count[b] == 0)
+        continue;
+      const double COST = half_area(llo, lhi)*lcount + right_area[b]*right_count[b];
+      if (COST < best_cost)
+      {
+        best_cost = COST;
+        best_axis = axis;
+        best_split = b;
+      }
+    }
+  }
+
+  // compare the cost of splitting to the cost of a leaf
+  const double AREA = half_area(lo, hi);
+  const double LEAF_COST = AREA*N;
+  const bool NO_SPLIT = (best_cost == INF);
+  if ((NO_SPLIT || TRAVERSAL_COST*AREA + best_cost >= LEAF_COST) && N <= MAX_LEAF_TRIS)
+  {
+    _nodes[IDX].offset = begin;
+    _nodes[IDX].count = N;
+    return IDX;
+  }
+
+  // partition the triangles
+  unsigned mid;
+  if (!NO_SPLIT)
+  {
+    BinPredicate pred(centroids, best_axis, clo[best_axis], NBINS/(chi[best_axis] - clo[best_axis]), best_split);
+    mid = std::partition(_tri_idx.begin()+begin, _tri_idx.begin()+end, pred) - _tri_idx.begin();
+  }
+  else
+  {
+    // centroids coincide; split at the median so that leaves stay small
+    mid = begin + N/2;
+    std::nth_element(_tri_idx.begin()+begin, _tri_idx.begin()+mid, _tri_idx.begin()+end, CentroidLess(centroids, 0));
+  }
+
+  // build the children; the left child immediately follows this node
+  build_node(begin, mid, depth+1, centroids, boxes);
+  const unsigned RIGHT = build_node(mid, end, depth+1, centroids, boxes);
+  _nodes[IDX].offset = RIGHT;
+  _nodes[IDX].count = 0;
+  return IDX;
+}
+
+/// Computes the squared distance from a point to the box of a node
+double FlatBVH::calc_sq_dist(const Node& n, const Point3d& p)
+{
+  double dist = 0.0;
+  for (unsigned k=0; k< 3; k++)
+  {
+    const double D = std::max(n.lo[k] - p[k], std::max((double) 0.0, p[k] - n.hi[k]));
+    dist += D*D;
+  }
+
+  return dist;
+}
+
+/// Determines whether the box of node a overlaps the box of node b (transformed into a's frame)
+bool FlatBVH::overlaps(const Node& a, const Node& b, const double R[3][3], const double absR[3][3], const double t[3])
+{
+  // get the center and half-extents of b
+  const double CB[3] = { (b.lo[0] + b.hi[0])*0.5, (b.lo[1] + b.hi[1])*0.5, (b.lo[2] + b.hi[2])*0.5 };
+  const double HB[3] = { (b.hi[0] - b.lo[0])*0.5, (b.hi[1] - b.lo[1])*0.5, (b.hi[2] - b.lo[2])*0.5 };
+
+  // compare the box around transformed b against a, one axis at a time
+  for (unsigned i=0; i< 3; i++)
+  {
+    const double C = R[i][0]*CB[0] + R[i][1]*CB[1] + R[i][2]*CB[2] + t[i];
+    const double H = absR[i][0]*HB[0] + absR[i][1]*HB[1] + absR[i][2]*HB[2];
+    if (C - H > a.hi[i] || C + H < a.lo[i])
+      return false;
+  }
+
+  return true;
+}
+
+/// Finds all pairs of triangles from two hierarchies whose leaf boxes overlap
+/**
+ * \param a the first hierarchy
+ * \param b the second hierarchy
+ * \param aTb the transform from b's mesh frame to a's mesh frame
+ * \param tri_pairs on return, pairs of (a, b) triangle indices to test
+ */
+void FlatBVH::intersect(const FlatBVH& a, const FlatBVH& b, const Transform3d& aTb, vector<pair<unsigned, unsigned> >& tri_pairs)
+{
+  tri_pairs.clear();
+  if (a.empty() || b.empty())
+    return;
+
+  // get the rotation and translation as plain arrays
+  const Matrix3d RM(aTb.q);
+  double R[3][3], absR[3][3], t[3];
+  for (unsigned i=0; i< 3; i++)
+  {
+    for (unsigned j=0; j< 3; j++)
+    {
+      R[i][j] = RM(i,j);
+      absR[i][j] = std::fabs(R[i][j]);
+    }
+    t[i] = aTb.x[i];
+  }
+
+  // each pop pushes at most two pairs while descending one level in one of
+  // the trees, so the stack never exceeds the sum of the tree depths
+  pair<unsigned, unsigned> stack[MAX_DEPTH*2+2];
+  unsigned sz = 0;
+  stack[sz++] = make_pair(0, 0);
+
+  while (sz > 0)
+  {
+    const pair<unsigned, unsigned> P = stack[--sz];
+    const Node& na = a._nodes[P.first];
+    const Node& nb = b._nodes[P.second];
+    if (!overlaps(na, nb, R, absR, t))
+      continue;
+
+    // output all triangle pairs from two leaves
+    if (na.is_leaf() && nb.is_leaf())
+    {
+      for (unsigned i=na.offset; i< na.offset+na.count; i++)
+        for (unsigned j=nb.offset; j< nb.offset+nb.count; j++)
+          tri_pairs.push_back(make_pair(a._tri_idx[i], b._tri_idx[j]));
+      continue;
+    }
+
+    // descend into the larger node (or the only internal one)
+    if (nb.is_leaf() || (!na.is_leaf() && half_area(na.lo, na.hi) >= half_area(nb.lo, nb.hi)))
+    {
+      stack[sz++] = make_pair(na.offset, P.second);
+      stack[sz++] = make_pair(P.first+1, P.second);
+    }
+    else
+    {
+      stack[sz++] = make_pair(P.first, nb.offset);
+      stack[sz++] = make_pair(P.first, P.second+1);
+    }
+  }
+}
+
+/// Finds the triangle of the mesh closest to a point
+/**
+ * \param mesh the mesh the hierarchy was built from
+ * \param p the query point (in the mesh frame)
+ * \param tri on return, the index of the closest triangle
+ * \param closest on return, the closest point on that triangle
+ * \return the squared distance from p to the closest triangle (infinite if
+ *         the hierarchy is empty)
+ */
+double FlatBVH::calc_closest_tri(const IndexedTriArray& mesh, const Point3d& p, unsigned& tri, Point3d& closest) const
+{
+  double best = std::numeric_limits<double>::max();
+  if (empty())
+    return best;
+
+  // each pop pushes at most two nodes while descending one level
+  unsigned stack[MAX_DEPTH+2];
+  unsigned sz = 0;
+  stack[sz++] = 0;
+
+  while (sz > 0)
+  {
+    const unsigned IDX = stack[--sz];
+    const Node& n = _nodes[IDX];
+    if (calc_sq_dist(n, p) >= best)
+      continue;
+
+    // test the triangles of a leaf
+    if (n.is_leaf())
+    {
+      for (unsigned i=n.offset; i< n.offset+n.count; i++)
+      {
+        Point3d cp;
+        const double D = Triangle::calc_sq_dist(mesh.get_triangle(_tri_idx[i], p.pose), p, cp);
+        if (D < best)
+        {
+          best = D;
+          tri = _tri_idx[i];
+          closest = cp;
+        }
+      }
+      continue;
+    }
+
+    // visit the nearer child first (it is pushed last)
+    const unsigned LEFT = IDX+1, RIGHT = n.offset;
+    if (calc_sq_dist(_nodes[LEFT], p) < calc_sq_dist(_nodes[RIGHT], p))
+    {
+      stack[sz++] = RIGHT;
+      stack[sz++] = LEFT;
+    }
+    else
+    {
+      stack[sz++] = LEFT;
+      stack[sz++] = RIGHT;
+    }
+  }
+
+  return best;
+}
+
+
+/// Gets the pseudo-normal of the feature of a triangle that contains a point
+/**
+ * \param mesh the mesh the hierarchy was built from
+ * \param tri the index of the triangle
+ * \param closest a point on the triangle (in the mesh frame)
+ * \return the pseudo-normal of the vertex, edge, or face of the triangle
+ *         containing the point (the face normal if no pseudo-normals are
+ *         available)
+ */
+Vector3d FlatBVH::get_pseudo_normal(const IndexedTriArray& mesh, unsigned tri, const Point3d& closest) const
+{
+  const vector<Origin3d>& verts = mesh.get_vertices();
+  const IndexedTri& f = mesh.get_facets()[tri];
+  const Origin3d& a = verts[f.a];
+  const Origin3d& b = verts[f.b];
+  const Origin3d& c = verts[f.c];
+
+  // get the face normal
+  const Origin3d N = normalize(cross(b - a, c - a));
+  if (_edge_normals.size() != mesh.get_facets().size()*3 || _vertex_normals.size() != verts.size())
+    return Vector3d(N, closest.pose);
+
+  // compute the barycentric coordinates of the point
+  const Origin3d V0 = b - a, V1 = c - a, V2 = Origin3d(closest) - a;
+  const double D00 = V0.dot(V0), D01 = V0.dot(V1), D11 = V1.dot(V1);
+  const double D20 = V2.dot(V0), D21 = V2.dot(V1);
+  const double DENOM = D00*D11 - D01*D01;
+  if (std::fabs(DENOM) < NEAR_ZERO)
+    return Vector3d(N, closest.pose);
+  const double V = (D11*D20 - D01*D21)/DENOM;
+  const double W = (D00*D21 - D01*D20)/DENOM;
+  const double U = 1.0 - V - W;
+
+  // determine the feature containing the point
+  const bool ZU = (U < NEAR_ZERO), ZV = (V < NEAR_ZERO), ZW = (W < NEAR_ZERO);
+  if (ZV && ZW)
+    return Vector3d(_vertex_normals[f.a], closest.pose);
+  else if (ZU && ZW)
+    return Vector3d(_vertex_normals[f.b], closest.pose);
+  else if (ZU && ZV)
+    return Vector3d(_vertex_normals[f.c], closest.pose);
+  else if (ZW)
+    return Vector3d(_edge_normals[tri*3], closest.pose);
+  else if (ZU)
+    return Vector3d(_edge_normals[tri*3+1], closest.pose);
+  else if (ZV)
+    return Vector3d(_edge_normals[tri*3+2], closest.pose);
+  else
+    return Vector3d(N, closest.pose);
+}
+
+/// Computes the signed distance from a point to the mesh
+/**
+ * \param mesh the closed mesh the hierarchy was built from
+ * \param p the query point (in the mesh frame)
+ * \param normal on return, the unit direction from the closest point on the
+ *        mesh toward p if p is outside, away from p if p is inside, or the
+ *        pseudo-normal of the closest feature if p lies on the mesh
+ * \return the signed distance (negative inside; infinite if the hierarchy
+ *         is empty)
+ */
+double FlatBVH::calc_signed_dist(const IndexedTriArray& mesh, const Point3d& p, Vector3d& normal) const
+{
+  // find the closest triangle
+  unsigned tri;
+  Point3d closest;
+  double dist = calc_closest_tri(mesh, p, tri, closest);
+  if (dist == std::numeric_limits<double>::max())
+  {
+    normal.set_zero(p.pose);
+    return dist;
+  }
+  dist = std::sqrt(dist);
+
+  // determine the side of the point using the pseudo-normal of the closest
+  // feature (a single triangle's normal can be wrong at edges and vertices)
+  Vector3d pseudo_normal = get_pseudo_normal(mesh, tri, closest);
+  Vector3d diff = p - closest;
+  const bool INSIDE = diff.dot(pseudo_normal) < 0.0;
+
+  // use the direction to the point as the normal, unless the point is on
+  // the mesh
+  if (dist > NEAR_ZERO)
+    normal = (INSIDE) ? -diff/dist : diff/dist;
+  else
+    normal = pseudo_normal;
+
+  return (INSIDE) ? -dist : dist;
+}
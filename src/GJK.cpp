@@ -448,6 +448,7 @@ double GJK::do_gjk(CollisionGeometryPtr A, CollisionGeometryPtr B, Point3d& clos
     }
   }
 
+  BINARY_LOG(LOG_COLDET)("gjk-max-iter", max_iter, min_dist);
   FILE_LOG(LOG_COLDET) << "GJK::do_gjk() exited" << std::endl;
   return min_dist;
 }
@@ -1,6 +1,7 @@
 // intersection.cpp : Defines the entry point for the console application.
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <Moby/Types.h>
 #include <Moby/CompGeom.h>
@@ -26,6 +27,14 @@ using boost::dynamic_pointer_cast;
 using namespace Ravelin;
 using namespace Moby;
 
+GaussianMixture::GaussianMixture()
+{
+  // setup an empty grid
+  _grid_nx = _grid_ny = 0;
+  _grid_x0 = _grid_y0 = (double) 0.0;
+  _cell_size = (double) 1.0;
+}
+
 /// Computes the OSG visualization
 osg::Node* GaussianMixture::create_visualization()
 {
@@ -86,12 +95,377 @@ osg::Node* GaussianMixture::create_visualization()
   #endif 
 }
 
-/// Computes the distance and normal from a point on the CSG
+/// Computes the (vertical) distance and normal from a point to the mixture surface
+/**
+ * \param p the point, defined in the primitive frame
+ */
 double GaussianMixture::calc_dist_and_normal(const Point3d& p, Vector3d& normal) const
 {
-  // TODO: implement this
-  assert(false);
-  return 0.0;
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // evaluate the height and gradient under the point
+  double h, dhdx, dhdy;
+  eval(p[X], p[Y], h, dhdx, dhdy);
+
+  // setup the surface normal
+  normal = Vector3d(-dhdx, -dhdy, (double) 1.0, p.pose);
+  normal.normalize();
+
+  return p[Z] - h;
+}
+
+/// Computes the height of the mixture (and the surface normal) at a point in the primitive frame
+double GaussianMixture::calc_height(double x, double y, Vector3d& normal) const
+{
+  double h, dhdx, dhdy;
+  eval(x, y, h, dhdx, dhdy);
+  normal = Vector3d(-dhdx, -dhdy, (double) 1.0, get_pose());
+  normal.normalize();
+  return h;
+}
+
+/// Computes the height of the mixture and its gradient at a batch of points in the primitive frame
+/**
+ * Runs of consecutive points that lie in the same grid cell are evaluated
+ * together, so callers sampling a neighborhood (e.g., footstep planners)
+ * should pass nearby points consecutively.
+ * \param n the number of points
+ * \param x the x coordinates of the points
+ * \param y the y coordinates of the points
+ * \param h on return, the heights at the points
+ * \param dhdx on return, the partial derivatives of height w.r.t. x (may be NULL)
+ * \param dhdy on return, the partial derivatives of height w.r.t. y (may be NULL)
+ */
+void GaussianMixture::calc_heights(unsigned n, const double* x, const double* y, double* h, double* dhdx, double* dhdy) const
+{
+  const unsigned CHUNK = 64;
+  double hc[CHUNK];
+  unsigned kmax[CHUNK];
+
+  for (unsigned s=0; s< n; )
+  {
+    // points off of the grid are supported by no Gaussian
+    unsigned i0, j0, i1, j1;
+    if (!get_cells(x[s], y[s], x[s], y[s], i0, j0, i1, j1))
+    {
+      h[s] = (double) 0.0;
+      if (dhdx)
+        dhdx[s] = (double) 0.0;
+      if (dhdy)
+        dhdy[s] = (double) 0.0;
+      s++;
+      continue;
+    }
+    const unsigned CELL = j0*_grid_nx + i0;
+
+    // gather the run of subsequent points that lie in the same cell
+    unsigned e = s+1;
+    while (e < n && e-s < CHUNK && get_cells(x[e], y[e], x[e], y[e], i0, j0, i1, j1) && j0*_grid_nx + i0 == CELL)
+      e++;
+    const unsigned N = e - s;
+    const double* XS = x + s;
+    const double* YS = y + s;
+
+    // evaluate every Gaussian of the cell at all points of the run (no 
+    // branches, so the inner loop vectorizes over the points) 
+    const unsigned START = _cell_start[CELL], END = _cell_start[CELL+1];
+    for (unsigned j=0; j< N; j++)
+    {
+      hc[j] = (double) 0.0;
+      kmax[j] = END;
+    }
+    for (unsigned k=START; k< END; k++)
+    {
+      const double A = _cA[k], CTH = _ccth[k], STH = _csth[k];
+      const double X0 = _cx0[k], Y0 = _cy0[k], AX = _cax[k], AY = _cay[k];
+      for (unsigned j=0; j< N; j++)
+      {
+        const double DX = CTH*XS[j] + STH*YS[j] - X0;
+        const double DY = -STH*XS[j] + CTH*YS[j] - Y0;
+        const double HK = A * std::exp(-(DX*DX*AX + DY*DY*AY));
+        const bool GREATER = (HK > hc[j]);
+        hc[j] = GREATER ? HK : hc[j];
+        kmax[j] = GREATER ? k : kmax[j];
+      }
+    }
+
+    // store the heights and the gradients of the dominant Gaussians
+    for (unsigned j=0; j< N; j++)
+    {
+      double gx = (double) 0.0, gy = (double) 0.0;
+      if (kmax[j] < END)
+        calc_gradient(kmax[j], XS[j], YS[j], hc[j], gx, gy);
+      h[s+j] = hc[j];
+      if (dhdx)
+        dhdx[s+j] = gx;
+      if (dhdy)
+        dhdy[s+j] = gy;
+    }
+
+    s = e;
+  }
+}
+
+/// Computes the gradient of the height of one bucketed Gaussian at a point in the primitive frame
+/**
+ * \param k the index of the Gaussian in the cell arrays
+ * \param h the height of the Gaussian at the point
+ */
+void GaussianMixture::calc_gradient(unsigned k, double x, double y, double h, double& dhdx, double& dhdy) const
+{
+  const double DX = _ccth[k]*x + _csth[k]*y - _cx0[k];
+  const double DY = -_csth[k]*x + _ccth[k]*y - _cy0[k];
+  const double KX = _cax[k]*DX, KY = _cay[k]*DY;
+  dhdx = (double) -2.0 * h * (KX*_ccth[k] - KY*_csth[k]);
+  dhdy = (double) -2.0 * h * (KX*_csth[k] + KY*_ccth[k]);
+}
+
+/// Evaluates the height of the mixture and its gradient at a point in the primitive frame
+/**
+ * The height of the mixture is the maximum height over all Gaussians; only
+ * Gaussians whose support overlaps the grid cell containing the point are
+ * examined.
+ * \return the index of the dominant Gaussian, or -1 if no Gaussian supports
+ *         the point
+ */
+int GaussianMixture::eval(double x, double y, double& h, double& dhdx, double& dhdy) const
+{
+  const unsigned CHUNK = 64;
+  double hc[CHUNK];
+
+  // setup defaults
+  h = dhdx = dhdy = (double) 0.0;
+
+  // find the grid cell
+  unsigned i0, j0, i1, j1;
+  if (!get_cells(x, y, x, y, i0, j0, i1, j1))
+    return -1;
+  const unsigned CELL = j0*_grid_nx + i0;
+  const unsigned START = _cell_start[CELL], END = _cell_start[CELL+1];
+
+  // evaluate the Gaussians of the cell in chunks
+  int imax = -1;
+  for (unsigned k=START; k< END; k+= CHUNK)
+  {
+    const unsigned N = std::min(CHUNK, END - k);
+    const double* A = &_cA[k];
+    const double* CTH = &_ccth[k];
+    const double* STH = &_csth[k];
+    const double* X0 = &_cx0[k];
+    const double* Y0 = &_cy0[k];
+    const double* AX = &_cax[k];
+    const double* AY = &_cay[k];
+
+    // compute the heights (no branches, so this loop vectorizes)
+    for (unsigned j=0; j< N; j++)
+    {
+      const double DX = CTH[j]*x + STH[j]*y - X0[j];
+      const double DY = -STH[j]*x + CTH[j]*y - Y0[j];
+      hc[j] = A[j] * std::exp(-(DX*DX*AX[j] + DY*DY*AY[j]));
+    }
+
+    // find the maximum
+    for (unsigned j=0; j< N; j++)
+      if (hc[j] > h)
+      {
+        h = hc[j];
+        imax = (int) (k+j);
+      }
+  }
+
+  // see whether any Gaussian supports the point
+  if (imax < 0)
+    return -1;
+
+  // compute the gradient of the dominant Gaussian
+  calc_gradient((unsigned) imax, x, y, h, dhdx, dhdy);
+
+  return (int) _cell_gauss[imax];
+}
+
+/// Gets the (clamped) range of grid cells overlapped by a rectangle in the primitive frame
+/**
+ * \return <b>false</b> if the rectangle does not overlap the grid
+ */
+bool GaussianMixture::get_cells(double xmin, double ymin, double xmax, double ymax, unsigned& i0, unsigned& j0, unsigned& i1, unsigned& j1) const
+{
+  // look for an empty grid
+  if (_grid_nx == 0 || _grid_ny == 0)
+    return false;
+
+  // get the rectangle in grid coordinates
+  const double U0 = (xmin - _grid_x0)/_cell_size;
+  const double V0 = (ymin - _grid_y0)/_cell_size;
+  const double U1 = (xmax - _grid_x0)/_cell_size;
+  const double V1 = (ymax - _grid_y0)/_cell_size;
+
+  // check for no overlap
+  if (U1 < 0.0 || V1 < 0.0 || U0 >= (double) _grid_nx || V0 >= (double) _grid_ny)
+    return false;
+
+  // clamp the cell indices
+  i0 = (U0 < 0.0) ? 0 : (unsigned) U0;
+  j0 = (V0 < 0.0) ? 0 : (unsigned) V0;
+  i1 = (unsigned) std::min(U1, (double) (_grid_nx-1));
+  j1 = (unsigned) std::min(V1, (double) (_grid_ny-1));
+  return true;
+}
+
+/// Computes an upper bound on the mixture height over a rectangle in the primitive frame
+double GaussianMixture::calc_height_bound(double xmin, double ymin, double xmax, double ymax) const
+{
+  // Gaussians are truncated to zero beyond the height NEAR_ZERO
+  double hmax = NEAR_ZERO;
+
+  // get the cells overlapped by the rectangle
+  unsigned i0, j0, i1, j1;
+  if (!get_cells(xmin, ymin, xmax, ymax, i0, j0, i1, j1))
+    return hmax;
+
+  // get the maximum bound over the cells
+  for (unsigned j=j0; j<= j1; j++)
+    for (unsigned i=i0; i<= i1; i++)
+      hmax = std::max(hmax, _cell_hmax[j*_grid_nx+i]);
+
+  return hmax;
+}
+
+/// Constructs the grid used to accelerate height queries
+/**
+ * Each Gaussian is truncated where its height falls below NEAR_ZERO and is
+ * bucketed into every grid cell that its (circular) support overlaps. Each
+ * cell also stores an upper bound on the mixture height over the cell, so
+ * that queries well above the terrain can be rejected without evaluating any
+ * Gaussians.
+ */
+void GaussianMixture::construct_grid()
+{
+  const unsigned MAX_CELLS = 512;
+  const double INF = std::numeric_limits<double>::max();
+
+  // clear the grid
+  _grid_nx = _grid_ny = 0;
+  _cell_start.clear();
+  _cell_gauss.clear();
+  _cell_hmax.clear();
+  _cA.clear();
+  _ccth.clear();
+  _csth.clear();
+  _cx0.clear();
+  _cy0.clear();
+  _cax.clear();
+  _cay.clear();
+
+  // compute the center and support radius of each Gaussian
+  vector<double> cx(_gauss.size()), cy(_gauss.size()), r(_gauss.size());
+  vector<double> sigma(_gauss.size());
+  double xmin = INF, ymin = INF, xmax = -INF, ymax = -INF, rsum = 0.0;
+  unsigned nsupported = 0;
+  for (unsigned i=0; i< _gauss.size(); i++)
+  {
+    const Gauss& g = _gauss[i];
+    const double CTH = std::cos(g.th), STH = std::sin(g.th);
+    cx[i] = CTH*g.x0 - STH*g.y0;
+    cy[i] = STH*g.x0 + CTH*g.y0;
+    sigma[i] = std::max(g.sigma_x, g.sigma_y);
+    r[i] = (g.A > NEAR_ZERO) ? sigma[i]*std::sqrt((double) 2.0*std::log(g.A/NEAR_ZERO)) : (double) 0.0;
+    if (r[i] <= (double) 0.0)
+      continue;
+    xmin = std::min(xmin, cx[i] - r[i]);
+    ymin = std::min(ymin, cy[i] - r[i]);
+    xmax = std::max(xmax, cx[i] + r[i]);
+    ymax = std::max(ymax, cy[i] + r[i]);
+    rsum += r[i];
+    nsupported++;
+  }
+
+  // look for no Gaussians
+  if (nsupported == 0)
+    return;
+
+  // size the cells using the mean support radius (bounding the number of cells)
+  const double EXTENT = std::max(xmax - xmin, ymax - ymin);
+  _cell_size = std::max(rsum/nsupported, EXTENT/MAX_CELLS);
+  _grid_x0 = xmin;
+  _grid_y0 = ymin;
+  _grid_nx = std::min((unsigned) std::ceil((xmax - xmin)/_cell_size), MAX_CELLS);
+  _grid_ny = std::min((unsigned) std::ceil((ymax - ymin)/_cell_size), MAX_CELLS);
+  _grid_nx = std::max(_grid_nx, (unsigned) 1);
+  _grid_ny = std::max(_grid_ny, (unsigned) 1);
+  const unsigned NCELLS = _grid_nx*_grid_ny;
+
+  // bucket the Gaussians into cells; first pass counts, second pass fills
+  _cell_start.resize(NCELLS+1, 0);
+  _cell_hmax.resize(NCELLS, NEAR_ZERO);
+  vector<unsigned> fill;
+  for (unsigned pass=0; pass< 2; pass++)
+  {
+    if (pass == 1)
+    {
+      // convert counts to offsets 
+      for (unsigned c=0; c< NCELLS; c++)
+        _cell_start[c+1] += _cell_start[c];
+      _cell_gauss.resize(_cell_start[NCELLS]);
+      fill.assign(_cell_start.begin(), _cell_start.end()-1);
+    }
+
+    for (unsigned k=0; k< _gauss.size(); k++)
+    {
+      if (r[k] <= (double) 0.0)
+        continue;
+
+      // get the cells overlapped by the support's bounding square
+      unsigned i0, j0, i1, j1;
+      if (!get_cells(cx[k]-r[k], cy[k]-r[k], cx[k]+r[k], cy[k]+r[k], i0, j0, i1, j1))
+        continue;
+
+      for (unsigned j=j0; j<= j1; j++)
+        for (unsigned i=i0; i<= i1; i++)
+        {
+          // get the distance from the center to the cell
+          const double CX0 = _grid_x0 + i*_cell_size, CY0 = _grid_y0 + j*_cell_size;
+          const double DX = std::max((double) 0.0, std::max(CX0 - cx[k], cx[k] - CX0 - _cell_size));
+          const double DY = std::max((double) 0.0, std::max(CY0 - cy[k], cy[k] - CY0 - _cell_size));
+          const double D2 = DX*DX + DY*DY;
+          if (D2 > r[k]*r[k])
+            continue;
+
+          const unsigned CELL = j*_grid_nx + i;
+          if (pass == 0)
+          {
+            // count the entry
+            _cell_start[CELL+1]++;
+
+            // update the height bound over the cell
+            const double HBOUND = _gauss[k].A*std::exp(-D2/((double) 2.0*sigma[k]*sigma[k]));
+            _cell_hmax[CELL] = std::max(_cell_hmax[CELL], HBOUND);
+          }
+          else
+            _cell_gauss[fill[CELL]++] = k;
+        }
+    }
+  }
+
+  // setup the coefficients for each entry
+  const unsigned NENTRIES = _cell_gauss.size();
+  _cA.resize(NENTRIES);
+  _ccth.resize(NENTRIES);
+  _csth.resize(NENTRIES);
+  _cx0.resize(NENTRIES);
+  _cy0.resize(NENTRIES);
+  _cax.resize(NENTRIES);
+  _cay.resize(NENTRIES);
+  for (unsigned k=0; k< NENTRIES; k++)
+  {
+    const Gauss& g = _gauss[_cell_gauss[k]];
+    _cA[k] = g.A;
+    _ccth[k] = std::cos(g.th);
+    _csth[k] = std::sin(g.th);
+    _cx0[k] = g.x0;
+    _cy0[k] = g.y0;
+    _cax[k] = (double) 1.0/((double) 2.0*g.sigma_x*g.sigma_x);
+    _cay[k] = (double) 1.0/((double) 2.0*g.sigma_y*g.sigma_y);
+  }
 }
 
 /// Finds the signed distance between the sphere and another primitive
@@ -421,6 +795,9 @@ void GaussianMixture::rebuild(const vector<Gauss>& gauss)
   // copy the Gaussians
   _gauss = gauss;
 
+  // bucket the Gaussians for height queries
+  construct_grid();
+
   // construct sets of vertices
   construct_vertices();
 
@@ -455,6 +832,10 @@ void GaussianMixture::construct_BVs(CollisionGeometryPtr geom)
   shared_ptr<const Pose3d> P = get_pose();
   assert(!P->rpose);
 
+  // setup the pose of the primitive relative to the geometry, used by queries
+  _query_pose = shared_ptr<Pose3d>(new Pose3d(*P));
+  _query_pose->rpose = gpose;
+
   // setup a transform
   Transform3d T;
   T.source = gpose;
@@ -571,25 +952,12 @@ void GaussianMixture::construct_vertices()
 /// Determines whether a point is inside one of the Gaussians
 bool GaussianMixture::point_inside(BVPtr bv, const Point3d& point, Vector3d& normal) const
 {
-  double a,b,c,X,Y,Z,X_next,eps;
-  static shared_ptr<Pose3d> P;
-  
-  const double PARAM_BOUND = -5.0;
-  int n=0;
-  const int NMAX = _gauss.size(); 
-
-  // get the pose for the collision geometry
-  shared_ptr<const Pose3d> gpose = bv->geom->get_pose(); 
-
-  // get the pose for this geometry and BV
-  shared_ptr<const Pose3d> bpose = get_pose(); 
-  assert(!bpose->rpose);
+  const unsigned X = 0, Y = 1, Z = 2;
 
-  // setup a new pose
-  if (!P)
-    P = shared_ptr<Pose3d>(new Pose3d);
-  *P = *bpose;
-  P->rpose = gpose;
+  // get the pose of the primitive relative to the geometry (built with the
+  // BVs and only read here, so that queries may run concurrently)
+  assert(bv->geom == _geom && _query_pose);
+  shared_ptr<const Pose3d> P = _query_pose;
 
   // get the transform from the point pose to the Gaussian pose
   Transform3d T = Pose3d::calc_relative_pose(point.pose, P); 
@@ -597,71 +965,22 @@ bool GaussianMixture::point_inside(BVPtr bv, const Point3d& point, Vector3d& nor
   // convert the point to primitive space
   Point3d p = T.transform_point(point);
 
-  // find max(z) of gaussians
-  double tempX,tempY,tempZ,tempMax;
-  tempX=p[0];
-  tempY=p[1];
-  tempMax = -std::numeric_limits<double>::max();
-  int num = 0;
-  for(int i=0;i<_gauss.size();i++){
-
-    // compute some constants
-    const double CTH = std::cos(_gauss[i].th);
-    const double STH = std::sin(_gauss[i].th); 
-    const double S2TH = std::sin((double) 2.0 * _gauss[i].th); 
-
-    a = CTH*CTH/2/_gauss[i].sigma_x*_gauss[i].sigma_x + STH*STH/2/_gauss[i].sigma_y*_gauss[i].sigma_y;
-    b = -S2TH/4/_gauss[i].sigma_x*_gauss[i].sigma_x + S2TH/4/_gauss[i].sigma_y*_gauss[i].sigma_y;
-    c = STH*STH/2/_gauss[i].sigma_x*_gauss[i].sigma_x + CTH*CTH/2/_gauss[i].sigma_y*_gauss[i].sigma_y;
-    tempZ = _gauss[i].A*std::exp( - (a*(tempX-_gauss[i].x0)*a*(tempX-_gauss[i].x0) + 2*b*(tempX-_gauss[i].x0)*(tempY-_gauss[i].y0) + c*(tempY-_gauss[i].y0)*(tempY-_gauss[i].y0)));
-    //tempZ=_gauss[i].A/std::exp((tempX - _gauss[i].x0)*(tempX - _gauss[i].x0)/(2*_gauss[i].sigma_x) + ((tempY - _gauss[i].y0)*(tempY - _gauss[i].y0))/(2*_gauss[i].sigma_y)); 
-    if(tempZ>tempMax){
-      tempMax=tempZ;
-      num = i;
-    }
-  }
-
-  //*************************************************************
-  // check p is already inside
-  if(p[2] <= tempMax)
-  {
-    // compute some constants
-    const double CTH = std::cos(_gauss[num].th);
-    const double STH = std::sin(_gauss[num].th); 
-    const double S2TH = std::sin((double) 2.0 * _gauss[num].th); 
-
-    // normal -------------------------------------------------------------
-    a = CTH/2/_gauss[num].sigma_x*_gauss[num].sigma_x + STH/2/_gauss[num].sigma_y*_gauss[num].sigma_y;
-    b = -S2TH/4/_gauss[num].sigma_x*_gauss[num].sigma_x + S2TH/4/_gauss[num].sigma_y*_gauss[num].sigma_y;
-    c = STH*STH/2/_gauss[num].sigma_x*_gauss[num].sigma_x + CTH*CTH/2/_gauss[num].sigma_y*_gauss[num].sigma_y;
-      
-    X = tempX;
-    Y = tempY;
-    Z = tempMax;
-    // w.r.t F(x,y)
-    normal[0] = _gauss[num].A*std::exp((S2TH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x) - S2TH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y))*(X - _gauss[num].x0)*(Y - _gauss[num].y0) - (CTH*CTH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y) + STH*STH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x))*(Y - _gauss[num].y0)*(Y - _gauss[num].y0) - (CTH*CTH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x) + STH*STH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y))*(X - _gauss[num].x0)*(X - _gauss[num].x0))*((S2TH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x) - S2TH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y))*(Y - _gauss[num].y0) - (CTH*CTH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x) + STH*STH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y))*(2*X - 2*_gauss[num].x0));
-    normal[1] = _gauss[num].A*std::exp((S2TH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x) - S2TH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y))*(X - _gauss[num].x0)*(Y - _gauss[num].y0) - (CTH*CTH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y) + STH*STH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x))*(Y - _gauss[num].y0)*(Y - _gauss[num].y0) - (CTH*CTH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x) + STH*STH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y))*(X - _gauss[num].x0)*(X - _gauss[num].x0))*((S2TH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x) - S2TH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y))*(X - _gauss[num].x0) - (CTH*CTH/(2*_gauss[num].sigma_y*_gauss[num].sigma_y) + STH*STH/(2*_gauss[num].sigma_x*_gauss[num].sigma_x))*(2*Y - 2*_gauss[num].y0));
-    normal[2] = +1;
+  // points above the coarse height bound are outside
+  if (p[Z] > calc_height_bound(p[X], p[Y], p[X], p[Y]))
+    return false;
 
-    // normalize the normal
-    normal.normalize();
-    normal = T.inverse_transform_vector(normal);
+  // evaluate the height under the point
+  double h, dhdx, dhdy;
+  eval(p[X], p[Y], h, dhdx, dhdy);
+  if (p[Z] > h)
+    return false;
 
-    if(tempMax-p[2] <= std::exp(PARAM_BOUND*2)) //error bound
-    {      
-      // cout<<"inside errorbound= "<<endl;
-      // cout<<"X= "<<isect[0] <<" Y= "<<isect[1] <<" Z= "<<isect[2] <<endl;
-      return true;
-    }
-    if(a==0 && b==0) // no tangent
-    {
-      // cout<<"X= "<<isect[0] <<" Y= "<<isect[1] <<" Z= "<<isect[2] <<endl;
-      return true;
-    }
-  }
+  // compute the surface normal and transform it back
+  normal = Vector3d(-dhdx, -dhdy, (double) 1.0, P);
+  normal.normalize();
+  normal = T.inverse_transform_vector(normal);
 
-  // if we're here, point is outside
-  return false;
+  return true;
 }
 
 /// Evaluates the intersection function (for Newton-Raphson)
@@ -744,23 +1063,14 @@ bool GaussianMixture::intersect_seg(BVPtr bv, const LineSeg3& seg,double& tisect
 {
   const unsigned X = 0, Y = 1, Z = 2;
   const double INF = std::numeric_limits<double>::max();
-  static shared_ptr<Pose3d> P;
 
-  // setup intersection vectors
-  SAFESTATIC vector<double> t, depth;
+  // get this thread's vector of candidate Gaussians
+  vector<unsigned>& candidates = _candidates();
 
-  // get the pose for the collision geometry
-  shared_ptr<const Pose3d> gpose = bv->geom->get_pose(); 
-
-  // get the pose for this geometry and BV
-  shared_ptr<const Pose3d> bpose = get_pose(); 
-  assert(!bpose->rpose);
-
-  // setup a new pose
-  if (!P)
-    P = shared_ptr<Pose3d>(new Pose3d);
-  *P = *bpose;
-  P->rpose = gpose;
+  // get the pose of the primitive relative to the geometry (built with the
+  // BVs and only read here, so that queries may run concurrently)
+  assert(bv->geom == _geom && _query_pose);
+  shared_ptr<const Pose3d> P = _query_pose;
 
   // get the transform from the line segment pose to the primitive pose
   Transform3d T = Pose3d::calc_relative_pose(seg.first.pose, P); 
@@ -769,62 +1079,74 @@ bool GaussianMixture::intersect_seg(BVPtr bv, const LineSeg3& seg,double& tisect
   Point3d p = T.transform_point(seg.first);
   Point3d q = T.transform_point(seg.second);
 
-  // determine whether any starting points are inside the Gaussians
-  depth.resize(_gauss.size());
-  for (unsigned i=0; i< _gauss.size(); i++)
-    depth[i] = p[Z] - gauss(_gauss[i], p[X], p[Y]);
+  // get the footprint of the segment
+  const double XMIN = std::min(p[X], q[X]), XMAX = std::max(p[X], q[X]);
+  const double YMIN = std::min(p[Y], q[Y]), YMAX = std::max(p[Y], q[Y]);
+
+  // segments entirely above the coarse height bound cannot intersect
+  if (std::min(p[Z], q[Z]) > calc_height_bound(XMIN, YMIN, XMAX, YMAX))
+    return false;
 
-  // see whether any points are inside the Gaussians
-  unsigned mini = std::min_element(depth.begin(), depth.end()) - depth.begin();
-  if (depth[mini] < (double) 0.0)
+  // determine whether the starting point is inside the Gaussians
+  double h, dhdx, dhdy;
+  eval(p[X], p[Y], h, dhdx, dhdy);
+  if (p[Z] - h < (double) 0.0)
   {
     // point is inside, compute and transform the normal
     tisect = (double) 0.0;
     isect = seg.first; 
     
     // compute the transformed normal
-    normal = T.inverse_transform_vector(grad(_gauss[mini], p[X], p[Y]));
+    normal = Vector3d(-dhdx, -dhdy, (double) 1.0, P);
+    normal.normalize();
+    normal = T.inverse_transform_vector(normal);
 
     return true;
   }
 
   // no points are inside; make sure that a point on the line segment is
   // inside
-  for (unsigned i=0; i< _gauss.size(); i++)
-    depth[i] = q[Z] - gauss(_gauss[i], q[X], q[Y]);
-
-  // see whether all points are outside
-  mini = std::min_element(depth.begin(), depth.end()) - depth.begin();
-  if (depth[mini] > (double) 0.0)
+  eval(q[X], q[Y], h, dhdx, dhdy);
+  if (q[Z] - h > (double) 0.0)
     return false;
 
-  // still here? use Newton-Raphson 
-  t.resize(_gauss.size());
-  for (unsigned i=0; i< _gauss.size(); i++)
-    t[i] = INF;
+  // get the Gaussians bucketed under the segment
+  candidates.clear();
+  unsigned i0, j0, i1, j1;
+  if (get_cells(XMIN, YMIN, XMAX, YMAX, i0, j0, i1, j1))
+    for (unsigned j=j0; j<= j1; j++)
+      for (unsigned i=i0; i<= i1; i++)
+      {
+        const unsigned CELL = j*_grid_nx + i;
+        candidates.insert(candidates.end(), _cell_gauss.begin()+_cell_start[CELL], _cell_gauss.begin()+_cell_start[CELL+1]);
+      }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
 
-  // compute t
-  for (unsigned i=0; i< _gauss.size(); i++)
+  // still here? use Newton-Raphson on Gaussians containing the end point
+  tisect = INF;
+  for (unsigned i=0; i< candidates.size(); i++)
   {
     // only apply to appropriate points 
-    if (depth[i] > (double) 0.0)
+    const Gauss& g = _gauss[candidates[i]];
+    if (q[Z] - gauss(g, q[X], q[Y]) > (double) 0.0)
       continue;
 
     // apply Newton-Raphson
-    t[i] = newton_raphson(_gauss[i], p, q);
+    tisect = std::min(tisect, newton_raphson(g, p, q));
   }
 
-  // get the first intersection
-  mini = std::min_element(t.begin(), t.end()) - t.begin();
-
-  // compute the point of intersection and normal
-  tisect = t[mini];
-  isect = p + (q-p)*tisect;
+  // look for no convergence
+  if (tisect == INF)
+    return false;
 
   // compute transformed normal
   double x = p[X] + (q[X] - p[X])*tisect;
   double y = p[Y] + (q[Y] - p[Y])*tisect;
-  normal = T.inverse_transform_vector(grad(_gauss[mini], x, y));
+  eval(x, y, h, dhdx, dhdy);
+  normal = Vector3d(-dhdx, -dhdy, (double) 1.0, P);
+  normal.normalize();
+  normal = T.inverse_transform_vector(normal);
 
   // compute and transform intersection point
   isect = seg.first + (seg.second-seg.first)*tisect;
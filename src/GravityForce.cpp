@@ -30,20 +30,35 @@ GravityForce::GravityForce(const GravityForce& source)
   operator=(source);
 }
 
+/// Adds the force of gravity to a rigid body
+/**
+ * The force acts at the center-of-mass; it is expressed in the global frame
+ * (with the corresponding moment) so that no pose needs to be allocated.
+ */
+static void add_gravity(RigidBodyPtr rb, const Vector3d& gravity)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // get the center-of-mass and the force (global frame)
+  Transform3d T = Pose3d::calc_relative_pose(rb->get_inertial_pose(), GLOBAL);
+  const double m = rb->get_mass();
+  Vector3d com(T.x[X], T.x[Y], T.x[Z], GLOBAL);
+  Vector3d f(gravity[X]*m, gravity[Y]*m, gravity[Z]*m, GLOBAL);
+
+  // setup the wrench and add it
+  SForced w(GLOBAL);
+  w.set_force(f);
+  w.set_torque(Vector3d::cross(com, f));
+  rb->add_force(w);
+}
+
 /// Adds gravity to a body
 void GravityForce::add_force(DynamicBodyPtr body)
 {
   // check to see whether body is a rigid body first 
   shared_ptr<RigidBody> rb = dynamic_pointer_cast<RigidBody>(body);
   if (rb)
-  {
-    shared_ptr<Pose3d> P(new Pose3d(*rb->get_inertial_pose()));
-    P->update_relative_pose(GLOBAL);
-    P->q.set_identity();
-    SForced w(boost::const_pointer_cast<const Pose3d>(P));
-    w.set_force(gravity * rb->get_mass());
-    rb->add_force(w);        
-  }
+    add_gravity(rb, gravity);
   else
   {
     // it's an articulated body, get it as such
@@ -55,14 +70,7 @@ void GravityForce::add_force(DynamicBodyPtr body)
       
       // apply gravity force to all links
       BOOST_FOREACH(RigidBodyPtr rb, links)
-      {
-        shared_ptr<Pose3d> P(new Pose3d(*rb->get_inertial_pose()));
-        P->update_relative_pose(GLOBAL);
-        P->q.set_identity();
-        SForced w(boost::const_pointer_cast<const Pose3d>(P));
-        w.set_force(gravity * rb->get_mass());
-        rb->add_force(w);        
-      }
+        add_gravity(rb, gravity);
     }
   }
 }
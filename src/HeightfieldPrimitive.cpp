@@ -0,0 +1,897 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <algorithm>
+#ifdef USE_OSG
+#include <osg/Geode>
+#include <osg/Geometry>
+#endif
+#include <Moby/Constants.h>
+#include <Moby/XMLTree.h>
+#include <Moby/OBB.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/SpherePrimitive.h>
+#include <Moby/BoxPrimitive.h>
+#include <Moby/HeightfieldPrimitive.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using boost::const_pointer_cast;
+using std::string;
+using std::map;
+using std::list;
+using std::vector;
+using std::pair;
+using std::make_pair;
+
+// the number of cells (along each dimension) in the finest pyramid tile
+const unsigned TILE = 8;
+
+// the maximum number of cells examined when bounding the slope for a query
+const unsigned MAX_SLOPE_CELLS = 256;
+
+/// Creates an empty heightfield
+HeightfieldPrimitive::HeightfieldPrimitive()
+{
+  init();
+}
+
+/// Creates an empty heightfield at the given transform
+HeightfieldPrimitive::HeightfieldPrimitive(const Pose3d& T) : Primitive(T)
+{
+  init();
+}
+
+/// Releases the memory mapping, if any
+HeightfieldPrimitive::~HeightfieldPrimitive()
+{
+  unmap_file();
+}
+
+/// Sets default values
+void HeightfieldPrimitive::init()
+{
+  _map_addr = NULL;
+  _map_len = 0;
+  _samples = NULL;
+  _format = eFloat32;
+  _maxval = (double) 1.0;
+  _rows = _cols = 0;
+  _dx = _dy = (double) 1.0;
+  _hscale = (double) 1.0;
+  _x0 = _y0 = (double) 0.0;
+}
+
+/// Memory maps a file (read only)
+void HeightfieldPrimitive::map_file(const string& filename)
+{
+  // release any existing mapping
+  unmap_file();
+
+  // open the file
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("HeightfieldPrimitive - unable to open " + filename);
+
+  // get the file size
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    close(fd);
+    throw std::runtime_error("HeightfieldPrimitive - unable to read " + filename);
+  }
+
+  // map the file; the mapping remains valid after the descriptor is closed
+  void* addr = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED)
+    throw std::runtime_error("HeightfieldPrimitive - unable to map " + filename);
+
+  _map_addr = addr;
+  _map_len = (size_t) st.st_size;
+  _filename = filename;
+}
+
+/// Releases the memory mapping, if any
+void HeightfieldPrimitive::unmap_file()
+{
+  if (_map_addr)
+    munmap(_map_addr, _map_len);
+  _map_addr = NULL;
+  _map_len = 0;
+}
+
+/// Loads heights from a raw file of (native) 32-bit floats in row-major order
+void HeightfieldPrimitive::load_raw(const string& filename, unsigned rows, unsigned cols)
+{
+  // map the file
+  map_file(filename);
+
+  // verify that the file is large enough
+  if (_map_len < (size_t) rows*cols*sizeof(float))
+  {
+    unmap_file();
+    throw std::runtime_error("HeightfieldPrimitive::load_raw() - " + filename + " is smaller than rows x cols");
+  }
+
+  // setup the samples
+  _heights.clear();
+  _samples = (const unsigned char*) _map_addr;
+  _format = eFloat32;
+  _maxval = (double) 1.0;
+  setup_grid(rows, cols);
+}
+
+/// Loads heights from a binary (P5) PGM file
+/**
+ * Samples are normalized to [0, 1] (before the height scale is applied); the
+ * first row of the image lies at the minimum y coordinate.
+ */
+void HeightfieldPrimitive::load_pgm(const string& filename)
+{
+  // map the file
+  map_file(filename);
+  const char* data = (const char*) _map_addr;
+
+  // verify the magic number
+  if (_map_len < 2 || data[0] != 'P' || data[1] != '5')
+  {
+    unmap_file();
+    throw std::runtime_error("HeightfieldPrimitive::load_pgm() - " + filename + " is not a binary PGM file");
+  }
+
+  // read the width, height, and maximum value
+  size_t pos = 2;
+  unsigned header[3];
+  for (unsigned k=0; k< 3; k++)
+  {
+    // skip whitespace and comments
+    while (pos < _map_len && (std::isspace(data[pos]) || data[pos] == '#'))
+    {
+      if (data[pos] == '#')
+        while (pos < _map_len && data[pos] != '\n')
+          pos++;
+      else
+        pos++;
+    }
+
+    // read the number
+    header[k] = 0;
+    while (pos < _map_len && std::isdigit(data[pos]))
+      header[k] = header[k]*10 + (unsigned) (data[pos++] - '0');
+  }
+
+  // skip the single whitespace character before the samples
+  pos++;
+
+  // verify the header and size
+  const unsigned COLS = header[0], ROWS = header[1], MAXVAL = header[2];
+  const size_t SAMPLE_SZ = (MAXVAL < 256) ? 1 : 2;
+  if (MAXVAL == 0 || pos + (size_t) ROWS*COLS*SAMPLE_SZ > _map_len)
+  {
+    unmap_file();
+    throw std::runtime_error("HeightfieldPrimitive::load_pgm() - " + filename + " is truncated or corrupt");
+  }
+
+  // setup the samples
+  _heights.clear();
+  _samples = (const unsigned char*) data + pos;
+  _format = (SAMPLE_SZ == 1) ? eUInt8 : eUInt16;
+  _maxval = (double) MAXVAL;
+  setup_grid(ROWS, COLS);
+}
+
+/// Sets the heights directly (row major, rows along y)
+void HeightfieldPrimitive::set_heights(const vector<double>& heights, unsigned rows, unsigned cols)
+{
+  if (heights.size() != (size_t) rows*cols)
+    throw std::runtime_error("HeightfieldPrimitive::set_heights() - heights must have rows x cols entries");
+
+  // release any mapping and copy the heights
+  unmap_file();
+  _filename.clear();
+  _heights.resize(heights.size());
+  std::copy(heights.begin(), heights.end(), _heights.begin());
+
+  // setup the samples
+  _samples = (const unsigned char*) &_heights[0];
+  _format = eFloat32;
+  _maxval = (double) 1.0;
+  setup_grid(rows, cols);
+}
+
+/// Sets the spacing between samples
+void HeightfieldPrimitive::set_spacing(double dx, double dy)
+{
+  if (dx <= (double) 0.0 || dy <= (double) 0.0)
+    throw std::runtime_error("HeightfieldPrimitive::set_spacing() - spacing must be positive");
+
+  _dx = dx;
+  _dy = dy;
+  setup_grid(_rows, _cols);
+}
+
+/// Sets the multiplier applied to every sample
+void HeightfieldPrimitive::set_height_scale(double scale)
+{
+  _hscale = scale;
+  setup_grid(_rows, _cols);
+}
+
+/// Sets up the grid dimensions and everything that depends upon them
+void HeightfieldPrimitive::setup_grid(unsigned rows, unsigned cols)
+{
+  // nothing to do if no samples have been set
+  if (!_samples)
+    return;
+
+  if (rows < 2 || cols < 2)
+    throw std::runtime_error("HeightfieldPrimitive - heightfields require at least two rows and two columns");
+
+  // center the grid on the origin
+  _rows = rows;
+  _cols = cols;
+  _x0 = -(double) 0.5 * (cols-1) * _dx;
+  _y0 = -(double) 0.5 * (rows-1) * _dy;
+
+  // the mesh is no longer valid
+  _mesh.reset();
+  _smesh.first.reset();
+  _smesh.second.clear();
+  _invalidated = true;
+
+  // rebuild the pyramid and bounding volumes
+  build_pyramid();
+  update_OBBs();
+}
+
+/// Gets the (scaled) height sample at row i and column j
+double HeightfieldPrimitive::get_sample(unsigned i, unsigned j) const
+{
+  const size_t k = (size_t) i*_cols + j;
+  switch (_format)
+  {
+    case eFloat32:
+    {
+      float f;
+      std::memcpy(&f, _samples + k*sizeof(float), sizeof(float));
+      return _hscale * (double) f;
+    }
+
+    case eUInt8:
+      return _hscale * (double) _samples[k] / _maxval;
+
+    case eUInt16:
+      return _hscale * (double) ((_samples[2*k] << 8) | _samples[2*k+1]) / _maxval;
+  }
+
+  return (double) 0.0;
+}
+
+/// Builds the min/max pyramid over tiles of the grid
+void HeightfieldPrimitive::build_pyramid()
+{
+  _prows.clear();
+  _pcols.clear();
+  _pmin.clear();
+  _pmax.clear();
+
+  // setup the finest level: each tile covers TILE x TILE cells
+  unsigned nr = (_rows - 2)/TILE + 1;
+  unsigned nc = (_cols - 2)/TILE + 1;
+  _prows.push_back(nr);
+  _pcols.push_back(nc);
+  _pmin.push_back(vector<float>(nr*nc, std::numeric_limits<float>::max()));
+  _pmax.push_back(vector<float>(nr*nc, -std::numeric_limits<float>::max()));
+  for (unsigned i=0; i< _rows; i++)
+    for (unsigned j=0; j< _cols; j++)
+    {
+      // samples on tile borders belong to both neighboring tiles
+      const float H = (float) get_sample(i, j);
+      const unsigned A0 = (i == 0) ? 0 : (i-1)/TILE, A1 = std::min(i/TILE, nr-1);
+      const unsigned B0 = (j == 0) ? 0 : (j-1)/TILE, B1 = std::min(j/TILE, nc-1);
+      for (unsigned a=A0; a<= A1; a++)
+        for (unsigned b=B0; b<= B1; b++)
+        {
+          _pmin[0][a*nc+b] = std::min(_pmin[0][a*nc+b], H);
+          _pmax[0][a*nc+b] = std::max(_pmax[0][a*nc+b], H);
+        }
+    }
+
+  // build coarser levels until a single tile remains
+  while (nr > 1 || nc > 1)
+  {
+    const unsigned L = _pmin.size()-1;
+    const unsigned NR = (nr+1)/2, NC = (nc+1)/2;
+    vector<float> lmin(NR*NC, std::numeric_limits<float>::max());
+    vector<float> lmax(NR*NC, -std::numeric_limits<float>::max());
+    for (unsigned a=0; a< nr; a++)
+      for (unsigned b=0; b< nc; b++)
+      {
+        const unsigned K = (a/2)*NC + b/2;
+        lmin[K] = std::min(lmin[K], _pmin[L][a*nc+b]);
+        lmax[K] = std::max(lmax[K], _pmax[L][a*nc+b]);
+      }
+    _pmin.push_back(lmin);
+    _pmax.push_back(lmax);
+    _prows.push_back(nr = NR);
+    _pcols.push_back(nc = NC);
+  }
+}
+
+/// Computes bounds on the height over a rectangle in the primitive frame
+/**
+ * The bounds are conservative and take constant time to compute.
+ */
+void HeightfieldPrimitive::calc_height_bounds(double xmin, double ymin, double xmax, double ymax, double& hmin, double& hmax) const
+{
+  // look for no samples
+  if (_pmin.empty())
+  {
+    hmin = hmax = (double) 0.0;
+    return;
+  }
+
+  // get the range of cells covered by the rectangle (clamped to the grid)
+  const double U0 = std::max((double) 0.0, std::min((xmin - _x0)/_dx, (double) (_cols-2)));
+  const double U1 = std::max((double) 0.0, std::min((xmax - _x0)/_dx, (double) (_cols-2)));
+  const double V0 = std::max((double) 0.0, std::min((ymin - _y0)/_dy, (double) (_rows-2)));
+  const double V1 = std::max((double) 0.0, std::min((ymax - _y0)/_dy, (double) (_rows-2)));
+
+  // get the range of tiles at the finest level
+  unsigned a0 = (unsigned) V0/TILE, a1 = (unsigned) V1/TILE;
+  unsigned b0 = (unsigned) U0/TILE, b1 = (unsigned) U1/TILE;
+
+  // move up the pyramid until the rectangle covers at most 2x2 tiles
+  unsigned L = 0;
+  while ((a1 - a0 > 1 || b1 - b0 > 1) && L+1 < _pmin.size())
+  {
+    a0 >>= 1;  a1 >>= 1;
+    b0 >>= 1;  b1 >>= 1;
+    L++;
+  }
+
+  // get the bounds over the tiles
+  hmin = std::numeric_limits<double>::max();
+  hmax = -std::numeric_limits<double>::max();
+  for (unsigned a=a0; a<= a1; a++)
+    for (unsigned b=b0; b<= b1; b++)
+    {
+      hmin = std::min(hmin, (double) _pmin[L][a*_pcols[L]+b]);
+      hmax = std::max(hmax, (double) _pmax[L][a*_pcols[L]+b]);
+    }
+}
+
+/// Gets the axis-aligned bounds of the heightfield in the primitive frame
+void HeightfieldPrimitive::get_bounds(Point3d& lo, Point3d& hi) const
+{
+  const double HMIN = (_pmin.empty()) ? 0.0 : (double) _pmin.back().front();
+  const double HMAX = (_pmax.empty()) ? 0.0 : (double) _pmax.back().front();
+  lo = Point3d(_x0, _y0, HMIN, get_pose());
+  hi = Point3d(-_x0, -_y0, HMAX, get_pose());
+}
+
+/// Computes the (bilinearly interpolated) height at a point in the primitive frame
+double HeightfieldPrimitive::calc_height(double x, double y) const
+{
+  double dhdx, dhdy;
+  return calc_height(x, y, dhdx, dhdy);
+}
+
+/// Computes the (bilinearly interpolated) height and its gradient at a point in the primitive frame
+double HeightfieldPrimitive::calc_height(double x, double y, double& dhdx, double& dhdy) const
+{
+  // look for no samples
+  if (!_samples)
+  {
+    dhdx = dhdy = (double) 0.0;
+    return (double) 0.0;
+  }
+
+  // get the grid coordinates (clamped to the grid)
+  const double U = std::max((double) 0.0, std::min((x - _x0)/_dx, (double) (_cols-1)));
+  const double V = std::max((double) 0.0, std::min((y - _y0)/_dy, (double) (_rows-1)));
+
+  // get the cell and the coordinates within it
+  const unsigned J = std::min((unsigned) U, _cols-2);
+  const unsigned I = std::min((unsigned) V, _rows-2);
+  const double FU = U - J, FV = V - I;
+
+  // get the corner heights
+  const double H00 = get_sample(I, J);
+  const double H01 = get_sample(I, J+1);
+  const double H10 = get_sample(I+1, J);
+  const double H11 = get_sample(I+1, J+1);
+
+  // compute the gradient and height
+  dhdx = ((H01 - H00)*((double) 1.0 - FV) + (H11 - H10)*FV)/_dx;
+  dhdy = ((H10 - H00)*((double) 1.0 - FU) + (H11 - H01)*FU)/_dy;
+  return (H00*((double) 1.0 - FU) + H01*FU)*((double) 1.0 - FV) +
+         (H10*((double) 1.0 - FU) + H11*FU)*FV;
+}
+
+/// Computes an upper bound on the slope of the heightfield over a rectangle in the primitive frame
+/**
+ * \return <b>false</b> if the rectangle covers too many cells to bound the
+ *         slope cheaply (slope is not set)
+ */
+bool HeightfieldPrimitive::calc_max_slope(double xmin, double ymin, double xmax, double ymax, double& slope) const
+{
+  // look for no samples
+  if (!_samples)
+  {
+    slope = (double) 0.0;
+    return true;
+  }
+
+  // get the range of cells covered by the rectangle (clamped to the grid;
+  // heights are constant beyond the grid, so no steeper slopes lie there)
+  const unsigned J0 = (unsigned) std::max((double) 0.0, std::min((xmin - _x0)/_dx, (double) (_cols-2)));
+  const unsigned J1 = (unsigned) std::max((double) 0.0, std::min((xmax - _x0)/_dx, (double) (_cols-2)));
+  const unsigned I0 = (unsigned) std::max((double) 0.0, std::min((ymin - _y0)/_dy, (double) (_rows-2)));
+  const unsigned I1 = (unsigned) std::max((double) 0.0, std::min((ymax - _y0)/_dy, (double) (_rows-2)));
+  if ((size_t) (I1-I0+1)*(J1-J0+1) > MAX_SLOPE_CELLS)
+    return false;
+
+  // the bilinear gradient over a cell is bounded by its edge differences
+  double max_sq = (double) 0.0;
+  for (unsigned i=I0; i<= I1; i++)
+    for (unsigned j=J0; j<= J1; j++)
+    {
+      const double H00 = get_sample(i, j), H01 = get_sample(i, j+1);
+      const double H10 = get_sample(i+1, j), H11 = get_sample(i+1, j+1);
+      const double SX = std::max(std::fabs(H01 - H00), std::fabs(H11 - H10))/_dx;
+      const double SY = std::max(std::fabs(H10 - H00), std::fabs(H11 - H01))/_dy;
+      max_sq = std::max(max_sq, SX*SX + SY*SY);
+    }
+
+  slope = std::sqrt(max_sq);
+  return true;
+}
+
+/// Computes the distance and normal from a point to the heightfield
+/**
+ * The normal is that of the heightfield directly below (or above) the
+ * point. The distance is a lower bound on the signed distance, as conservative
+ * advancement requires: for points above the heightfield, the height gap is
+ * divided by the steepest slope within that gap of the point (or, if that
+ * region is large, the point's height above the highest sample under it is
+ * used); for points below, the (negative) height gap is returned.
+ * \param p the point, defined in the primitive frame
+ */
+double HeightfieldPrimitive::calc_dist_and_normal(const Point3d& p, Vector3d& normal) const
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // get the height and gradient under the point
+  double dhdx, dhdy;
+  const double H = calc_height(p[X], p[Y], dhdx, dhdy);
+
+  // setup the normal
+  const double NRM = std::sqrt(dhdx*dhdx + dhdy*dhdy + (double) 1.0);
+  normal = Vector3d(-dhdx/NRM, -dhdy/NRM, (double) 1.0/NRM, p.pose);
+
+  // points on or below the heightfield are no deeper than the height gap
+  const double GAP = p[Z] - H;
+  if (GAP <= (double) 0.0)
+    return GAP;
+
+  // no part of the heightfield within the gap (horizontally) of the point
+  // rises faster than the maximum slope L, so the distance is at least
+  // GAP/sqrt(1 + L^2)
+  double L;
+  if (calc_max_slope(p[X] - GAP, p[Y] - GAP, p[X] + GAP, p[Y] + GAP, L))
+    return GAP/std::sqrt((double) 1.0 + L*L);
+
+  // too many cells: the heightfield within the gap of the point lies below
+  // the maximum height there
+  double hmin, hmax;
+  calc_height_bounds(p[X] - GAP, p[Y] - GAP, p[X] + GAP, p[Y] + GAP, hmin, hmax);
+  return std::max((double) 0.0, p[Z] - hmax);
+}
+
+/// Computes the distances and normals from a set of points to the heightfield
+/**
+ * \param p the points, defined in the primitive frame
+ * \param dist on return, the distance of each point from the heightfield
+ * \param normals on return, the heightfield normal beneath each point
+ */
+void HeightfieldPrimitive::calc_dist_and_normal(const vector<Point3d>& p, vector<double>& dist, vector<Vector3d>& normals) const
+{
+  dist.resize(p.size());
+  normals.resize(p.size());
+  for (unsigned i=0; i< p.size(); i++)
+    dist[i] = calc_dist_and_normal(p[i], normals[i]);
+}
+
+/// Computes the signed distance of a point from the heightfield
+double HeightfieldPrimitive::calc_signed_dist(const Point3d& p)
+{
+  assert(p.pose == get_pose());
+
+  Vector3d normal;
+  return calc_dist_and_normal(p, normal);
+}
+
+/// Computes the signed distance from a point (in the box frame) to a box, and the closest point on the box
+static double calc_box_dist(const BoxPrimitive& box, const Point3d& p, Point3d& closest)
+{
+  const double EXT[3] = { box.get_x_len()*0.5, box.get_y_len()*0.5, box.get_z_len()*0.5 };
+
+  // clamp the point to the box
+  closest = p;
+  double sq_dist = (double) 0.0;
+  for (unsigned i=0; i< 3; i++)
+  {
+    closest[i] = std::max(-EXT[i], std::min(EXT[i], p[i]));
+    sq_dist += (p[i] - closest[i])*(p[i] - closest[i]);
+  }
+  if (sq_dist > (double) 0.0)
+    return std::sqrt(sq_dist);
+
+  // point is inside: project it onto the nearest face
+  unsigned k = 0;
+  for (unsigned i=1; i< 3; i++)
+    if (EXT[i] - std::fabs(p[i]) < EXT[k] - std::fabs(p[k]))
+      k = i;
+  closest[k] = (p[k] < (double) 0.0) ? -EXT[k] : EXT[k];
+  return std::fabs(p[k]) - EXT[k];
+}
+
+/// Computes the signed distance between the heightfield and another primitive
+double HeightfieldPrimitive::calc_signed_dist(shared_ptr<const Primitive> p, shared_ptr<const Pose3d> pose_this, shared_ptr<const Pose3d> pose_p, Point3d& pthis, Point3d& pp) const
+{
+  vector<Point3d> verts;
+  Vector3d normal;
+
+  // get the transform from the other primitive to this
+  Transform3d T = Pose3d::calc_relative_pose(pose_p, pose_this);
+
+  // spheres: use the distance from the center
+  shared_ptr<const SpherePrimitive> spherep = dynamic_pointer_cast<const SpherePrimitive>(p);
+  if (spherep)
+  {
+    // get the sphere center in this frame
+    Point3d c = T.transform_point(Point3d(0.0, 0.0, 0.0, pose_p));
+    c.pose = get_pose();
+    const double D = calc_dist_and_normal(c, normal);
+    normal.pose = pose_this;
+
+    // setup the closest points
+    c.pose = pose_this;
+    pthis = c - normal*D;
+    pp = T.inverse_transform_point(c - normal*spherep->get_radius());
+    return D - spherep->get_radius();
+  }
+
+  // boxes: use the corners (samples under the box are checked below)
+  shared_ptr<const BoxPrimitive> boxp = dynamic_pointer_cast<const BoxPrimitive>(p);
+  if (boxp)
+  {
+    const double HX = boxp->get_x_len()*0.5, HY = boxp->get_y_len()*0.5, HZ = boxp->get_z_len()*0.5;
+    for (unsigned i=0; i< 8; i++)
+      verts.push_back(Point3d((i & 1) ? HX : -HX, (i & 2) ? HY : -HY, (i & 4) ? HZ : -HZ, pose_p));
+  }
+  else
+  {
+    // other primitives: use the vertices
+    const_pointer_cast<Primitive>(p)->get_vertices(verts);
+    for (unsigned i=0; i< verts.size(); i++)
+      verts[i].pose = pose_p;
+  }
+
+  // find the closest vertex (and the XY footprint of the vertices)
+  const unsigned X = 0, Y = 1;
+  double min_dist = std::numeric_limits<double>::max();
+  double xmin = std::numeric_limits<double>::max(), xmax = -xmin;
+  double ymin = xmin, ymax = xmax;
+  for (unsigned i=0; i< verts.size(); i++)
+  {
+    Point3d v = T.transform_point(verts[i]);
+    v.pose = get_pose();
+    xmin = std::min(xmin, v[X]);  xmax = std::max(xmax, v[X]);
+    ymin = std::min(ymin, v[Y]);  ymax = std::max(ymax, v[Y]);
+    const double D = calc_dist_and_normal(v, normal);
+    if (D < min_dist)
+    {
+      min_dist = D;
+      normal.pose = v.pose = pose_this;
+      pthis = v - normal*D;
+      pp = verts[i];
+    }
+  }
+
+  // boxes: a peak of the heightfield may reach a face without any corner
+  // nearing the heightfield, so also check the samples under the box
+  if (boxp && _samples && !verts.empty())
+  {
+    // get the range of samples within the footprint
+    const double U0 = std::ceil((xmin - _x0)/_dx), U1 = std::floor((xmax - _x0)/_dx);
+    const double V0 = std::ceil((ymin - _y0)/_dy), V1 = std::floor((ymax - _y0)/_dy);
+    if (U1 >= (double) 0.0 && V1 >= (double) 0.0 && U0 <= (double) (_cols-1) && V0 <= (double) (_rows-1))
+    {
+      const unsigned J0 = (unsigned) std::max(U0, (double) 0.0), J1 = (unsigned) std::min(U1, (double) (_cols-1));
+      const unsigned I0 = (unsigned) std::max(V0, (double) 0.0), I1 = (unsigned) std::min(V1, (double) (_rows-1));
+      for (unsigned i=I0; i<= I1; i++)
+        for (unsigned j=J0; j<= J1; j++)
+        {
+          // get the sample in the box frame
+          Point3d s(_x0 + j*_dx, _y0 + i*_dy, get_sample(i, j), pose_this);
+          Point3d sb = T.inverse_transform_point(s);
+
+          // get the signed distance from the sample to the box
+          Point3d closest;
+          const double D = calc_box_dist(*boxp, sb, closest);
+          if (D < min_dist)
+          {
+            min_dist = D;
+            pthis = s;
+            pp = closest;
+            pp.pose = pose_p;
+          }
+        }
+    }
+  }
+
+  return min_dist;
+}
+
+/// Updates the bounding volumes to reflect the current grid and pose
+void HeightfieldPrimitive::update_OBBs()
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // get the pose for this primitive
+  shared_ptr<const Pose3d> P = get_pose();
+  assert(!P->rpose);
+
+  // get the bounds of the heightfield
+  Point3d lo, hi;
+  get_bounds(lo, hi);
+
+  for (map<CollisionGeometryPtr, OBBPtr>::iterator i = _obbs.begin(); i != _obbs.end(); i++)
+  {
+    // get the pose for the geometry
+    shared_ptr<const Pose3d> gpose = i->first->get_pose();
+
+    // setup a transform from the primitive frame to the geometry frame
+    Transform3d T;
+    T.source = gpose;
+    T.target = gpose;
+    T.q = P->q;
+    T.x = P->x;
+
+    // setup the OBB
+    OBBPtr obb = i->second;
+    obb->center = T.transform_point(Point3d(0.0, 0.0, (lo[Z] + hi[Z])*0.5, gpose));
+    obb->R = P->q;
+    obb->l[X] = hi[X];
+    obb->l[Y] = hi[Y];
+    obb->l[Z] = (hi[Z] - lo[Z])*0.5;
+  }
+}
+
+/// Gets the bounding volume for the heightfield
+BVPtr HeightfieldPrimitive::get_BVH_root(CollisionGeometryPtr geom)
+{
+  // heightfields are not applicable for deformable bodies
+  if (is_deformable())
+    throw std::runtime_error("HeightfieldPrimitive::get_BVH_root(CollisionGeometryPtr geom) - primitive unusable for deformable bodies!");
+
+  // get the pointer to the bounding box
+  OBBPtr& obb = _obbs[geom];
+
+  // create the bounding box, if necessary
+  if (!obb)
+  {
+    obb = shared_ptr<OBB>(new OBB);
+    obb->geom = geom;
+    update_OBBs();
+  }
+
+  return obb;
+}
+
+/// Transforms the primitive
+void HeightfieldPrimitive::set_pose(const Pose3d& p)
+{
+  // go ahead and set the new transform
+  Primitive::set_pose(p);
+
+  // invalidate the mesh
+  _mesh.reset();
+  _smesh.first.reset();
+  _smesh.second.clear();
+  _invalidated = true;
+
+  // update the bounding volumes
+  update_OBBs();
+}
+
+/// Gets the samples of the heightfield (in the primitive frame)
+void HeightfieldPrimitive::get_vertices(vector<Point3d>& vertices)
+{
+  vertices.clear();
+  vertices.reserve((size_t) _rows*_cols);
+  for (unsigned i=0; i< _rows; i++)
+    for (unsigned j=0; j< _cols; j++)
+      vertices.push_back(Point3d(_x0 + j*_dx, _y0 + i*_dy, get_sample(i, j), get_pose()));
+}
+
+/// Gets the triangle mesh (two triangles per cell), computing it if necessary
+shared_ptr<const IndexedTriArray> HeightfieldPrimitive::get_mesh()
+{
+  if (!_mesh)
+  {
+    // setup the vertices
+    vector<Origin3d> verts;
+    verts.reserve((size_t) _rows*_cols);
+    for (unsigned i=0; i< _rows; i++)
+      for (unsigned j=0; j< _cols; j++)
+        verts.push_back(Origin3d(_x0 + j*_dx, _y0 + i*_dy, get_sample(i, j)));
+
+    // setup the facets (counter-clockwise when viewed from above)
+    vector<IndexedTri> facets;
+    if (_rows > 1 && _cols > 1)
+      facets.reserve((size_t) (_rows-1)*(_cols-1)*2);
+    for (unsigned i=0; i+1 < _rows; i++)
+      for (unsigned j=0; j+1 < _cols; j++)
+      {
+        const unsigned A = i*_cols + j, B = A + 1, C = A + _cols, D = C + 1;
+        facets.push_back(IndexedTri(A, B, D));
+        facets.push_back(IndexedTri(A, D, C));
+      }
+
+    // create the mesh
+    _mesh = shared_ptr<IndexedTriArray>(new IndexedTriArray(verts.begin(), verts.end(), facets.begin(), facets.end()));
+
+    // setup sub mesh (it will be just the standard mesh)
+    list<unsigned> all_tris;
+    for (unsigned i=0; i< _mesh->num_tris(); i++)
+      all_tris.push_back(i);
+    _smesh = make_pair(_mesh, all_tris);
+  }
+
+  return _mesh;
+}
+
+/// Gets a sub-mesh for the primitive
+const pair<shared_ptr<const IndexedTriArray>, list<unsigned> >& HeightfieldPrimitive::get_sub_mesh(BVPtr bv)
+{
+  if (!_smesh.first)
+    get_mesh();
+  return _smesh;
+}
+
+/// Creates the visualization for this primitive
+osg::Node* HeightfieldPrimitive::create_visualization()
+{
+  #ifdef USE_OSG
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // create a new group to hold the geometry
+  osg::Group* group = new osg::Group;
+  osg::Geode* geode = new osg::Geode;
+  osg::Geometry* geom = new osg::Geometry;
+  geode->addDrawable(geom);
+  group->addChild(geode);
+
+  // get the vertices and facets
+  shared_ptr<const IndexedTriArray> mesh = get_mesh();
+  const std::vector<Origin3d>& verts = mesh->get_vertices();
+  const std::vector<IndexedTri>& facets = mesh->get_facets();
+
+  // create the vertex array
+  osg::Vec3Array* varray = new osg::Vec3Array(verts.size());
+  for (unsigned i=0; i< verts.size(); i++)
+    (*varray)[i] = osg::Vec3((float) verts[i][X], (float) verts[i][Y], (float) verts[i][Z]);
+  geom->setVertexArray(varray);
+
+  // create the faces
+  osg::DrawElementsUInt* faces = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES, 0);
+  for (unsigned i=0; i< facets.size(); i++)
+  {
+    faces->push_back(facets[i].a);
+    faces->push_back(facets[i].b);
+    faces->push_back(facets[i].c);
+  }
+  geom->addPrimitiveSet(faces);
+
+  return group;
+  #else
+  return NULL;
+  #endif
+}
+
+/// Implements Base::load_from_xml() for serialization
+void HeightfieldPrimitive::load_from_xml(shared_ptr<const XMLTree> node, map<string, BasePtr>& id_map)
+{
+  // verify that the node type is correct
+  assert(strcasecmp(node->name.c_str(), "Heightfield") == 0);
+
+  // load the parent data
+  Primitive::load_from_xml(node, id_map);
+
+  // read the spacing and height scale
+  XMLAttrib* dx_attr = node->get_attrib("dx");
+  XMLAttrib* dy_attr = node->get_attrib("dy");
+  XMLAttrib* hscale_attr = node->get_attrib("height-scale");
+  if (dx_attr)
+    _dx = dx_attr->get_real_value();
+  if (dy_attr)
+    _dy = dy_attr->get_real_value();
+  if (hscale_attr)
+    _hscale = hscale_attr->get_real_value();
+  if (_dx <= (double) 0.0 || _dy <= (double) 0.0)
+    throw std::runtime_error("HeightfieldPrimitive::load_from_xml() - spacing must be positive");
+
+  // make sure that the heightfield has a filename specified
+  XMLAttrib* fname_attr = node->get_attrib("filename");
+  if (!fname_attr)
+  {
+    std::cerr << "HeightfieldPrimitive::load_from_xml() - trying to load a ";
+    std::cerr << " heightfield w/o a filename!" << std::endl;
+    std::cerr << "  offending node: " << std::endl << *node << std::endl;
+    return;
+  }
+
+  // get the filename and its lowercase version
+  string fname(fname_attr->get_string_value());
+  string fname_lower = fname;
+  std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), (int(*)(int)) std::tolower);
+
+  // load PGM files directly; raw files need their dimensions
+  if (fname_lower.size() >= 4 && fname_lower.compare(fname_lower.size()-4, 4, ".pgm") == 0)
+    load_pgm(fname);
+  else
+  {
+    XMLAttrib* rows_attr = node->get_attrib("rows");
+    XMLAttrib* cols_attr = node->get_attrib("cols");
+    if (!rows_attr || !cols_attr)
+      throw std::runtime_error("HeightfieldPrimitive::load_from_xml() - raw heightfields require 'rows' and 'cols' attributes");
+    load_raw(fname, rows_attr->get_unsigned_value(), cols_attr->get_unsigned_value());
+  }
+}
+
+/// Implements Base::save_to_xml() for serialization
+/**
+ * \note heights set directly (via set_heights()) are not saved
+ */
+void HeightfieldPrimitive::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base> >& shared_objects) const
+{
+  // save the parent data
+  Primitive::save_to_xml(node, shared_objects);
+
+  // (re)set the node name
+  node->name = "Heightfield";
+
+  // save the spacing and height scale
+  node->attribs.insert(XMLAttrib("dx", _dx));
+  node->attribs.insert(XMLAttrib("dy", _dy));
+  node->attribs.insert(XMLAttrib("height-scale", _hscale));
+
+  // save the file data
+  if (!_filename.empty())
+  {
+    node->attribs.insert(XMLAttrib("filename", _filename));
+    if (_format == eFloat32)
+    {
+      node->attribs.insert(XMLAttrib("rows", _rows));
+      node->attribs.insert(XMLAttrib("cols", _cols));
+    }
+  }
+}
+
@@ -47,6 +47,14 @@ ImpactEventHandler::ImpactEventHandler()
   ip_eps = 1e-6;
   use_ip_solver = false;
 
+  // setup parameters for the block-sparse solver
+  sparse_min_contacts = 100;
+  sparse_max_iterations = 100;
+  sparse_eps = 1e-8;
+
+  // setup the scratch frame for compute_rigid_contact_data()
+  _rc_P = shared_ptr<Pose3d>(new Pose3d);
+
   // setup variables to help warmstarting
   _last_contacts = _last_limits = _last_contact_constraints = 0;
 
@@ -134,14 +142,21 @@ void ImpactEventHandler::apply_model(const vector<Event>& events, double max_tim
           if (e->contact_mu_coulomb < 1e2)
             all_inf = false;
           if (e->contact_mu_coulomb > 0.0)
-            all_frictionless = true;
+            all_frictionless = false;
         }
 
+      // large groups of contacts use the block-sparse representation
+      const bool SPARSE = use_sparse_solver(revents);
+
       // apply model to the reduced contacts
       if (all_inf)   
         apply_inf_friction_model_to_connected_events(revents);
+      else if (all_frictionless && SPARSE)
+        apply_sparse_model_to_connected_events(revents, false);
       else if (all_frictionless)
         apply_visc_friction_model_to_connected_events(revents);
+      else if (SPARSE)
+        apply_sparse_model_to_connected_events(revents, true);
       else
         apply_model_to_connected_events(revents);
 
@@ -416,6 +431,13 @@ void ImpactEventHandler::update_from_stacked(EventProblemData& q, const VectorNd
   else
     q.update_from_stacked_nqp(z);
 
+  // add the impulses to the events
+  add_event_impulses(q);
+}
+
+/// Adds the impulses in q (cn, cs, ct, and l) to the events
+void ImpactEventHandler::add_event_impulses(const EventProblemData& q)
+{
   // setup a temporary frame
   shared_ptr<Pose3d> P(new Pose3d);
 
@@ -1026,11 +1048,14 @@ void ImpactEventHandler::compute_problem_data(EventProblemData& q)
   RowIteratord CsCt = q.Cs_iM_CtT.row_iterator_begin();
   RowIteratord CtCt = q.Ct_iM_CtT.row_iterator_begin();
 
+  // contacts between free rigid bodies are handled in closed form
+  const bool RIGID_CONTACTS = compute_rigid_contact_data(q);
+
   // process contact events, setting up matrices
   for (unsigned i=0; i< q.contact_events.size(); i++) 
   {
     // compute cross event data for contact events
-    for (unsigned j=0; j< q.contact_events.size(); j++)
+    for (unsigned j=0; j< q.contact_events.size() && !RIGID_CONTACTS; j++)
     {
       // reset _MM
       _MM.set_zero(3, 3);
@@ -1125,6 +1150,181 @@ void ImpactEventHandler::compute_problem_data(EventProblemData& q)
   }
 }
 
+/// Computes the contact/contact blocks of the problem data in closed form when every contact is between free rigid bodies
+/**
+ * The spatial inertia of a free rigid body, taken in a frame at its center
+ * of mass that is aligned with the global frame, is block diagonal: the
+ * mass and the 3x3 rotational inertia about the center of mass (there is
+ * no coupling term, unlike in the mixed frame, whose origin is generally
+ * not the center of mass). With r = p - x (p the contact point, x the
+ * center of mass) and R = [n s t], the contact Jacobian is [R' G'], where
+ * the columns of G are r x n, r x s, and r x t. Every 3x3 block of
+ * contact-space inertia contributed by the body is then
+ * R_i'R_j/m + G_i'inv(J)G_j, and the contact velocity contributed is
+ * R_i'v + G_i'w; no Jacobians are built and no generalized inertias are
+ * factored. Each body's incident contacts are processed in a single pass
+ * over contiguous arrays. If q.sparse_contacts is set, the blocks are added
+ * to q.C_iM_CT (whose structure must already be set) instead.
+ * \return <b>true</b> if the contact/contact blocks (and contact velocities)
+ *         were computed, <b>false</b> (and nothing is computed) if some
+ *         contact involves a link of an articulated body
+ */
+bool ImpactEventHandler::compute_rigid_contact_data(EventProblemData& q)
+{
+  const unsigned X = 0, Y = 1, Z = 2, N = 0, S = 1, T = 2;
+  const unsigned NC = q.contact_events.size();
+
+  // all contacts must be between free rigid bodies
+  _rc_bodies.clear();
+  for (unsigned i=0; i< NC; i++)
+  {
+    DynamicBodyPtr su1 = get_super_body(q.contact_events[i]->contact_geom1->get_single_body());
+    DynamicBodyPtr su2 = get_super_body(q.contact_events[i]->contact_geom2->get_single_body());
+    RigidBodyPtr rb1 = dynamic_pointer_cast<RigidBody>(su1);
+    RigidBodyPtr rb2 = dynamic_pointer_cast<RigidBody>(su2);
+    if (!rb1 || !rb2)
+      return false;
+    _rc_bodies.push_back(rb1);
+    _rc_bodies.push_back(rb2);
+  }
+
+  // make the bodies unique
+  std::sort(_rc_bodies.begin(), _rc_bodies.end());
+  _rc_bodies.erase(std::unique(_rc_bodies.begin(), _rc_bodies.end()), _rc_bodies.end());
+  const unsigned NB = _rc_bodies.size();
+
+  // store the contact directions (columns n, s, t) and find the contacts
+  // incident to each body: +1 for the first geometry's body, -1 for the
+  // second's (the directions are negated for the second body)
+  _rc_R.resize(NC*9);
+  _rc_incident.resize(NB);
+  for (unsigned i=0; i< NB; i++)
+    _rc_incident[i].clear();
+  for (unsigned i=0; i< NC; i++)
+  {
+    const Event& e = *q.contact_events[i];
+    assert(e.contact_normal.pose == GLOBAL);
+    assert(e.contact_tan1.pose == GLOBAL);
+    assert(e.contact_tan2.pose == GLOBAL);
+    double* R = &_rc_R[i*9];
+    R[N*3+X] = e.contact_normal[X]; R[N*3+Y] = e.contact_normal[Y]; R[N*3+Z] = e.contact_normal[Z];
+    R[S*3+X] = e.contact_tan1[X];   R[S*3+Y] = e.contact_tan1[Y];   R[S*3+Z] = e.contact_tan1[Z];
+    R[T*3+X] = e.contact_tan2[X];   R[T*3+Y] = e.contact_tan2[Y];   R[T*3+Z] = e.contact_tan2[Z];
+
+    RigidBodyPtr rb1 = dynamic_pointer_cast<RigidBody>(get_super_body(e.contact_geom1->get_single_body()));
+    RigidBodyPtr rb2 = dynamic_pointer_cast<RigidBody>(get_super_body(e.contact_geom2->get_single_body()));
+    unsigned b1 = std::lower_bound(_rc_bodies.begin(), _rc_bodies.end(), rb1) - _rc_bodies.begin();
+    unsigned b2 = std::lower_bound(_rc_bodies.begin(), _rc_bodies.end(), rb2) - _rc_bodies.begin();
+    _rc_incident[b1].push_back(std::make_pair(i, 1.0));
+    _rc_incident[b2].push_back(std::make_pair(i, -1.0));
+  }
+
+  // process each body
+  for (unsigned b=0; b< NB; b++)
+  {
+    // disabled bodies have no generalized coordinates
+    RigidBodyPtr rb = _rc_bodies[b];
+    if (!rb->is_enabled())
+      continue;
+
+    // get the inertia and velocity in a frame at the center of mass that is
+    // aligned with the global frame
+    _rc_P->set_identity();
+    _rc_P->rpose = GLOBAL;
+    _rc_P->x = Pose3d::calc_relative_pose(rb->get_inertial_pose(), GLOBAL).x;
+    SpatialRBInertiad J = Pose3d::transform(_rc_P, rb->get_inertia());
+    SVelocityd xd = Pose3d::transform(_rc_P, rb->get_velocity());
+    Vector3d v = xd.get_linear(), w = xd.get_angular();
+    const double inv_m = 1.0/J.m;
+    Matrix3d iJ = Matrix3d::invert(J.J);
+    const Origin3d& x = _rc_P->x;
+
+    // compute G and inv(J)*G for every incident contact
+    const std::vector<std::pair<unsigned, double> >& inc = _rc_incident[b];
+    const unsigned NI = inc.size();
+    _rc_G.resize(NI*9);
+    _rc_H.resize(NI*9);
+    for (unsigned k=0; k< NI; k++)
+    {
+      const Point3d& p = q.contact_events[inc[k].first]->contact_point;
+      const double rx = p[X] - x[X], ry = p[Y] - x[Y], rz = p[Z] - x[Z];
+      const double* R = &_rc_R[inc[k].first*9];
+      double* G = &_rc_G[k*9];
+      double* H = &_rc_H[k*9];
+      for (unsigned c=0; c< 9; c+= 3)
+      {
+        G[c+X] = ry*R[c+Z] - rz*R[c+Y];
+        G[c+Y] = rz*R[c+X] - rx*R[c+Z];
+        G[c+Z] = rx*R[c+Y] - ry*R[c+X];
+        H[c+X] = iJ(X,X)*G[c+X] + iJ(X,Y)*G[c+Y] + iJ(X,Z)*G[c+Z];
+        H[c+Y] = iJ(Y,X)*G[c+X] + iJ(Y,Y)*G[c+Y] + iJ(Y,Z)*G[c+Z];
+        H[c+Z] = iJ(Z,X)*G[c+X] + iJ(Z,Y)*G[c+Y] + iJ(Z,Z)*G[c+Z];
+      }
+    }
+
+    // accumulate the contact velocities and the contact-space inertia blocks
+    for (unsigned k=0; k< NI; k++)
+    {
+      const unsigned i = inc[k].first;
+      const double si = inc[k].second;
+      const double* Ri = &_rc_R[i*9];
+      const double* Gi = &_rc_G[k*9];
+
+      // the velocity along direction d is d'v + (r x d)'w
+      double vel[3];
+      for (unsigned r=0; r< 3; r++)
+      {
+        const double* d = Ri + r*3;
+        const double* g = Gi + r*3;
+        vel[r] = si*(d[X]*v[X] + d[Y]*v[Y] + d[Z]*v[Z] + 
+                     g[X]*w[X] + g[Y]*w[Y] + g[Z]*w[Z]);
+      }
+      q.Cn_v[i] += vel[N];
+      q.Cs_v[i] += vel[S];
+      q.Ct_v[i] += vel[T];
+
+      for (unsigned l=0; l< NI; l++)
+      {
+        const unsigned j = inc[l].first;
+        const double sij = si*inc[l].second;
+        const double* Rj = &_rc_R[j*9];
+        const double* Hj = &_rc_H[l*9];
+
+        // compute the 3x3 block R_i'R_j/m + G_i'H_j
+        double K[3][3];
+        for (unsigned r=0; r< 3; r++)
+          for (unsigned c=0; c< 3; c++)
+          {
+            const double* d1 = Ri + r*3, * d2 = Rj + c*3;
+            const double* g = Gi + r*3, * h = Hj + c*3;
+            K[r][c] = sij*(inv_m*(d1[X]*d2[X] + d1[Y]*d2[Y] + d1[Z]*d2[Z]) +
+                           g[X]*h[X] + g[Y]*h[Y] + g[Z]*h[Z]);
+          }
+
+        // setup appropriate parts of contact inertia matrices
+        if (q.sparse_contacts)
+        {
+          double* B = q.C_iM_CT.get_block(i,j);
+          for (unsigned r=0; r< 3; r++)
+            for (unsigned c=0; c< 3; c++)
+              B[r*3+c] += K[r][c];
+        }
+        else
+        {
+          q.Cn_iM_CnT(i,j) += K[N][N];
+          q.Cn_iM_CsT(i,j) += K[N][S];
+          q.Cn_iM_CtT(i,j) += K[N][T];
+          q.Cs_iM_CsT(i,j) += K[S][S];
+          q.Cs_iM_CtT(i,j) += K[S][T];
+          q.Ct_iM_CtT(i,j) += K[T][T];
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
 /// Solves the viscous friction LCP
 void ImpactEventHandler::apply_visc_friction_model(EventProblemData& q)
 {
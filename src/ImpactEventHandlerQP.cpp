@@ -93,7 +93,7 @@ void ImpactEventHandler::solve_qp(VectorNd& z, EventProblemData& q, double max_t
 /// Computes the kinetic energy of the system using the current impulse set
 double ImpactEventHandler::calc_ke(EventProblemData& q, const VectorNd& z)
 {
-  static VectorNd cn, cs, ct, l, alpha_x;
+  SAFESTATIC VectorNd cn, cs, ct, l, alpha_x;
 
   // save the current impulses
   cn = q.cn;
@@ -0,0 +1,419 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <algorithm>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include <limits>
+#include <cmath>
+#include <Moby/ArticulatedBody.h>
+#include <Moby/Constants.h>
+#include <Moby/Event.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/SingleBody.h>
+#include <Moby/RigidBody.h>
+#include <Moby/Log.h>
+#include <Moby/ImpactEventHandler.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using std::list;
+using boost::shared_ptr;
+using std::vector;
+using std::endl;
+using boost::dynamic_pointer_cast;
+
+// adds the velocity change due to an impulse change at contact i to the stacked contact velocities
+static void propagate_impulse(const ContactBlockMatrix& C, unsigned i, const double* dj, VectorNd& w)
+{
+  const unsigned N = 0, S = 1, T = 2;
+  const unsigned NC = C.size();
+
+  // block (j,i) is the transpose of block (i,j)
+  for (unsigned k=C.row_begin(i); k< C.row_begin(i+1); k++)
+  {
+    const double* K = C.block(k);
+    const unsigned j = C.column(k);
+    w[j] += K[N*3+N]*dj[N] + K[S*3+N]*dj[S] + K[T*3+N]*dj[T];
+    w[j+NC] += K[N*3+S]*dj[N] + K[S*3+S]*dj[S] + K[T*3+S]*dj[T];
+    w[j+NC*2] += K[N*3+T]*dj[N] + K[S*3+T]*dj[S] + K[T*3+T]*dj[T];
+  }
+}
+
+/// Determines whether a group of connected events should be handled with the block-sparse solver
+/**
+ * The block-sparse solver handles groups of at least sparse_min_contacts
+ * contact events that involve no limit events and no implicit joint
+ * constraints.
+ */
+bool ImpactEventHandler::use_sparse_solver(const list<Event*>& events) const
+{
+  // look for limit events
+  unsigned ncontacts = 0;
+  BOOST_FOREACH(const Event* e, events)
+    if (e->event_type != Event::eContact)
+      return false;
+    else
+      ncontacts++;
+
+  // see whether the group is large enough
+  if (ncontacts < sparse_min_contacts)
+    return false;
+
+  // look for implicit joint constraints
+  BOOST_FOREACH(const Event* e, events)
+  {
+    ArticulatedBodyPtr ab1 = e->contact_geom1->get_single_body()->get_articulated_body();
+    ArticulatedBodyPtr ab2 = e->contact_geom2->get_single_body()->get_articulated_body();
+    if (ab1 && ab1->num_constraint_eqns_implicit() > 0)
+      return false;
+    if (ab2 && ab2->num_constraint_eqns_implicit() > 0)
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * Applies the impact model to a large set of connected contact events using
+ * block-sparse contact-space data
+ * \param events a set of connected (contact) events
+ * \param coulomb if <b>true</b>, Coulomb friction is determined by the
+ *        iterative solver; otherwise, only viscous friction is modeled (as
+ *        in apply_visc_friction_model())
+ */
+void ImpactEventHandler::apply_sparse_model_to_connected_events(const list<Event*>& events, bool coulomb)
+{
+  FILE_LOG(LOG_EVENT) << "ImpactEventHandler::apply_sparse_model_to_connected_events() entered" << endl;
+
+  // reset problem data
+  _epd.reset();
+
+  // save the events
+  _epd.events = vector<Event*>(events.begin(), events.end());
+
+  // determine sets of contact and limit events
+  _epd.partition_events();
+
+  // compute all event cross-terms
+  compute_sparse_problem_data(_epd);
+
+  // clear all impulses
+  for (unsigned i=0; i< _epd.N_CONTACTS; i++)
+    _epd.contact_events[i]->contact_impulse.set_zero(GLOBAL);
+
+  // solve the model
+  solve_sparse_model(_epd, coulomb);
+
+  // determine velocities due to impulse application
+  update_sparse_event_velocities_from_impulses(_epd);
+
+  // get the constraint violation before applying impulses
+  double minv = calc_min_constraint_velocity(_epd);
+
+  // apply restitution (in the normal direction only)
+  if (apply_restitution(_epd))
+  {
+    // add the restitution impulses
+    _epd.cs.set_zero(_epd.N_CONTACTS);
+    _epd.ct.set_zero(_epd.N_CONTACTS);
+    add_event_impulses(_epd);
+
+    // determine velocities due to impulse application
+    update_sparse_event_velocities_from_impulses(_epd);
+
+    // check to see whether we need to solve another impact problem
+    double minv_plus = calc_min_constraint_velocity(_epd);
+    FILE_LOG(LOG_EVENT) << "Applying restitution" << std::endl;
+    FILE_LOG(LOG_EVENT) << "  compression v+ minimum: " << minv << std::endl;
+    FILE_LOG(LOG_EVENT) << "  restitution v+ minimum: " << minv_plus << std::endl;
+    if (minv_plus < 0.0 && minv_plus < minv - NEAR_ZERO)
+    {
+      // need to solve another impact problem
+      solve_sparse_model(_epd, coulomb);
+    }
+  }
+
+  // apply impulses
+  apply_impulses(_epd);
+
+  FILE_LOG(LOG_EVENT) << "ImpactEventHandler::apply_sparse_model_to_connected_events() exiting" << endl;
+}
+
+/// Computes the block-sparse problem data for a set of contact events
+/**
+ * Only contact/contact terms are computed; the dense contact/contact
+ * matrices of q are left empty.
+ */
+void ImpactEventHandler::compute_sparse_problem_data(EventProblemData& q)
+{
+  const unsigned N = 0, S = 1, T = 2;
+  const unsigned NC = q.contact_events.size();
+  assert(q.limit_events.empty());
+
+  // determine set of "super" bodies from contact events
+  q.super_bodies.clear();
+  for (unsigned i=0; i< NC; i++)
+  {
+    q.super_bodies.push_back(get_super_body(q.contact_events[i]->contact_geom1->get_single_body()));
+    q.super_bodies.push_back(get_super_body(q.contact_events[i]->contact_geom2->get_single_body()));
+  }
+
+  // make super bodies vector unique
+  std::sort(q.super_bodies.begin(), q.super_bodies.end());
+  q.super_bodies.erase(std::unique(q.super_bodies.begin(), q.super_bodies.end()), q.super_bodies.end());
+
+  // set total number of generalized coordinates
+  q.N_GC = 0;
+  for (unsigned i=0; i< q.super_bodies.size(); i++)
+    q.N_GC += q.super_bodies[i]->num_generalized_coordinates(DynamicBody::eSpatial);
+
+  // setup constants
+  q.N_CONTACTS = q.N_ACT_CONTACTS = NC;
+  q.N_LIMITS = 0;
+
+  // determine the contacts incident to each super body; bodies without
+  // generalized coordinates (disabled bodies) couple nothing
+  _sparse_groups.resize(q.super_bodies.size());
+  for (unsigned i=0; i< _sparse_groups.size(); i++)
+    _sparse_groups[i].clear();
+  for (unsigned i=0; i< NC; i++)
+  {
+    DynamicBodyPtr su1 = get_super_body(q.contact_events[i]->contact_geom1->get_single_body());
+    DynamicBodyPtr su2 = get_super_body(q.contact_events[i]->contact_geom2->get_single_body());
+    unsigned b1 = std::lower_bound(q.super_bodies.begin(), q.super_bodies.end(), su1) - q.super_bodies.begin();
+    unsigned b2 = std::lower_bound(q.super_bodies.begin(), q.super_bodies.end(), su2) - q.super_bodies.begin();
+    if (su1->num_generalized_coordinates(DynamicBody::eSpatial) > 0)
+      _sparse_groups[b1].push_back(i);
+    if (su2->num_generalized_coordinates(DynamicBody::eSpatial) > 0 && b2 != b1)
+      _sparse_groups[b2].push_back(i);
+  }
+
+  // initialize the problem matrix / vectors
+  q.sparse_contacts = true;
+  q.C_iM_CT.set_structure(NC, _sparse_groups);
+  q.Cn_v.set_zero(NC);
+  q.Cs_v.set_zero(NC);
+  q.Ct_v.set_zero(NC);
+  q.cn.set_zero(NC);
+  q.cs.set_zero(NC);
+  q.ct.set_zero(NC);
+
+  FILE_LOG(LOG_EVENT) << "ImpactEventHandler::compute_sparse_problem_data() - " << q.C_iM_CT.num_blocks() << " blocks for " << NC << " contacts" << endl;
+
+  // contacts between free rigid bodies are handled in closed form
+  if (compute_rigid_contact_data(q))
+    return;
+
+  // compute only the structurally nonzero blocks
+  for (unsigned i=0; i< NC; i++)
+  {
+    for (unsigned k=q.C_iM_CT.row_begin(i); k< q.C_iM_CT.row_begin(i+1); k++)
+    {
+      const unsigned j = q.C_iM_CT.column(k);
+
+      // reset _MM
+      _MM.set_zero(3, 3);
+
+      // check whether i==j (single contact event)
+      if (i == j)
+      {
+        // compute matrix / vector for contact event i
+        _v.set_zero(3);
+        q.contact_events[i]->compute_event_data(_MM, _v);
+
+        // setup appropriate parts of contact velocities
+        q.Cn_v[i] = _v[N];
+        q.Cs_v[i] = _v[S];
+        q.Ct_v[i] = _v[T];
+      }
+      else
+        q.contact_events[i]->compute_cross_event_data(*q.contact_events[j], _MM);
+
+      // setup the block
+      double* B = q.C_iM_CT.block(k);
+      for (unsigned r=0; r< 3; r++)
+        for (unsigned c=0; c< 3; c++)
+          B[r*3+c] = _MM(r,c);
+    }
+  }
+}
+
+/// Solves the block-sparse model and adds the resulting impulses to the events
+void ImpactEventHandler::solve_sparse_model(EventProblemData& q, bool coulomb)
+{
+  // solve the frictionless (viscous friction) LCP
+  solve_sparse_lcp(q);
+
+  // determine Coulomb friction, warm starting from the LCP solution
+  if (coulomb)
+    solve_sparse_iterative(q);
+
+  // save contact impulses
+  add_event_impulses(q);
+}
+
+/// Solves the frictionless LCP (with viscous friction) using block-sparse data
+/**
+ * This is the sparse counterpart of solve_frictionless_lcp(): the LCP
+ * matrix Cn*inv(M)*Cn' is extracted from the block-sparse data and the
+ * LCP is solved with the sparse Lemke solver.
+ */
+void ImpactEventHandler::solve_sparse_lcp(EventProblemData& q)
+{
+  const unsigned N = 0, S = 1, T = 2;
+  const unsigned NC = q.N_CONTACTS;
+
+  // compute viscous friction impulses
+  q.cs = q.Cs_v;
+  q.ct = q.Ct_v;
+  for (unsigned i=0; i< NC; i++)
+  {
+    q.cs[i] *= -q.contact_events[i]->contact_mu_viscous;
+    q.ct[i] *= -q.contact_events[i]->contact_mu_viscous;
+  }
+
+  // compute viscous friction terms contributions in normal directions
+  _sz.set_zero(NC*3);
+  _sz.set_sub_vec(NC*S, q.cs);
+  _sz.set_sub_vec(NC*T, q.ct);
+  q.C_iM_CT.mult(_sz, _sw);
+  _qq = _sw.segment(NC*N, NC*S);
+  _qq += q.Cn_v;
+
+  // setup the LCP matrix
+  q.C_iM_CT.to_sparse(N, N, _sCn_iM_CnT);
+
+  FILE_LOG(LOG_EVENT) << "ImpulseEventHandler::solve_sparse_lcp() entered" << std::endl;
+  FILE_LOG(LOG_EVENT) << "  Cn * v: " << q.Cn_v << std::endl;
+  FILE_LOG(LOG_EVENT) << "  LCP vector: " << _qq << std::endl;
+
+  // solve the LCP
+  _v.resize(0);
+  if (!_lcp.lcp_lemke_regularized(_sCn_iM_CnT, _qq, _v))
+    throw std::runtime_error("Unable to solve event LCP!");
+  q.cn = _v;
+
+  FILE_LOG(LOG_EVENT) << "  LCP result: " << q.cn << std::endl;
+  FILE_LOG(LOG_EVENT) << "ImpulseEventHandler::solve_sparse_lcp() exited" << std::endl;
+}
+
+/// Determines contact impulses with Coulomb friction by projected block Gauss-Seidel
+/**
+ * Starting from the impulses in q, each contact in turn has its normal
+ * impulse set to zero its normal velocity (clamped to be nonnegative), and
+ * then its frictional impulse set to zero its tangential velocity (projected
+ * onto the friction disc of radius mu*cn). Velocity changes are propagated
+ * only to the contacts coupled to the contact being updated, so each sweep
+ * costs time proportional to the number of blocks. Friction is modeled with
+ * a true (circular) friction cone for all contacts.
+ */
+void ImpactEventHandler::solve_sparse_iterative(EventProblemData& q)
+{
+  const unsigned N = 0, S = 1, T = 2;
+  const unsigned NC = q.N_CONTACTS;
+  const ContactBlockMatrix& C = q.C_iM_CT;
+
+  // stack the impulses
+  _sz.resize(NC*3);
+  _sz.set_sub_vec(NC*N, q.cn);
+  _sz.set_sub_vec(NC*S, q.cs);
+  _sz.set_sub_vec(NC*T, q.ct);
+
+  // compute the contact velocities given the impulses
+  C.mult(_sz, _sw);
+  for (unsigned i=0; i< NC; i++)
+  {
+    _sw[i+NC*N] += q.Cn_v[i];
+    _sw[i+NC*S] += q.Cs_v[i];
+    _sw[i+NC*T] += q.Ct_v[i];
+  }
+
+  // do sweeps
+  unsigned iter = 0;
+  for (; iter< sparse_max_iterations; iter++)
+  {
+    double max_delta = 0.0;
+    for (unsigned i=0; i< NC; i++)
+    {
+      const double* D = C.get_block(i,i);
+      double dj[3];
+
+      // update the normal impulse
+      if (D[N*3+N] > NEAR_ZERO)
+      {
+        const double cn = std::max(0.0, _sz[i+NC*N] - _sw[i+NC*N]/D[N*3+N]);
+        dj[N] = cn - _sz[i+NC*N];
+        dj[S] = dj[T] = 0.0;
+        _sz[i+NC*N] = cn;
+        propagate_impulse(C, i, dj, _sw);
+        max_delta = std::max(max_delta, std::fabs(dj[N]));
+      }
+
+      // update the frictional impulse
+      const double DET = D[S*3+S]*D[T*3+T] - D[S*3+T]*D[T*3+S];
+      if (DET > NEAR_ZERO)
+      {
+        const double ws = _sw[i+NC*S], wt = _sw[i+NC*T];
+        double cs = _sz[i+NC*S] - (D[T*3+T]*ws - D[S*3+T]*wt)/DET;
+        double ct = _sz[i+NC*T] - (D[S*3+S]*wt - D[T*3+S]*ws)/DET;
+
+        // project onto the friction disc
+        const double MAXF = q.contact_events[i]->contact_mu_coulomb*_sz[i+NC*N];
+        const double F = std::sqrt(cs*cs + ct*ct);
+        if (F > MAXF)
+        {
+          const double SCAL = (F > NEAR_ZERO) ? MAXF/F : 0.0;
+          cs *= SCAL;
+          ct *= SCAL;
+        }
+
+        dj[N] = 0.0;
+        dj[S] = cs - _sz[i+NC*S];
+        dj[T] = ct - _sz[i+NC*T];
+        _sz[i+NC*S] = cs;
+        _sz[i+NC*T] = ct;
+        propagate_impulse(C, i, dj, _sw);
+        max_delta = std::max(max_delta, std::max(std::fabs(dj[S]), std::fabs(dj[T])));
+      }
+    }
+
+    // check for convergence
+    if (max_delta < sparse_eps)
+      break;
+  }
+
+  FILE_LOG(LOG_EVENT) << "ImpactEventHandler::solve_sparse_iterative() - " << iter << " sweeps" << endl;
+
+  // save the impulses
+  q.cn = _sz.segment(NC*N, NC*S);
+  q.cs = _sz.segment(NC*S, NC*T);
+  q.ct = _sz.segment(NC*T, NC*3);
+}
+
+/// Updates post-impact contact velocities using block-sparse data
+void ImpactEventHandler::update_sparse_event_velocities_from_impulses(EventProblemData& q)
+{
+  const unsigned N = 0, S = 1, T = 2;
+  const unsigned NC = q.N_CONTACTS;
+
+  // stack the impulses
+  _sz.resize(NC*3);
+  _sz.set_sub_vec(NC*N, q.cn);
+  _sz.set_sub_vec(NC*S, q.cs);
+  _sz.set_sub_vec(NC*T, q.ct);
+
+  // update the velocities
+  q.C_iM_CT.mult(_sz, _sw);
+  q.Cn_v += _sw.segment(NC*N, NC*S);
+  q.Cs_v += _sw.segment(NC*S, NC*T);
+  q.Ct_v += _sw.segment(NC*T, NC*3);
+
+  FILE_LOG(LOG_EVENT) << "new Cn_v: " << q.Cn_v << std::endl;
+  FILE_LOG(LOG_EVENT) << "new Cs_v: " << q.Cs_v << std::endl;
+  FILE_LOG(LOG_EVENT) << "new Ct_v: " << q.Ct_v << std::endl;
+}
+
@@ -141,10 +141,11 @@ void IndexedTetraArray::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base>
   // do not save the array to the OBJ file if it already exists (which we
   // crudely check for using std::ifstream to avoid OS-specific calls -- note
   // that it is possible that opening a file may fails for other reasons than
-  // the file does not exist)
-  std::ifstream in(filename.c_str());
+  // the file does not exist); the file is placed relative to the document
+  std::string path = node->get_path(filename);
+  std::ifstream in(path.c_str());
   if (in.fail())
-    write_to_tetra(filename);
+    write_to_tetra(path);
   else
     in.close();
 }
@@ -19,9 +19,6 @@ using boost::shared_ptr;
 using namespace Ravelin;
 using namespace Moby;
 
-// shared (static) linear algebra object
-LinAlgd Joint::_LA;
-
 /// Initializes the joint
 /**
  * The inboard and outboard links are set to NULL.
@@ -145,7 +145,7 @@ bool LCP::lcp_fast(const MatrixNd& M, const VectorNd& q, VectorNd& z, double zer
 /// Get the minimum index of vector v; if there are multiple minima (within zero_tol), returns one randomly 
 unsigned LCP::rand_min(const VectorNd& v, double zero_tol)
 {
-  static vector<unsigned> minima;
+  SAFESTATIC vector<unsigned> minima;
   minima.clear();
   unsigned minv = std::min_element(v.begin(), v.end()) - v.begin();
   minima.push_back(minv);
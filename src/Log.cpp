@@ -1,3 +1,7 @@
+#include <sys/time.h>
+#include <cstring>
+#include <algorithm>
+#include <map>
 #include <Moby/Log.h>
 
 using namespace Moby;
@@ -16,3 +20,227 @@ void OutputToFile::output(const std::string& msg)
     stream << msg << std::flush;
 }
 
+const unsigned LogRecord::MAX_VALUES;
+const unsigned BinaryLog::CAPACITY;
+const unsigned BinaryLog::VERSION;
+unsigned BinaryLog::recording_level = 0;
+std::vector<BinaryLog::Sink> BinaryLog::_sinks;
+unsigned BinaryLog::_nthreads = 0;
+pthread_mutex_t BinaryLog::_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_key_t BinaryLog::_key;
+pthread_once_t BinaryLog::_key_once = PTHREAD_ONCE_INIT;
+
+/// The magic string at the start of a binary log file
+static const char MAGIC[8] = "MOBYLOG";
+
+/// Opens a sink that receives the records of the given subsystems
+/**
+ * \param levels the subsystems (LOG_* bits) written to the file
+ * \param fname the file to write
+ */
+void BinaryLog::open(unsigned levels, const std::string& fname)
+{
+  std::FILE* fp = std::fopen(fname.c_str(), "wb");
+  if (!fp)
+  {
+    std::cerr << "BinaryLog::open() - unable to open " << fname << " for writing" << std::endl;
+    return;
+  }
+
+  // write the header
+  std::fwrite(MAGIC, 1, sizeof(MAGIC), fp);
+  unsigned version = VERSION;
+  std::fwrite(&version, sizeof(unsigned), 1, fp);
+
+  // add the sink
+  pthread_mutex_lock(&_mutex);
+  Sink sink;
+  sink.levels = levels;
+  sink.fp = fp;
+  _sinks.push_back(sink);
+  recording_level |= levels;
+  pthread_mutex_unlock(&_mutex);
+}
+
+/// Flushes the calling thread's records and closes all sinks
+/**
+ * Other threads must flush their records before the sinks are closed.
+ */
+void BinaryLog::close()
+{
+  flush();
+  pthread_mutex_lock(&_mutex);
+  recording_level = 0;
+  for (unsigned i=0; i< _sinks.size(); i++)
+    std::fclose(_sinks[i].fp);
+  _sinks.clear();
+  pthread_mutex_unlock(&_mutex);
+}
+
+/// Writes the calling thread's records to the sinks
+void BinaryLog::flush()
+{
+  flush(get_buffer());
+}
+
+/// Records an entry in the calling thread's buffer
+/**
+ * \param level the subsystem(s) of the entry
+ * \param tag a string identifying the entry; the string must outlive the
+ *        buffer (string literals are ideal)
+ * \param nvalues the number of values (at most LogRecord::MAX_VALUES)
+ * \param values the values
+ */
+void BinaryLog::record(unsigned level, const char* tag, unsigned nvalues, const double* values)
+{
+  Buffer* buffer = get_buffer();
+
+  // make room, if necessary
+  if (buffer->size == CAPACITY)
+    flush(buffer);
+
+  // get the time
+  timeval t;
+  gettimeofday(&t, NULL);
+
+  // setup the record
+  LogRecord& r = buffer->records[(buffer->head + buffer->size++) % CAPACITY];
+  r.time = (double) t.tv_sec + (double) t.tv_usec * 1e-6;
+  r.level = level;
+  r.thread = buffer->thread;
+  r.tag = tag;
+  r.nvalues = std::min(nvalues, LogRecord::MAX_VALUES);
+  for (unsigned i=0; i< r.nvalues; i++)
+    r.values[i] = values[i];
+}
+
+/// Writes the records of a buffer to the sinks and empties the buffer
+void BinaryLog::flush(Buffer* buffer)
+{
+  pthread_mutex_lock(&_mutex);
+  for (unsigned i=0; i< buffer->size; i++)
+  {
+    const LogRecord& r = buffer->records[(buffer->head + i) % CAPACITY];
+    for (unsigned j=0; j< _sinks.size(); j++)
+      if (_sinks[j].levels & r.level)
+        write(_sinks[j].fp, r);
+  }
+  for (unsigned j=0; j< _sinks.size(); j++)
+    std::fflush(_sinks[j].fp);
+  pthread_mutex_unlock(&_mutex);
+
+  buffer->head = (buffer->head + buffer->size) % CAPACITY;
+  buffer->size = 0;
+}
+
+/// Writes a single record to a file
+void BinaryLog::write(std::FILE* fp, const LogRecord& r)
+{
+  unsigned taglen = (r.tag) ? std::strlen(r.tag) : 0;
+  std::fwrite(&r.time, sizeof(double), 1, fp);
+  std::fwrite(&r.level, sizeof(unsigned), 1, fp);
+  std::fwrite(&r.thread, sizeof(unsigned), 1, fp);
+  std::fwrite(&taglen, sizeof(unsigned), 1, fp);
+  std::fwrite(r.tag, 1, taglen, fp);
+  std::fwrite(&r.nvalues, sizeof(unsigned), 1, fp);
+  std::fwrite(r.values, sizeof(double), r.nvalues, fp);
+}
+
+/// Reads a binary log file
+/**
+ * \param fname the file to read
+ * \param records on return, the records (the tag of each record points into
+ *        tags)
+ * \param tags on return, the distinct tags
+ * \return <b>true</b> if the file was read successfully
+ */
+bool BinaryLog::read(const std::string& fname, std::vector<LogRecord>& records, std::vector<std::string>& tags)
+{
+  records.clear();
+  tags.clear();
+
+  std::FILE* fp = std::fopen(fname.c_str(), "rb");
+  if (!fp)
+    return false;
+
+  // check the header
+  char magic[sizeof(MAGIC)];
+  unsigned version;
+  if (std::fread(magic, 1, sizeof(MAGIC), fp) != sizeof(MAGIC) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || std::fread(&version, sizeof(unsigned), 1, fp) != 1 || version != VERSION)
+  {
+    std::fclose(fp);
+    return false;
+  }
+
+  // read the records; tags are stored as indices until all are read, since
+  // the tag vector may be reallocated
+  std::vector<unsigned> tag_idx;
+  std::map<std::string, unsigned> tag_map;
+  while (true)
+  {
+    LogRecord r;
+    unsigned taglen;
+    if (std::fread(&r.time, sizeof(double), 1, fp) != 1)
+      break;
+    if (std::fread(&r.level, sizeof(unsigned), 1, fp) != 1 || std::fread(&r.thread, sizeof(unsigned), 1, fp) != 1 || std::fread(&taglen, sizeof(unsigned), 1, fp) != 1)
+      break;
+    std::string tag(taglen, ' ');
+    if (taglen > 0 && std::fread(&tag[0], 1, taglen, fp) != taglen)
+      break;
+    if (std::fread(&r.nvalues, sizeof(unsigned), 1, fp) != 1 || r.nvalues > LogRecord::MAX_VALUES || std::fread(r.values, sizeof(double), r.nvalues, fp) != r.nvalues)
+      break;
+
+    // store the tag
+    std::map<std::string, unsigned>::const_iterator i = tag_map.find(tag);
+    if (i == tag_map.end())
+    {
+      i = tag_map.insert(std::make_pair(tag, (unsigned) tags.size())).first;
+      tags.push_back(tag);
+    }
+    tag_idx.push_back(i->second);
+    records.push_back(r);
+  }
+  std::fclose(fp);
+
+  // set the tags
+  for (unsigned i=0; i< records.size(); i++)
+    records[i].tag = tags[tag_idx[i]].c_str();
+
+  return true;
+}
+
+/// Gets the calling thread's buffer (creating it, if necessary)
+/**
+ * Buffers are kept per thread (through a pthread key) in every build, not
+ * only in THREADSAFE builds, since OpenMP and background threads record
+ * entries whether or not the rest of the library is threadsafe.
+ */
+BinaryLog::Buffer* BinaryLog::get_buffer()
+{
+  pthread_once(&_key_once, &create_key);
+  Buffer* buffer = (Buffer*) pthread_getspecific(_key);
+  if (!buffer)
+  {
+    buffer = new Buffer;
+    buffer->head = buffer->size = 0;
+    pthread_mutex_lock(&_mutex);
+    buffer->thread = _nthreads++;
+    pthread_mutex_unlock(&_mutex);
+    pthread_setspecific(_key, buffer);
+  }
+
+  return buffer;
+}
+
+/// Creates the key for the per-thread buffers
+void BinaryLog::create_key()
+{
+  pthread_key_create(&_key, &destroy_buffer);
+}
+
+/// Flushes and destroys a thread's buffer (called when the thread exits)
+void BinaryLog::destroy_buffer(void* buffer)
+{
+  flush((Buffer*) buffer);
+  delete (Buffer*) buffer;
+}
@@ -0,0 +1,427 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include <Moby/DynamicBody.h>
+#include <Moby/LoopClosureSolver.h>
+
+using std::vector;
+using namespace Ravelin;
+using namespace Moby;
+
+// the number of iterative refinement steps for the regularized KKT system
+static const unsigned KKT_REFINE_ITER = 2;
+
+/// Sets up a solver using the Schur complement formulation
+LoopClosureSolver::LoopClosureSolver()
+{
+  solver_type = eSchur;
+  kkt_regularization = NEAR_ZERO;
+  _rank = 0;
+}
+
+/// Computes the generalized accelerations that satisfy the loop constraints
+/**
+ * \param body the body (used to solve with / get its generalized inertia)
+ * \param J the loop-closure constraint Jacobian
+ * \param f the generalized forces
+ * \param gamma the constraint bias; the accelerations satisfy J*a + gamma = 0
+ * \param a contains the generalized accelerations on return
+ */
+void LoopClosureSolver::solve(DynamicBody& body, const MatrixNd& J, const VectorNd& f, const VectorNd& gamma, VectorNd& a)
+{
+  if (solver_type == eSparseKKT)
+    solve_kkt(body, J, f, gamma, a);
+  else
+    solve_schur(body, J, f, gamma, a);
+}
+
+/// Solves using the constraint-space inertia J*inv(M)*J'
+void LoopClosureSolver::solve_schur(DynamicBody& body, const MatrixNd& J, const VectorNd& f, const VectorNd& gamma, VectorNd& a)
+{
+  const unsigned M = J.rows();
+
+  // compute the unconstrained accelerations and the constraint right hand side
+  body.solve_generalized_inertia(f, _x);
+  J.mult(_x, _workv) += gamma;
+
+  // form the constraint-space inertia
+  body.transpose_solve_generalized_inertia(J, _iM_JT);
+  J.mult(_iM_JT, _Lambda);
+
+  // factor, reusing the last pivot order if possible; if the rank of the
+  // constraints has changed, the factorization fails and the pivot order
+  // must be recomputed
+  if (_perm.size() != M || !factor_ldl(false))
+  {
+    if (_perm.size() == M)
+    {
+      FILE_LOG(LOG_DYNAMICS) << "LoopClosureSolver::solve_schur() - constraint rank changed; repivoting" << std::endl;
+      J.mult(_iM_JT, _Lambda);
+    }
+    factor_ldl(true);
+  }
+
+  // compute the constraint forces
+  solve_ldl(_workv);
+
+  // compute the generalized accelerations: inv(M)*(f - J'*lambda)
+  _iM_JT.mult(_workv, _workv2);
+  a = _x;
+  a -= _workv2;
+}
+
+/// Swaps rows and columns i and j of a symmetric matrix
+void LoopClosureSolver::swap_sym(MatrixNd& A, unsigned i, unsigned j)
+{
+  const unsigned N = A.rows();
+  for (unsigned k=0; k< N; k++)
+    std::swap(A(i,k), A(j,k));
+  for (unsigned k=0; k< N; k++)
+    std::swap(A(k,i), A(k,j));
+}
+
+/// Factors _Lambda in place as P*_Lambda*P' = L*D*L'
+/**
+ * On return, the strictly lower triangle of the leading _rank x _rank block
+ * of _Lambda holds L and its diagonal holds D.
+ * \param pivot if <b>true</b>, the largest remaining diagonal element is
+ *        chosen as the pivot at each step (determining the rank); otherwise,
+ *        the swaps and rank of the last pivoted factorization are reused
+ * \return <b>false</b> if the swaps could not be reused because the rank
+ *         has changed (_Lambda is then destroyed)
+ */
+bool LoopClosureSolver::factor_ldl(bool pivot)
+{
+  MatrixNd& A = _Lambda;
+  const unsigned N = A.rows();
+
+  // determine the tolerance for zero pivots
+  double max_diag = 0.0;
+  for (unsigned i=0; i< N; i++)
+    max_diag = std::max(max_diag, A(i,i));
+  const double TOL = NEAR_ZERO * std::max((double) 1.0, max_diag);
+
+  // setup the swaps, if necessary
+  if (pivot)
+  {
+    _perm.resize(N);
+    for (unsigned i=0; i< N; i++)
+      _perm[i] = i;
+    _rank = N;
+  }
+
+  for (unsigned k=0; k< N; k++)
+  {
+    // once the rank has been reached, the remaining diagonal must be zero
+    if (!pivot && k == _rank)
+    {
+      for (unsigned i=k; i< N; i++)
+        if (A(i,i) > TOL)
+          return false;
+      break;
+    }
+
+    // find the pivot
+    if (pivot)
+    {
+      unsigned p = k;
+      for (unsigned i=k+1; i< N; i++)
+        if (A(i,i) > A(p,p))
+          p = i;
+      _perm[k] = p;
+    }
+    if (_perm[k] != k)
+      swap_sym(A, k, _perm[k]);
+
+    // check for a zero pivot
+    const double D = A(k,k);
+    if (D <= TOL)
+    {
+      if (!pivot)
+        return false;
+
+      // the remaining block is (numerically) zero; record the rank
+      _rank = k;
+      for (unsigned i=k; i< N; i++)
+        _perm[i] = i;
+      break;
+    }
+
+    // compute the k'th column of L and update the remaining block
+    for (unsigned i=k+1; i< N; i++)
+      A(i,k) /= D;
+    for (unsigned j=k+1; j< N; j++)
+      for (unsigned i=j; i< N; i++)
+      {
+        A(i,j) -= A(i,k)*A(j,k)*D;
+        A(j,i) = A(i,j);
+      }
+  }
+
+  return true;
+}
+
+/// Solves _Lambda*x = b using the factorization (b is overwritten)
+/**
+ * Components of x corresponding to redundant constraints are set to zero.
+ */
+void LoopClosureSolver::solve_ldl(VectorNd& x) const
+{
+  const MatrixNd& A = _Lambda;
+  const unsigned N = A.rows();
+
+  // apply the row swaps
+  for (unsigned k=0; k< N; k++)
+    if (_perm[k] != k)
+      std::swap(x[k], x[_perm[k]]);
+
+  // solve L*D*L'*y = x using the leading block
+  for (unsigned i=0; i< _rank; i++)
+    for (unsigned j=0; j< i; j++)
+      x[i] -= A(i,j)*x[j];
+  for (unsigned i=0; i< _rank; i++)
+    x[i] /= A(i,i);
+  for (unsigned i=_rank; i< N; i++)
+    x[i] = 0.0;
+  for (unsigned i=_rank; i > 0; i--)
+    for (unsigned j=i; j< _rank; j++)
+      x[i-1] -= A(j,i-1)*x[j];
+
+  // undo the swaps
+  for (unsigned k=N; k > 0; k--)
+    if (_perm[k-1] != k-1)
+      std::swap(x[k-1], x[_perm[k-1]]);
+}
+
+/// Solves using the regularized KKT matrix [M J'; J -delta*I]
+void LoopClosureSolver::solve_kkt(DynamicBody& body, const MatrixNd& J, const VectorNd& f, const VectorNd& gamma, VectorNd& a)
+{
+  const unsigned NGC = J.columns(), M = J.rows();
+
+  // assemble the KKT matrix, redoing the symbolic analysis if its pattern
+  // has changed
+  body.get_generalized_inertia(_M);
+  assemble_kkt(_M, J);
+  if (_Ap_new != _Ap || _Ai_new != _Ai)
+  {
+    _Ap.swap(_Ap_new);
+    _Ai.swap(_Ai_new);
+    symbolic_kkt();
+  }
+
+  // factor the matrix
+  if (!numeric_kkt())
+  {
+    std::cerr << "LoopClosureSolver::solve_kkt() - KKT matrix is singular; using Schur complement formulation" << std::endl;
+    solve_schur(body, J, f, gamma, a);
+    return;
+  }
+
+  // solve [M J'; J -delta*I]*[a; lambda] = [f; -gamma]
+  _xkkt.resize(NGC+M);
+  for (unsigned i=0; i< NGC; i++)
+    _xkkt[i] = f[i];
+  for (unsigned i=0; i< M; i++)
+    _xkkt[NGC+i] = -gamma[i];
+  _rkkt = _xkkt;
+  solve_kkt_factored(_xkkt);
+
+  // refine the solution against the unregularized matrix, removing the
+  // (small) constraint error introduced by the regularization
+  const unsigned N = NGC+M;
+  for (unsigned iter=0; iter< KKT_REFINE_ITER; iter++)
+  {
+    // compute the residual r = b - K*x using the upper triangle
+    _dkkt = _rkkt;
+    for (unsigned j=0; j< N; j++)
+      for (unsigned p=_Ap[j]; p< _Ap[j+1]; p++)
+      {
+        const unsigned i = _Ai[p];
+        if (i == j)
+        {
+          if (j < NGC)
+            _dkkt[j] -= _Ax[p]*_xkkt[j];
+        }
+        else
+        {
+          _dkkt[i] -= _Ax[p]*_xkkt[j];
+          _dkkt[j] -= _Ax[p]*_xkkt[i];
+        }
+      }
+
+    // correct the solution
+    solve_kkt_factored(_dkkt);
+    for (unsigned i=0; i< N; i++)
+      _xkkt[i] += _dkkt[i];
+  }
+
+  // get the generalized accelerations
+  a.resize(NGC);
+  for (unsigned i=0; i< NGC; i++)
+    a[i] = _xkkt[i];
+}
+
+/// Assembles the upper triangle of the KKT matrix in compressed column form
+/**
+ * The pattern is written to _Ap_new and _Ai_new, and the values to _Ax;
+ * exact zeros (from branch-induced sparsity in M and from joints that do not
+ * lie on a loop) are not stored.
+ */
+void LoopClosureSolver::assemble_kkt(const MatrixNd& M, const MatrixNd& J)
+{
+  const unsigned NGC = J.columns(), NEQ = J.rows();
+
+  _Ap_new.resize(NGC+NEQ+1);
+  _Ai_new.clear();
+  _Ax.clear();
+
+  // columns of M
+  _Ap_new[0] = 0;
+  for (unsigned j=0; j< NGC; j++)
+  {
+    for (unsigned i=0; i<= j; i++)
+      if (M(i,j) != 0.0 || i == j)
+      {
+        _Ai_new.push_back(i);
+        _Ax.push_back(M(i,j));
+      }
+    _Ap_new[j+1] = _Ai_new.size();
+  }
+
+  // columns of [J'; -delta*I]
+  for (unsigned r=0; r< NEQ; r++)
+  {
+    for (unsigned i=0; i< NGC; i++)
+      if (J(r,i) != 0.0)
+      {
+        _Ai_new.push_back(i);
+        _Ax.push_back(J(r,i));
+      }
+    _Ai_new.push_back(NGC+r);
+    _Ax.push_back(-kkt_regularization);
+    _Ap_new[NGC+r+1] = _Ai_new.size();
+  }
+}
+
+/// Computes the elimination tree and the column counts of L for the KKT matrix
+void LoopClosureSolver::symbolic_kkt()
+{
+  const unsigned N = _Ap.size()-1;
+  const unsigned NONE = N;
+
+  _parent.resize(N);
+  _Lnz.resize(N);
+  _flag.resize(N);
+  _Lp.resize(N+1);
+  for (unsigned k=0; k< N; k++)
+  {
+    _parent[k] = NONE;
+    _flag[k] = k;
+    _Lnz[k] = 0;
+    for (unsigned p=_Ap[k]; p< _Ap[k+1]; p++)
+    {
+      // follow the path from i to the root of the etree, stopping at k
+      unsigned i = _Ai[p];
+      if (i >= k)
+        continue;
+      for (; _flag[i] != k; i = _parent[i])
+      {
+        if (_parent[i] == NONE)
+          _parent[i] = k;
+        _Lnz[i]++;
+        _flag[i] = k;
+      }
+    }
+  }
+
+  // setup the column pointers of L
+  _Lp[0] = 0;
+  for (unsigned k=0; k< N; k++)
+    _Lp[k+1] = _Lp[k] + _Lnz[k];
+  _Li.resize(_Lp[N]);
+  _Lx.resize(_Lp[N]);
+  _D.resize(N);
+  _y.resize(N);
+  _pattern.resize(N);
+
+  FILE_LOG(LOG_DYNAMICS) << "LoopClosureSolver::symbolic_kkt() - KKT matrix of size " << N << " has " << _Ai.size() << " nonzeros in its upper triangle and " << _Lp[N] << " in L" << std::endl;
+}
+
+/// Computes the numeric LDL' factorization of the KKT matrix (up-looking)
+/**
+ * \return <b>false</b> if a zero pivot was encountered
+ */
+bool LoopClosureSolver::numeric_kkt()
+{
+  const unsigned N = _Ap.size()-1;
+
+  for (unsigned k=0; k< N; k++)
+  {
+    // compute the nonzero pattern of row k of L (in topological order)
+    _y[k] = 0.0;
+    unsigned top = N;
+    _flag[k] = k;
+    _Lnz[k] = 0;
+    for (unsigned p=_Ap[k]; p< _Ap[k+1]; p++)
+    {
+      unsigned i = _Ai[p];
+      _y[i] += _Ax[p];
+      unsigned len = 0;
+      for (; _flag[i] != k; i = _parent[i])
+      {
+        _pattern[len++] = i;
+        _flag[i] = k;
+      }
+      while (len > 0)
+        _pattern[--top] = _pattern[--len];
+    }
+
+    // compute the numerical values of row k of L
+    _D[k] = _y[k];
+    _y[k] = 0.0;
+    for (; top< N; top++)
+    {
+      const unsigned i = _pattern[top];
+      const double YI = _y[i];
+      _y[i] = 0.0;
+      const unsigned P2 = _Lp[i] + _Lnz[i];
+      for (unsigned p=_Lp[i]; p< P2; p++)
+        _y[_Li[p]] -= _Lx[p]*YI;
+      const double L_KI = YI/_D[i];
+      _D[k] -= L_KI*YI;
+      _Li[P2] = k;
+      _Lx[P2] = L_KI;
+      _Lnz[i]++;
+    }
+
+    // check for a zero pivot
+    if (_D[k] == 0.0)
+      return false;
+  }
+
+  return true;
+}
+
+/// Solves L*D*L'*x = b for the factored KKT matrix (b is overwritten)
+void LoopClosureSolver::solve_kkt_factored(vector<double>& x) const
+{
+  const unsigned N = _Ap.size()-1;
+
+  for (unsigned j=0; j< N; j++)
+    for (unsigned p=_Lp[j]; p< _Lp[j+1]; p++)
+      x[_Li[p]] -= _Lx[p]*x[j];
+  for (unsigned j=0; j< N; j++)
+    x[j] /= _D[j];
+  for (unsigned j=N; j > 0; j--)
+    for (unsigned p=_Lp[j-1]; p< _Lp[j]; p++)
+      x[j-1] -= _Lx[p]*x[_Li[p]];
+}
+
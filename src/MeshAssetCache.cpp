@@ -0,0 +1,266 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <sys/stat.h>
+#include <climits>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+#include <list>
+#include <stdexcept>
+#include <Moby/Log.h>
+#include <Moby/Constants.h>
+#include <Moby/CompGeom.h>
+#include <Moby/Polyhedron.h>
+#include <Moby/BinaryMeshFile.h>
+#include <Moby/MeshAssetCache.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using std::string;
+using std::map;
+using std::vector;
+using std::pair;
+using std::make_pair;
+
+// static members
+map<string, MeshAssetCache::Entry> MeshAssetCache::_by_path;
+map<pair<unsigned long long, unsigned>, shared_ptr<const MeshAssetCache::Asset> > MeshAssetCache::_by_hash;
+std::set<pair<unsigned long long, unsigned> > MeshAssetCache::_building;
+#ifdef THREADSAFE
+pthread_mutex_t MeshAssetCache::_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t MeshAssetCache::_built = PTHREAD_COND_INITIALIZER;
+#endif
+
+/// Computes a (64-bit FNV-1a) hash of the contents of a file
+bool MeshAssetCache::hash_file(const string& filename, unsigned long long& hash)
+{
+  const unsigned long long FNV_OFFSET = 14695981039346656037ULL;
+  const unsigned long long FNV_PRIME = 1099511628211ULL;
+  const unsigned BUF_SIZE = 65536;
+
+  FILE* fp = fopen(filename.c_str(), "rb");
+  if (!fp)
+    return false;
+
+  hash = FNV_OFFSET;
+  unsigned char buffer[BUF_SIZE];
+  size_t n;
+  while ((n = fread(buffer, 1, BUF_SIZE, fp)) > 0)
+    for (size_t i=0; i< n; i++)
+    {
+      hash ^= (unsigned long long) buffer[i];
+      hash *= FNV_PRIME;
+    }
+
+  fclose(fp);
+  return true;
+}
+
+/// Reads a mesh file and computes the data shared by all of its instances
+/**
+ * Binary mesh files may already hold the BVH and mass data; these are used
+ * unless the mesh must be translated to center it or the mass data must be
+ * computed from the convex hull of the mesh.
+ */
+shared_ptr<MeshAssetCache::Asset> MeshAssetCache::create_asset(const string& filename, bool center, bool convexify_inertia)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+  const char* MBM_EXT = ".mbm";
+
+  // setup the asset
+  shared_ptr<Asset> asset(new Asset);
+  asset->convexify_inertia = convexify_inertia;
+
+  // read the mesh 
+  shared_ptr<IndexedTriArray> mesh;
+  shared_ptr<FlatBVH> bvh;
+  unsigned contents = 0;
+  if (filename.size() >= strlen(MBM_EXT) && strcasecmp(filename.c_str() + filename.size() - strlen(MBM_EXT), MBM_EXT) == 0)
+    contents = BinaryMeshFile::read(filename, mesh, bvh, asset->volume_ints, asset->centroid);
+  else
+    mesh = shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(filename)));
+
+  // compute the centroid of the surface, if necessary
+  if (!(contents & BinaryMeshFile::eMassProperties))
+  {
+    shared_ptr<const Pose3d> P;
+    std::list<Triangle> tris;
+    mesh->get_tris(std::back_inserter(tris), P);
+    Point3d centroid = CompGeom::calc_centroid_3D(tris.begin(), tris.end());
+    asset->centroid = Origin3d(centroid[X], centroid[Y], centroid[Z]);
+  }
+
+  // center the mesh, if desired (this invalidates any stored data)
+  if (center && asset->centroid.norm() > NEAR_ZERO)
+  {
+    Transform3d T = Transform3d::identity();
+    T.x = Origin3d(-asset->centroid[X], -asset->centroid[Y], -asset->centroid[Z]);
+    mesh = shared_ptr<IndexedTriArray>(new IndexedTriArray(mesh->transform(T)));
+    asset->centroid = Origin3d(0.0, 0.0, 0.0);
+    bvh.reset();
+    contents &= ~((unsigned) BinaryMeshFile::eMassProperties);
+  }
+
+  // build the BVH, if necessary
+  if (!bvh)
+    bvh = shared_ptr<FlatBVH>(new FlatBVH(*mesh));
+
+  // compute the mass data from the convex hull of the mesh, if desired
+  if (convexify_inertia)
+  {
+    const vector<Origin3d>& verts = mesh->get_vertices();
+    PolyhedronPtr poly = CompGeom::calc_convex_hull(verts.begin(), verts.end());
+    const IndexedTriArray& hull = poly->get_mesh();
+    shared_ptr<const Pose3d> P;
+    std::list<Triangle> tris;
+    hull.get_tris(std::back_inserter(tris), P);
+    Point3d centroid = CompGeom::calc_centroid_3D(tris.begin(), tris.end());
+    asset->centroid = Origin3d(centroid[X], centroid[Y], centroid[Z]);
+    hull.calc_volume_ints(asset->volume_ints);
+  }
+  else if (!(contents & BinaryMeshFile::eMassProperties))
+    mesh->calc_volume_ints(asset->volume_ints);
+
+  asset->mesh = mesh;
+  asset->bvh = bvh;
+  return asset;
+}
+
+/// Gets the asset for a mesh file, loading it if necessary
+/**
+ * \param filename the name of the file (Wavefront OBJ or binary mesh)
+ * \param center if <b>true</b>, the mesh is translated so that the centroid
+ *        of its surface lies at the origin
+ * \param convexify_inertia if <b>true</b>, the mass data of the asset are
+ *        computed from the convex hull of the mesh
+ */
+shared_ptr<const MeshAssetCache::Asset> MeshAssetCache::load(const string& filename, bool center, bool convexify_inertia)
+{
+  // get the canonical path and the state of the file
+  char path[PATH_MAX];
+  struct stat st;
+  if (!realpath(filename.c_str(), path) || stat(path, &st) != 0)
+    throw std::runtime_error("MeshAssetCache::load() - unable to open " + filename);
+  const string KEY = string(path) + ((center) ? "|center" : "|") + ((convexify_inertia) ? "|convexify" : "|");
+  const unsigned OPTIONS = get_options(center, convexify_inertia);
+
+  // look for an entry for the path that is unchanged
+  shared_ptr<const Asset> asset;
+  #ifdef THREADSAFE
+  pthread_mutex_lock(&_mutex);
+  #endif
+  map<string, Entry>::const_iterator i = _by_path.find(KEY);
+  if (i != _by_path.end() && i->second.size == st.st_size && i->second.mtime == st.st_mtime)
+    asset = i->second.asset;
+  #ifdef THREADSAFE
+  pthread_mutex_unlock(&_mutex);
+  #endif
+  if (asset)
+    return asset;
+
+  // hash the contents (outside of the lock)
+  unsigned long long hash;
+  if (!hash_file(path, hash))
+    throw std::runtime_error("MeshAssetCache::load() - unable to read " + filename);
+  const pair<unsigned long long, unsigned> HASH_KEY = make_pair(hash, OPTIONS);
+
+  // look for an identical file; if another thread is building it, wait for
+  // the build to finish
+  #ifdef THREADSAFE
+  pthread_mutex_lock(&_mutex);
+  while (_building.find(HASH_KEY) != _building.end())
+    pthread_cond_wait(&_built, &_mutex);
+  #endif
+  map<pair<unsigned long long, unsigned>, shared_ptr<const Asset> >::const_iterator j = _by_hash.find(HASH_KEY);
+  if (j != _by_hash.end())
+    asset = j->second;
+  else
+  {
+    // mark the asset as being built, then build it outside of the lock so
+    // that loads of other files are not serialized behind this one
+    _building.insert(HASH_KEY);
+    #ifdef THREADSAFE
+    pthread_mutex_unlock(&_mutex);
+    #endif
+
+    FILE_LOG(LOG_SIMULATOR) << "MeshAssetCache::load() - loading " << path << std::endl;
+    try
+    {
+      asset = create_asset(path, center, convexify_inertia);
+    }
+    catch (...)
+    {
+      // let any waiting threads try the build themselves
+      #ifdef THREADSAFE
+      pthread_mutex_lock(&_mutex);
+      #endif
+      _building.erase(HASH_KEY);
+      #ifdef THREADSAFE
+      pthread_cond_broadcast(&_built);
+      pthread_mutex_unlock(&_mutex);
+      #endif
+      throw;
+    }
+
+    // publish the asset
+    #ifdef THREADSAFE
+    pthread_mutex_lock(&_mutex);
+    #endif
+    _building.erase(HASH_KEY);
+    _by_hash[HASH_KEY] = asset;
+    #ifdef THREADSAFE
+    pthread_cond_broadcast(&_built);
+    #endif
+  }
+
+  // update the path entry
+  Entry& e = _by_path[KEY];
+  e.size = st.st_size;
+  e.mtime = st.st_mtime;
+  e.hash = hash;
+  e.asset = asset;
+
+  #ifdef THREADSAFE
+  pthread_mutex_unlock(&_mutex);
+  #endif
+
+  return asset;
+}
+
+/// Removes all assets from the cache (instances keep the assets they use)
+void MeshAssetCache::clear()
+{
+  #ifdef THREADSAFE
+  pthread_mutex_lock(&_mutex);
+  #endif
+
+  _by_path.clear();
+  _by_hash.clear();
+
+  #ifdef THREADSAFE
+  pthread_mutex_unlock(&_mutex);
+  #endif
+}
+
+/// Gets the number of distinct assets in the cache
+unsigned MeshAssetCache::size()
+{
+  #ifdef THREADSAFE
+  pthread_mutex_lock(&_mutex);
+  #endif
+
+  unsigned sz = _by_hash.size();
+
+  #ifdef THREADSAFE
+  pthread_mutex_unlock(&_mutex);
+  #endif
+
+  return sz;
+}
+
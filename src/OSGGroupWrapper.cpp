@@ -164,8 +164,9 @@ void OSGGroupWrapper::save_to_xml(XMLTreePtr node, std::list<shared_ptr<const Ba
   // save the visualization data 
   node->attribs.insert(XMLAttrib("filename", filename));
   #ifdef USE_OSG
-  if (!osgDB::writeNodeFile(*_group, filename))
-    std::cerr << "OSGGroupWrapper::save_to_xml() - unable to write scene graph to " << filename << std::endl;
+  std::string path = node->get_path(filename);
+  if (!osgDB::writeNodeFile(*_group, path))
+    std::cerr << "OSGGroupWrapper::save_to_xml() - unable to write scene graph to " << path << std::endl;
   #endif
 }
 
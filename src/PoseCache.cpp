@@ -0,0 +1,199 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <boost/foreach.hpp>
+#include <Moby/RigidBody.h>
+#include <Moby/ArticulatedBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/Primitive.h>
+#include <Moby/PoseCache.h>
+
+using boost::dynamic_pointer_cast;
+using std::map;
+using std::vector;
+using namespace Ravelin;
+using namespace Moby;
+
+/// Assigns indices to all rigid bodies (links) and collision geometries
+/**
+ * Transforms are not valid until update() is called.
+ */
+void PoseCache::rebuild(const vector<DynamicBodyPtr>& bodies)
+{
+  // clear everything
+  _bodies.clear();
+  _geoms.clear();
+  _geom_begin.clear();
+  _body_index.clear();
+  _geom_index.clear();
+
+  // get the rigid bodies
+  for (unsigned i=0; i< bodies.size(); i++)
+  {
+    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(bodies[i]);
+    if (ab)
+      _bodies.insert(_bodies.end(), ab->get_links().begin(), ab->get_links().end());
+    else
+      _bodies.push_back(dynamic_pointer_cast<RigidBody>(bodies[i]));
+  }
+
+  // index the bodies and their geometries
+  for (unsigned i=0; i< _bodies.size(); i++)
+  {
+    _body_index[_bodies[i].get()] = i;
+    _geom_begin.push_back(_geoms.size());
+    BOOST_FOREACH(CollisionGeometryPtr cg, _bodies[i]->geometries)
+    {
+      _geom_index[cg.get()] = _geoms.size();
+      _geoms.push_back(cg);
+    }
+  }
+  _geom_begin.push_back(_geoms.size());
+
+  // size the transforms
+  _body_T.resize(_bodies.size()*STRIDE);
+  _geom_T.resize(_geoms.size()*STRIDE);
+}
+
+/// Refreshes the transforms of all bodies and geometries from the current body poses
+void PoseCache::update()
+{
+  const int NBODIES = (int) _bodies.size();
+
+  #pragma omp parallel for
+  for (int i=0; i< NBODIES; i++)
+  {
+    // get the global transform of the body (the only chain walk)
+    Transform3d T = Pose3d::calc_relative_pose(_bodies[i]->get_pose(), GLOBAL);
+    double* Tb = &_body_T[i*STRIDE];
+    set_transform(T.q, T.x, Tb);
+
+    // compose the transforms of the body's geometries and their primitives;
+    // geometry poses are defined relative to the body pose, and primitive
+    // poses are defined relative to the geometry pose
+    double Tg[STRIDE];
+    for (unsigned j=_geom_begin[i]; j< _geom_begin[i+1]; j++)
+    {
+      const Pose3d& Fg = *_geoms[j]->get_pose();
+      const Pose3d& Fp = *_geoms[j]->get_geometry()->get_pose();
+      compose(Tb, Fg.q, Fg.x, Tg);
+      compose(Tg, Fp.q, Fp.x, &_geom_T[j*STRIDE]);
+    }
+  }
+}
+
+/// Gets the index of a rigid body (or NONE if the body is not cached)
+unsigned PoseCache::get_body_index(RigidBodyPtr rb) const
+{
+  map<RigidBody*, unsigned>::const_iterator i = _body_index.find(rb.get());
+  return (i == _body_index.end()) ? NONE : i->second;
+}
+
+/// Gets the index of a collision geometry (or NONE if the geometry is not cached)
+unsigned PoseCache::get_geom_index(CollisionGeometryPtr cg) const
+{
+  map<CollisionGeometry*, unsigned>::const_iterator i = _geom_index.find(cg.get());
+  return (i == _geom_index.end()) ? NONE : i->second;
+}
+
+/// Sets a pose to the global pose of the primitive of the i'th geometry
+/**
+ * The pose is made relative to the global frame, so it may be passed to
+ * Primitive::calc_signed_dist() without any chain being walked.
+ */
+void PoseCache::get_geom_pose(unsigned i, Pose3d& P) const
+{
+  const double* T = get_geom_transform(i);
+  P.q.w = T[12];
+  P.q.x = T[13];
+  P.q.y = T[14];
+  P.q.z = T[15];
+  P.x = Origin3d(T[9], T[10], T[11]);
+  P.rpose = GLOBAL;
+}
+
+/// Transforms a point from the primitive frame of the i'th geometry to the global frame
+/**
+ * \note the pose of p is not examined
+ */
+Point3d PoseCache::transform_point_to_global(unsigned i, const Point3d& p) const
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+  const double* T = get_geom_transform(i);
+  return Point3d(T[0]*p[X] + T[1]*p[Y] + T[2]*p[Z] + T[9],
+                 T[3]*p[X] + T[4]*p[Y] + T[5]*p[Z] + T[10],
+                 T[6]*p[X] + T[7]*p[Y] + T[8]*p[Z] + T[11], GLOBAL);
+}
+
+/// Transforms a point from the global frame to the primitive frame of the i'th geometry
+/**
+ * \note the pose of p is not examined, and the pose of the result is left
+ *       for the caller to set (typically to the primitive's pose)
+ */
+Point3d PoseCache::transform_point_from_global(unsigned i, const Point3d& p) const
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+  const double* T = get_geom_transform(i);
+  const double dx = p[X] - T[9], dy = p[Y] - T[10], dz = p[Z] - T[11];
+  return Point3d(T[0]*dx + T[3]*dy + T[6]*dz,
+                 T[1]*dx + T[4]*dy + T[7]*dz,
+                 T[2]*dx + T[5]*dy + T[8]*dz);
+}
+
+/// Transforms a vector from the primitive frame of the i'th geometry to the global frame
+/**
+ * \note the pose of v is not examined
+ */
+Vector3d PoseCache::transform_vector_to_global(unsigned i, const Vector3d& v) const
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+  const double* T = get_geom_transform(i);
+  return Vector3d(T[0]*v[X] + T[1]*v[Y] + T[2]*v[Z],
+                  T[3]*v[X] + T[4]*v[Y] + T[5]*v[Z],
+                  T[6]*v[X] + T[7]*v[Y] + T[8]*v[Z], GLOBAL);
+}
+
+/// Stores a transform given by a unit quaternion and a translation
+void PoseCache::set_transform(const Quatd& q, const Origin3d& x, double* T)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // setup the rotation matrix
+  const double ww = q.w*q.w, xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+  const double xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+  const double wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+  T[0] = ww + xx - yy - zz;  T[1] = 2.0*(xy - wz);      T[2] = 2.0*(xz + wy);
+  T[3] = 2.0*(xy + wz);      T[4] = ww - xx + yy - zz;  T[5] = 2.0*(yz - wx);
+  T[6] = 2.0*(xz - wy);      T[7] = 2.0*(yz + wx);      T[8] = ww - xx - yy + zz;
+
+  // setup the translation and the quaternion
+  T[9] = x[X];  T[10] = x[Y];  T[11] = x[Z];
+  T[12] = q.w;  T[13] = q.x;  T[14] = q.y;  T[15] = q.z;
+}
+
+/// Composes a stored transform with a relative transform (T = T1 * T2)
+void PoseCache::compose(const double* T1, const Quatd& q2, const Origin3d& x2, double* T)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // compose the quaternions
+  Quatd q;
+  q.w = T1[12]*q2.w - T1[13]*q2.x - T1[14]*q2.y - T1[15]*q2.z;
+  q.x = T1[12]*q2.x + T1[13]*q2.w + T1[14]*q2.z - T1[15]*q2.y;
+  q.y = T1[12]*q2.y - T1[13]*q2.z + T1[14]*q2.w + T1[15]*q2.x;
+  q.z = T1[12]*q2.z + T1[13]*q2.y - T1[14]*q2.x + T1[15]*q2.w;
+
+  // transform the translation
+  Origin3d x(T1[0]*x2[X] + T1[1]*x2[Y] + T1[2]*x2[Z] + T1[9],
+             T1[3]*x2[X] + T1[4]*x2[Y] + T1[5]*x2[Z] + T1[10],
+             T1[6]*x2[X] + T1[7]*x2[Y] + T1[8]*x2[Z] + T1[11]);
+
+  set_transform(q, x, T);
+}
+
@@ -49,6 +49,9 @@ RCArticulatedBody::RCArticulatedBody()
   b_alpha = (double) 0.0;
   b_beta = (double) 0.0;
 
+  // solve loop closure constraints using the constraint-space inertia
+  loop_solver_type = LoopClosureSolver::eSchur;
+
   // invalidate position quanitites
   _position_invalidated = true;
 }
@@ -863,77 +866,68 @@ void RCArticulatedBody::calc_fwd_dyn()
 }
 
 /// Computes the forward dynamics with loops
+/**
+ * The loop-closure constraints are solved by the body's LoopClosureSolver
+ * (see loop_solver_type); all workspaces are members, so bodies may be
+ * simulated concurrently.
+ */
 void RCArticulatedBody::calc_fwd_dyn_loops()
 {
   double Cx[6];
-  SAFESTATIC MatrixNd Jx_iM_JxT, U, V;
-  SAFESTATIC MatrixNd Jx_dot, iM_JxT;
-  SAFESTATIC VectorNd v, fext, C, alpha_x, beta_x, Dx_v, Jx_v, Jx_dot_v, workv;
-  SAFESTATIC VectorNd iM_fext, a, S;
 
-  // get the generalized velocity, generalized forces, and inverse generalized
-  // inertia matrix
-  get_generalized_velocity(eSpatial, v);
-  get_generalized_forces(fext);
+  // get the generalized velocity and generalized forces
+  get_generalized_velocity(eSpatial, _loop_v);
+  get_generalized_forces(_loop_fext);
 
   // determine how many implicit constraint equations
-  unsigned N_EXPLICIT_CONSTRAINT_EQNS = 0;
+  unsigned N_IMPLICIT_CONSTRAINT_EQNS = 0;
   for (unsigned i=0; i< _ijoints.size(); i++)
-    N_EXPLICIT_CONSTRAINT_EQNS = _ijoints[i]->num_constraint_eqns();
+    N_IMPLICIT_CONSTRAINT_EQNS += _ijoints[i]->num_constraint_eqns();
 
   // evaluate implicit constraints
-  C.resize(N_EXPLICIT_CONSTRAINT_EQNS);
-  for (unsigned i=0, r=0, s=0; i< _ijoints.size(); i++)
+  _loop_C.resize(N_IMPLICIT_CONSTRAINT_EQNS);
+  for (unsigned i=0, r=0; i< _ijoints.size(); i++)
   {
     _ijoints[i]->evaluate_constraints(Cx);
     for (unsigned j=0; j< _ijoints[i]->num_constraint_eqns(); j++)
-      C[r++] = Cx[j];
+      _loop_C[r++] = Cx[j];
   }
 
   // get the implicit constraint Jacobian and its time derivative
   determine_implicit_constraint_jacobian(_Jx);
-  determine_implicit_constraint_jacobian_dot(Jx_dot);
-
-  // compute Jx * v and Jx_dot * v
-  _Jx.mult(v, Jx_v);
-  Jx_dot.mult(v, Jx_dot_v);
+  determine_implicit_constraint_jacobian_dot(_Jx_dot);
 
   // get movement Jacobian for implicit constraints and compute velocities
   determine_implicit_constraint_movement_jacobian(_Dx);
-  _Dx.mult(v, Dx_v);
+  _Dx.mult(_loop_v, _loop_workv);
   for (unsigned i=0, k=0; i< _ijoints.size(); i++)
   {
-    Dx_v.get_sub_vec(k, k+_ijoints[i]->num_dof(), _ijoints[i]->qd);
+    _loop_workv.get_sub_vec(k, k+_ijoints[i]->num_dof(), _ijoints[i]->qd);
     k += _ijoints[i]->num_dof();
   }
 
   // add in implicit actuator forces
-  beta_x.resize(_Dx.rows());
+  _loop_beta.resize(_Dx.rows());
   for (unsigned i=0, k=0; i< _ijoints.size(); i++)
   {
-    _ijoints[i]->get_scaled_force(workv);
+    _ijoints[i]->get_scaled_force(_loop_workv);
     for (unsigned j=0; j< _ijoints[i]->num_dof(); j++)
-      beta_x[k++] = workv[j];
+      _loop_beta[k++] = _loop_workv[j];
   }
-  _Dx.transpose_mult(beta_x, workv);
-  fext += workv;
-
-  // compute the constraint forces
-  solve_generalized_inertia(fext, iM_fext);
-  _Jx.mult(iM_fext, alpha_x) += Jx_dot_v;
-  _Jx.mult(v, workv) *= ((double) 2.0 * b_alpha);
-  alpha_x += workv;
-  C *= (b_beta*b_beta);
-  alpha_x += C;
-  transpose_solve_generalized_inertia(_Jx, iM_JxT);
-  _Jx.mult(iM_JxT, Jx_iM_JxT);
-  _LA->svd(Jx_iM_JxT, U, S, V);
-  _LA->solve_LS_fast(U, S, V, alpha_x);
+  _Dx.transpose_mult(_loop_beta, _loop_workv);
+  _loop_fext += _loop_workv;
+
+  // compute the constraint bias (with Baumgarte stabilization):
+  // Jx_dot*v + 2*alpha*Jx*v + beta^2*C
+  _Jx.mult(_loop_v, _loop_gamma) *= ((double) 2.0 * b_alpha);
+  _loop_gamma += _Jx_dot.mult(_loop_v, _loop_workv);
+  _loop_C *= (b_beta*b_beta);
+  _loop_gamma += _loop_C;
 
   // compute generalized acceleration
-  fext -= _Jx.transpose_mult(alpha_x, workv);
-  solve_generalized_inertia(fext, a);
-  set_generalized_acceleration(a);
+  _loop_solver.solver_type = loop_solver_type;
+  _loop_solver.solve(*this, _Jx, _loop_fext, _loop_gamma, _loop_a);
+  set_generalized_acceleration(_loop_a);
 }
 
 /// Determines the ndof x ngc Jacobian for implicit constraint movement (ndof is the number of degrees of freedom of the implicit constraints)
@@ -1645,8 +1639,8 @@ VectorNd& RCArticulatedBody::get_generalized_forces(VectorNd& f)
 VectorNd& RCArticulatedBody::convert_to_generalized_force(SingleBodyPtr body, const SForced& w, const Point3d& p, VectorNd& gf)
 {
   const unsigned SPATIAL_DIM = 6;
-  static vector<SVelocityd> J;
-  static vector<SVelocityd> sprime;
+  SAFESTATIC vector<SVelocityd> J;
+  SAFESTATIC vector<SVelocityd> sprime;
 
   // get the body as a rigid body
   RigidBodyPtr link = dynamic_pointer_cast<RigidBody>(body);
@@ -1809,6 +1803,23 @@ void RCArticulatedBody::load_from_xml(shared_ptr<const XMLTree> node, map<string
   if (bbeta_attr)
     b_beta = bbeta_attr->get_real_value();
 
+  // get the loop closure solver
+  XMLAttrib* loop_solver_attr = node->get_attrib("loop-solver");
+  if (loop_solver_attr)
+  {
+    string solver = loop_solver_attr->get_string_value();
+    if (strcasecmp(solver.c_str(), "schur") == 0)
+      loop_solver_type = LoopClosureSolver::eSchur;
+    else if (strcasecmp(solver.c_str(), "kkt") == 0)
+      loop_solver_type = LoopClosureSolver::eSparseKKT;
+    else
+    {
+      std::cerr << "RCArticulatedBody::load_from_xml() - unknown ";
+      std::cerr << "loop solver '" << solver << "' -- valid types are ";
+      std::cerr << "'schur' and 'kkt'" << std::endl;
+    }
+  }
+
   // compile everything once again, for safe measure
   compile();
 
@@ -1870,5 +1881,11 @@ void RCArticulatedBody::save_to_xml(XMLTreePtr node, list<shared_ptr<const Base>
   // save baumgarte parameters
   node->attribs.insert(XMLAttrib("baumgarte-alpha", b_alpha));
   node->attribs.insert(XMLAttrib("baumgarte-beta", b_beta));
+
+  // save the loop closure solver
+  if (loop_solver_type == LoopClosureSolver::eSchur)
+    node->attribs.insert(XMLAttrib("loop-solver", string("schur")));
+  else
+    node->attribs.insert(XMLAttrib("loop-solver", string("kkt")));
 }
 
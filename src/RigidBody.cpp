@@ -706,6 +706,9 @@ void RigidBody::add_force(const SForced& w)
   // do not add forces to disabled bodies
   if (!_enabled)
     return;
+
+  // an applied force wakes the body
+  _sleeping = false;
   
   // update the force 
   _force0 += Pose3d::transform(GLOBAL, w);
@@ -1171,6 +1174,9 @@ void RigidBody::remove_inner_joint(JointPtr joint)
  */
 void RigidBody::apply_impulse(const SMomentumd& w)
 {  
+  // an applied impulse wakes the body
+  _sleeping = false;
+
   // if this is not an articulated body, just update linear and angular
   // momenta and velocites
   if (_abody.expired())
@@ -16,36 +16,35 @@ void RungeKuttaIntegrator::integrate(VectorNd& x, VectorNd& (*f)(const VectorNd&
 {
   const double ONE_SIXTH = 1.0/6.0;
   const double ONE_THIRD = 1.0/3.0;
-  SAFESTATIC VectorNd k1, k2, k3, k4, tmp;
   
   // compute k1
-  f(x, time, step_size, data, k1) *= step_size;
+  f(x, time, step_size, data, _k1) *= step_size;
 
   // compute k2
   const double HALF_STEP = step_size * (double) 0.5;
-  ((tmp = k1) *= 0.5) += x;
-  f(tmp, time + HALF_STEP, HALF_STEP, data, k2) *= step_size;
+  ((_tmp = _k1) *= 0.5) += x;
+  f(_tmp, time + HALF_STEP, HALF_STEP, data, _k2) *= step_size;
 
   // compute k3
-  ((tmp = k2) *= 0.5) += x;
-  f(tmp, time + HALF_STEP, HALF_STEP, data, k3) *= step_size;
+  ((_tmp = _k2) *= 0.5) += x;
+  f(_tmp, time + HALF_STEP, HALF_STEP, data, _k3) *= step_size;
 
   // compute k4
-  ((tmp = k3) *= 0.5) += x;
-  f(tmp, time + step_size, step_size, data, k4) *= step_size;
+  ((_tmp = _k3) *= 0.5) += x;
+  f(_tmp, time + step_size, step_size, data, _k4) *= step_size;
 
   // update the time
   time += step_size;
 
   // compute new state
-  k1 *= ONE_SIXTH;
-  k2 *= ONE_THIRD;
-  k3 *= ONE_THIRD;
-  k4 *= ONE_SIXTH;
-  x += k1;
-  x += k2;
-  x += k3;
-  x += k4;
+  _k1 *= ONE_SIXTH;
+  _k2 *= ONE_THIRD;
+  _k3 *= ONE_THIRD;
+  _k4 *= ONE_SIXTH;
+  x += _k1;
+  x += _k2;
+  x += _k3;
+  x += _k4;
 
   return;
 }
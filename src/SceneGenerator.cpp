@@ -0,0 +1,539 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <Ravelin/Origin3d.h>
+#include <Moby/XMLTree.h>
+#include <Moby/XMLReader.h>
+#include <Moby/Simulator.h>
+#include <Moby/MeshAssetCache.h>
+#include <Moby/SceneGenerator.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using std::vector;
+using std::string;
+using std::map;
+using std::set;
+
+/// Constructs an empty scene
+/**
+ * \param seed the seed for the generator used to jitter positions
+ */
+SceneGenerator::SceneGenerator(unsigned seed)
+{
+  _seed = seed;
+  _next_id = 0;
+  _x = 0.0;
+  _zext = 0.0;
+  _epsilon = 0.0;
+  _mu_coulomb = 0.5;
+  _mu_viscous = 0.0;
+}
+
+/// Sets the contact parameters used for every pair of bodies
+void SceneGenerator::set_contact_parameters(double epsilon, double mu_coulomb, double mu_viscous)
+{
+  _epsilon = epsilon;
+  _mu_coulomb = mu_coulomb;
+  _mu_viscous = mu_viscous;
+}
+
+/// Adds a pile of n boxes (cubes) with the given edge length
+void SceneGenerator::add_box_pile(unsigned n, double size)
+{
+  // create the primitive
+  string id = new_id("box-primitive");
+  XMLTreePtr prim(new XMLTree("Box"));
+  prim->attribs.insert(XMLAttrib("id", id));
+  prim->attribs.insert(XMLAttrib("xlen", size));
+  prim->attribs.insert(XMLAttrib("ylen", size));
+  prim->attribs.insert(XMLAttrib("zlen", size));
+  prim->attribs.insert(XMLAttrib("density", 10.0));
+  _shared.push_back(prim);
+
+  // add the pile
+  add_pile(n, vector<string>(1, id), size, 0.1);
+}
+
+/// Adds a pile of n spheres with the given radius
+void SceneGenerator::add_sphere_pile(unsigned n, double radius)
+{
+  // create the primitive
+  string id = new_id("sphere-primitive");
+  XMLTreePtr prim(new XMLTree("Sphere"));
+  prim->attribs.insert(XMLAttrib("id", id));
+  prim->attribs.insert(XMLAttrib("radius", radius));
+  prim->attribs.insert(XMLAttrib("density", 10.0));
+  _shared.push_back(prim);
+
+  // add the pile
+  add_pile(n, vector<string>(1, id), radius*2.0, 0.1);
+}
+
+/// Adds clutter of n rigid bodies, each using a randomly chosen mesh file
+void SceneGenerator::add_mesh_clutter(unsigned n, const vector<string>& mesh_fnames)
+{
+  if (mesh_fnames.empty())
+    throw std::runtime_error("SceneGenerator::add_mesh_clutter() - no mesh files given");
+
+  // create a primitive for each mesh file (once)
+  vector<string> ids;
+  double radius = 0.0;
+  BOOST_FOREACH(const string& fname, mesh_fnames)
+  {
+    // use the canonical path, so that the scene can be written anywhere
+    char path[PATH_MAX];
+    if (!realpath(fname.c_str(), path))
+      throw std::runtime_error("SceneGenerator::add_mesh_clutter() - unable to find mesh file " + fname);
+
+    // create the primitive, if necessary
+    map<string, std::pair<string, double> >::const_iterator i = _mesh_primitives.find(path);
+    if (i == _mesh_primitives.end())
+    {
+      // determine the bounding radius of the (centered) mesh
+      shared_ptr<const MeshAssetCache::Asset> asset = MeshAssetCache::load(path, true);
+      double r = 0.0;
+      BOOST_FOREACH(const Origin3d& v, asset->mesh->get_vertices())
+        r = std::max(r, v.norm());
+
+      // create the primitive
+      string id = new_id("mesh-primitive");
+      XMLTreePtr prim(new XMLTree("TriangleMesh"));
+      prim->attribs.insert(XMLAttrib("id", id));
+      prim->attribs.insert(XMLAttrib("filename", string(path)));
+      prim->attribs.insert(XMLAttrib("center", true));
+      prim->attribs.insert(XMLAttrib("density", 1.0));
+      _shared.push_back(prim);
+      i = _mesh_primitives.insert(std::make_pair(string(path), std::make_pair(id, r))).first;
+    }
+
+    ids.push_back(i->second.first);
+    radius = std::max(radius, i->second.second);
+  }
+
+  // add the pile (with arbitrary orientations)
+  add_pile(n, ids, radius*2.0, M_PI);
+}
+
+/// Adds a pile of n rigid bodies
+/**
+ * \param primitive_ids the primitives to choose among (at random) for each
+ *        body
+ * \param size the size of the (cubic) cell holding each body
+ * \param max_rot the maximum rotation (about each axis) of each body
+ */
+void SceneGenerator::add_pile(unsigned n, const vector<string>& primitive_ids, double size, double max_rot)
+{
+  // bodies are placed in layers of k x k cells
+  const unsigned K = std::max((unsigned) 1, (unsigned) std::ceil(std::pow((double) n, 1.0/3.0) - 1e-8));
+  const double SPACING = size * 1.1, JITTER = size * 0.05;
+
+  for (unsigned i=0; i< n; i++)
+  {
+    // determine the cell
+    const unsigned LAYER = i / (K*K), IX = (i % (K*K)) % K, IZ = (i % (K*K)) / K;
+
+    // choose the primitive
+    const string& pid = primitive_ids[(primitive_ids.size() == 1) ? 0 : (unsigned) random(0.0, primitive_ids.size() - 1e-8)];
+
+    // setup the body
+    XMLTreePtr body(new XMLTree("RigidBody"));
+    body->attribs.insert(XMLAttrib("id", new_id("body")));
+    body->attribs.insert(XMLAttrib("enabled", true));
+    body->attribs.insert(XMLAttrib("visualization-id", pid));
+    double x = _x + SPACING*(IX + 0.5) + random(-JITTER, JITTER);
+    double y = SPACING*(LAYER + 0.5);
+    double z = SPACING*(IZ + 0.5 - 0.5*K) + random(-JITTER, JITTER);
+    body->attribs.insert(XMLAttrib("position", Origin3d(x, y, z)));
+    body->attribs.insert(XMLAttrib("rpy", random(-max_rot, max_rot), random(-max_rot, max_rot), random(-max_rot, max_rot)));
+
+    // setup the inertia and the geometry
+    XMLTreePtr inertia(new XMLTree("InertiaFromPrimitive"));
+    inertia->attribs.insert(XMLAttrib("primitive-id", pid));
+    body->add_child(inertia);
+    XMLTreePtr geom(new XMLTree("CollisionGeometry"));
+    geom->attribs.insert(XMLAttrib("primitive-id", pid));
+    body->add_child(geom);
+
+    add_body(body);
+  }
+
+  // update the extents
+  _x += SPACING*(K + 1);
+  _zext = std::max(_zext, SPACING*K);
+}
+
+/// Adds a fixed-base chain of n links, initially horizontal, that falls onto the ground
+void SceneGenerator::add_chain(unsigned n, double link_len)
+{
+  // create the primitive
+  string pid = new_id("link-primitive");
+  XMLTreePtr prim(new XMLTree("Box"));
+  prim->attribs.insert(XMLAttrib("id", pid));
+  prim->attribs.insert(XMLAttrib("xlen", link_len*0.2));
+  prim->attribs.insert(XMLAttrib("ylen", link_len));
+  prim->attribs.insert(XMLAttrib("zlen", link_len*0.2));
+  prim->attribs.insert(XMLAttrib("density", 1.0));
+  _shared.push_back(prim);
+
+  // setup the articulated body; the base is high enough that roughly half of
+  // the chain piles up on the ground
+  string cid = new_id("chain");
+  const double X0 = _x + link_len, Y0 = link_len*(0.5*n + 1.0);
+  XMLTreePtr chain(new XMLTree("RCArticulatedBody"));
+  chain->attribs.insert(XMLAttrib("id", cid));
+  chain->attribs.insert(XMLAttrib("floating-base", false));
+  chain->attribs.insert(XMLAttrib("fdyn-algorithm", string("crb")));
+  chain->attribs.insert(XMLAttrib("fdyn-algorithm-frame", string("link")));
+
+  // setup the base
+  XMLTreePtr base(new XMLTree("RigidBody"));
+  base->attribs.insert(XMLAttrib("id", cid + "-base"));
+  base->attribs.insert(XMLAttrib("position", Origin3d(X0, Y0, 0.0)));
+  XMLTreePtr base_inertia(new XMLTree("InertiaFromPrimitive"));
+  base_inertia->attribs.insert(XMLAttrib("primitive-id", pid));
+  base->add_child(base_inertia);
+  chain->add_child(base);
+
+  // setup the links (lying along +x) and joints
+  string inboard = cid + "-base";
+  for (unsigned i=0; i< n; i++)
+  {
+    const string LINK = cid + "-l" + boost::lexical_cast<string>(i);
+    XMLTreePtr link(new XMLTree("RigidBody"));
+    link->attribs.insert(XMLAttrib("id", LINK));
+    link->attribs.insert(XMLAttrib("position", Origin3d(X0 + link_len*(i + 0.5), Y0, 0.0)));
+    link->attribs.insert(XMLAttrib("rpy", 0.0, 0.0, M_PI_2));
+    link->attribs.insert(XMLAttrib("visualization-id", pid));
+    XMLTreePtr inertia(new XMLTree("InertiaFromPrimitive"));
+    inertia->attribs.insert(XMLAttrib("primitive-id", pid));
+    link->add_child(inertia);
+    XMLTreePtr geom(new XMLTree("CollisionGeometry"));
+    geom->attribs.insert(XMLAttrib("primitive-id", pid));
+    link->add_child(geom);
+    chain->add_child(link);
+
+    XMLTreePtr joint(new XMLTree("RevoluteJoint"));
+    joint->attribs.insert(XMLAttrib("id", cid + "-q" + boost::lexical_cast<string>(i)));
+    joint->attribs.insert(XMLAttrib("q", 0.0));
+    joint->attribs.insert(XMLAttrib("qd", 0.0));
+    joint->attribs.insert(XMLAttrib("location", Origin3d(X0 + link_len*i, Y0, 0.0)));
+    joint->attribs.insert(XMLAttrib("inboard-link-id", inboard));
+    joint->attribs.insert(XMLAttrib("outboard-link-id", LINK));
+    joint->attribs.insert(XMLAttrib("axis", Origin3d(0.0, 0.0, 1.0)));
+    joint->attribs.insert(XMLAttrib("lower-limits", -100000.0));
+    joint->attribs.insert(XMLAttrib("upper-limits", 100000.0));
+    joint->attribs.insert(XMLAttrib("coulomb-friction-coeff", 0.0));
+    joint->attribs.insert(XMLAttrib("viscous-friction-coeff", 0.0));
+    joint->attribs.insert(XMLAttrib("restitution-coeff", 0.0));
+    chain->add_child(joint);
+
+    inboard = LINK;
+  }
+
+  add_body(chain);
+
+  // update the extents
+  _x = X0 + link_len*(n + 1);
+  _zext = std::max(_zext, link_len);
+}
+
+/// Adds a row of m robots, each cloned from the first articulated body in a Moby XML file
+/**
+ * The primitives and other objects that the robot refers to are copied
+ * (once) from the file. All IDs are prefixed so that clones are distinct,
+ * and each clone is translated along x so that no two overlap.
+ */
+void SceneGenerator::add_robots(unsigned m, const string& robot_fname)
+{
+  // read the file using its canonical path, so that any paths in it are
+  // resolved to absolute paths
+  char path[PATH_MAX];
+  if (!realpath(robot_fname.c_str(), path))
+    throw std::runtime_error("SceneGenerator::add_robots() - unable to find " + robot_fname);
+  shared_ptr<XMLTree> root = XMLReader::read_tree(path);
+  if (!root)
+    throw std::runtime_error("SceneGenerator::add_robots() - unable to read " + robot_fname);
+
+  // find the articulated body
+  shared_ptr<const XMLTree> robot;
+  BOOST_FOREACH(XMLTreePtr child, root->children)
+    if (strcasecmp(child->name.c_str(), "RCArticulatedBody") == 0)
+    {
+      robot = child;
+      break;
+    }
+  if (!robot)
+    throw std::runtime_error("SceneGenerator::add_robots() - no RCArticulatedBody in " + robot_fname);
+
+  // get the IDs within the robot
+  set<string> internal;
+  collect_ids(robot, internal);
+
+  // find the objects outside of the robot that it refers to (along with the
+  // objects that they refer to)
+  set<string> refs, closed;
+  collect_refs(robot, refs);
+  vector<shared_ptr<const XMLTree> > external;
+  while (!refs.empty())
+  {
+    string ref = *refs.begin();
+    refs.erase(refs.begin());
+    if (internal.find(ref) != internal.end() || !closed.insert(ref).second)
+      continue;
+    BOOST_FOREACH(XMLTreePtr child, root->children)
+    {
+      XMLAttrib* id_attr = child->get_attrib("id");
+      if (id_attr && id_attr->value == ref)
+      {
+        external.push_back(child);
+        collect_refs(child, refs);
+        break;
+      }
+    }
+  }
+
+  // copy the external objects with new IDs
+  const string PREFIX = new_id("robot") + "-";
+  map<string, string> rename;
+  BOOST_FOREACH(shared_ptr<const XMLTree> node, external)
+    rename[node->get_attrib("id")->value] = PREFIX + node->get_attrib("id")->value;
+  BOOST_FOREACH(shared_ptr<const XMLTree> node, external)
+    _shared.push_back(clone_renamed(node, rename));
+
+  // determine the extent of the robot along x from its links
+  double xmin = std::numeric_limits<double>::max();
+  double xmax = -std::numeric_limits<double>::max();
+  BOOST_FOREACH(XMLTreePtr child, robot->children)
+  {
+    XMLAttrib* pos_attr = child->get_attrib("position");
+    if (!pos_attr || strcasecmp(child->name.c_str(), "RigidBody") != 0)
+      continue;
+    Origin3d x = pos_attr->get_origin_value();
+    xmin = std::min(xmin, x[0]);
+    xmax = std::max(xmax, x[0]);
+  }
+  if (xmin > xmax)
+    xmin = xmax = 0.0;
+  const double WIDTH = (xmax - xmin) + 1.0;
+
+  // clone the robot
+  for (unsigned j=0; j< m; j++)
+  {
+    // rename the IDs within the robot
+    const string CLONE_PREFIX = PREFIX + boost::lexical_cast<string>(j) + "-";
+    BOOST_FOREACH(const string& id, internal)
+      rename[id] = CLONE_PREFIX + id;
+
+    // clone and translate
+    XMLTreePtr clone = clone_renamed(robot, rename);
+    clone->attribs.erase(XMLAttrib("translate", ""));
+    clone->attribs.insert(XMLAttrib("translate", Origin3d(_x + WIDTH*(j + 0.5) - xmin, 0.0, 0.0)));
+    add_body(clone);
+  }
+
+  // update the extents
+  _x += WIDTH*(m + 1);
+  _zext = std::max(_zext, WIDTH);
+}
+
+/// Gets the Moby XML tree (the MOBY node) for the scene
+XMLTreePtr SceneGenerator::get_tree() const
+{
+  XMLTreePtr moby(new XMLTree("MOBY"));
+
+  // setup the ground, the integrator, and gravity
+  const double XLEN = _x + 20.0, ZLEN = _zext + 20.0;
+  XMLTreePtr ground_prim(new XMLTree("Box"));
+  ground_prim->attribs.insert(XMLAttrib("id", string("ground-primitive")));
+  ground_prim->attribs.insert(XMLAttrib("xlen", XLEN));
+  ground_prim->attribs.insert(XMLAttrib("ylen", 0.5));
+  ground_prim->attribs.insert(XMLAttrib("zlen", ZLEN));
+  ground_prim->attribs.insert(XMLAttrib("density", 10.0));
+  moby->add_child(ground_prim);
+  XMLTreePtr integrator(new XMLTree("RungeKuttaIntegrator"));
+  integrator->attribs.insert(XMLAttrib("id", string("rk4")));
+  moby->add_child(integrator);
+  XMLTreePtr gravity(new XMLTree("GravityForce"));
+  gravity->attribs.insert(XMLAttrib("id", string("gravity")));
+  gravity->attribs.insert(XMLAttrib("accel", Origin3d(0.0, -9.81, 0.0)));
+  moby->add_child(gravity);
+
+  // copy the shared objects and the bodies
+  BOOST_FOREACH(XMLTreePtr node, _shared)
+    moby->add_child(node->clone());
+  BOOST_FOREACH(XMLTreePtr node, _bodies)
+    moby->add_child(node->clone());
+
+  // setup the ground body
+  XMLTreePtr ground(new XMLTree("RigidBody"));
+  ground->attribs.insert(XMLAttrib("id", string("ground")));
+  ground->attribs.insert(XMLAttrib("enabled", false));
+  ground->attribs.insert(XMLAttrib("position", Origin3d(0.5*_x, -0.25, 0.0)));
+  ground->attribs.insert(XMLAttrib("visualization-id", string("ground-primitive")));
+  XMLTreePtr ground_geom(new XMLTree("CollisionGeometry"));
+  ground_geom->attribs.insert(XMLAttrib("primitive-id", string("ground-primitive")));
+  ground->add_child(ground_geom);
+  moby->add_child(ground);
+
+  // setup the collision detector and the simulator
+  XMLTreePtr ccd(new XMLTree("GeneralizedCCD"));
+  ccd->attribs.insert(XMLAttrib("id", string("ccd")));
+  ccd->attribs.insert(XMLAttrib("eps-tolerance", 1e-3));
+  XMLTreePtr sim(new XMLTree("EventDrivenSimulator"));
+  sim->attribs.insert(XMLAttrib("id", string("simulator")));
+  sim->attribs.insert(XMLAttrib("integrator-id", string("rk4")));
+  sim->attribs.insert(XMLAttrib("collision-detector-id", string("ccd")));
+  vector<XMLTreePtr> bodies = _bodies;
+  bodies.push_back(ground);
+  BOOST_FOREACH(XMLTreePtr node, bodies)
+  {
+    const string& ID = node->get_attrib("id")->value;
+    XMLTreePtr ccd_body(new XMLTree("Body"));
+    ccd_body->attribs.insert(XMLAttrib("body-id", ID));
+    if (strcasecmp(node->name.c_str(), "RigidBody") != 0)
+      ccd_body->attribs.insert(XMLAttrib("disable-adjacent-links", true));
+    ccd->add_child(ccd_body);
+    XMLTreePtr sim_body(new XMLTree("DynamicBody"));
+    sim_body->attribs.insert(XMLAttrib("dynamic-body-id", ID));
+    sim->add_child(sim_body);
+  }
+  XMLTreePtr force(new XMLTree("RecurrentForce"));
+  force->attribs.insert(XMLAttrib("recurrent-force-id", string("gravity")));
+  sim->add_child(force);
+  XMLTreePtr cparams(new XMLTree("ContactParameters"));
+  cparams->attribs.insert(XMLAttrib("epsilon", _epsilon));
+  cparams->attribs.insert(XMLAttrib("mu-coulomb", _mu_coulomb));
+  cparams->attribs.insert(XMLAttrib("mu-viscous", _mu_viscous));
+  sim->add_child(cparams);
+  moby->add_child(ccd);
+  moby->add_child(sim);
+
+  return moby;
+}
+
+/// Writes the scene to a Moby XML file
+void SceneGenerator::write(const string& fname) const
+{
+  std::ofstream out(fname.c_str());
+  if (out.fail())
+    throw std::runtime_error("SceneGenerator::write() - unable to open " + fname + " for writing");
+  out << "<XML>" << std::endl << *get_tree() << "</XML>" << std::endl;
+  if (out.fail())
+    throw std::runtime_error("SceneGenerator::write() - unable to write " + fname);
+}
+
+/// Constructs the objects in the scene (without writing any XML)
+map<string, BasePtr> SceneGenerator::construct() const
+{
+  return XMLReader::construct(get_tree());
+}
+
+/// Finds the simulator among constructed objects
+shared_ptr<Simulator> SceneGenerator::find_simulator(const map<string, BasePtr>& id_map)
+{
+  shared_ptr<Simulator> sim;
+  for (map<string, BasePtr>::const_iterator i = id_map.begin(); i != id_map.end(); i++)
+    if ((sim = dynamic_pointer_cast<Simulator>(i->second)))
+      break;
+  return sim;
+}
+
+/// Finds all convex meshes (files ending in _convex.obj) in a directory
+/**
+ * The filenames are sorted, so that generated scenes do not depend on the
+ * order of the directory.
+ */
+vector<string> SceneGenerator::find_convex_meshes(const string& dir)
+{
+  const string SUFFIX = "_convex.obj";
+  vector<string> fnames;
+  DIR* d = opendir(dir.c_str());
+  if (!d)
+    return fnames;
+  for (dirent* e = readdir(d); e; e = readdir(d))
+  {
+    string name(e->d_name);
+    if (name.size() > SUFFIX.size() && name.compare(name.size()-SUFFIX.size(), SUFFIX.size(), SUFFIX) == 0)
+      fnames.push_back(dir + "/" + name);
+  }
+  closedir(d);
+  std::sort(fnames.begin(), fnames.end());
+  return fnames;
+}
+
+/// Generates a new ID
+string SceneGenerator::new_id(const string& prefix)
+{
+  return prefix + boost::lexical_cast<string>(_next_id++);
+}
+
+/// Generates a uniformly distributed random number in [lo, hi]
+double SceneGenerator::random(double lo, double hi)
+{
+  return lo + (hi - lo) * ((double) rand_r(&_seed) / RAND_MAX);
+}
+
+/// Adds a body to the scene
+void SceneGenerator::add_body(XMLTreePtr body)
+{
+  _bodies.push_back(body);
+}
+
+/// Collects the values of all 'id' attributes in a tree
+void SceneGenerator::collect_ids(shared_ptr<const XMLTree> node, set<string>& ids)
+{
+  XMLAttrib* id_attr = node->get_attrib("id");
+  if (id_attr)
+    ids.insert(id_attr->value);
+  BOOST_FOREACH(XMLTreePtr child, node->children)
+    collect_ids(child, ids);
+}
+
+/// Collects the values of all attributes that refer to other objects ('*-id') in a tree
+void SceneGenerator::collect_refs(shared_ptr<const XMLTree> node, set<string>& refs)
+{
+  BOOST_FOREACH(const XMLAttrib& a, node->attribs)
+    if (a.name.size() > 3 && a.name.compare(a.name.size()-3, 3, "-id") == 0)
+      refs.insert(a.value);
+  BOOST_FOREACH(XMLTreePtr child, node->children)
+    collect_refs(child, refs);
+}
+
+/// Clones a tree, renaming IDs and references to IDs; text and comments are dropped
+XMLTreePtr SceneGenerator::clone_renamed(shared_ptr<const XMLTree> node, const map<string, string>& rename)
+{
+  XMLTreePtr copy(new XMLTree(node->name));
+  BOOST_FOREACH(const XMLAttrib& a, node->attribs)
+  {
+    // see whether the attribute is an ID or a reference to one
+    bool id = (a.name == "id" || (a.name.size() > 3 && a.name.compare(a.name.size()-3, 3, "-id") == 0));
+    map<string, string>::const_iterator i = rename.find(a.value);
+    if (id && i != rename.end())
+      copy->attribs.insert(XMLAttrib(a.name, i->second));
+    else
+      copy->attribs.insert(XMLAttrib(a.name, a.value));
+  }
+  BOOST_FOREACH(XMLTreePtr child, node->children)
+    if (strcasecmp(child->name.c_str(), "text") != 0 && strcasecmp(child->name.c_str(), "comment") != 0)
+      copy->add_child(clone_renamed(child, rename));
+  return copy;
+}
+
@@ -38,6 +38,11 @@ Simulator::Simulator()
   // clear dynamics timings
   dynamics_time = (double) 0.0;
 
+  // setup the (empty) state layout and body lists
+  _state_layout_valid = false;
+  update_state_layout();
+  update_body_lists();
+
   // setup the persistent and transient visualization data
   #ifdef USE_OSG
   _persistent_vdata = new osg::Group;
@@ -66,15 +71,12 @@ VectorNd& Simulator::ode(const VectorNd& x, double t, double dt, void* data, Vec
   // initialize the ODE index
   unsigned idx = 0;
 
-  // resize dx
+  // resize dx (does not reallocate once dx has held a state this large)
   dx.resize(x.size());
 
   // loop through all bodies, preparing to compute the ODE
-  BOOST_FOREACH(DynamicBodyPtr db, s->_bodies)
+  BOOST_FOREACH(DynamicBodyPtr db, s->_ode_bodies)
   {
-    if (db->get_kinematic())
-      continue;
-
     // get the number of generalized coordinates and velocities
     const unsigned NGC = db->num_generalized_coordinates(DynamicBody::eEuler);
     const unsigned NGV = db->num_generalized_coordinates(DynamicBody::eSpatial);
@@ -93,16 +95,15 @@ VectorNd& Simulator::ode(const VectorNd& x, double t, double dt, void* data, Vec
   s->check_pairwise_constraint_violations();
 
   // loop through all bodies, computing forward dynamics 
-  BOOST_FOREACH(DynamicBodyPtr db, s->_bodies)
-    if (!db->get_kinematic())
-      db->calc_fwd_dyn();
+  BOOST_FOREACH(DynamicBodyPtr db, s->_ode_bodies)
+    db->calc_fwd_dyn();
+
+  // reset the ODE index
+  idx = 0;
 
   // loop through all bodies, computing the ODE
-  BOOST_FOREACH(DynamicBodyPtr db, s->_bodies)
+  BOOST_FOREACH(DynamicBodyPtr db, s->_ode_bodies)
   {
-    if (db->get_kinematic())
-      continue;
-
     // get the number of generalized coordinates and velocities
     const unsigned NGC = db->num_generalized_coordinates(DynamicBody::eEuler);
     const unsigned NGV = db->num_generalized_coordinates(DynamicBody::eSpatial);
@@ -130,13 +131,23 @@ VectorNd& Simulator::ode(const VectorNd& x, double t, double dt, void* data, Vec
 double Simulator::step(double step_size)
 {
   #ifdef USE_OSG
-  // clear one-step visualization data
-  _transient_vdata->removeChildren(0, _transient_vdata->getNumChildren());
+  // clear one-step visualization data (the visualization thread owns it
+  // when snapshots are being published)
+  if (!snapshot_buffer)
+    _transient_vdata->removeChildren(0, _transient_vdata->getNumChildren());
   #endif
 
+  // separate kinematic bodies from dynamic bodies (set_kinematic() may have
+  // been called since the last step)
+  update_body_lists();
+
   // compute forward dynamics and integrate 
   current_time += integrate(step_size);
 
+  // publish the snapshot, if desired
+  if (snapshot_buffer)
+    publish_snapshot();
+
   // call the callback
   if (post_step_callback_fn)
     post_step_callback_fn(this);
@@ -185,6 +196,10 @@ void Simulator::remove_dynamic_body(DynamicBodyPtr body)
   else
     _bodies.erase(i);
 
+  // invalidate the state layout and rebuild the body lists
+  _state_layout_valid = false;
+  update_body_lists();
+
   #ifdef USE_OSG
   // see whether the body is articulated 
   ArticulatedBodyPtr abody = dynamic_pointer_cast<ArticulatedBody>(body);
@@ -270,6 +285,68 @@ void Simulator::add_dynamic_body(DynamicBodyPtr body)
   // add the body to the list of bodies and sort the list of bodies
   _bodies.push_back(body); 
   std::sort(_bodies.begin(), _bodies.end());
+
+  // invalidate the state layout and rebuild the body lists
+  _state_layout_valid = false;
+  update_body_lists();
+}
+
+/// Computes the offset of each body's state within the contiguous state of all bodies
+/**
+ * Does nothing unless the layout has been invalidated (by adding or removing
+ * a body).
+ */
+void Simulator::update_state_layout()
+{
+  if (_state_layout_valid)
+    return;
+
+  _state_offsets.resize(_bodies.size()+1);
+  _state_offsets[0] = 0;
+  for (unsigned i=0; i< _bodies.size(); i++)
+  {
+    const unsigned NGC = _bodies[i]->num_generalized_coordinates(DynamicBody::eEuler);
+    const unsigned NGV = _bodies[i]->num_generalized_coordinates(DynamicBody::eSpatial);
+    _state_offsets[i+1] = _state_offsets[i] + NGC + NGV;
+  }
+
+  _state_layout_valid = true;
+}
+
+/// Separates the bodies whose dynamics are simulated from those that are kinematically updated
+/**
+ * Called whenever a body is added or removed and at the start of every step,
+ * so that per-body loops (integration, dynamics, event finding) can use the
+ * lists rather than querying every body.
+ */
+void Simulator::update_body_lists()
+{
+  _dynamic_bodies.clear();
+  _kinematic_bodies.clear();
+  for (unsigned i=0; i< _bodies.size(); i++)
+  {
+    if (_bodies[i]->get_kinematic())
+      _kinematic_bodies.push_back(_bodies[i]);
+    else
+      _dynamic_bodies.push_back(_bodies[i]);
+  }
+}
+
+/// Updates all kinematically updated bodies to time t by calling their controllers
+/**
+ * Kinematic bodies are not integrated and their dynamics are never computed;
+ * their controllers set their states directly. The controllers are called
+ * serially, in the order that the bodies were added, as a controller may
+ * read or modify other bodies or shared state.
+ */
+void Simulator::update_kinematic_bodies(double t)
+{
+  for (unsigned i=0; i< _kinematic_bodies.size(); i++)
+  {
+    const DynamicBodyPtr& db = _kinematic_bodies[i];
+    if (db->controller)
+      (*db->controller)(db, t, db->controller_arg);
+  }
 }
 
 /// Updates all visualization under the simulator
@@ -279,6 +356,105 @@ void Simulator::update_visualization()
     body->update_visualization();
 }
 
+/// Gets the visualizable objects of all bodies in the order used by snapshots
+/**
+ * Articulated bodies contribute their links and then their joints; all
+ * other bodies contribute themselves.
+ */
+void Simulator::get_visualizables(vector<shared_ptr<Visualizable> >& vis) const
+{
+  vis.clear();
+  BOOST_FOREACH(DynamicBodyPtr body, _bodies)
+  {
+    ArticulatedBodyPtr ab = dynamic_pointer_cast<ArticulatedBody>(body);
+    if (ab)
+    {
+      const vector<RigidBodyPtr>& links = ab->get_links();
+      const vector<JointPtr>& joints = ab->get_joints();
+      vis.insert(vis.end(), links.begin(), links.end());
+      vis.insert(vis.end(), joints.begin(), joints.end());
+    }
+    else
+      vis.push_back(body);
+  }
+}
+
+/// Publishes a snapshot of the current state to the snapshot buffer
+/**
+ * This is called by step(); it reads only poses, which are consistent at
+ * the end of a step, and writes only into the back snapshot of the buffer.
+ */
+void Simulator::publish_snapshot()
+{
+  if (!snapshot_buffer)
+    return;
+
+  fill_snapshot(snapshot_buffer->get_back());
+  snapshot_buffer->publish();
+}
+
+/// Fills a snapshot with the current time and the global pose of every visualizable object
+void Simulator::fill_snapshot(Snapshot& s)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  s.time = current_time;
+  s.contacts.clear();
+
+  // get the visualizable objects
+  get_visualizables(_snapshot_vis);
+
+  // store the poses
+  s.poses.resize(_snapshot_vis.size()*7);
+  for (unsigned i=0, j=0; i< _snapshot_vis.size(); i++)
+  {
+    Pose3d T0 = *_snapshot_vis[i]->get_visualization_pose();
+    T0.update_relative_pose(GLOBAL);
+    s.poses[j++] = T0.x[X];
+    s.poses[j++] = T0.x[Y];
+    s.poses[j++] = T0.x[Z];
+    s.poses[j++] = T0.q.w;
+    s.poses[j++] = T0.q.x;
+    s.poses[j++] = T0.q.y;
+    s.poses[j++] = T0.q.z;
+  }
+}
+
+/// Updates the visualization from a snapshot
+/**
+ * This is to be called by the visualization thread (with a snapshot
+ * acquired from snapshot_buffer) instead of update_visualization(); it
+ * does not read the state of any body, so the simulation may step 
+ * concurrently.
+ */
+void Simulator::apply_snapshot(const Snapshot& s)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // get the visualizable objects; quit if bodies were added or removed
+  // since the snapshot was taken
+  get_visualizables(_apply_vis);
+  if (s.poses.size() != _apply_vis.size()*7)
+    return;
+
+  // set the transforms
+  for (unsigned i=0, j=0; i< _apply_vis.size(); i++, j+= 7)
+  {
+    Origin3d x(s.poses[j+X], s.poses[j+Y], s.poses[j+Z]);
+    Quatd q;
+    q.w = s.poses[j+3];
+    q.x = s.poses[j+4];
+    q.y = s.poses[j+5];
+    q.z = s.poses[j+6];
+    _apply_vis[i]->set_visualization_transform(Pose3d(q, x));
+  }
+
+  #ifdef USE_OSG
+  // clear one-step visualization data
+  _transient_vdata->removeChildren(0, _transient_vdata->getNumChildren());
+  #endif
+}
+
 /// Adds transient visualization data to the simulator
 void Simulator::add_transient_vdata(osg::Node* vdata)
 {
@@ -326,6 +502,8 @@ void Simulator::load_from_xml(shared_ptr<const XMLTree> node, std::map<std::stri
   {
     // safe to clear the vector of bodies
     _bodies.clear();
+    _state_layout_valid = false;
+    update_body_lists();
 
     // process all DynamicBody child nodes
     for (std::list<shared_ptr<const XMLTree> >::const_iterator i = child_nodes.begin(); i != child_nodes.end(); i++)
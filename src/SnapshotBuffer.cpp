@@ -0,0 +1,94 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <algorithm>
+#include <Moby/SnapshotBuffer.h>
+
+using namespace Moby;
+
+SnapshotBuffer::SnapshotBuffer()
+{
+  _front = 0;
+  _middle = 1;
+  _back = 2;
+  _published = 0;
+  _fresh = false;
+  _closed = false;
+  for (unsigned i=0; i< 3; i++)
+  {
+    _snapshots[i].time = (double) 0.0;
+    _snapshots[i].sequence = 0;
+  }
+  pthread_mutex_init(&_mutex, NULL);
+  pthread_cond_init(&_published_cond, NULL);
+}
+
+SnapshotBuffer::~SnapshotBuffer()
+{
+  pthread_mutex_destroy(&_mutex);
+  pthread_cond_destroy(&_published_cond);
+}
+
+/// Publishes the back snapshot (simulation thread only)
+/**
+ * After publishing, get_back() refers to a different snapshot, whose
+ * contents are stale and must be overwritten entirely.
+ */
+void SnapshotBuffer::publish()
+{
+  pthread_mutex_lock(&_mutex);
+  _snapshots[_back].sequence = ++_published;
+  std::swap(_back, _middle);
+  _fresh = true;
+  pthread_cond_signal(&_published_cond);
+  pthread_mutex_unlock(&_mutex);
+}
+
+/// Makes the newest published snapshot the front snapshot (visualization thread only)
+/**
+ * \param wait if <b>true</b>, waits for a snapshot to be published (or for
+ *        the buffer to be closed) if none has been since the last call
+ * \return <b>true</b> if get_front() now refers to a snapshot not previously
+ *         acquired
+ */
+bool SnapshotBuffer::acquire(bool wait)
+{
+  pthread_mutex_lock(&_mutex);
+  while (wait && !_fresh && !_closed)
+    pthread_cond_wait(&_published_cond, &_mutex);
+  const bool FRESH = _fresh;
+  if (FRESH)
+  {
+    std::swap(_front, _middle);
+    _fresh = false;
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  return FRESH;
+}
+
+/// Closes the buffer, waking the visualization thread if it is waiting
+/**
+ * Either thread may close the buffer; the other thread learns of this via
+ * is_closed(). Snapshots may still be published and acquired.
+ */
+void SnapshotBuffer::close()
+{
+  pthread_mutex_lock(&_mutex);
+  _closed = true;
+  pthread_cond_signal(&_published_cond);
+  pthread_mutex_unlock(&_mutex);
+}
+
+/// Determines whether the buffer has been closed
+bool SnapshotBuffer::is_closed()
+{
+  pthread_mutex_lock(&_mutex);
+  const bool CLOSED = _closed;
+  pthread_mutex_unlock(&_mutex);
+  return CLOSED;
+}
+
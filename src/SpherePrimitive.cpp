@@ -16,6 +16,7 @@
 #include <Moby/BoundingSphere.h>
 #include <Moby/CollisionGeometry.h>
 #include <Moby/BoxPrimitive.h>
+#include <Moby/HeightfieldPrimitive.h>
 #include <Moby/SpherePrimitive.h>
 
 using namespace Ravelin;
@@ -343,6 +344,11 @@ double SpherePrimitive::calc_signed_dist(shared_ptr<const Primitive> p, shared_p
   if (spherep)
     return calc_signed_dist(spherep, pose_this, pose_p, pthis, pp);
 
+  // now try sphere/heightfield
+  shared_ptr<const HeightfieldPrimitive> hfp = dynamic_pointer_cast<const HeightfieldPrimitive>(p);
+  if (hfp)
+    return hfp->calc_signed_dist(dynamic_pointer_cast<const Primitive>(shared_from_this()), pose_p, pose_this, pp, pthis);
+
   assert(false);
   return 0.0;
 }
@@ -507,7 +513,7 @@ BVPtr SpherePrimitive::get_BVH_root(CollisionGeometryPtr geom)
 bool SpherePrimitive::intersect_seg(BVPtr bv, const LineSeg3& seg, double& t, Point3d& isect, Vector3d& normal) const
 {
   const unsigned X = 0, Y = 1, Z = 2;
-  static shared_ptr<Pose3d> P;
+  SAFESTATIC shared_ptr<Pose3d> P;
 
   // get the pose for the collision geometry
   shared_ptr<const Pose3d> gpose = bv->geom->get_pose(); 
@@ -605,7 +611,7 @@ bool SpherePrimitive::intersect_seg(BVPtr bv, const LineSeg3& seg, double& t, Po
 /*
 bool SpherePrimitive::point_inside(CollisionGeometryPtr geom, const Point3d& p, Vector3d& normal) const
 {
-  static shared_ptr<Pose3d> P;
+  SAFESTATIC shared_ptr<Pose3d> P;
 
   // get the pose for the collision geometry
   shared_ptr<const Pose3d> gpose = geom->get_pose(); 
@@ -11,8 +11,6 @@
 using namespace Ravelin;
 using namespace Moby;
 
-LinAlgd Tetrahedron::_LA;
-
 /// Calculates the signed distance from a point to the tetrahedron
 double Tetrahedron::calc_signed_dist(const Point3d& p, Point3d& closest) const
 {
@@ -154,7 +152,8 @@ void Tetrahedron::determine_barycentric_coords(const Point3d& px, double& u, dou
   M.set_column(Y, b - d);
   M.set_column(Z, c - d);
   Origin3d bary(p - d);
-  _LA.solve_fast(M, bary);
+  LinAlgd LA;
+  LA.solve_fast(M, bary);
 
   // compute barycentric coordinates
   u = bary[X];
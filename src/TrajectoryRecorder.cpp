@@ -0,0 +1,386 @@
+/****************************************************************************
+ * Copyright 2014 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+#include <Moby/Event.h>
+#include <Moby/Simulator.h>
+#include <Moby/EventDrivenSimulator.h>
+#include <Moby/DynamicBody.h>
+#include <Moby/TrajectoryRecorder.h>
+
+using namespace Ravelin;
+using namespace Moby;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using std::vector;
+using std::string;
+
+// the magic string that begins every file
+static const char MAGIC[8] = "MOBYTRJ";
+
+/// Compares two bodies by ID
+static bool compbody(DynamicBodyPtr b1, DynamicBodyPtr b2)
+{
+  return b1->id < b2->id;
+}
+
+/// Writes an unsigned integer to a file
+static void write_unsigned(FILE* fp, unsigned x)
+{
+  fwrite(&x, sizeof(unsigned), 1, fp);
+}
+
+/// Reads an unsigned integer from a file
+static bool read_unsigned(FILE* fp, unsigned& x)
+{
+  return fread(&x, sizeof(unsigned), 1, fp) == 1;
+}
+
+/// Creates a recorder that is not open
+TrajectoryRecorder::TrajectoryRecorder()
+{
+  _fp = NULL;
+  _capacity = _tail = _count = _block_size = 0;
+  _compress = _closing = false;
+}
+
+/// Closes the recorder, if it is open
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+  close();
+}
+
+/// Opens a file for recording the trajectory of a simulator
+/**
+ * \param fname the name of the file
+ * \param sim the simulator; its set of bodies must not change while recording
+ * \param capacity the number of records that the ring buffer holds; record()
+ *        blocks if the buffer is full
+ * \param compress if <b>true</b>, blocks are compressed (ignored if Moby 
+ *        was built without zlib)
+ */
+void TrajectoryRecorder::open(const string& fname, SimulatorPtr sim, unsigned capacity, bool compress)
+{
+  // close any open file
+  close();
+
+  // get the bodies in order of ID
+  _sim = sim;
+  _bodies = sim->get_dynamic_bodies();
+  std::sort(_bodies.begin(), _bodies.end(), compbody);
+
+  // setup the names of the columns
+  _names.clear();
+  _names.push_back("time");
+  _names.push_back("dynamics-time");
+  _names.push_back("coldet-time");
+  _names.push_back("event-time");
+  _names.push_back("contacts");
+  BOOST_FOREACH(DynamicBodyPtr db, _bodies)
+  {
+    const unsigned NGC = db->num_generalized_coordinates(DynamicBody::eEuler);
+    for (unsigned j=0; j< NGC; j++)
+    {
+      std::ostringstream oss;
+      oss << db->id << ".q" << j;
+      _names.push_back(oss.str());
+    }
+    const unsigned NGV = db->num_generalized_coordinates(DynamicBody::eSpatial);
+    for (unsigned j=0; j< NGV; j++)
+    {
+      std::ostringstream oss;
+      oss << db->id << ".qd" << j;
+      _names.push_back(oss.str());
+    }
+  }
+
+  // setup the ring buffer
+  _capacity = std::max(capacity, (unsigned) 2);
+  _ring.resize(_capacity * _names.size());
+  _tail = _count = 0;
+  _block_size = std::max(_capacity/4, (unsigned) 1);
+  _closing = false;
+
+  // determine whether to compress
+  #ifdef USE_ZLIB
+  _compress = compress;
+  #else
+  if (compress)
+    std::cerr << "TrajectoryRecorder::open() warning- built without zlib; not compressing" << std::endl;
+  _compress = false;
+  #endif
+
+  // open the file
+  _fp = fopen(fname.c_str(), "wb");
+  if (!_fp)
+    throw std::runtime_error("TrajectoryRecorder::open() - unable to open " + fname);
+
+  // write the header
+  fwrite(MAGIC, 1, sizeof(MAGIC), _fp);
+  write_unsigned(_fp, VERSION);
+  write_unsigned(_fp, _names.size());
+  write_unsigned(_fp, (_compress) ? COMPRESSED : 0);
+  for (unsigned i=0; i< _names.size(); i++)
+  {
+    write_unsigned(_fp, _names[i].size());
+    fwrite(_names[i].data(), 1, _names[i].size(), _fp);
+  }
+
+  // start the background thread
+  pthread_mutex_init(&_mutex, NULL);
+  pthread_cond_init(&_not_full, NULL);
+  pthread_cond_init(&_not_empty, NULL);
+  pthread_create(&_thread, NULL, &flush_thread, this);
+}
+
+/// Records the current state of the simulator
+void TrajectoryRecorder::record()
+{
+  assert(_fp);
+
+  // wait for a free record; NOTE: the background thread only changes 
+  // _tail and _count together, so the free record does not move
+  pthread_mutex_lock(&_mutex);
+  while (_count == _capacity)
+    pthread_cond_wait(&_not_full, &_mutex);
+  const unsigned IDX = (_tail + _count) % _capacity;
+  pthread_mutex_unlock(&_mutex);
+
+  // get the timings and the number of contacts
+  double* r = &_ring[IDX*_names.size()];
+  unsigned col = 0;
+  r[col++] = _sim->current_time;
+  r[col++] = _sim->dynamics_time;
+  shared_ptr<EventDrivenSimulator> eds = dynamic_pointer_cast<EventDrivenSimulator>(_sim);
+  if (eds)
+  {
+    unsigned ncontacts = 0;
+    const vector<Event>& events = eds->get_events();
+    for (unsigned i=0; i< events.size(); i++)
+      if (events[i].event_type == Event::eContact)
+        ncontacts++;
+    r[col++] = eds->coldet_time;
+    r[col++] = eds->event_time;
+    r[col++] = (double) ncontacts;
+  }
+  else
+  {
+    r[col++] = 0.0;
+    r[col++] = 0.0;
+    r[col++] = 0.0;
+  }
+
+  // get the generalized coordinates and velocities
+  BOOST_FOREACH(DynamicBodyPtr db, _bodies)
+  {
+    db->get_generalized_coordinates(DynamicBody::eEuler, _work);
+    for (unsigned j=0; j< _work.size(); j++)
+      r[col++] = _work[j];
+    db->get_generalized_velocity(DynamicBody::eSpatial, _work);
+    for (unsigned j=0; j< _work.size(); j++)
+      r[col++] = _work[j];
+  }
+  assert(col == _names.size());
+
+  // make the record available to the background thread
+  pthread_mutex_lock(&_mutex);
+  _count++;
+  if (_count >= _block_size)
+    pthread_cond_signal(&_not_empty);
+  pthread_mutex_unlock(&_mutex);
+}
+
+/// Writes all remaining records and closes the file
+void TrajectoryRecorder::close()
+{
+  if (!_fp)
+    return;
+
+  // stop the background thread (it writes any remaining records first) 
+  pthread_mutex_lock(&_mutex);
+  _closing = true;
+  pthread_cond_signal(&_not_empty);
+  pthread_mutex_unlock(&_mutex);
+  pthread_join(_thread, NULL);
+  pthread_mutex_destroy(&_mutex);
+  pthread_cond_destroy(&_not_full);
+  pthread_cond_destroy(&_not_empty);
+
+  // close the file
+  bool failed = ferror(_fp);
+  if (fclose(_fp) != 0)
+    failed = true;
+  _fp = NULL;
+  _sim.reset();
+  _bodies.clear();
+  if (failed)
+    std::cerr << "TrajectoryRecorder::close() - error writing trajectory" << std::endl;
+}
+
+/// Writes blocks of records from the ring buffer until the recorder is closed
+void* TrajectoryRecorder::flush_thread(void* arg)
+{
+  TrajectoryRecorder* tr = (TrajectoryRecorder*) arg;
+
+  while (true)
+  {
+    // wait for a block (or for closing)
+    pthread_mutex_lock(&tr->_mutex);
+    while (tr->_count < tr->_block_size && !tr->_closing)
+      pthread_cond_wait(&tr->_not_empty, &tr->_mutex);
+    const unsigned START = tr->_tail;
+    const unsigned N = tr->_count;
+    const bool CLOSING = tr->_closing;
+    pthread_mutex_unlock(&tr->_mutex);
+
+    // write the records 
+    if (N > 0)
+      tr->write_block(START, N);
+
+    // release the records
+    pthread_mutex_lock(&tr->_mutex);
+    tr->_tail = (tr->_tail + N) % tr->_capacity;
+    tr->_count -= N;
+    pthread_cond_signal(&tr->_not_full);
+    pthread_mutex_unlock(&tr->_mutex);
+
+    // quit if closing and all records have been written
+    if (CLOSING && N == 0)
+      break;
+  }
+
+  return NULL;
+}
+
+/// Writes records from the ring buffer to the file as one block
+void TrajectoryRecorder::write_block(unsigned start, unsigned n)
+{
+  const unsigned NCOLS = _names.size();
+
+  // transpose the records into columns
+  _block.resize(n*NCOLS);
+  for (unsigned i=0; i< n; i++)
+  {
+    const double* r = &_ring[((start + i) % _capacity)*NCOLS];
+    for (unsigned j=0; j< NCOLS; j++)
+      _block[j*n+i] = r[j];
+  }
+
+  // setup the data to write
+  const unsigned RAW_BYTES = _block.size()*sizeof(double);
+  const unsigned char* data = (const unsigned char*) &_block[0];
+  unsigned stored_bytes = RAW_BYTES;
+  #ifdef USE_ZLIB
+  if (_compress)
+  {
+    // NOTE: blocks that fail to compress are stored as-is (stored and
+    // uncompressed sizes are then equal)
+    uLongf zlen = compressBound(RAW_BYTES);
+    _zblock.resize(zlen);
+    if (compress2(&_zblock[0], &zlen, data, RAW_BYTES, Z_BEST_SPEED) == Z_OK && zlen < RAW_BYTES)
+    {
+      data = &_zblock[0];
+      stored_bytes = (unsigned) zlen;
+    }
+  }
+  #endif
+
+  // write the block
+  write_unsigned(_fp, n);
+  write_unsigned(_fp, RAW_BYTES);
+  write_unsigned(_fp, stored_bytes);
+  fwrite(data, 1, stored_bytes, _fp);
+}
+
+/// Reads a trajectory file
+/**
+ * \param fname the name of the file
+ * \param names the names of the columns on return
+ * \param columns the columns on return (one value per record)
+ */
+void TrajectoryRecorder::read(const string& fname, vector<string>& names, vector<vector<double> >& columns)
+{
+  // open the file
+  FILE* fp = fopen(fname.c_str(), "rb");
+  if (!fp)
+    throw std::runtime_error("TrajectoryRecorder::read() - unable to open " + fname);
+
+  try
+  {
+    // read the header
+    char magic[sizeof(MAGIC)];
+    unsigned version, ncols, flags;
+    if (fread(magic, 1, sizeof(MAGIC), fp) != sizeof(MAGIC) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+      throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " is not a trajectory file");
+    if (!read_unsigned(fp, version) || version != VERSION)
+      throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " has an unsupported version");
+    if (!read_unsigned(fp, ncols) || !read_unsigned(fp, flags))
+      throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " is truncated");
+    #ifndef USE_ZLIB
+    if (flags & COMPRESSED)
+      throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " is compressed and Moby was built without zlib");
+    #endif
+
+    // read the names
+    names.resize(ncols);
+    for (unsigned i=0; i< ncols; i++)
+    {
+      unsigned len;
+      if (!read_unsigned(fp, len))
+        throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " is truncated");
+      names[i].resize(len);
+      if (len > 0 && fread(&names[i][0], 1, len, fp) != len)
+        throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " is truncated");
+    }
+
+    // read the blocks
+    columns.clear();
+    columns.resize(ncols);
+    vector<double> block;
+    vector<unsigned char> stored;
+    unsigned n, raw_bytes, stored_bytes;
+    while (read_unsigned(fp, n))
+    {
+      // read the block data
+      if (!read_unsigned(fp, raw_bytes) || !read_unsigned(fp, stored_bytes) || raw_bytes != n*ncols*sizeof(double))
+        throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " is corrupt");
+      block.resize(n*ncols);
+      if ((flags & COMPRESSED) && stored_bytes != raw_bytes)
+      {
+        #ifdef USE_ZLIB
+        stored.resize(stored_bytes);
+        if (fread(&stored[0], 1, stored_bytes, fp) != stored_bytes)
+          throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " is truncated");
+        uLongf len = raw_bytes;
+        if (uncompress((Bytef*) &block[0], &len, &stored[0], stored_bytes) != Z_OK || len != raw_bytes)
+          throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " is corrupt");
+        #endif
+      }
+      else if (n > 0 && fread(&block[0], 1, raw_bytes, fp) != raw_bytes)
+        throw std::runtime_error("TrajectoryRecorder::read() - " + fname + " is truncated");
+
+      // append the block to the columns
+      for (unsigned j=0; j< ncols; j++)
+        columns[j].insert(columns[j].end(), block.begin()+j*n, block.begin()+(j+1)*n);
+    }
+  }
+  catch (...)
+  {
+    fclose(fp);
+    throw;
+  }
+
+  fclose(fp);
+}
+
@@ -12,6 +12,7 @@
 #include <osg/Geometry>
 #endif
 #include <stack>
+#include <limits>
 #include <cctype>
 #include <string>
 #include <queue>
@@ -23,6 +24,8 @@
 #include <Moby/OBB.h>
 #include <Moby/BoundingSphere.h>
 #include <Moby/CollisionGeometry.h>
+#include <Moby/CompGeom.h>
+#include <Moby/FastThreadable.h>
 #include <Moby/TriangleMeshPrimitive.h>
 
 using namespace Ravelin;
@@ -39,6 +42,10 @@ using std::pair;
 using std::make_pair;
 using std::stack;
 using boost::dynamic_pointer_cast;
+using boost::const_pointer_cast;
+
+// the empty flat BVH
+const FlatBVH TriangleMeshPrimitive::_empty_bvh;
 
 /// Creates the triangle mesh primitive
 TriangleMeshPrimitive::TriangleMeshPrimitive()
@@ -56,16 +63,12 @@ TriangleMeshPrimitive::TriangleMeshPrimitive(const string& filename, bool center
   // do not sample edges by default
   _edge_sample_length = std::numeric_limits<double>::max();
 
-  // construct a new triangle mesh from the filename
-  if (filename.find(".obj") == filename.size() - 4)
-    set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(filename))));
+  // get the (shared) triangle mesh for the filename, centering it if desired
+  if (filename.find(".obj") == filename.size() - 4 || filename.find(".mbm") == filename.size() - 4)
+    set_asset(MeshAssetCache::load(filename, center));
   else
     throw std::runtime_error("TriangleMeshPrimitive (constructor): unknown mesh file type!");
 
-  // center the mesh
-  if (center)
-    this->center();
-
   // update the visualization, if necessary
   update_visualization();
 }
@@ -79,16 +82,12 @@ TriangleMeshPrimitive::TriangleMeshPrimitive(const string& filename, const Pose3
   // do not sample edges by default
   _edge_sample_length = std::numeric_limits<double>::max();
 
-  // construct a new triangle mesh from the filename
-  if (filename.find("obj") == filename.size() - 4)
-    set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(filename))));
+  // get the (shared) triangle mesh for the filename, centering it if desired
+  if (filename.find("obj") == filename.size() - 4 || filename.find(".mbm") == filename.size() - 4)
+    set_asset(MeshAssetCache::load(filename, center));
   else
     throw std::runtime_error("TriangleMeshPrimitive (constructor): unknown mesh file type!");
 
-  // center the mesh
-  if (center)
-    this->center();
-
   // update the visualization, if necessary
   update_visualization();
 }
@@ -100,8 +99,9 @@ void TriangleMeshPrimitive::set_deformable(bool flag)
 
   // vertices, mesh, and BVHs are no longer valid 
   _mesh = shared_ptr<IndexedTriArray>();
+  _flat_bvh.reset();
+  _asset.reset();
   _vertices.clear();
-  _mesh_vertices.clear();
   _roots.clear();
   _invalidated = true;
 }
@@ -113,7 +113,6 @@ void TriangleMeshPrimitive::set_edge_sample_length(double len)
 
   // vertices are no longer valid
   _vertices.clear();
-  _mesh_vertices.clear();
   _invalidated = true;
 }
 
@@ -185,6 +184,8 @@ void TriangleMeshPrimitive::center()
 
   // do the transformation
   _mesh = shared_ptr<IndexedTriArray>(new IndexedTriArray(_mesh->transform(T)));
+  _flat_bvh = shared_ptr<FlatBVH>(new FlatBVH(*_mesh));
+  _asset.reset();
 
   // re-calculate mass properties 
   calc_mass_properties();
@@ -230,6 +231,7 @@ void TriangleMeshPrimitive::load_from_xml(shared_ptr<const XMLTree> node, map<st
 
   // setup the file extensions
   const char* OBJ_EXT = ".obj";
+  const char* MBM_EXT = ".mbm";
 
   // get the filename
   string fname(fname_attr->get_string_value());
@@ -238,19 +240,21 @@ void TriangleMeshPrimitive::load_from_xml(shared_ptr<const XMLTree> node, map<st
   string fname_lower = fname;
   std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), (int(*)(int)) std::tolower);
 
-  // get the type of file and construct the triangle mesh appropriately
-  if (fname_lower.find(string(OBJ_EXT)) == fname_lower.size() - strlen(OBJ_EXT))
-    set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(fname))));
+  // see whether to center the mesh
+  XMLAttrib* center_attr = node->get_attrib("center");
+  const bool CENTER = (center_attr && center_attr->get_bool_value());
+
+  // get the type of file and get the (shared) triangle mesh appropriately;
+  // centering is done by the cache so that centered meshes are shared too
+  if (fname_lower.find(string(OBJ_EXT)) == fname_lower.size() - strlen(OBJ_EXT) ||
+      fname_lower.find(string(MBM_EXT)) == fname_lower.size() - strlen(MBM_EXT))
+    set_asset(MeshAssetCache::load(fname, CENTER, _convexify_inertia));
   else
   {
     cerr << "TriangleMeshPrimitive::load_from_xml() - unrecognized filename extension" << endl;
     cerr << "  for attribute 'filename'.  Valid extensions are '.obj' (Wavefront OBJ)" << endl;
+    cerr << "  and '.mbm' (Moby binary mesh)" << endl;
   }
-  
-  // see whether to center the mesh
-  XMLAttrib* center_attr = node->get_attrib("center");
-  if (center_attr && center_attr->get_bool_value())
-    this->center();
 
   // recompute mass properties
   calc_mass_properties();
@@ -286,8 +290,9 @@ void TriangleMeshPrimitive::save_to_xml(XMLTreePtr node, list<shared_ptr<const B
   // do not save the array to the OBJ file if it already exists (which we
   // crudely check for using std::ifstream to avoid OS-specific calls -- note
   // that it is possible that opening a file may fails for other reasons than
-  // the file does not exist)
-  std::ifstream in(filename.c_str());
+  // the file does not exist); the file is placed relative to the document
+  std::string path = node->get_path(filename);
+  std::ifstream in(path.c_str());
   if (in.fail())
   {
     // make sure there is a mesh to write
@@ -300,7 +305,7 @@ void TriangleMeshPrimitive::save_to_xml(XMLTreePtr node, list<shared_ptr<const B
     IndexedTriArray mesh_xform = _mesh->transform(T);
 
     // write the mesh
-    mesh_xform.write_to_obj(filename);
+    mesh_xform.write_to_obj(path);
   }
   else
     in.close();
@@ -309,13 +314,42 @@ void TriangleMeshPrimitive::save_to_xml(XMLTreePtr node, list<shared_ptr<const B
 /// Sets the mesh
 void TriangleMeshPrimitive::set_mesh(boost::shared_ptr<const IndexedTriArray> mesh)
 {
-  // set the mesh
+  // set the mesh and rebuild the flat BVH
   _mesh = mesh;
+  _asset.reset();
+  if (_mesh)
+    _flat_bvh = shared_ptr<FlatBVH>(new FlatBVH(*_mesh));
+  else
+    _flat_bvh.reset();
 
   // vertices and bounding volumes are no longer valid
   _vertices.clear();
-  _mesh_vertices.clear();
-  _roots.clear();;
+  _roots.clear();
+  _invalidated = true;
+
+  // recalculate the mass properties
+  if (!is_deformable())
+    calc_mass_properties();
+
+  // update visualization
+  update_visualization();
+}
+
+/// Sets the mesh using a cached asset
+/**
+ * The mesh and its flat BVH are shared with every other primitive that uses
+ * the asset; only the density-dependent mass properties are computed here.
+ */
+void TriangleMeshPrimitive::set_asset(shared_ptr<const MeshAssetCache::Asset> asset)
+{
+  // set the mesh and the flat BVH
+  _mesh = asset->mesh;
+  _flat_bvh = asset->bvh;
+  _asset = asset;
+
+  // vertices and bounding volumes are no longer valid
+  _vertices.clear();
+  _roots.clear();
   _invalidated = true;
 
   // recalculate the mass properties
@@ -344,27 +378,36 @@ void TriangleMeshPrimitive::calc_mass_properties()
     return;
   }
 
-  // determine which mesh to use
-  PolyhedronPtr poly;
-  const IndexedTriArray* mesh = NULL;
-  if (_convexify_inertia)
+  // use the centroid and volume integrals of the cached asset, if possible
+  if (_asset && _asset->mesh == _mesh && _asset->convexify_inertia == _convexify_inertia)
   {
-    const vector<Origin3d>& verts = _mesh->get_vertices();
-    poly = CompGeom::calc_convex_hull(verts.begin(), verts.end());
-    mesh = &poly->get_mesh();
+    _jF->x = _asset->centroid;
+    std::copy(_asset->volume_ints, _asset->volume_ints+10, volume_ints);
   }
   else
-    mesh = _mesh.get();
+  {
+    // determine which mesh to use
+    PolyhedronPtr poly;
+    const IndexedTriArray* mesh = NULL;
+    if (_convexify_inertia)
+    {
+      const vector<Origin3d>& verts = _mesh->get_vertices();
+      poly = CompGeom::calc_convex_hull(verts.begin(), verts.end());
+      mesh = &poly->get_mesh();
+    }
+    else
+      mesh = _mesh.get();
 
-  // get triangles
-  std::list<Triangle> tris;
-  mesh->get_tris(std::back_inserter(tris), get_pose());
+    // get triangles
+    std::list<Triangle> tris;
+    mesh->get_tris(std::back_inserter(tris), get_pose());
 
-  // compute the centroid of the triangle mesh
-  _jF->x = CompGeom::calc_centroid_3D(tris.begin(), tris.end());
+    // compute the centroid of the triangle mesh
+    _jF->x = CompGeom::calc_centroid_3D(tris.begin(), tris.end());
 
-  // calculate volume integrals
-  mesh->calc_volume_ints(volume_ints);
+    // calculate volume integrals
+    mesh->calc_volume_ints(volume_ints);
+  }
 
   // we'll need the volume
   const double volume = volume_ints[0];
@@ -405,338 +448,187 @@ void TriangleMeshPrimitive::calc_mass_properties()
       }
 }
 
-/// Gets the pointer to the root bounding box
+/// Gets the bounding volume around the mesh
+/**
+ * Distance and intersection queries on meshes use the flat BVH, so this is a
+ * single bounding volume (an OBB, or a bounding sphere for deformable
+ * meshes) around the whole mesh, used where a primitive's bounds are needed
+ * (e.g., for CSG operands).
+ */
 BVPtr TriangleMeshPrimitive::get_BVH_root(CollisionGeometryPtr geom)
 {
-  // build the bounding box if necessary
+  // build the bounding volume if necessary
   BVPtr& root = _roots[geom]; 
-  if (!root)
-    build_BB_tree(geom);
-
-  return root; 
-}
+  if (root || !_mesh)
+    return root;
 
-/// Determines whether the point on a thick triangle is degenerate
-bool TriangleMeshPrimitive::is_degen_point_on_tri(shared_ptr<AThickTri> tri, const Point3d& p)
-{
-  // get the barycentric coordinates for the point
-  double s, t;
-  tri->tri.determine_barycentric_coords(p, s, t);
+  // get the vertices from the mesh
+  const vector<Origin3d>& verts = _mesh->get_vertices();
 
-  // correct s and t, if necessary
-  if (s < (double) 0.0)
-  {
-    if (s < -NEAR_ZERO)
-      FILE_LOG(LOG_COLDET) << "Primitive::is_degen_point_on_tri() warning- s=" << s << endl;
-    s = (double) 0.0;
-  }
-  if (t < (double) 0.0)
-  {
-    if (t < -NEAR_ZERO)
-      FILE_LOG(LOG_COLDET) << "Primitive::is_degen_point_on_tri() warning- t=" << t << endl;
-    t = (double) 0.0;
-  }
-  if (s + t > (double) 1.0)
-  {
-    if (s + t > (double) 1.0 + NEAR_ZERO)
-      FILE_LOG(LOG_COLDET) << "Primitive::is_degen_point_on_tri() warning- s+t=" << (s+t) << endl;
-    double isum = (double) 1.0/(s + t);
-    s *= isum;
-    t *= isum;
-  }
+  // get the geometry pose
+  shared_ptr<const Pose3d> gpose = geom->get_pose();
 
-  // get the feature of the determined point
-  Triangle::FeatureType feat = tri->tri.determine_feature(s, t);
+  // get pose of this primitive
+  shared_ptr<const Pose3d> P = get_pose();
 
-  // if the feature is a face, we can exit now
-  if (feat == Triangle::eFace)
-    return false;
+  // setup transform
+  Transform3d T;
+  T.source = gpose;
+  T.target = gpose;
+  T.x = P->x;
+  T.q = P->q;
 
-  // for the other features, we'll need the indexed triangle from the original 
-  // triangle mesh 
-  const IndexedTriArray& mesh = *tri->mesh;
-  const IndexedTri& f = mesh.get_facets()[tri->tri_idx];
+  // transform the vertices into Point3d objects
+  vector<Point3d> vertices(verts.size());
+  for (unsigned i=0; i< verts.size(); i++)
+    vertices[i] = T.transform_point(Point3d(verts[i], gpose));
 
-  // now process the feature type
-  switch (feat)
-  {
-    // see whether vertex A is coincident to all coplanar facets
-    case Triangle::eVertexA:
-      return !mesh.is_coplanar(f.a);
-
-    // see whether vertex B is coincident to all coplanar facets
-    case Triangle::eVertexB:
-      return !mesh.is_coplanar(f.b);
-    
-    // see whether vertex C is coincident to all coplanar facets
-    case Triangle::eVertexC:
-      return !mesh.is_coplanar(f.c);
-
-    // see whether edge AB is coincident to all coplanar facets
-    case Triangle::eEdgeAB:
-      return !mesh.is_coplanar(f.a, f.b);
-      
-    // see whether edge BC is coincident to all coplanar facets
-    case Triangle::eEdgeBC:
-      return !mesh.is_coplanar(f.b, f.c);
-     
-    // see whether edge AC is coincident to all coplanar facets
-    case Triangle::eEdgeAC:
-      return !mesh.is_coplanar(f.a, f.c);
- 
-    // this should already be handled
-    case Triangle::eFace:
-      assert(false);
-      return true;
-
-    // this should not happen
-    case Triangle::eNone:
-      assert(false);
-      return true;
-  }
+  // build a BV around all vertices 
+  if (!is_deformable())
+    root = BVPtr(new OBB(vertices.begin(), vertices.end()));
+  else
+    root = BVPtr(new BoundingSphere(vertices.begin(), vertices.end()));
+  root->geom = geom;
 
-  // should never get here...
-  assert(false);
-  return true;
+  return root; 
 }
 
 /// Gets mesh data for the geometry with the specified bounding volume
 const std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> >& TriangleMeshPrimitive::get_sub_mesh(BVPtr bv)
 {
-  assert(_mesh_tris.find(bv) != _mesh_tris.end());
-  _smesh = make_pair(_mesh, _mesh_tris.find(bv)->second);
+  // the bounding volume covers the entire mesh
+  if (_smesh.first != _mesh)
+  {
+    _smesh.first = _mesh;
+    _smesh.second.clear();
+    if (_mesh)
+      for (unsigned i=0; i< _mesh->get_facets().size(); i++)
+        _smesh.second.push_back(i);
+  }
+
   return _smesh;
 }
 
 /// Computes the signed distance to a point from the mesh 
 double TriangleMeshPrimitive::calc_signed_dist(const Point3d& p)
 {
-  // TODO: implement this
-  assert(false);
-  return 0.0;
+  Vector3d normal;
+  return calc_dist_and_normal(p, normal);
 }
 
 /// Computes the distance and normal from a point on the mesh 
+/**
+ * The closest triangle is found using the flat BVH; the distance is negative
+ * if the point lies behind that triangle (i.e., inside a closed mesh).
+ */
 double TriangleMeshPrimitive::calc_dist_and_normal(const Point3d& p, Vector3d& normal) const
 {
-  // TODO: implement this
-  assert(false);
-  return 0.0;
-}
+  // verify that the point is in this primitive's space
+  assert(p.pose == get_pose());
 
-/// Computes the distance and normal from a point on the mesh 
-double TriangleMeshPrimitive::calc_signed_dist(shared_ptr<const Primitive> primitive, shared_ptr<const Pose3d> pose_this, shared_ptr<const Pose3d> pose_p, Point3d& pthis, Point3d& pprimitive) const
-{
-  // TODO: implement this
-  assert(false);
-  return 0.0;
+  // compute the signed distance using the flat BVH
+  if (!_mesh || !_flat_bvh)
+  {
+    normal.set_zero(p.pose);
+    return std::numeric_limits<double>::max();
+  }
+
+  return _flat_bvh->calc_signed_dist(*_mesh, p, normal);
 }
 
-/// Determines whether a point is inside / on one of the thick triangles
-/*
-bool TriangleMeshPrimitive::point_inside(BVPtr bv, const Point3d& p, Vector3d& normal) const
+/// Computes the signed distance between the mesh and another primitive
+/**
+ * The vertices of each primitive are tested against the other. Against
+ * another mesh, the flat BVHs are also traversed together to find crossing
+ * triangles, so that meshes whose triangles intersect without any vertex
+ * lying inside the other mesh are not reported as separated.
+ */
+double TriangleMeshPrimitive::calc_signed_dist(shared_ptr<const Primitive> primitive, shared_ptr<const Pose3d> pose_this, shared_ptr<const Pose3d> pose_p, Point3d& pthis, Point3d& pprimitive) const
 {
-  const double EXPANSION_CONST = 0.01;
-
-  // expand the BV 
-  BVPtr ebv;
-  if (!is_deformable())
+  SAFESTATIC FastThreadable<vector<pair<unsigned, unsigned> > > tri_pairs;
+  vector<Point3d> verts;
+  Vector3d normal;
+
+  // look for no mesh
+  double min_dist = std::numeric_limits<double>::max();
+  if (!_mesh || !_flat_bvh)
+    return min_dist;
+
+  // get the transforms between the other primitive and this
+  Transform3d T = Pose3d::calc_relative_pose(pose_p, pose_this);
+  Transform3d Tinv = Pose3d::calc_relative_pose(pose_this, pose_p);
+
+  // get the vertices of the other primitive
+  shared_ptr<const TriangleMeshPrimitive> meshp = dynamic_pointer_cast<const TriangleMeshPrimitive>(primitive);
+  if (meshp)
   {
-    assert(dynamic_pointer_cast<OBB>(bv));
-    OBB eobb = *dynamic_pointer_cast<OBB>(bv);
-    eobb.l *= ((double) 1.0 + EXPANSION_CONST);
-    ebv = BVPtr(new OBB(eobb));
+    if (meshp->_mesh)
+    {
+      const vector<Origin3d>& mverts = meshp->_mesh->get_vertices();
+      for (unsigned i=0; i< mverts.size(); i++)
+        verts.push_back(Point3d(mverts[i], pose_p));
+    }
   }
   else
   {
-    assert(dynamic_pointer_cast<BoundingSphere>(bv));
-    BoundingSphere bs = *dynamic_pointer_cast<BoundingSphere>(bv);
-    bs.radius *= ((double) 1.0 + EXPANSION_CONST);
-    ebv = BVPtr(new BoundingSphere(bs));
+    const_pointer_cast<Primitive>(primitive)->get_vertices(verts);
+    for (unsigned i=0; i< verts.size(); i++)
+      verts[i].pose = pose_p;
   }
 
-  // handle the two cases: leaf and internal node
-  if (bv->is_leaf())
+  // test the vertices of the other primitive against this mesh
+  for (unsigned i=0; i< verts.size(); i++)
   {
-    // get the triangles of the BV
-    assert(_tris.find(bv) != _tris.end());
-    const list<shared_ptr<AThickTri> >& tris = _tris.find(bv)->second;
-    
-    // see whether the point is inside/on one of the thick triangles
-    BOOST_FOREACH(shared_ptr<AThickTri> tri, tris)
-      if (tri->point_inside(p) && !is_degen_point_on_tri(tri, p))
-      {
-        normal = tri->determine_normal(p);
-        return true;
-      }
-
-    // still here?  not inside/on any of the triangles
-    return false;
+    Point3d v = T.transform_point(verts[i]);
+    v.pose = get_pose();
+    const double D = _flat_bvh->calc_signed_dist(*_mesh, v, normal);
+    if (D < min_dist)
+    {
+      min_dist = D;
+      normal.pose = v.pose = pose_this;
+      pthis = v - normal*D;
+      pprimitive = verts[i];
+    }
   }
-  else
-  {
-    BOOST_FOREACH(BVPtr child, bv->children)
-      if (!ebv->outside(p) && point_inside(child, p, normal))
-        return true;
-  }  
-
-  // still here?  not inside/on...
-  return false;
-}
-*/
-
-/// Intersects a line segment against the triangle mesh and returns first point of intersection
-/*
-bool TriangleMeshPrimitive::intersect_seg(BVPtr bv, const LineSeg3& seg, double& t, Point3d& isect, Vector3d& normal) const
-{
-  const unsigned LEAF_TRIS_CUTOFF = 5;
-  const double EXPANSION_CONST = 0.01;
-
-  // setup statistics variables
-  unsigned n_bv_tests = 0;
-  unsigned n_tri_tests = 0;
 
-  // setup first point of intersection
-  double tfirst = std::numeric_limits<double>::max();
-
-  // create a stack and add the BV to it
-  stack<BVPtr> S;
-  S.push(bv);
-
-  // process until stack is empty
-  while (!S.empty())
+  // test the vertices of this mesh against the other primitive
+  const vector<Origin3d>& tverts = _mesh->get_vertices();
+  for (unsigned i=0; i< tverts.size(); i++)
   {
-    // get the BV from the top of the stack
-    bv = S.top();
-    S.pop();
-
-    // if the BV is a leaf, add all thick triangles to output if there are
-    // not many thick triangles; otherwise, see whether the line segment
-    // intersects the OBB
-    if (bv->is_leaf())
+    Point3d w = Tinv.transform_point(Point3d(tverts[i], pose_this));
+    w.pose = primitive->get_pose();
+    const double D = primitive->calc_dist_and_normal(w, normal);
+    if (D < min_dist)
     {
-      // get the list of thick triangles 
-      assert(_tris.find(bv) != _tris.end());
-      const list<shared_ptr<AThickTri> >& tris = _tris.find(bv)->second;
-    
-      // expand the BV 
-      BVPtr ebv;
-      if (!is_deformable())
-      {
-        assert(dynamic_pointer_cast<OBB>(bv));
-        OBB eobb = *dynamic_pointer_cast<OBB>(bv);
-        eobb.l *= ((double) 1.0 + EXPANSION_CONST);
-        ebv = BVPtr(new OBB(eobb));
-      }
-      else
-      {
-        assert(dynamic_pointer_cast<BoundingSphere>(bv));
-        BoundingSphere bs = *dynamic_pointer_cast<BoundingSphere>(bv);
-        bs.radius *= ((double) 1.0 + EXPANSION_CONST);
-        ebv = BVPtr(new BoundingSphere(bs));
-      }
-
-      // if the list is sufficiently small or there is an intersection with
-      // the BV, check all triangles
-      double tmin = 0, tmax = 1;
-      Point3d pt;
-      if (tris.size() <= LEAF_TRIS_CUTOFF || (++n_bv_tests && ebv->intersects(seg, tmin, tmax, pt)))
-      {
-        BOOST_FOREACH(shared_ptr<AThickTri> tri, tris)
-        {
-          n_tri_tests++;
-          FILE_LOG(LOG_COLDET) << "   -- intersecting thick tri: " << endl << tri->tri <<"  and segment " << seg.first << " / " << seg.second << endl;
-          double tx;
-          if (tri->intersect_seg(seg, tx, pt) && tx < tfirst)
-          {
-            // project the point onto the actual triangle
-            Vector3d tri_normal = tri->tri.calc_normal();
-            double tri_offset = tri->tri.calc_offset(tri_normal);
-
-            // compute P = I - n*n'
-            Matrix3d P;
-            Opsd::outer_prod(tri_normal, -tri_normal, P);
-            P += Matrix3d::identity();
-            Point3d proj_point(P * Origin3d(pt), tri_normal.pose);
-            double remainder = tri_offset - proj_point.dot(tri_normal);
-            proj_point += tri_normal * remainder;
-
-            // ensure that projected point does not occur on vertex / edge
-            if (!is_degen_point_on_tri(tri, proj_point))
-            {
-              tfirst = tx;
-              isect = pt;
-              normal = tri->determine_normal(isect);
-              FILE_LOG(LOG_COLDET) << "  intersection detected!  time of impact: " << t << endl;
-            }
-            else
-            {
-              FILE_LOG(LOG_COLDET) << "  intersection detected, but point of intersection on vertex/edge" << endl;
-              FILE_LOG(LOG_COLDET) << "    intersection point: " << isect << endl;
-            }
-          }
-        }
-      }
+      min_dist = D;
+      normal.pose = w.pose = pose_p;
+      pthis = Point3d(tverts[i], pose_this);
+      pprimitive = w - normal*D;
     }
-    else
-    {
-      // copy the BV to an expanded one
-      BVPtr ebv;
-      if (!is_deformable())
-      {
-        assert(dynamic_pointer_cast<OBB>(bv));
-        OBB eobb = *dynamic_pointer_cast<OBB>(bv);
-        eobb.l *= ((double) 1.0 + EXPANSION_CONST);
-        ebv = BVPtr(new OBB(eobb));
-      }
-      else
-      {
-        assert(dynamic_pointer_cast<BoundingSphere>(bv));
-        BoundingSphere bs = *dynamic_pointer_cast<BoundingSphere>(bv);
-        bs.radius *= ((double) 1.0 + EXPANSION_CONST);
-        ebv = BVPtr(new BoundingSphere(bs));
-      }
+  }
 
-      double tmin = 0, tmax = 1;
-      Point3d pt;
-      n_bv_tests++;
-      if (ebv->intersects(seg, tmin, tmax, pt))
+  // meshes: look for crossing triangles if no vertex lies inside
+  if (meshp && meshp->_mesh && meshp->_flat_bvh && min_dist > (double) 0.0)
+  {
+    vector<pair<unsigned, unsigned> >& pairs = tri_pairs();
+    FlatBVH::intersect(*_flat_bvh, *meshp->_flat_bvh, T, pairs);
+    for (unsigned i=0; i< pairs.size(); i++)
+    {
+      Triangle ta = _mesh->get_triangle(pairs[i].first, pose_this);
+      Triangle tb = Triangle::transform(meshp->_mesh->get_triangle(pairs[i].second, pose_p), T);
+      if (CompGeom::query_intersect_tri_tri(ta, tb))
       {
-        FILE_LOG(LOG_COLDET) << " -- internal BV " << bv << " and line segment intersect; testing " << bv->children.size() << " child OBB nodes" << std::endl;
-        BOOST_FOREACH(BVPtr child, bv->children)
-        {
-          FILE_LOG(LOG_COLDET) << "    -- child: " << child << std::endl;
-          S.push(child);
-        }
+        Point3d cpb;
+        Triangle::calc_sq_dist(ta, tb, pthis, cpb);
+        pprimitive = Tinv.transform_point(cpb);
+        return (double) 0.0;
       }
     }
   }
 
-  // look for valid intersection
-  t = tfirst;
-
-  FILE_LOG(LOG_COLDET) << "# of BV / line segment tests: " << n_bv_tests << endl;
-  FILE_LOG(LOG_COLDET) << "# of tri / line segment tests: " << n_tri_tests << endl;
-
-  return (tfirst > -NEAR_ZERO && tfirst < 1.0 + NEAR_ZERO);
+  return min_dist;
 }
 
-/// Gets vertices corresponding to the bounding volume
-void TriangleMeshPrimitive::get_vertices(BVPtr bv, vector<const Point3d*>& vertices) 
-{
-  // get the vertices for this geometry
-  vector<Point3d>& verts = _vertices[bv->geom];
-
-  // get the mesh covered by the BV
-  map<BVPtr, list<unsigned> >::const_iterator v_iter = _mesh_vertices.find(bv);
-  const list<unsigned>& vlist = v_iter->second;
-
-  // get the vertex indices
-  for (list<unsigned>::const_iterator i = vlist.begin(); i != vlist.end(); i++)
-    vertices.push_back(&verts[*i]);
-}
-*/
-
 /// Gets vertices corresponding to the bounding volume
 void TriangleMeshPrimitive::get_vertices(vector<Point3d>& vertices) 
 {
@@ -767,8 +659,9 @@ void TriangleMeshPrimitive::set_pose(const Pose3d& p)
 
   // reset mesh, vertices, and bounding volumes 
   _mesh.reset();
+  _flat_bvh.reset();
+  _asset.reset();
   _vertices.clear();
-  _mesh_vertices.clear();
   _roots.clear();
   _invalidated = true;
 
@@ -776,502 +669,3 @@ void TriangleMeshPrimitive::set_pose(const Pose3d& p)
   calc_mass_properties();
 }
 
-/****************************************************************************
- Methods for building bounding box trees begin 
-****************************************************************************/
-
-/// Builds an bounding volume tree (OBB or BoundingSphere) from an indexed triangle mesh using a top-down approach 
-/*
- * \return the root of the bounding box tree
- */
-void TriangleMeshPrimitive::build_BB_tree(CollisionGeometryPtr geom)
-{
-  const unsigned THREE_D = 3;
-  BVPtr child1, child2;
-
-  FILE_LOG(LOG_BV) << "TriangleMeshPrimitive::build_BB_tree() entered" << endl;
-
-  // clear any existing data for BVs for this geometry
-  BVPtr& geom_root = _roots[geom];
-  if (geom_root)
-  {
-    std::queue<BVPtr> q;
-    q.push(geom_root);
-    while (!q.empty())
-    {
-      // get the bv off of the front of the queue
-      BVPtr bv = q.front();
-      q.pop();
-
-      // add children of the bv to the queue
-      BOOST_FOREACH(BVPtr child, bv->children)
-        q.push(child);
-
-      // clear data associated with this bv
-      _mesh_tris.erase(bv);
-      _mesh_vertices.erase(bv);
-      _tris.erase(bv);
-    }
-  }
-
-  // get the vertices from the mesh
-  const vector<Origin3d>& verts = _mesh->get_vertices();
-
-  // get the geometry pose
-  shared_ptr<const Pose3d> gpose = geom->get_pose();
-
-  // get pose of this primitive
-  shared_ptr<const Pose3d> P = get_pose();
-
-  // setup transform
-  Transform3d T;
-  T.source = gpose;
-  T.target = gpose;
-  T.x = P->x;
-  T.q = P->q;
-
-  // transform the vertices into Point3d objects
-  vector<Point3d> vertices(verts.size());
-  for (unsigned i=0; i< verts.size(); i++)
-    vertices[i] = T.transform_point(Point3d(verts[i], gpose));
-
-  // build an BV around all vertices 
-  BVPtr root;
-  if (!is_deformable())
-    root = BVPtr(new OBB(vertices.begin(), vertices.end()));
-  else
-    root = BVPtr(new BoundingSphere(vertices.begin(), vertices.end()));
-
-  // point the root to the geometry
-  root->geom = geom;
-
-  // set root to point to all facet indices
-  list<unsigned> tris_idx;
-  for (unsigned i=0; i< _mesh->get_facets().size(); i++)
-    tris_idx.push_back(i);
-
-  // setup mapping from BV to mesh
-  _mesh_tris[root] = tris_idx;
-
-  FILE_LOG(LOG_BV) << "  -- created root: " << root << endl;
-
-  // add the root to a splitting queue
-  queue<BVPtr> Q;
-  Q.push(root);
-
-  // split until we can't split further
-  while (!Q.empty())
-  {
-    // get the bounding box off of the top of the queue
-    BVPtr bb = Q.front();
-    Q.pop();
-
-    FILE_LOG(LOG_BV) << "  -- splitting BV: " << bb << endl;
-
-    // split the bounding box across each of the three axes
-    for (unsigned i=0; i< 3; i++)
-    {
-      Vector3d axis(gpose);
-
-      // get the i'th column of R if an OBB
-      if (!is_deformable())
-      {
-        OBBPtr obb = dynamic_pointer_cast<OBB>(bb);
-        assert(obb);
-        obb->R.get_column(i, axis);
-      }
-      else
-      {
-        if (i == 0) axis = Vector3d(1,0,0,gpose);
-        else if (i == 1) axis = Vector3d(0,1,0,gpose);
-        else axis = Vector3d(0,0,1,gpose); 
-      }
-
-      // split the bounding box across the axis
-      if (split(_mesh, bb, child1, child2, axis))
-        break;
-    }
-
-    // make sure that this BV was divisible
-    if (!child1)
-      continue;
-
-    // child was divisible; remove thick triangles
-    _tris.erase(bb);
-
-    // setup child pointers
-    bb->children.push_back(child1);
-    bb->children.push_back(child2);
-
-    // get lists of triangles for children
-    assert(_mesh_tris.find(child1) != _mesh_tris.end());
-    assert(_mesh_tris.find(child2) != _mesh_tris.end());
-    const std::list<unsigned>& c1tris = _mesh_tris.find(child1)->second;
-    const std::list<unsigned>& c2tris = _mesh_tris.find(child2)->second;
-
-    // create thick triangles for child1
-    list<shared_ptr<AThickTri> >& ttris1 = _tris[child1];
-    BOOST_FOREACH(unsigned idx, c1tris)
-    {
-      try
-      {
-        ttris1.push_back(shared_ptr<AThickTri>(new AThickTri(_mesh->get_triangle(idx, get_pose()), 0.0)));
-        ttris1.back()->mesh = _mesh;
-        ttris1.back()->tri_idx = idx;
-      }
-      catch (NumericalException e)
-      {
-        // we won't do anything...  we just won't add the triangle
-      }
-    }
-    
-    // create thick triangles for child2
-    list<shared_ptr<AThickTri> >& ttris2 = _tris[child2];
-    BOOST_FOREACH(unsigned idx, c2tris)
-    {
-      try
-      {
-        ttris2.push_back(shared_ptr<AThickTri>(new AThickTri(_mesh->get_triangle(idx, get_pose()), 0.0)));
-        ttris2.back()->mesh = _mesh;
-        ttris2.back()->tri_idx = idx;
-      }
-      catch (NumericalException e)
-      {
-        // we won't do anything...  we just won't add the triangle
-      }
-    }
-
-    // add children to the queue for processing if they have more than one tri
-    if (c1tris.size() > 1)
-      Q.push(child1);
-    if (c2tris.size() > 1)
-      Q.push(child2);
-
-    FILE_LOG(LOG_BV) << "  -- built children " << child1 << ", " << child2 << " from " << bb << endl;
-    FILE_LOG(LOG_BV) << "  -- ID: " << child1 << endl;
-    FILE_LOG(LOG_BV) << "  -- ID: " << child2 << endl;
-  }
-
-  // now, collapse the tree
-  Q.push(root);
-  while (!Q.empty())
-  {
-    // for any children with a greater volume than the obb in question,
-    // remove the grandchildren and add them as children
-    BVPtr bb = Q.front();
-    double vol = bb->calc_volume();
-    bool erased_one = false;
-    for (list<BVPtr>::iterator i = bb->children.begin(); i != bb->children.end(); )
-    {
-      // get the volume of this child
-      double voli = (*i)->calc_volume();
-      if (!(*i)->is_leaf() && voli > vol + NEAR_ZERO)
-      {
-        erased_one = true;
-        BOOST_FOREACH(BVPtr gchild, (*i)->children)
-          bb->children.push_back(gchild);
-        i = (*i)->children.erase(i);
-      }
-      else
-        i++;
-    }
-
-    if (!erased_one)
-    {
-      Q.pop();
-      BOOST_FOREACH(BVPtr child, bb->children)
-        if (!child->is_leaf())
-          Q.push(child);
-    }
-  }
-
-  Q.push(root);
-  while (!Q.empty())
-  {
-    // get the element off of the front of the queue
-    BVPtr bb = Q.front();
-    Q.pop();
-
-    // fatten the bounding volume
-    if (!is_deformable())
-    {
-      // cast it to an OBB
-      OBBPtr obb = dynamic_pointer_cast<OBB>(bb);
-      assert(obb);
-    }
-    else
-    {
-      // cast it to a bounding sphere
-      shared_ptr<BoundingSphere> bs = dynamic_pointer_cast<BoundingSphere>(bb);
-      assert(bs);
-    }
-
-    // add all children to the queue
-    if (!bb->is_leaf())
-    {
-      BOOST_FOREACH(BVPtr child, bb->children)
-        Q.push(child);
-    }
-
-    // wipe out userdata
-    bb->userdata = shared_ptr<void>();
-  }
-
-  // save the root
-  geom_root = root;
-
-  // output how many triangles are in each bounding box
-  if (LOGGING(LOG_BV))
-  {
-    stack<pair<BVPtr, unsigned> > S;
-    S.push(make_pair(root, 0));
-    while (!S.empty())
-    {
-      // get the node off of the top of the stack
-      BVPtr node = S.top().first;
-      unsigned depth = S.top().second;
-      S.pop();
-      
-      // get the triangles in this BV
-      const list<unsigned>& tris = _mesh_tris.find(node)->second;
-      std::ostringstream out;
-      for (unsigned i=0; i< depth; i++)
-        out << " ";
-      out << "triangles covered by BV: " << tris.size() << endl;
-      FILE_LOG(LOG_BV) << out.str();
-
-      // put all children onto the stack
-      BOOST_FOREACH(BVPtr child, node->children)
-        S.push(make_pair(child, depth+1));
-    }
-  }
-
-  // build set of mesh vertices
-  construct_mesh_vertices(_mesh, geom, gpose);
-
-  FILE_LOG(LOG_BV) << "Primitive::build_BB_tree() exited" << endl;
-}
-
-/// Creates the set of mesh vertices
-void TriangleMeshPrimitive::construct_mesh_vertices(shared_ptr<const IndexedTriArray> mesh, CollisionGeometryPtr geom, shared_ptr<const Pose3d> P)
-{
-  const unsigned EDGES_PER_TRI = 3;
-
-/*
-  // get the sets of vertices and facets from the mesh
-  const vector<Origin3d>& mesh_vertices = mesh->get_vertices();
-  const vector<IndexedTri>& mesh_facets = mesh->get_facets();
-
-  // also, we'll need the vertex-to-facet map
-  vector<list<unsigned> > vf_map = mesh->determine_vertex_facet_map();
-
-  // create a new vector of vertices
-  vector<Point3d>& vertices = _vertices[geom];
-  vertices.resize(mesh_vertices.size());
-  for (unsigned i=0; i< mesh_vertices.size(); i++)
-    vertices[i] = Point3d(mesh_vertices[i], P);
-
-  // now, modify the vertices based on the intersection tolerance
-  for (unsigned i=0; i< mesh_vertices.size(); i++)
-  {
-    // get list of facets indicent to vertex i
-    const list<unsigned>& ifacets = vf_map[i];
-
-    // setup the current normal
-    Vector3d normal = Vector3d::zero(P);
-
-    // add all coincident normals together, then normalize
-    BOOST_FOREACH(unsigned j, ifacets)
-      normal += mesh->get_triangle(j, P).calc_normal();
-
-    // if we can't normalize, skip this vertex 
-    if (normal.norm() < NEAR_ZERO)
-      continue;
-
-    // otherwise, normalize the normal and add intersection tolerance (in dir
-    // of normal) to vertex i
-    normal.normalize();
-  }
-
-  // now, add additional samples based on edges in the mesh
-  map<sorted_pair<unsigned>, list<unsigned> > edge_subsamples;
-  for (unsigned i=0; i< mesh_facets.size(); i++)
-  {
-    // setup sorted pairs for the three edges
-    sorted_pair<unsigned> e[EDGES_PER_TRI];
-    e[0] = make_sorted_pair(mesh_facets[i].a, mesh_facets[i].b);
-    e[1] = make_sorted_pair(mesh_facets[i].b, mesh_facets[i].c);
-    e[2] = make_sorted_pair(mesh_facets[i].c, mesh_facets[i].a);
-
-    // check the three edges
-    for (unsigned j=0; j< EDGES_PER_TRI; j++)
-    {
-      if (edge_subsamples.find(e[j]) == edge_subsamples.end())
-      {
-        // edge does not already exist..  add vertices as necessary
-        list<unsigned>& ess = edge_subsamples[e[j]];
-
-        // subdivide edge to create new vertices as necessary
-        queue<sorted_pair<unsigned> > q;
-        q.push(e[j]);
-        while (!q.empty())
-        {
-          // get the two vertices of the "edge"
-          unsigned vi = q.front().first;
-          unsigned vj = q.front().second;
-          q.pop();
-          const Point3d& v1 = vertices[vi];
-          const Point3d& v2 = vertices[vj];
-
-          // subdivide, adding a vertex as necessary
-          if ((v1-v2).norm() > _edge_sample_length)
-          {
-            unsigned vk = vertices.size();
-            vertices.push_back((v1+v2) * (double) 0.5);
-            ess.push_back(vk);
-            q.push(make_sorted_pair(vi,vk));
-            q.push(make_sorted_pair(vk,vj));
-          }
-        }
-      }
-    }
-  }
-
-  // iterate over all mesh triangles
-  for (map<BVPtr, list<unsigned> >::const_iterator i = _mesh_tris.begin(); i != _mesh_tris.end(); i++)
-  {
-    // get the list of facets
-    const list<unsigned>& covered_facets = i->second;
-
-    // create the list of vertices for this BV
-    list<unsigned>& vlist = _mesh_vertices[i->first];
-
-    // get the edges referenced by each facet
-    BOOST_FOREACH(unsigned j, covered_facets)
-    {
-      // add vertices a, b, c of the covered facet to the list
-      vlist.push_back(mesh_facets[j].a);
-      vlist.push_back(mesh_facets[j].b);
-      vlist.push_back(mesh_facets[j].c);
-
-      // add all vertex samples to the list
-      sorted_pair<unsigned> e[EDGES_PER_TRI];
-      e[0] = make_sorted_pair(mesh_facets[j].a, mesh_facets[j].b);
-      e[1] = make_sorted_pair(mesh_facets[j].b, mesh_facets[j].c);
-      e[2] = make_sorted_pair(mesh_facets[j].c, mesh_facets[j].a);
-      for (unsigned k=0; k< EDGES_PER_TRI; k++)
-      {
-        assert(edge_subsamples.find(e[k]) != edge_subsamples.end());
-        const list<unsigned>& ess = edge_subsamples[e[k]];
-        vlist.insert(vlist.end(), ess.begin(), ess.end());
-      }
-    }
-  }
-*/
-}
-
-/// Splits a collection of triangles along a splitting plane into 2 new meshes 
-void TriangleMeshPrimitive::split_tris(const Point3d& point, const Vector3d& normal, const IndexedTriArray& orig_mesh, const list<unsigned>& ofacets, list<unsigned>& pfacets, list<unsigned>& nfacets) 
-{
-  // get original vertices and facets
-  const vector<Origin3d>& vertices = orig_mesh.get_vertices();
-  const vector<IndexedTri>& facets = orig_mesh.get_facets();
-
-  // determine the splitting plane: ax + by + cz = d
-  double offset = Vector3d::dot(point, normal);
-
-  // determine the side of the splitting plane of the triangles
-  Plane plane(normal, offset);
-  BOOST_FOREACH(unsigned i, ofacets)
-  {
-    // setup the vertices in the same pose as the normal
-    Point3d pa(vertices[facets[i].a], normal.pose);
-    Point3d pb(vertices[facets[i].b], normal.pose);
-    Point3d pc(vertices[facets[i].c], normal.pose);
-
-    // get the three signed distances
-    double sa = plane.calc_signed_distance(pa);
-    double sb = plane.calc_signed_distance(pb);
-    double sc = plane.calc_signed_distance(pc);
-    double min_s = std::min(sa, std::min(sb, sc));
-    double max_s = std::max(sa, std::max(sb, sc));    
-
-    // see whether we can cleanly put the triangle into one side
-    if (min_s > 0)
-      pfacets.push_back(i);
-    else if (max_s < 0)
-      nfacets.push_back(i);
-    else
-    {
-      // triangle is split down the middle; get its centroid
-      Triangle tri(pa, pb, pc);
-      Point3d tri_centroid = tri.calc_centroid();
-      double scent = plane.calc_signed_distance(tri_centroid);
-      if (scent > 0)
-        pfacets.push_back(i);
-      else
-        nfacets.push_back(i);
-    }
-  }
-}
-
-/// Splits a bounding box  along a given axis into two new bounding boxes; returns true if split successful
-bool TriangleMeshPrimitive::split(shared_ptr<const IndexedTriArray> mesh, shared_ptr<BV> source, shared_ptr<BV>& tgt1, shared_ptr<BV>& tgt2, const Vector3d& axis) 
-{
-  // setup two lists of triangles
-  list<unsigned> ptris, ntris;
-
-  // clear both targets
-  tgt1 = shared_ptr<BV>();
-  tgt2 = shared_ptr<BV>();
-
-  // get the mesh and the list of triangles
-  assert(_mesh_tris.find(source) != _mesh_tris.end());
-  const list<unsigned>& tris = _mesh_tris.find(source)->second;
-
-  // make sure that not trying to split a single triangle
-  assert(tris.size() > 1); 
-
-  // determine the centroid of this set of triangles
-  list<Triangle> t_tris;
-  BOOST_FOREACH(unsigned idx, tris)
-    t_tris.push_back(mesh->get_triangle(idx, source->get_relative_pose())); 
-  Point3d centroid = CompGeom::calc_centroid_3D(t_tris.begin(), t_tris.end());
-
-  // get the side of the splitting plane of the triangles
-  split_tris(centroid, axis, *mesh, tris, ptris, ntris);
-  if (ptris.empty() || ntris.empty())
-    return false;
-
-  // get vertices from both meshes
-  vector<Point3d> pverts, nverts;
-  get_vertices(*mesh, ptris.begin(), ptris.end(), std::back_inserter(pverts), centroid.pose);
-  get_vertices(*mesh, ntris.begin(), ntris.end(), std::back_inserter(nverts), centroid.pose);
-
-  // create two new BVs 
-  if (!is_deformable())
-  {
-    tgt1 = OBBPtr(new OBB(pverts.begin(), pverts.end()));
-    tgt2 = OBBPtr(new OBB(nverts.begin(), nverts.end()));
-  }
-  else
-  {
-    tgt1 = shared_ptr<BoundingSphere>(new BoundingSphere(pverts.begin(), pverts.end()));
-    tgt2 = shared_ptr<BoundingSphere>(new BoundingSphere(nverts.begin(), nverts.end()));
-  }
-
-  // setup geometry pointers
-  tgt1->geom = source->geom;
-  tgt2->geom = source->geom;
-
-  // setup mesh data for the BVs
-  _mesh_tris[tgt1] = ptris;
-  _mesh_tris[tgt2] = ntris;
-
-  return true;
-}
-
-/****************************************************************************
- Methods for building bounding box trees end 
-****************************************************************************/
-
@@ -7,7 +7,6 @@
 #include <dlfcn.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <errno.h>
 #include <fstream>
 #include <iostream>
 #include <stack>
@@ -63,52 +62,19 @@ using boost::dynamic_pointer_cast;
  */
 bool URDFReader::read(const string& fname, std::string& name, vector<RigidBodyPtr>& links, vector<JointPtr>& joints)
 {
-  // *************************************************************
-  // going to remove any path from the argument and change to that
-  // path; this is done so that all files referenced from the
-  // local path of the XML file are found
-  // *************************************************************
-
-  // set the filename to use as the argument, by default
-  string filename = fname;
-
-  // get the current pathname
-  size_t BUFSIZE = 8192;
-  boost::shared_array<char> cwd;
-  while (true)
-  {
-    cwd = boost::shared_array<char>((new char[BUFSIZE]));
-    if (getcwd(cwd.get(), BUFSIZE) == cwd.get())
-      break;
-    if (errno != ERANGE)
-    {
-      std::cerr << "URDFReader::read() - unable to allocate sufficient memory!" << std::endl;
-      return false;
-    }
-    BUFSIZE *= 2;
-  }
-
-  // separate the path from the filename
+  // get the directory of the file; files referenced from the URDF file
+  // are found relative to it
+  string directory;
   size_t last_path_sep = fname.find_last_of('/');
   if (last_path_sep != string::npos)
-  {
-    // get the new working path
-    string pathname = fname.substr(0,last_path_sep+1);
-
-    // change to the new working path
-    chdir(pathname.c_str());
-
-    // get the new filename
-    filename = fname.substr(last_path_sep+1,string::npos);
-  }
+    directory = fname.substr(0,last_path_sep+1);
 
   // read the XML Tree 
-  shared_ptr<const XMLTree> tree = XMLTree::read_from_xml(filename);
+  shared_ptr<const XMLTree> tree = XMLTree::read_from_xml(fname);
   if (!tree)
   {
     std::cerr << "URDFReader::read() - unable to open file " << fname;
     std::cerr << " for reading" << std::endl;
-    chdir(cwd.get());
     return false;
   }
   
@@ -124,6 +90,7 @@ bool URDFReader::read(const string& fname, std::string& name, vector<RigidBodyPt
   if (strcasecmp(tree->name.c_str(), "Robot") == 0)
   {
     URDFData data;
+    data.directory = directory;
     if (!read_robot(tree, data, name, links, joints))
       return false;
   }
@@ -133,9 +100,6 @@ bool URDFReader::read(const string& fname, std::string& name, vector<RigidBodyPt
     return false;
   }
 
-  // change back to the initial working directory
-  chdir(cwd.get());
-
   return true;
 }
 
@@ -663,7 +627,7 @@ bool URDFReader::read_texture(shared_ptr<const XMLTree> node, URDFData& data, st
       XMLAttrib* tfname_attrib = (*i)->get_attrib("filename");
       if (tfname_attrib)
       {
-        texture_fname = tfname_attrib->get_string_value();
+        texture_fname = data.get_path(tfname_attrib->get_string_value());
         return true;
       }
       else
@@ -873,7 +837,7 @@ shared_ptr<TriangleMeshPrimitive> URDFReader::read_trimesh(shared_ptr<const XMLT
         std::cerr << "URDFReader::read_trimesh() warning- 'scale' attribute is not used" << std::endl;
 
       // construct the triangle mesh primitive 
-      return shared_ptr<TriangleMeshPrimitive>(new TriangleMeshPrimitive(filename_attrib->get_string_value(),false));
+      return shared_ptr<TriangleMeshPrimitive>(new TriangleMeshPrimitive(data.get_path(filename_attrib->get_string_value()),false));
     }
   }
 
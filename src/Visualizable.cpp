@@ -137,6 +137,24 @@ void Visualizable::update_visualization()
   Pose3d T0 = *T;
   T0.update_relative_pose(GLOBAL);
 
+  // update the transform
+  set_visualization_transform(T0);
+  #endif
+}
+
+/// Sets the transform in the scenegraph from a pose relative to the global frame
+/**
+ * Unlike update_visualization(), this method does not read the pose of
+ * this object, so it may be called from a thread other than the one 
+ * that is updating the object (e.g., with a pose taken from a Snapshot).
+ */
+void Visualizable::set_visualization_transform(const Pose3d& T0)
+{
+  #ifdef USE_OSG
+  // if there is no visualization data, quit now
+  if (!_vizdata)
+    return;
+
   // update the transform
   osg::Matrixd m;
   to_osg_matrix(T0, m);
@@ -11,6 +11,7 @@
 #include <fstream>
 #include <stack>
 #include <queue>
+#include <libxml/xmlreader.h>
 
 #ifdef USE_OSG
 #include <Moby/OSGGroupWrapper.h>
@@ -26,6 +27,7 @@
 #include <Moby/CollisionGeometry.h>
 #include <Moby/BoxPrimitive.h>
 #include <Moby/GaussianMixture.h>
+#include <Moby/HeightfieldPrimitive.h>
 #include <Moby/SpherePrimitive.h>
 #include <Moby/CylinderPrimitive.h>
 #include <Moby/ConePrimitive.h>
@@ -54,77 +56,221 @@ using namespace Moby;
 
 /// Reads an XML file and constructs all read objects
 /**
+ * Relative paths in the file (e.g., to meshes and plugins) are resolved
+ * against the directory containing the file; the working directory of the
+ * process is never changed, so files may be read on several threads at once.
  * \return a map of IDs to read objects
  */
 std::map<std::string, BasePtr> XMLReader::read(const std::string& fname)
 {
-  // setup the list of IDs
-  std::map<std::string, BasePtr> id_map;
-  
-  // *************************************************************
-  // going to remove any path from the argument and change to that
-  // path; this is done so that all files referenced from the
-  // local path of the XML file are found
-  // *************************************************************
-
-  // set the filename to use as the argument, by default
-  std::string filename = fname;
-
-  // get the current pathname
-  size_t BUFSIZE = 8192;
-  boost::shared_array<char> cwd;
-  while (true)
-  {
-    cwd = boost::shared_array<char>((new char[BUFSIZE]));
-    if (getcwd(cwd.get(), BUFSIZE) == cwd.get())
-      break;
-    if (errno != ERANGE)
-    {
-      std::cerr << "XMLReader::read() - unable to allocate sufficient memory!" << std::endl;
-      return id_map;
-    }
-    BUFSIZE *= 2;
-  }
-
-  // separate the path from the filename
-  size_t last_path_sep = fname.find_last_of('/');
-  if (last_path_sep != std::string::npos)
-  {
-    // get the new working path
-    std::string pathname = fname.substr(0,last_path_sep+1);
-
-    // change to the new working path
-    chdir(pathname.c_str());
+  // read the tree
+  shared_ptr<XMLTree> moby_tree = read_tree(fname);
+  if (!moby_tree)
+    return std::map<std::string, BasePtr>();
 
-    // get the new filename
-    filename = fname.substr(last_path_sep+1,std::string::npos);
-  }
+  // construct all objects
+  return construct(moby_tree);
+}
 
+/// Reads the moby tree of an XML file without constructing any objects
+/**
+ * Relative paths in the tree are made relative to the directory containing
+ * the file, so the tree may be used from any working directory.
+ * \return the moby tree, or a null pointer on error
+ */
+shared_ptr<XMLTree> XMLReader::read_tree(const std::string& fname)
+{
   // read the XML Tree 
-  shared_ptr<const XMLTree> root_tree = XMLTree::read_from_xml(filename);
+  shared_ptr<const XMLTree> root_tree = XMLTree::read_from_xml(fname);
   if (!root_tree)
   {
     std::cerr << "XMLReader::read() - unable to open file " << fname;
     std::cerr << " for reading" << std::endl;
-    chdir(cwd.get());
-    return id_map;
+    return shared_ptr<XMLTree>();
   }
 
- 
   // find the moby tree 
   shared_ptr<XMLTree> moby_tree = boost::const_pointer_cast<XMLTree>(find_subtree(root_tree, "moby"));
 
-  // mark the moby root as processed
-  moby_tree->processed = true;
-
    // make sure that the Moby node was found
   if (!moby_tree)
   {
     std::cerr << "XMLReader::read() - no moby tag found!" << std::endl;
-    chdir(cwd.get());
+    return moby_tree;
+  }
+
+  // make all paths in the tree relative to the XML file
+  resolve_paths(moby_tree, get_directory(fname));
+
+  return moby_tree;
+}
+
+/// Constructs all objects described by a moby tree 
+/**
+ * \note the tree is marked as it is processed, so a tree can only be used 
+ *       to construct objects once
+ * \return a map of IDs to read objects
+ */
+std::map<std::string, BasePtr> XMLReader::construct(shared_ptr<XMLTree> moby_tree)
+{
+  // setup the list of IDs
+  std::map<std::string, BasePtr> id_map;
+
+  // mark the moby root as processed
+  moby_tree->processed = true;
+
+  // construct all objects 
+  process_tags(moby_tree, id_map);
+
+  // output unprocessed tags / attributes
+  report_unprocessed(moby_tree);
+
+  return id_map;
+}
+
+/// Reads an XML file in a streaming manner and constructs all read objects
+/**
+ * Unlike read(), this method never holds the XML tree of the entire file in
+ * memory: the file is parsed incrementally and each child of the moby tag 
+ * is converted to a tree, used to construct its objects, and then discarded
+ * before the next child is parsed. As a consequence, an object may only 
+ * refer (by ID) to objects defined in <i>earlier</i> children of the moby
+ * tag (or earlier within the same child).
+ * \return a map of IDs to read objects
+ */
+std::map<std::string, BasePtr> XMLReader::read_streaming(const std::string& fname)
+{
+  // setup the list of IDs
+  std::map<std::string, BasePtr> id_map;
+
+  // get the directory that paths are relative to
+  const std::string DIR = get_directory(fname);
+
+  // open the file
+  XMLTree::init_parser();
+  xmlTextReaderPtr reader = xmlReaderForFile(fname.c_str(), NULL, 0);
+  if (!reader)
+  {
+    std::cerr << "XMLReader::read_streaming() - unable to open file " << fname;
+    std::cerr << " for reading" << std::endl;
     return id_map;
   }
 
+  // parse the file
+  int moby_depth = -1;
+  int status = xmlTextReaderRead(reader);
+  while (status == 1)
+  {
+    // only elements are of interest
+    const int DEPTH = xmlTextReaderDepth(reader);
+    if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT)
+    {
+      // see whether we have left the moby tag
+      if (moby_depth >= 0 && DEPTH <= moby_depth)
+        break;
+      status = xmlTextReaderRead(reader);
+      continue;
+    }
+
+    // look for the moby tag
+    if (moby_depth < 0)
+    {
+      const char* name = (const char*) xmlTextReaderConstLocalName(reader);
+      if (name && strcasecmp(name, "moby") == 0)
+      {
+        moby_depth = DEPTH;
+        if (xmlTextReaderIsEmptyElement(reader))
+          break;
+      }
+      status = xmlTextReaderRead(reader);
+      continue;
+    }
+
+    // see whether we have left the moby tag
+    if (DEPTH <= moby_depth)
+      break;
+
+    // expand the child of the moby tag, then construct its objects
+    xmlNode* node = xmlTextReaderExpand(reader);
+    if (!node)
+    {
+      status = -1;
+      break;
+    }
+    shared_ptr<XMLTree> tree = boost::const_pointer_cast<XMLTree>(XMLTree::construct_xml_tree(node));
+    tree->processed = true;
+    resolve_paths(tree, DIR);
+    process_tags(tree, id_map);
+    report_unprocessed(tree);
+
+    // move past the child (this releases its nodes)
+    status = xmlTextReaderNext(reader);
+  }
+
+  // close the file
+  xmlFreeTextReader(reader);
+
+  // look for errors
+  if (status < 0)
+    std::cerr << "XMLReader::read_streaming() - error parsing " << fname << std::endl;
+  else if (moby_depth < 0)
+    std::cerr << "XMLReader::read_streaming() - no moby tag found!" << std::endl;
+
+  return id_map;
+}
+
+/// Gets the directory (including the trailing separator) containing a file
+std::string XMLReader::get_directory(const std::string& fname)
+{
+  size_t last_path_sep = fname.find_last_of('/');
+  return (last_path_sep == std::string::npos) ? std::string() : fname.substr(0, last_path_sep+1);
+}
+
+/// Makes the relative paths in attributes of a tree relative to a directory
+/**
+ * Path attributes are "filename", "plugin", and any attribute whose name ends
+ * in "-filename". Absolute paths are left unchanged.
+ */
+void XMLReader::resolve_paths(shared_ptr<XMLTree> root, const std::string& dir)
+{
+  const std::string SUFFIX = "-filename";
+
+  // nothing to do if the directory is the working directory
+  if (dir.empty())
+    return;
+
+  // process the tree
+  std::queue<shared_ptr<XMLTree> > q;
+  q.push(root);
+  while (!q.empty())
+  {
+    // get the node off the front of the queue
+    shared_ptr<XMLTree> node = q.front();
+    q.pop();
+
+    // look for path attributes; NOTE: the value of an attribute is not used
+    // for ordering, so it may be changed in place
+    BOOST_FOREACH(const XMLAttrib& a, node->attribs)
+    {
+      const std::string& name = a.name;
+      if (strcasecmp(name.c_str(), "filename") != 0 && 
+          strcasecmp(name.c_str(), "plugin") != 0 &&
+          (name.size() <= SUFFIX.size() || strcasecmp(name.c_str() + name.size() - SUFFIX.size(), SUFFIX.c_str()) != 0))
+        continue;
+      if (a.value.empty() || a.value[0] == '/')
+        continue;
+      ((XMLAttrib&) a).value = dir + a.value;
+    }
+
+    // add all children to the queue
+    BOOST_FOREACH(XMLTreePtr child, node->children)
+      q.push(child);
+  }
+}
+
+/// Constructs the objects described in a tree
+void XMLReader::process_tags(shared_ptr<const XMLTree> tree, std::map<std::string, BasePtr>& id_map)
+{
   // ********************************************************************
   // NOTE: read_from_xml() (via process_tag()) treats all nodes at the
   // same level; it is irrelevant to it whether a RigidBody is
@@ -134,63 +280,64 @@ std::map<std::string, BasePtr> XMLReader::read(const std::string& fname)
   // ********************************************************************
 
   // read and construct all primitives
-  process_tag("Box", moby_tree, &read_box, id_map);
-  process_tag("Sphere", moby_tree, &read_sphere, id_map);
-  process_tag("Cylinder", moby_tree, &read_cylinder, id_map);
-  process_tag("Cone", moby_tree, &read_cone, id_map);
-  process_tag("TriangleMesh", moby_tree, &read_trimesh, id_map);
-  process_tag("TetraMesh", moby_tree, &read_tetramesh, id_map);
-  process_tag("GaussianMixture", moby_tree, &read_gaussian_mixture, id_map);
-  process_tag("PrimitivePlugin", moby_tree, &read_primitive_plugin, id_map);
-  process_tag("CSG", moby_tree, &read_CSG, id_map);
+  process_tag("Box", tree, &read_box, id_map);
+  process_tag("Sphere", tree, &read_sphere, id_map);
+  process_tag("Cylinder", tree, &read_cylinder, id_map);
+  process_tag("Cone", tree, &read_cone, id_map);
+  process_tag("TriangleMesh", tree, &read_trimesh, id_map);
+  process_tag("TetraMesh", tree, &read_tetramesh, id_map);
+  process_tag("GaussianMixture", tree, &read_gaussian_mixture, id_map);
+  process_tag("Heightfield", tree, &read_heightfield, id_map);
+  process_tag("PrimitivePlugin", tree, &read_primitive_plugin, id_map);
+  process_tag("CSG", tree, &read_CSG, id_map);
 
   // read and construct all integrators
-  process_tag("EulerIntegrator", moby_tree, &read_euler_integrator, id_map);
-  process_tag("VariableEulerIntegrator", moby_tree, &read_variable_euler_integrator, id_map);
-  process_tag("BulirschStoerIntegrator", moby_tree, &read_bulirsch_stoer_integrator, id_map);
-  process_tag("RungeKuttaIntegrator", moby_tree, &read_rk4_integrator, id_map);
-  process_tag("RungeKuttaFehlbergIntegrator", moby_tree, &read_rkf4_integrator, id_map);
-  process_tag("RungeKuttaImplicitIntegrator", moby_tree, &read_rk4i_integrator, id_map);
-  process_tag("ODEPACKIntegrator", moby_tree, &read_odepack_integrator, id_map);
+  process_tag("EulerIntegrator", tree, &read_euler_integrator, id_map);
+  process_tag("VariableEulerIntegrator", tree, &read_variable_euler_integrator, id_map);
+  process_tag("BulirschStoerIntegrator", tree, &read_bulirsch_stoer_integrator, id_map);
+  process_tag("RungeKuttaIntegrator", tree, &read_rk4_integrator, id_map);
+  process_tag("RungeKuttaFehlbergIntegrator", tree, &read_rkf4_integrator, id_map);
+  process_tag("RungeKuttaImplicitIntegrator", tree, &read_rk4i_integrator, id_map);
+  process_tag("ODEPACKIntegrator", tree, &read_odepack_integrator, id_map);
 
   // read and construct all recurrent forces (except damping)
-  process_tag("GravityForce", moby_tree, &read_gravity_force, id_map);
-  process_tag("StokesDragForce", moby_tree, &read_stokes_drag_force, id_map);
+  process_tag("GravityForce", tree, &read_gravity_force, id_map);
+  process_tag("StokesDragForce", tree, &read_stokes_drag_force, id_map);
 
   #ifdef USE_OSG
   // read and construct all OSGGroupWrapper objects
-  process_tag("OSGGroup", moby_tree, &read_osg_group, id_map);
+  process_tag("OSGGroup", tree, &read_osg_group, id_map);
   #endif
 
   // read and construct all rigid bodies (including articulated body links)
-  process_tag("RigidBody", moby_tree, &read_rigid_body, id_map);
+  process_tag("RigidBody", tree, &read_rigid_body, id_map);
 
   // read and construct all joints -- we do this after the links have been read
-  process_tag("RevoluteJoint", moby_tree, &read_revolute_joint, id_map);
-  process_tag("PrismaticJoint", moby_tree, &read_prismatic_joint, id_map);
-  process_tag("SphericalJoint", moby_tree, &read_spherical_joint, id_map);
-  process_tag("UniversalJoint", moby_tree, &read_universal_joint, id_map);
-  process_tag("FixedJoint", moby_tree, &read_fixed_joint, id_map);
-  process_tag("JointPlugin", moby_tree, &read_joint_plugin, id_map);
+  process_tag("RevoluteJoint", tree, &read_revolute_joint, id_map);
+  process_tag("PrismaticJoint", tree, &read_prismatic_joint, id_map);
+  process_tag("SphericalJoint", tree, &read_spherical_joint, id_map);
+  process_tag("UniversalJoint", tree, &read_universal_joint, id_map);
+  process_tag("FixedJoint", tree, &read_fixed_joint, id_map);
+  process_tag("JointPlugin", tree, &read_joint_plugin, id_map);
 
   // read and construct all articulated bodies
-//  process_tag("MCArticulatedBody", moby_tree, &read_mc_abody, id_map);
-  process_tag("RCArticulatedBody", moby_tree, &read_rc_abody, id_map);
-  process_tag("RCArticulatedBodySymbolicPlugin", moby_tree, &read_rc_abody_symbolic, id_map);
+//  process_tag("MCArticulatedBody", tree, &read_mc_abody, id_map);
+  process_tag("RCArticulatedBody", tree, &read_rc_abody, id_map);
+  process_tag("RCArticulatedBodySymbolicPlugin", tree, &read_rc_abody_symbolic, id_map);
 
   // damping forces must be constructed after bodies
-  process_tag("DampingForce", moby_tree, &read_damping_force, id_map);
+  process_tag("DampingForce", tree, &read_damping_force, id_map);
 
   // finally, read and construct the simulator objects -- must be done last
-  process_tag("Simulator", moby_tree, &read_simulator, id_map);
-  process_tag("EventDrivenSimulator", moby_tree, &read_event_driven_simulator, id_map);
-
-  // change back to the initial working directory
-  chdir(cwd.get());
+  process_tag("Simulator", tree, &read_simulator, id_map);
+  process_tag("EventDrivenSimulator", tree, &read_event_driven_simulator, id_map);
+}
 
-  // output unprocessed tags / attributes
+/// Outputs the tags and attributes of a tree that were not processed
+void XMLReader::report_unprocessed(shared_ptr<const XMLTree> root)
+{
   std::queue<shared_ptr<const XMLTree> > q;
-  q.push(moby_tree);
+  q.push(root);
   while (!q.empty())
   {
     // get the node off the front of the queue
@@ -213,8 +360,6 @@ std::map<std::string, BasePtr> XMLReader::read(const std::string& fname)
     BOOST_FOREACH(XMLTreePtr child, node->children)
       q.push(child);
   }
-
-  return id_map;
 }
 
 /// Finds and processes given tags
@@ -386,6 +531,19 @@ void XMLReader::read_gaussian_mixture(shared_ptr<const XMLTree> node, std::map<s
   b->load_from_xml(node, id_map);
 }
 
+/// Reads and constructs the HeightfieldPrimitive object
+void XMLReader::read_heightfield(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
+{  
+  // sanity check
+  assert(strcasecmp(node->name.c_str(), "Heightfield") == 0);
+
+  // create a new HeightfieldPrimitive object
+  boost::shared_ptr<Base> b(new HeightfieldPrimitive());
+  
+  // populate the object
+  b->load_from_xml(node, id_map);
+}
+
 /// Reads and constructs the BoxPrimitive object
 void XMLReader::read_box(shared_ptr<const XMLTree> node, std::map<std::string, BasePtr>& id_map)
 {  
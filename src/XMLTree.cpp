@@ -11,6 +11,9 @@
 #include <limits>
 #include <cmath>
 #include <sstream>
+#ifdef THREADSAFE
+#include <pthread.h>
+#endif
 #include <Ravelin/MatrixNd.h>
 #include <Moby/MissizeException.h>
 #include <Moby/XMLTree.h>
@@ -274,18 +277,38 @@ bool XMLAttrib::get_bool_value()
   }
 }
 
-shared_ptr<const XMLTree> XMLTree::read_from_xml(const std::string& fname)
+#ifdef THREADSAFE
+/// Initializes libxml2 (called only once)
+static void init_libxml()
 {
-  xmlDoc* doc;
-
-  // *************************************************************
-  // going to remove any path from the argument and change to that
-  // path; this is done so that all files referenced from the
-  // local path of the XML file are found
-  // *************************************************************
+  LIBXML_TEST_VERSION
+  xmlInitParser();
+}
+#endif
 
+/// Initializes the XML parser
+/**
+ * libxml2 must be initialized once before it is used from several threads;
+ * this is done on the first call to this method. 
+ */
+void XMLTree::init_parser()
+{
+  #ifdef THREADSAFE
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, &init_libxml);
+  #else
   // initialize the library and look for potential ABI mismatches
   LIBXML_TEST_VERSION
+  #endif
+}
+
+/// Reads an XML file into a tree 
+shared_ptr<const XMLTree> XMLTree::read_from_xml(const std::string& fname)
+{
+  xmlDoc* doc;
+
+  // initialize the library
+  init_parser();
 
   // open the file
   if ((doc = xmlReadFile(fname.c_str(), NULL, 0)) == NULL)
@@ -593,6 +616,41 @@ XMLTree::XMLTree(const std::string& name, const std::list<XMLAttrib>& attributes
   this->processed = false;
 }
 
+/// Makes a deep copy of this tree (the copy has no parent and no objects)
+XMLTreePtr XMLTree::clone() const
+{
+  XMLTreePtr copy(new XMLTree(name));
+  copy->id = id;
+  copy->directory = directory;
+  for (std::set<XMLAttrib>::const_iterator i = attribs.begin(); i != attribs.end(); i++)
+    copy->attribs.insert(XMLAttrib(i->name, i->value));
+  for (std::list<XMLTreePtr>::const_iterator i = children.begin(); i != children.end(); i++)
+    copy->add_child((*i)->clone());
+  return copy;
+}
+
+/// Gets the path of a file named relative to the document containing this tree
+/**
+ * Objects that write auxiliary files while being serialized name them 
+ * relative to the document; this gives the path at which to write them
+ * without changing the working directory.
+ * \return fname prefixed by the directory of the root of this tree (fname
+ *         itself if it is absolute or the root has no directory)
+ */
+std::string XMLTree::get_path(const std::string& fname) const
+{
+  // find the root of the tree
+  shared_ptr<const XMLTree> root;
+  for (shared_ptr<const XMLTree> node = _parent.lock(); node; node = node->get_parent().lock())
+    root = node;
+  const std::string& dir = (root) ? root->directory : directory;
+
+  // absolute paths are used as is
+  if (dir.empty() || fname.empty() || fname[0] == '/')
+    return fname;
+  return dir + fname;
+}
+
 /// Gets the specified attribute
 /**
  * \return a pointer to the attribute with the specified name, or NULL if the
@@ -4,7 +4,6 @@
  * License (found in COPYING).
  ****************************************************************************/
 
-#include <errno.h>
 #include <iostream>
 #include <fstream>
 #include <Moby/Base.h>
@@ -17,41 +16,16 @@ using namespace Moby;
 /// Serializes the given objects (and all dependencies) to XML
 void XMLWriter::serialize_to_xml(const std::string& fname, const std::list<shared_ptr<const Base> >& objects)
 {
-  // get the filename
-  std::string filename = fname;
-
-  // get the current path
-  size_t BUFSIZE = 8192;
-  boost::shared_array<char> cwd;
-  while (true)
-  {
-    cwd = boost::shared_array<char>((new char[BUFSIZE]));
-    if (getcwd(cwd.get(), BUFSIZE) == cwd.get())
-      break;
-    if (errno != ERANGE)
-    {
-      std::cerr << "XMLWriter::serialize_to_xml() - unable to allocate sufficient memory!" << std::endl;
-      return;
-    }
-    BUFSIZE *= 2;
-  }
-
-  // separate the path from the filename
+  // get the directory of the file; auxiliary files written by the objects
+  // are placed relative to it (see XMLTree::get_path())
+  std::string directory;
   size_t last_path_sep = fname.find_last_of('/');
   if (last_path_sep != std::string::npos)
-  {
-    // get the new working path
-    std::string pathname = fname.substr(0,last_path_sep+1);
-
-    // change to the new working path
-    chdir(pathname.c_str());
-
-    // get the new filename
-    filename = fname.substr(last_path_sep+1,std::string::npos);
-  }
+    directory = fname.substr(0,last_path_sep+1);
 
   // create a new XMLTree
   XMLTreePtr topnode(new XMLTree("XML"));
+  topnode->directory = directory;
 
   // create a node for Moby
   XMLTreePtr node(new XMLTree("Moby"));
@@ -87,56 +61,28 @@ void XMLWriter::serialize_to_xml(const std::string& fname, const std::list<share
   }
 
   // open the file for writing
-  std::ofstream out(filename.c_str());
+  std::ofstream out(fname.c_str());
 
   // write the tree to the file
   out << *topnode << std::endl;
 
   // close the file
   out.close();
-
-  // change back to the original directory (if any)
-  chdir(cwd.get());
 }
 
 /// Serializes the given object (and all of its dependencies) to XML
 void XMLWriter::serialize_to_xml(const std::string& fname, shared_ptr<const Base> object)
 {
-  // get the filename
-  std::string filename = fname;
-
-  // get the current path
-  size_t BUFSIZE = 8192;
-  boost::shared_array<char> cwd;
-  while (true)
-  {
-    cwd = boost::shared_array<char>((new char[BUFSIZE]));
-    if (getcwd(cwd.get(), BUFSIZE) == cwd.get())
-      break;
-    if (errno != ERANGE)
-    {
-      std::cerr << "XMLWriter::serialize_to_xml() - unable to allocate sufficient memory!" << std::endl;
-      return;
-    }
-    BUFSIZE *= 2;
-  }
-
-  // separate the path from the filename
+  // get the directory of the file; auxiliary files written by the objects
+  // are placed relative to it (see XMLTree::get_path())
+  std::string directory;
   size_t last_path_sep = fname.find_last_of('/');
   if (last_path_sep != std::string::npos)
-  {
-    // get the new working path
-    std::string pathname = fname.substr(0,last_path_sep+1);
-
-    // change to the new working path
-    chdir(pathname.c_str());
-
-    // get the new filename
-    filename = fname.substr(last_path_sep+1,std::string::npos);
-  }
+    directory = fname.substr(0,last_path_sep+1);
 
   // create a new XMLTree
   XMLTreePtr topnode(new XMLTree("XML"));
+  topnode->directory = directory;
 
   // create a node for Moby
   XMLTreePtr node(new XMLTree("Moby"));
@@ -175,15 +121,12 @@ void XMLWriter::serialize_to_xml(const std::string& fname, shared_ptr<const Base
   }
 
   // open the file for writing
-  std::ofstream out(filename.c_str());
+  std::ofstream out(fname.c_str());
 
   // write the tree to the file
   out << *topnode << std::endl;
 
   // close the file
   out.close();
-
-  // change back to the initial working directory
-  chdir(cwd.get());
 }
 